@@ -0,0 +1,201 @@
+/***********************************************************
+ *
+ * @file: headless_world.h
+ * @breif: Gazebo-free world stepping a kinematic robot and a social force model crowd on a static map
+ * @author: Yang Haodong
+ * @update: 2023-10-1
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#ifndef HEADLESS_SIM_HEADLESS_WORLD_H_
+#define HEADLESS_SIM_HEADLESS_WORLD_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <lightsfm/grid_map.hpp>
+
+#include "costmap_snapshot.h"
+#include "global_planner.h"
+#include "headless_sim/scenario.h"
+
+namespace headless_sim
+{
+/**
+ * @brief Settings of one navigation episode
+ */
+struct EpisodeOptions
+{
+  double dt = 0.05;        // simulation step [s]
+  double timeout = 120.0;  // simulated time before giving up [s]
+};
+
+/**
+ * @brief Outcome of one navigation episode
+ */
+struct EpisodeResult
+{
+  enum Status
+  {
+    REACHED,
+    TIMEOUT,
+    COLLISION,
+    NO_PATH
+  };
+
+  Status status = NO_PATH;
+  std::string collision;         // what the robot hit, empty if nothing
+  double sim_time = 0.0;         // simulated time [s]
+  double wall_time = 0.0;        // wall clock time [s]
+  double plan_length = 0.0;      // length of the first global plan [m]
+  double travelled = 0.0;        // distance driven by the robot [m]
+  double min_ped_distance = -1;  // closest approach of a pedestrian to the footprint, -1 without pedestrians
+  int plans = 0;                 // successful global plans
+  double planning_time = 0.0;    // wall clock time in the global planner [s]
+
+  /**
+   * @brief Name of a status as printed in the reports
+   */
+  static const char* statusName(Status status);
+};
+
+/**
+ * @brief A static map with the obstacles of the scenario, its inflated costmap and the episodes run on it.
+ *        Navigation follows move_base: the global planner plans on the static costmap (pedestrians are not part of
+ *        it) at planner_frequency and the PID core tracks the plan at controller_frequency.
+ */
+class HeadlessWorld
+{
+public:
+  /**
+   * @brief Construct a new HeadlessWorld object
+   * @param scenario scenario to simulate
+   */
+  explicit HeadlessWorld(const Scenario& scenario);
+
+  /**
+   * @brief Load the map, rasterize the static obstacles and inflate the costmap
+   * @param error         reason of a failure
+   * @param costmap_cache costmap snapshot mapped instead of inflating the costmap, written after inflating if it is
+   *                      missing or of another map (optional). Delete it when the inflation parameters change.
+   * @return true if successful, else false
+   */
+  bool load(std::string& error, const std::string& costmap_cache = "");
+
+  /**
+   * @brief Drive the robot from start to goal through the crowd of the scenario
+   * @param start   robot start pose
+   * @param goal    goal pose
+   * @param options episode settings
+   * @return the outcome of the episode
+   */
+  EpisodeResult run(const Pose2D& start, const Pose2D& goal, const EpisodeOptions& options);
+
+  /**
+   * @brief Check if the footprint fits at a pose without touching an cell any graph planner avoids
+   * @param pose robot pose
+   * @return true if free, else false
+   */
+  bool isFree(const Pose2D& pose) const;
+
+  /**
+   * @brief Check if the graph planners can connect two poses, i.e. if the goal is not in a closed room or unknown
+   *        space outside the map
+   * @param from start pose
+   * @param to   goal pose
+   * @return true if connected, else false
+   */
+  bool isReachable(const Pose2D& from, const Pose2D& to);
+
+  /**
+   * @brief Bounds of the map in the world frame
+   */
+  void getBounds(double& min_x, double& min_y, double& max_x, double& max_y) const;
+
+  /**
+   * @brief Check if a global planner can run headless
+   * @param name planner name as in user_config.yaml
+   * @return true if supported, else false
+   */
+  static bool isPlannerSupported(const std::string& name);
+
+  /**
+   * @brief Names of all global planners that can run headless
+   */
+  static const std::vector<std::string>& supportedPlanners();
+
+  /**
+   * @brief Create a global planner for the costmap with the parameters of the scenario
+   * @param name planner name as in user_config.yaml
+   * @return the planner, nullptr if it is not supported
+   */
+  std::unique_ptr<global_planner::GlobalPlanner> createPlanner(const std::string& name) const;
+
+  /**
+   * @brief Create a global planner for any costmap, e.g. of a plan record
+   * @param name       planner name as in user_config.yaml
+   * @param nx         pixel number in costmap x direction
+   * @param ny         pixel number in costmap y direction
+   * @param resolution costmap resolution
+   * @param cfg        planner parameters
+   * @return the planner, nullptr if it is not supported
+   */
+  static std::unique_ptr<global_planner::GlobalPlanner> createPlanner(const std::string& name, int nx, int ny,
+                                                                      double resolution, const PlannerConfig& cfg);
+
+  /**
+   * @brief Plan from start to goal on the costmap, like GraphPlanner::makePlan
+   * @param planner  global planner
+   * @param start    start position
+   * @param goal     goal position
+   * @param plan     plan points in the world frame, goal last
+   * @param expanded number of nodes the planner expanded (optional)
+   * @return true if a plan was found, else false
+   */
+  bool makePlan(global_planner::GlobalPlanner& planner, const Eigen::Vector2d& start, const Eigen::Vector2d& goal,
+                std::vector<Eigen::Vector2d>& plan, size_t* expanded = nullptr);
+
+private:
+
+  /**
+   * @brief Costmap index of the cell of a pose, -1 outside the map
+   */
+  int cellOf(const Pose2D& pose) const;
+
+  /**
+   * @brief Footprint polygon at a pose
+   */
+  std::vector<Eigen::Vector2d> footprintAt(const Pose2D& pose) const;
+
+  /**
+   * @brief Check if the footprint polygon overlaps an occupied map cell
+   */
+  bool hitsObstacle(const std::vector<Eigen::Vector2d>& footprint) const;
+
+  /**
+   * @brief Distance from a point to the footprint polygon and the closest polygon point, 0 inside
+   */
+  static double distanceToFootprint(const std::vector<Eigen::Vector2d>& footprint, const Eigen::Vector2d& point,
+                                    Eigen::Vector2d& closest);
+
+  Scenario scenario_;
+  sfm::GridMap map_;                    // occupancy with the static obstacles, for the pedestrians and collisions
+  std::vector<unsigned char> costmap_;  // costmap_2d cost values
+  global_planner::CostmapSnapshot costmap_cache_;  // or the costs mapped from a snapshot
+  unsigned char* costs_;                           // costs in use, of costmap_ or costmap_cache_
+  int nx_, ny_;
+  double resolution_, origin_x_, origin_y_;
+  double inscribed_radius_;
+
+  std::vector<bool> reachable_;  // cells connected to reachable_from_
+  int reachable_from_;
+};
+}  // namespace headless_sim
+
+#endif
@@ -0,0 +1,142 @@
+/***********************************************************
+ *
+ * @file: scenario.h
+ * @breif: Scenario of the headless simulator, read from the user_config and sim_env configure files
+ * @author: Yang Haodong
+ * @update: 2023-10-1
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#ifndef HEADLESS_SIM_SCENARIO_H_
+#define HEADLESS_SIM_SCENARIO_H_
+
+#include <string>
+#include <vector>
+
+namespace headless_sim
+{
+/**
+ * @brief A planar pose
+ */
+struct Pose2D
+{
+  double x = 0.0, y = 0.0, theta = 0.0;
+};
+
+/**
+ * @brief One entry of pedestrians/ped_property in pedestrian_config.yaml
+ */
+struct PedestrianConfig
+{
+  std::string name;
+  Pose2D pose;
+  double velocity = 0.8;
+  double radius = 0.35;
+  bool cycle = false;
+  double time_delay = 0.0;
+  std::vector<std::string> ignore;  // models this pedestrian does not avoid
+  std::vector<Pose2D> goals;
+};
+
+/**
+ * @brief One entry of obstacles in obstacles_config.yaml
+ */
+struct ObstacleConfig
+{
+  std::string type;  // BOX, CYLINDER or SPHERE
+  Pose2D pose;
+  double w = 0.0, d = 0.0;  // BOX size along its x and y
+  double r = 0.0;           // CYLINDER and SPHERE radius
+};
+
+/**
+ * @brief Social force model weights of pedestrian_config.yaml
+ */
+struct SocialForceConfig
+{
+  double people_distance = 5.0;
+  double goal_weight = 2.0;
+  double obstacle_weight = 10.0;
+  double social_weight = 2.1;
+  double group_gaze_weight = 3.0;
+  double group_coh_weight = 2.0;
+  double group_rep_weight = 1.0;
+};
+
+/**
+ * @brief Navigation settings of the robot, from sim_env/config
+ */
+struct RobotConfig
+{
+  std::string type;
+  std::string global_planner = "a_star";
+  std::string local_planner = "pid";
+  Pose2D pose;
+
+  std::vector<Pose2D> footprint;  // polygon in the base frame, theta unused
+  double inflation_radius = 0.55;
+  double cost_scaling_factor = 10.0;
+
+  double controller_frequency = 10.0;
+  double planner_frequency = 0.0;  // 0 plans once per goal like move_base
+
+  // pid_planner_params.yaml
+  double p_window = 0.5, p_precision = 0.2, o_precision = 0.5;
+  double max_v = 0.5, min_v = 0.0, max_v_inc = 0.5;
+  double max_w = 1.57, min_w = 0.0, max_w_inc = 1.57;
+  double k_v_p = 1.0, k_v_i = 0.01, k_v_d = 0.1;
+  double k_w_p = 1.0, k_w_i = 0.01, k_w_d = 0.1;
+  double k_theta = 0.5;
+};
+
+/**
+ * @brief Parameters of the global planners, from sim_env/config/planner
+ */
+struct PlannerConfig
+{
+  bool outline_map = true;  // graph_planner_params.yaml
+
+  // sample_planner_params.yaml
+  int sample_points = 500;
+  double sample_max_d = 5.0;
+  double optimization_r = 10.0;
+
+  // evolutionary_planner_params.yaml
+  int n_ants = 50;
+  double alpha = 1.0, beta = 5.0, rho = 0.1, Q = 1.0;
+  int max_iter = 100;
+  int n_particles = 50, n_inherited = 10, point_num = 5, max_speed = 40;
+  double w_inertial = 1.0, w_social = 2.0, w_cognitive = 1.2;
+  int init_pos_mode = 2, pso_max_iter = 30;
+};
+
+/**
+ * @brief Everything main.sh would put into the Gazebo world for the first robot
+ */
+struct Scenario
+{
+  std::string map_file;  // map_server yaml
+  RobotConfig robot;
+  PlannerConfig planner;
+  SocialForceConfig social_force;
+  std::vector<PedestrianConfig> pedestrians;
+  std::vector<ObstacleConfig> obstacles;
+};
+
+/**
+ * @brief Load a scenario like main.sh does
+ * @param user_config_dir directory of user_config.yaml and its plugin files
+ * @param sim_env_dir     directory of the sim_env package (maps and robot configures)
+ * @param scenario        the loaded scenario
+ * @param error           reason of a failure
+ * @return true if successful, else false
+ */
+bool loadScenario(const std::string& user_config_dir, const std::string& sim_env_dir, Scenario& scenario,
+                  std::string& error);
+}  // namespace headless_sim
+
+#endif
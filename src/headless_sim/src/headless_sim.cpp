@@ -0,0 +1,188 @@
+/***********************************************************
+ *
+ * @file: headless_sim.cpp
+ * @breif: Faster than real time navigation episodes through the pedestrians of user_config, without Gazebo, rviz or
+ *         roscore
+ * @author: Yang Haodong
+ * @update: 2023-10-1
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <lightsfm/sfm.hpp>
+
+#include "headless_sim/headless_world.h"
+
+namespace
+{
+const char* usage =
+    "usage: headless_sim [options]\n"
+    "  --user-config DIR       user_config.yaml and its plugin files (default: src/user_config)\n"
+    "  --sim-env DIR           sim_env package with maps and robot configures (default: src/sim_env)\n"
+    "  --planner NAME          global planner (default: robot1 global planner of user_config.yaml)\n"
+    "  --planner-frequency F   replanning rate [Hz], 0 plans once (default: move_base_params.yaml)\n"
+    "  --start X Y YAW         robot start pose (default: robot1 pose of user_config.yaml)\n"
+    "  --goal X Y YAW          goal pose (default: a random free pose per episode)\n"
+    "  --episodes N            number of episodes (default: 1)\n"
+    "  --seed S                seed of the random goals, episode k uses S + k (default: 0)\n"
+    "  --min-distance D        minimum start to random goal distance [m] (default: 3)\n"
+    "  --dt DT                 simulation step [s] (default: 0.05)\n"
+    "  --timeout T             simulated time limit of an episode [s] (default: 120)\n"
+    "One JSON object per episode is printed to stdout, the summary to stderr. The exit code is 0 if every episode\n"
+    "reached its goal, 1 if any did not and 2 on configure errors.\n";
+
+/**
+ * @brief Read three numbers following argv[i] into a pose
+ */
+bool parsePose(int argc, char** argv, int& i, headless_sim::Pose2D& pose)
+{
+  if (i + 3 >= argc)
+    return false;
+  pose.x = std::atof(argv[++i]);
+  pose.y = std::atof(argv[++i]);
+  pose.theta = std::atof(argv[++i]);
+  return true;
+}
+
+/**
+ * @brief A random pose the robot fits at and can reach, at least min_distance away from start
+ */
+bool randomGoal(headless_sim::HeadlessWorld& world, const headless_sim::Pose2D& start, double min_distance,
+                std::mt19937& rng, headless_sim::Pose2D& goal)
+{
+  double min_x, min_y, max_x, max_y;
+  world.getBounds(min_x, min_y, max_x, max_y);
+  std::uniform_real_distribution<double> ux(min_x, max_x), uy(min_y, max_y), uyaw(-M_PI, M_PI);
+  for (int attempt = 0; attempt < 10000; attempt++)
+  {
+    goal.x = ux(rng);
+    goal.y = uy(rng);
+    goal.theta = uyaw(rng);
+    if (std::hypot(goal.x - start.x, goal.y - start.y) >= min_distance && world.isFree(goal) &&
+        world.isReachable(start, goal))
+      return true;
+  }
+  return false;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  std::string user_config_dir = HEADLESS_SIM_USER_CONFIG_DIR;
+  std::string sim_env_dir = HEADLESS_SIM_SIM_ENV_DIR;
+  std::string planner;
+  double planner_frequency = -1.0;
+  headless_sim::Pose2D start, goal;
+  bool has_start = false, has_goal = false;
+  int episodes = 1;
+  unsigned seed = 0;
+  double min_distance = 3.0;
+  headless_sim::EpisodeOptions options;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--user-config" && has_value)
+      user_config_dir = argv[++i];
+    else if (arg == "--sim-env" && has_value)
+      sim_env_dir = argv[++i];
+    else if (arg == "--planner" && has_value)
+      planner = argv[++i];
+    else if (arg == "--planner-frequency" && has_value)
+      planner_frequency = std::atof(argv[++i]);
+    else if (arg == "--start" && parsePose(argc, argv, i, start))
+      has_start = true;
+    else if (arg == "--goal" && parsePose(argc, argv, i, goal))
+      has_goal = true;
+    else if (arg == "--episodes" && has_value)
+      episodes = std::atoi(argv[++i]);
+    else if (arg == "--seed" && has_value)
+      seed = std::strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--min-distance" && has_value)
+      min_distance = std::atof(argv[++i]);
+    else if (arg == "--dt" && has_value)
+      options.dt = std::atof(argv[++i]);
+    else if (arg == "--timeout" && has_value)
+      options.timeout = std::atof(argv[++i]);
+    else
+    {
+      std::cerr << usage;
+      return arg == "--help" || arg == "-h" ? 0 : 2;
+    }
+  }
+  if (episodes < 1 || options.dt <= 0 || options.timeout <= 0)
+  {
+    std::cerr << usage;
+    return 2;
+  }
+
+  headless_sim::Scenario scenario;
+  std::string error;
+  if (!headless_sim::loadScenario(user_config_dir, sim_env_dir, scenario, error))
+  {
+    std::cerr << "Failed to load the scenario: " << error << std::endl;
+    return 2;
+  }
+  if (!planner.empty())
+    scenario.robot.global_planner = planner;
+  if (planner_frequency >= 0)
+    scenario.robot.planner_frequency = planner_frequency;
+  if (scenario.robot.local_planner != "pid")
+    std::cerr << "Local planner " << scenario.robot.local_planner << " has no ROS-free core, tracking with pid"
+              << std::endl;
+  if (!has_start)
+    start = scenario.robot.pose;
+
+  headless_sim::HeadlessWorld world(scenario);
+  if (!world.load(error))
+  {
+    std::cerr << "Failed to load the world: " << error << std::endl;
+    return 2;
+  }
+
+  // the crowds of user_config are small, threads would cost more than they save
+  sfm::SFM.setThreads(1);
+
+  int reached = 0;
+  double sim_time = 0.0, wall_time = 0.0;
+  for (int k = 0; k < episodes; k++)
+  {
+    std::mt19937 rng(seed + k);
+    if (!has_goal && !randomGoal(world, start, min_distance, rng, goal))
+    {
+      std::cerr << "No free goal at least " << min_distance << " m away from the start" << std::endl;
+      return 2;
+    }
+
+    headless_sim::EpisodeResult result = world.run(start, goal, options);
+    reached += result.status == headless_sim::EpisodeResult::REACHED;
+    sim_time += result.sim_time;
+    wall_time += result.wall_time;
+
+    printf("{\"episode\": %d, \"planner\": \"%s\", \"start\": [%.3f, %.3f, %.3f], \"goal\": [%.3f, %.3f, %.3f], "
+           "\"status\": \"%s\", \"collision\": \"%s\", \"sim_time\": %.3f, \"wall_time\": %.6f, "
+           "\"plan_length\": %.3f, \"travelled\": %.3f, \"min_ped_distance\": %.3f, \"plans\": %d, "
+           "\"planning_time\": %.6f}\n",
+           k, scenario.robot.global_planner.c_str(), start.x, start.y, start.theta, goal.x, goal.y, goal.theta,
+           headless_sim::EpisodeResult::statusName(result.status), result.collision.c_str(), result.sim_time,
+           result.wall_time, result.plan_length, result.travelled, result.min_ped_distance, result.plans,
+           result.planning_time);
+    fflush(stdout);
+  }
+
+  fprintf(stderr, "%d/%d episodes reached the goal, %.1f s simulated in %.3f s (%.0fx real time)\n", reached,
+          episodes, sim_time, wall_time, wall_time > 0 ? sim_time / wall_time : 0.0);
+  return reached == episodes ? 0 : 1;
+}
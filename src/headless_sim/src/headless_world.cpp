@@ -0,0 +1,654 @@
+/***********************************************************
+ *
+ * @file: headless_world.cpp
+ * @breif: Gazebo-free world stepping a kinematic robot and a social force model crowd on a static map
+ * @author: Yang Haodong
+ * @update: 2023-10-1
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include <lightsfm/sfm.hpp>
+
+#include "a_star.h"
+#include "d_star.h"
+#include "d_star_lite.h"
+#include "jump_point_search.h"
+#include "lazy_theta_star.h"
+#include "lpa_star.h"
+#include "theta_star.h"
+#include "rrt.h"
+#include "rrt_star.h"
+#include "rrt_connect.h"
+#include "informed_rrt.h"
+#include "aco.h"
+#include "pso.h"
+#include "pid_controller.h"
+
+#include "headless_sim/headless_world.h"
+
+namespace headless_sim
+{
+namespace
+{
+// random goals must be free for every graph planner, a_star and d_star use the smallest obstacle factor
+const double FREE_COST = LETHAL_COST * 0.25;
+}  // namespace
+
+/**
+ * @brief Name of a status as printed in the reports
+ */
+const char* EpisodeResult::statusName(Status status)
+{
+  switch (status)
+  {
+    case REACHED:
+      return "reached";
+    case TIMEOUT:
+      return "timeout";
+    case COLLISION:
+      return "collision";
+    default:
+      return "no_path";
+  }
+}
+
+/**
+ * @brief Construct a new HeadlessWorld object
+ * @param scenario scenario to simulate
+ */
+HeadlessWorld::HeadlessWorld(const Scenario& scenario)
+  : scenario_(scenario)
+  , costs_(nullptr)
+  , nx_(0)
+  , ny_(0)
+  , resolution_(0.05)
+  , origin_x_(0.0)
+  , origin_y_(0.0)
+  , inscribed_radius_(0.0)
+  , reachable_from_(-1)
+{
+}
+
+/**
+ * @brief Load the map, rasterize the static obstacles and inflate the costmap
+ * @param error         reason of a failure
+ * @param costmap_cache costmap snapshot mapped instead of inflating the costmap, written after inflating if it is
+ *                      missing or of another map (optional). Delete it when the inflation parameters change.
+ * @return true if successful, else false
+ */
+bool HeadlessWorld::load(std::string& error, const std::string& costmap_cache)
+{
+  if (!isPlannerSupported(scenario_.robot.global_planner))
+  {
+    error = "global planner " + scenario_.robot.global_planner + " is not available headless";
+    return false;
+  }
+  if (!map_.load(scenario_.map_file))
+  {
+    error = "failed to load map " + scenario_.map_file;
+    return false;
+  }
+  nx_ = map_.getWidth(), ny_ = map_.getHeight();
+  resolution_ = map_.getResolution();
+  origin_x_ = map_.getOriginX(), origin_y_ = map_.getOriginY();
+
+  // static obstacles are occupied cells, as the laser of the robot would mark them
+  std::vector<bool> occupied = map_.getOccupancy();
+  for (const auto& obs : scenario_.obstacles)
+  {
+    const double c = std::cos(obs.pose.theta), s = std::sin(obs.pose.theta);
+    for (int y = 0; y < ny_; y++)
+    {
+      for (int x = 0; x < nx_; x++)
+      {
+        const double dx = origin_x_ + (x + 0.5) * resolution_ - obs.pose.x;
+        const double dy = origin_y_ + (y + 0.5) * resolution_ - obs.pose.y;
+        bool inside;
+        if (obs.type == "BOX")
+          inside = std::fabs(c * dx + s * dy) <= obs.w / 2 && std::fabs(-s * dx + c * dy) <= obs.d / 2;
+        else
+          inside = std::hypot(dx, dy) <= obs.r;
+        if (inside)
+          occupied[y * nx_ + x] = true;
+      }
+    }
+  }
+  map_.setOccupancy(occupied, nx_, ny_, resolution_, origin_x_, origin_y_);
+
+  // inscribed radius: closest footprint edge to the robot center
+  const std::vector<Pose2D>& footprint = scenario_.robot.footprint;
+  inscribed_radius_ = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < footprint.size(); i++)
+  {
+    Eigen::Vector2d closest;
+    const Pose2D& a = footprint[i];
+    const Pose2D& b = footprint[(i + 1) % footprint.size()];
+    std::vector<Eigen::Vector2d> edge = { Eigen::Vector2d(a.x, a.y), Eigen::Vector2d(b.x, b.y) };
+    inscribed_radius_ = std::min(inscribed_radius_, distanceToFootprint(edge, Eigen::Vector2d::Zero(), closest));
+  }
+
+  // a snapshot of the same map spares the inflation, its costs are used where they are mapped
+  std::string cache_error;
+  if (!costmap_cache.empty() && costmap_cache_.open(costmap_cache, cache_error))
+  {
+    if (costmap_cache_.sizeX() == nx_ && costmap_cache_.sizeY() == ny_ && costmap_cache_.resolution() == resolution_ &&
+        costmap_cache_.originX() == origin_x_ && costmap_cache_.originY() == origin_y_)
+    {
+      costmap_.clear();
+      costs_ = costmap_cache_.costs();
+      return true;
+    }
+    costmap_cache_.close();
+  }
+
+  // costmap_2d::InflationLayer costs from the exact distance to the nearest occupied cell, in the cost values of
+  // global_planner.h: OBSTACLE_COST is costmap_2d::LETHAL_OBSTACLE, LETHAL_COST costmap_2d::INSCRIBED_INFLATED_OBSTACLE
+  costmap_.assign(nx_ * ny_, 0);
+  for (int y = 0; y < ny_; y++)
+  {
+    for (int x = 0; x < nx_; x++)
+    {
+      const utils::Vector2d center(origin_x_ + (x + 0.5) * resolution_, origin_y_ + (y + 0.5) * resolution_);
+      unsigned char& cost = costmap_[y * nx_ + x];
+      if (occupied[y * nx_ + x])
+      {
+        cost = OBSTACLE_COST;
+        continue;
+      }
+      const double d = map_.nearestObstacle(center).distance;
+      if (d < 0 || d > scenario_.robot.inflation_radius)
+        continue;
+      if (d <= inscribed_radius_)
+        cost = LETHAL_COST;
+      else
+        cost = static_cast<unsigned char>((LETHAL_COST - 1) *
+                                          std::exp(-scenario_.robot.cost_scaling_factor * (d - inscribed_radius_)));
+    }
+  }
+  costs_ = costmap_.data();
+
+  if (!costmap_cache.empty() &&
+      !global_planner::CostmapSnapshot::write(costmap_cache, costs_, nx_, ny_, resolution_, origin_x_, origin_y_, 0,
+                                              cache_error))
+    std::cerr << "Costmap cache not written: " << cache_error << std::endl;
+
+  return true;
+}
+
+/**
+ * @brief Drive the robot from start to goal through the crowd of the scenario
+ * @param start   robot start pose
+ * @param goal    goal pose
+ * @param options episode settings
+ * @return the outcome of the episode
+ */
+EpisodeResult HeadlessWorld::run(const Pose2D& start, const Pose2D& goal, const EpisodeOptions& options)
+{
+  const auto wall_start = std::chrono::steady_clock::now();
+  const RobotConfig& cfg = scenario_.robot;
+  EpisodeResult result;
+
+  // a fresh planner per episode, incremental planners must not reuse the last search
+  std::unique_ptr<global_planner::GlobalPlanner> planner = createPlanner(cfg.global_planner);
+
+  pid_planner::PIDController controller;
+  controller.setTimeStep(1.0 / cfg.controller_frequency);
+  controller.setTolerances(cfg.p_window, cfg.p_precision, cfg.o_precision);
+  controller.setLinearLimits(cfg.max_v, cfg.min_v, cfg.max_v_inc);
+  controller.setAngularLimits(cfg.max_w, cfg.min_w, cfg.max_w_inc);
+  controller.setLinearGains(cfg.k_v_p, cfg.k_v_i, cfg.k_v_d);
+  controller.setAngularGains(cfg.k_w_p, cfg.k_w_i, cfg.k_w_d);
+  controller.setThetaWeight(cfg.k_theta);
+
+  // the robot moves like a teleoperated agent of lightsfm
+  sfm::Agent robot(utils::Vector2d(start.x, start.y), utils::Angle::fromRadian(start.theta), 0.0, 0.0);
+
+  // pedestrians as PedestrianSFMPlugin::Reset() initializes them
+  const SocialForceConfig& sf = scenario_.social_force;
+  std::vector<sfm::Agent> agents(scenario_.pedestrians.size());
+  std::vector<bool> avoids_robot(agents.size());
+  sfm::Workspace workspace;
+  for (size_t i = 0; i < agents.size(); i++)
+  {
+    const PedestrianConfig& ped = scenario_.pedestrians[i];
+    sfm::Agent& agent = agents[i];
+    agent.id = static_cast<int>(i) + 1;
+    agent.position.set(ped.pose.x, ped.pose.y);
+    agent.yaw = utils::Angle::fromRadian(ped.pose.theta);
+    agent.desiredVelocity = ped.velocity;
+    agent.radius = ped.radius;
+    agent.cyclicGoals = ped.cycle;
+    for (const auto& g : ped.goals)
+    {
+      sfm::Goal sfm_goal;
+      sfm_goal.center.set(g.x, g.y);
+      sfm_goal.radius = 0.3;
+      agent.goals.push_back(sfm_goal);
+    }
+    agent.params.forceFactorDesired = sf.goal_weight;
+    agent.params.forceFactorObstacle = sf.obstacle_weight;
+    agent.params.forceFactorSocial = sf.social_weight;
+    agent.params.forceFactorGroupGaze = sf.group_gaze_weight;
+    agent.params.forceFactorGroupCoherence = sf.group_coh_weight;
+    agent.params.forceFactorGroupRepulsion = sf.group_rep_weight;
+    avoids_robot[i] = std::find(ped.ignore.begin(), ped.ignore.end(), cfg.type) == ped.ignore.end();
+  }
+  sfm::SFM.setNeighborDistance(sf.people_distance);
+
+  // control and replanning periods in simulation steps, no replanning at planner_frequency 0
+  auto stepsOf = [&options](double frequency) {
+    return frequency > 0 ? std::max(1, static_cast<int>(std::lround(1.0 / (frequency * options.dt)))) : 0;
+  };
+  const int control_steps = std::max(1, stepsOf(cfg.controller_frequency));
+  const int plan_steps = stepsOf(cfg.planner_frequency);
+  const Eigen::Vector2d goal_position(goal.x, goal.y);
+  std::vector<Eigen::Vector2d> plan;
+
+  auto replan = [&]() {
+    auto t = std::chrono::steady_clock::now();
+    bool found =
+        makePlan(*planner, Eigen::Vector2d(robot.position.getX(), robot.position.getY()), goal_position, plan);
+    result.planning_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+    if (found)
+    {
+      // move_base keeps the last plan if replanning fails
+      controller.setPlan(plan, goal.theta);
+      result.plans++;
+    }
+    return found;
+  };
+
+  if (!replan())
+  {
+    result.status = EpisodeResult::NO_PATH;
+    result.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    return result;
+  }
+  for (size_t i = 1; i < plan.size(); i++)
+    result.plan_length += (plan[i] - plan[i - 1]).norm();
+
+  result.status = EpisodeResult::TIMEOUT;
+  for (long step = 0; step * options.dt < options.timeout; step++)
+  {
+    const double time = step * options.dt;
+    const Pose2D pose = { robot.position.getX(), robot.position.getY(), robot.yaw.toRadian() };
+    const std::vector<Eigen::Vector2d> footprint = footprintAt(pose);
+
+    // navigation
+    if (plan_steps > 0 && step > 0 && step % plan_steps == 0)
+      replan();
+    if (step % control_steps == 0)
+    {
+      double v_cmd, w_cmd;
+      controller.computeVelocityCommands(Eigen::Vector3d(pose.x, pose.y, pose.theta), robot.linearVelocity,
+                                         robot.angularVelocity, v_cmd, w_cmd);
+      robot.linearVelocity = v_cmd;
+      robot.angularVelocity = w_cmd;
+      if (controller.isGoalReached())
+      {
+        result.status = EpisodeResult::REACHED;
+        break;
+      }
+    }
+
+    // nearest obstacle of every pedestrian, as PedestrianSFMPlugin::handleObstacles finds it
+    for (size_t i = 0; i < agents.size(); i++)
+    {
+      sfm::Agent& agent = agents[i];
+      agent.obstacles1.clear();
+      sfm::Map::Obstacle obs = map_.nearestObstacle(agent.position);
+      double min_dist = obs.distance >= 0 ? obs.distance : std::numeric_limits<double>::max();
+      utils::Vector2d closest = obs.position;
+      if (avoids_robot[i])
+      {
+        Eigen::Vector2d point;
+        double d = distanceToFootprint(footprint, Eigen::Vector2d(agent.position.getX(), agent.position.getY()), point);
+        if (d < min_dist)
+        {
+          min_dist = d;
+          closest.set(point.x(), point.y());
+        }
+      }
+      if (min_dist < std::numeric_limits<double>::max())
+        agent.obstacles1.push_back(closest);
+
+      // pedestrians still waiting for their time delay stand still but are seen by the others
+      agent.teleoperated = time < scenario_.pedestrians[i].time_delay;
+      if (agent.teleoperated)
+      {
+        agent.linearVelocity = 0.0;
+        agent.angularVelocity = 0.0;
+      }
+    }
+
+    sfm::SFM.computeForces(agents, workspace);
+    sfm::SFM.updatePosition(agents, options.dt);
+    const utils::Vector2d last = robot.position;
+    robot.move(options.dt);
+    result.travelled += (robot.position - last).norm();
+    result.sim_time = time + options.dt;
+
+    // collisions
+    const std::vector<Eigen::Vector2d> moved =
+        footprintAt({ robot.position.getX(), robot.position.getY(), robot.yaw.toRadian() });
+    if (hitsObstacle(moved))
+    {
+      result.status = EpisodeResult::COLLISION;
+      result.collision = "static obstacle";
+    }
+    for (size_t i = 0; i < agents.size(); i++)
+    {
+      Eigen::Vector2d point;
+      double d = distanceToFootprint(moved, Eigen::Vector2d(agents[i].position.getX(), agents[i].position.getY()),
+                                     point) -
+                 agents[i].radius;
+      d = std::max(d, 0.0);
+      if (result.min_ped_distance < 0 || d < result.min_ped_distance)
+        result.min_ped_distance = d;
+      if (d <= 0.0 && result.collision.empty())
+      {
+        result.status = EpisodeResult::COLLISION;
+        result.collision = scenario_.pedestrians[i].name;
+      }
+    }
+    if (result.status == EpisodeResult::COLLISION)
+      break;
+  }
+
+  result.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  return result;
+}
+
+/**
+ * @brief Check if the footprint fits at a pose without touching an cell any graph planner avoids
+ * @param pose robot pose
+ * @return true if free, else false
+ */
+bool HeadlessWorld::isFree(const Pose2D& pose) const
+{
+  const int cell = cellOf(pose);
+
+  return cell >= 0 && costs_[cell] < FREE_COST && !hitsObstacle(footprintAt(pose));
+}
+
+/**
+ * @brief Check if the graph planners can connect two poses, i.e. if the goal is not in a closed room or unknown space
+ *        outside the map
+ * @param from start pose
+ * @param to   goal pose
+ * @return true if connected, else false
+ */
+bool HeadlessWorld::isReachable(const Pose2D& from, const Pose2D& to)
+{
+  const int start = cellOf(from), goal = cellOf(to);
+  if (start < 0 || goal < 0)
+    return false;
+
+  // 8-connected flood fill through the cells all planners accept, kept for further goals from the same cell
+  if (start != reachable_from_)
+  {
+    reachable_.assign(nx_ * ny_, false);
+    std::vector<int> open = { start };
+    reachable_[start] = true;
+    while (!open.empty())
+    {
+      const int i = open.back();
+      open.pop_back();
+      const int x = i % nx_, y = i / nx_;
+      for (int dy = -1; dy <= 1; dy++)
+      {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+          const int nx = x + dx, ny = y + dy;
+          if (nx < 0 || ny < 0 || nx >= nx_ || ny >= ny_)
+            continue;
+          const int n = ny * nx_ + nx;
+          if (!reachable_[n] && costs_[n] < FREE_COST)
+          {
+            reachable_[n] = true;
+            open.push_back(n);
+          }
+        }
+      }
+    }
+    reachable_from_ = start;
+  }
+  return reachable_[goal];
+}
+
+/**
+ * @brief Bounds of the map in the world frame
+ */
+void HeadlessWorld::getBounds(double& min_x, double& min_y, double& max_x, double& max_y) const
+{
+  min_x = origin_x_;
+  min_y = origin_y_;
+  max_x = origin_x_ + nx_ * resolution_;
+  max_y = origin_y_ + ny_ * resolution_;
+}
+
+/**
+ * @brief Check if a global planner can run headless
+ * @param name planner name as in user_config.yaml
+ * @return true if supported, else false
+ */
+bool HeadlessWorld::isPlannerSupported(const std::string& name)
+{
+  const std::vector<std::string>& planners = supportedPlanners();
+  return std::find(planners.begin(), planners.end(), name) != planners.end();
+}
+
+/**
+ * @brief Names of all global planners that can run headless
+ */
+const std::vector<std::string>& HeadlessWorld::supportedPlanners()
+{
+  // voronoi needs the diagram of the VoronoiLayer costmap plugin
+  static const std::vector<std::string> planners = {
+    // graph search
+    "a_star", "dijkstra", "gbfs", "jps", "d_star", "lpa_star", "d_star_lite", "theta_star", "lazy_theta_star",
+    // sampling
+    "rrt", "rrt_star", "rrt_connect", "informed_rrt",
+    // evolutionary
+    "aco", "pso"
+  };
+  return planners;
+}
+
+/**
+ * @brief Create a global planner for the costmap with the parameters of the scenario
+ * @param name planner name as in user_config.yaml
+ * @return the planner, nullptr if it is not supported
+ */
+std::unique_ptr<global_planner::GlobalPlanner> HeadlessWorld::createPlanner(const std::string& name) const
+{
+  return createPlanner(name, nx_, ny_, resolution_, scenario_.planner);
+}
+
+/**
+ * @brief Create a global planner for any costmap, e.g. of a plan record
+ * @param name       planner name as in user_config.yaml
+ * @param nx         pixel number in costmap x direction
+ * @param ny         pixel number in costmap y direction
+ * @param resolution costmap resolution
+ * @param cfg        planner parameters
+ * @return the planner, nullptr if it is not supported
+ */
+std::unique_ptr<global_planner::GlobalPlanner> HeadlessWorld::createPlanner(const std::string& name, int nx, int ny,
+                                                                            double resolution,
+                                                                            const PlannerConfig& cfg)
+{
+  global_planner::GlobalPlanner* planner = nullptr;
+  if (name == "a_star")
+    planner = new global_planner::AStar(nx, ny, resolution);
+  else if (name == "dijkstra")
+    planner = new global_planner::AStar(nx, ny, resolution, true);
+  else if (name == "gbfs")
+    planner = new global_planner::AStar(nx, ny, resolution, false, true);
+  else if (name == "jps")
+    planner = new global_planner::JumpPointSearch(nx, ny, resolution);
+  else if (name == "d_star")
+    planner = new global_planner::DStar(nx, ny, resolution);
+  else if (name == "lpa_star")
+    planner = new global_planner::LPAStar(nx, ny, resolution);
+  else if (name == "d_star_lite")
+    planner = new global_planner::DStarLite(nx, ny, resolution);
+  else if (name == "theta_star")
+    planner = new global_planner::ThetaStar(nx, ny, resolution);
+  else if (name == "lazy_theta_star")
+    planner = new global_planner::LazyThetaStar(nx, ny, resolution);
+  else if (name == "rrt")
+    planner = new global_planner::RRT(nx, ny, resolution, cfg.sample_points, cfg.sample_max_d);
+  else if (name == "rrt_star")
+    planner = new global_planner::RRTStar(nx, ny, resolution, cfg.sample_points, cfg.sample_max_d,
+                                          cfg.optimization_r);
+  else if (name == "rrt_connect")
+    planner = new global_planner::RRTConnect(nx, ny, resolution, cfg.sample_points, cfg.sample_max_d);
+  else if (name == "informed_rrt")
+    planner = new global_planner::InformedRRT(nx, ny, resolution, cfg.sample_points, cfg.sample_max_d,
+                                              cfg.optimization_r);
+  else if (name == "aco")
+    planner = new global_planner::ACO(nx, ny, resolution, cfg.n_ants, cfg.alpha, cfg.beta, cfg.rho, cfg.Q,
+                                      cfg.max_iter);
+  else if (name == "pso")
+    planner = new global_planner::PSO(nx, ny, resolution, cfg.n_particles, cfg.n_inherited, cfg.point_num,
+                                      cfg.w_inertial, cfg.w_social, cfg.w_cognitive, cfg.max_speed, cfg.init_pos_mode,
+                                      cfg.pso_max_iter);
+  return std::unique_ptr<global_planner::GlobalPlanner>(planner);
+}
+
+/**
+ * @brief Plan from start to goal on the costmap, like GraphPlanner::makePlan
+ * @param planner  global planner
+ * @param start    start position
+ * @param goal     goal position
+ * @param plan     plan points in the world frame, goal last
+ * @param expanded number of nodes the planner expanded (optional)
+ * @return true if a plan was found, else false
+ */
+bool HeadlessWorld::makePlan(global_planner::GlobalPlanner& planner, const Eigen::Vector2d& start,
+                             const Eigen::Vector2d& goal, std::vector<Eigen::Vector2d>& plan, size_t* expanded)
+{
+  if (start.x() < origin_x_ || start.y() < origin_y_ || goal.x() < origin_x_ || goal.y() < origin_y_)
+    return false;
+
+  int g_start_x, g_start_y, g_goal_x, g_goal_y;
+  planner.map2Grid((start.x() - origin_x_) / resolution_, (start.y() - origin_y_) / resolution_, g_start_x, g_start_y);
+  planner.map2Grid((goal.x() - origin_x_) / resolution_, (goal.y() - origin_y_) / resolution_, g_goal_x, g_goal_y);
+  if (g_start_x >= nx_ || g_start_y >= ny_ || g_goal_x >= nx_ || g_goal_y >= ny_)
+    return false;
+
+  global_planner::Node start_node(g_start_x, g_start_y, 0, 0, planner.grid2Index(g_start_x, g_start_y), 0);
+  global_planner::Node goal_node(g_goal_x, g_goal_y, 0, 0, planner.grid2Index(g_goal_x, g_goal_y), 0);
+
+  // the planner plugins outline the costmap before every plan
+  if (scenario_.planner.outline_map)
+    planner.outlineMap(costs_);
+
+  std::vector<global_planner::Node> path, expand;
+  const bool found = planner.plan(costs_, start_node, goal_node, path, expand);
+  if (expanded)
+    *expanded = expand.size();
+  if (!found)
+    return false;
+
+  // the path runs from the goal back to the start
+  std::vector<Eigen::Vector2d> new_plan;
+  new_plan.reserve(path.size() + 1);
+  for (int i = static_cast<int>(path.size()) - 1; i >= 0; i--)
+    new_plan.emplace_back(origin_x_ + path[i].x_ * resolution_, origin_y_ + path[i].y_ * resolution_);
+  new_plan.push_back(goal);
+  plan.swap(new_plan);
+  return true;
+}
+
+/**
+ * @brief Costmap index of the cell of a pose, -1 outside the map
+ */
+int HeadlessWorld::cellOf(const Pose2D& pose) const
+{
+  const int x = static_cast<int>(std::floor((pose.x - origin_x_) / resolution_));
+  const int y = static_cast<int>(std::floor((pose.y - origin_y_) / resolution_));
+  if (x < 0 || y < 0 || x >= nx_ || y >= ny_)
+    return -1;
+  return y * nx_ + x;
+}
+
+/**
+ * @brief Footprint polygon at a pose
+ */
+std::vector<Eigen::Vector2d> HeadlessWorld::footprintAt(const Pose2D& pose) const
+{
+  const double c = std::cos(pose.theta), s = std::sin(pose.theta);
+  std::vector<Eigen::Vector2d> polygon;
+  polygon.reserve(scenario_.robot.footprint.size());
+  for (const auto& p : scenario_.robot.footprint)
+    polygon.emplace_back(pose.x + c * p.x - s * p.y, pose.y + s * p.x + c * p.y);
+  return polygon;
+}
+
+/**
+ * @brief Check if the footprint polygon overlaps an occupied map cell
+ */
+bool HeadlessWorld::hitsObstacle(const std::vector<Eigen::Vector2d>& footprint) const
+{
+  // the outline sampled at the map resolution, enough as obstacles are larger than a cell
+  for (size_t i = 0; i < footprint.size(); i++)
+  {
+    const Eigen::Vector2d& a = footprint[i];
+    const Eigen::Vector2d& b = footprint[(i + 1) % footprint.size()];
+    const int samples = std::max(1, static_cast<int>(std::ceil((b - a).norm() / resolution_)));
+    for (int k = 0; k < samples; k++)
+    {
+      const Eigen::Vector2d p = a + (b - a) * (static_cast<double>(k) / samples);
+      if (map_.isObstacle(utils::Vector2d(p.x(), p.y())))
+        return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Distance from a point to the footprint polygon and the closest polygon point, 0 inside
+ */
+double HeadlessWorld::distanceToFootprint(const std::vector<Eigen::Vector2d>& footprint, const Eigen::Vector2d& point,
+                                          Eigen::Vector2d& closest)
+{
+  double min_dist = std::numeric_limits<double>::max();
+  bool inside = false;
+  for (size_t i = 0, j = footprint.size() - 1; i < footprint.size(); j = i++)
+  {
+    const Eigen::Vector2d& a = footprint[j];
+    const Eigen::Vector2d& b = footprint[i];
+    const Eigen::Vector2d ab = b - a;
+    const double t = std::min(std::max((point - a).dot(ab) / std::max(ab.squaredNorm(), 1e-12), 0.0), 1.0);
+    const Eigen::Vector2d q = a + t * ab;
+    const double d = (point - q).norm();
+    if (d < min_dist)
+    {
+      min_dist = d;
+      closest = q;
+    }
+    // even-odd rule
+    if ((a.y() > point.y()) != (b.y() > point.y()) &&
+        point.x() < a.x() + (point.y() - a.y()) * (b.x() - a.x()) / (b.y() - a.y()))
+      inside = !inside;
+  }
+  if (inside && footprint.size() > 2)
+  {
+    closest = point;
+    return 0.0;
+  }
+  return min_dist;
+}
+}  // namespace headless_sim
@@ -0,0 +1,255 @@
+/***********************************************************
+ *
+ * @file: plan_replay.cpp
+ * @breif: Re-run the plan requests captured by the record_plans option of the global planner plugins offline, on the
+ *         recorded costmaps, with the recorded or another planner
+ * @author: Yang Haodong
+ * @update: 2023-10-9
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "headless_sim/headless_world.h"
+#include "plan_recorder.h"
+
+namespace
+{
+const char* usage =
+    "usage: plan_replay [options] FILE...\n"
+    "  --planner NAME          replay with this global planner instead of the recorded one\n"
+    "  --repeat N              plans per record, the median time is reported (default: 1)\n"
+    "  --min-time T            only records whose recorded search took at least T seconds (default: 0)\n"
+    "  --failed                only records whose recorded search failed\n"
+    "  --output FILE           write a CSV line per replayed record to FILE\n"
+    "FILE are record files of record_plans, e.g. /tmp/GraphPlanner_a_star_*.rec. Each record is planned with its\n"
+    "seed, so with the recorded planner a sample planner draws the same samples as on the robot.\n"
+    "The exit code is 0 if all records could be read and 2 otherwise.\n";
+
+/**
+ * @brief Planner parameters of a record, named as in the yaml files of sim_env/config/planner
+ */
+headless_sim::PlannerConfig plannerConfig(const global_planner::PlanRecord& record)
+{
+  headless_sim::PlannerConfig cfg;
+  for (const auto& param : record.params)
+  {
+    const std::string& name = param.first;
+    const char* value = param.second.c_str();
+    if (name == "outline_map")
+      cfg.outline_map = param.second == "true";
+    else if (name == "sample_points")
+      cfg.sample_points = std::atoi(value);
+    else if (name == "sample_max_d")
+      cfg.sample_max_d = std::atof(value);
+    else if (name == "optimization_r")
+      cfg.optimization_r = std::atof(value);
+    else if (name == "n_ants")
+      cfg.n_ants = std::atoi(value);
+    else if (name == "alpha")
+      cfg.alpha = std::atof(value);
+    else if (name == "beta")
+      cfg.beta = std::atof(value);
+    else if (name == "rho")
+      cfg.rho = std::atof(value);
+    else if (name == "Q")
+      cfg.Q = std::atof(value);
+    else if (name == "max_iter")
+      cfg.max_iter = std::atoi(value);
+    else if (name == "n_particles")
+      cfg.n_particles = std::atoi(value);
+    else if (name == "n_inherited")
+      cfg.n_inherited = std::atoi(value);
+    else if (name == "pointNum")
+      cfg.point_num = std::atoi(value);
+    else if (name == "max_speed")
+      cfg.max_speed = std::atoi(value);
+    else if (name == "w_inertial")
+      cfg.w_inertial = std::atof(value);
+    else if (name == "w_social")
+      cfg.w_social = std::atof(value);
+    else if (name == "w_cognitive")
+      cfg.w_cognitive = std::atof(value);
+    else if (name == "initposmode")
+      cfg.init_pos_mode = std::atoi(value);
+    else if (name == "pso_max_iter")
+      cfg.pso_max_iter = std::atoi(value);
+  }
+  return cfg;
+}
+
+/**
+ * @brief Outcome of replaying one record
+ */
+struct Replay
+{
+  bool found = false;
+  double time = 0.0;       // median search time [s]
+  size_t expanded = 0;     // expanded nodes of the last repetition
+  bool same_path = false;  // whether the last repetition returned the recorded path
+};
+
+/**
+ * @brief Plan a record repeatedly with a fresh planner each time, as the planners keep state between plans
+ */
+Replay replay(const std::string& planner_name, const global_planner::PlanRecord& record,
+              const global_planner::PlanRecordReader& reader, int repeat)
+{
+  Replay result;
+  const headless_sim::PlannerConfig cfg = plannerConfig(record);
+  std::vector<double> times;
+  for (int r = 0; r < repeat; r++)
+  {
+    std::unique_ptr<global_planner::GlobalPlanner> planner = headless_sim::HeadlessWorld::createPlanner(
+        planner_name, reader.sizeX(), reader.sizeY(), reader.resolution(), cfg);
+    planner->setSeed(record.seed);
+    const global_planner::Node start(record.start_gx, record.start_gy, 0, 0,
+                                     planner->grid2Index(record.start_gx, record.start_gy), 0);
+    const global_planner::Node goal(record.goal_gx, record.goal_gy, 0, 0,
+                                    planner->grid2Index(record.goal_gx, record.goal_gy), 0);
+
+    // the recorded costs are those the planner got, already outlined
+    std::vector<global_planner::Node> path, expand;
+    const auto t = std::chrono::steady_clock::now();
+    result.found = planner->plan(reader.costs().data(), start, goal, path, expand);
+    times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count());
+    result.expanded = expand.size();
+
+    result.same_path = path.size() == record.path.size();
+    for (size_t i = 0; result.same_path && i < path.size(); i++)
+      result.same_path = path[i].x_ == record.path[i].first && path[i].y_ == record.path[i].second;
+  }
+  std::sort(times.begin(), times.end());
+  result.time = times[times.size() / 2];
+  return result;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  std::vector<std::string> files;
+  std::string planner_override, output_file;
+  int repeat = 1;
+  double min_time = 0.0;
+  bool failed_only = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--planner" && has_value)
+      planner_override = argv[++i];
+    else if (arg == "--repeat" && has_value)
+      repeat = std::atoi(argv[++i]);
+    else if (arg == "--min-time" && has_value)
+      min_time = std::atof(argv[++i]);
+    else if (arg == "--failed")
+      failed_only = true;
+    else if (arg == "--output" && has_value)
+      output_file = argv[++i];
+    else if (arg.compare(0, 1, "-") != 0)
+      files.push_back(arg);
+    else
+    {
+      std::cerr << usage;
+      return arg == "--help" || arg == "-h" ? 0 : 2;
+    }
+  }
+  if (files.empty() || repeat < 1)
+  {
+    std::cerr << usage;
+    return 2;
+  }
+  if (!planner_override.empty() && !headless_sim::HeadlessWorld::isPlannerSupported(planner_override))
+  {
+    std::cerr << "Global planner " << planner_override << " is not available headless" << std::endl;
+    return 2;
+  }
+
+  std::ofstream output;
+  if (!output_file.empty())
+  {
+    output.open(output_file);
+    if (!output)
+    {
+      std::cerr << "Failed to write " << output_file << std::endl;
+      return 2;
+    }
+    output << "file,record,planner,recorded_found,recorded_time,recorded_expanded,replay_planner,found,time,"
+              "expanded,same_path\n";
+  }
+
+  // some planners log to std::cout, the table goes to stdout alone
+  std::streambuf* table = std::cout.rdbuf(std::cerr.rdbuf());
+  std::ostream out(table);
+  char line[256];
+  snprintf(line, sizeof(line), "%-7s %-16s %-5s %10s %9s | %-16s %-5s %10s %9s %s\n", "record", "planner", "found",
+           "time[ms]", "expanded", "replay", "found", "time[ms]", "expanded", "path");
+  out << line;
+
+  int status = 0, replayed = 0, reproduced = 0, skipped = 0;
+  for (const std::string& file : files)
+  {
+    global_planner::PlanRecordReader reader;
+    std::string error;
+    if (!reader.open(file, error))
+    {
+      std::cerr << error << std::endl;
+      status = 2;
+      continue;
+    }
+
+    global_planner::PlanRecord record;
+    int index = 0;
+    for (; reader.next(record, error); index++)
+    {
+      if (record.search_time < min_time || (failed_only && record.found))
+        continue;
+      const std::string planner = planner_override.empty() ? record.planner : planner_override;
+      if (!headless_sim::HeadlessWorld::isPlannerSupported(planner))
+      {
+        // e.g. voronoi, which plans on the diagram of the costmap layer
+        skipped++;
+        continue;
+      }
+
+      const Replay result = replay(planner, record, reader, repeat);
+      replayed++;
+      const bool same_planner = planner == record.planner;
+      if (same_planner && result.found == record.found && result.same_path)
+        reproduced++;
+
+      snprintf(line, sizeof(line), "%-7d %-16s %-5s %10.3f %9lu | %-16s %-5s %10.3f %9lu %s\n", index,
+               record.planner.c_str(), record.found ? "yes" : "no", record.search_time * 1e3,
+               static_cast<unsigned long>(record.expanded), planner.c_str(), result.found ? "yes" : "no",
+               result.time * 1e3, static_cast<unsigned long>(result.expanded),
+               !same_planner ? "-" : result.same_path ? "same" : "differs");
+      out << line;
+      if (output.is_open())
+        output << file << "," << index << "," << record.planner << "," << record.found << "," << record.search_time
+               << "," << record.expanded << "," << planner << "," << result.found << "," << result.time << ","
+               << result.expanded << "," << result.same_path << "\n";
+    }
+    if (!error.empty())
+    {
+      std::cerr << file << ": " << error << " after " << index << " records" << std::endl;
+      status = 2;
+    }
+  }
+
+  std::cerr << replayed << " records replayed, " << reproduced << " with the recorded result";
+  if (skipped > 0)
+    std::cerr << ", " << skipped << " of planners not available headless skipped";
+  std::cerr << std::endl;
+  return status;
+}
@@ -0,0 +1,576 @@
+/***********************************************************
+ *
+ * @file: planner_benchmark.cpp
+ * @breif: Every headless global planner on a fixed corpus of start/goal pairs of the sim_env maps, with JSON results
+ *         and a comparison against a previous run
+ * @author: Yang Haodong
+ * @update: 2023-10-1
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <sys/resource.h>
+#include <yaml-cpp/yaml.h>
+
+#include "headless_sim/headless_world.h"
+
+namespace
+{
+/*
+ * Heap usage of the process. Planners allocate their open and closed lists, trees or populations per plan, so the
+ * peak heap growth during makePlan is the memory a planner needs.
+ */
+std::atomic<size_t> heap_current(0), heap_peak(0);
+const size_t HEAP_HEADER = alignof(std::max_align_t);
+
+void* heapAllocate(size_t size)
+{
+  char* p = static_cast<char*>(std::malloc(size + HEAP_HEADER));
+  if (!p)
+    throw std::bad_alloc();
+  *reinterpret_cast<size_t*>(p) = size;
+  const size_t current = heap_current.fetch_add(size) + size;
+  size_t peak = heap_peak.load();
+  while (current > peak && !heap_peak.compare_exchange_weak(peak, current))
+    ;
+  return p + HEAP_HEADER;
+}
+
+void heapFree(void* ptr)
+{
+  if (!ptr)
+    return;
+  char* p = static_cast<char*>(ptr) - HEAP_HEADER;
+  heap_current.fetch_sub(*reinterpret_cast<size_t*>(p));
+  std::free(p);
+}
+}  // namespace
+
+void* operator new(size_t size)
+{
+  return heapAllocate(size);
+}
+void* operator new[](size_t size)
+{
+  return heapAllocate(size);
+}
+void operator delete(void* ptr) noexcept
+{
+  heapFree(ptr);
+}
+void operator delete[](void* ptr) noexcept
+{
+  heapFree(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept
+{
+  heapFree(ptr);
+}
+void operator delete[](void* ptr, size_t) noexcept
+{
+  heapFree(ptr);
+}
+
+namespace
+{
+const char* usage =
+    "usage: planner_benchmark [options]\n"
+    "  --user-config DIR       user_config.yaml, for the robot footprint (default: src/user_config)\n"
+    "  --sim-env DIR           sim_env package with maps and configures (default: src/sim_env)\n"
+    "  --maps A,B              maps of sim_env/maps (default: all)\n"
+    "  --planners A,B          global planners (default: all that run headless)\n"
+    "  --corpus FILE           start/goal pairs per map (default: headless_sim/benchmark/corpus.yaml)\n"
+    "  --pairs N               random pairs for maps missing in the corpus (default: 10)\n"
+    "  --seed S                seed of these random pairs and of the planners (default: 0)\n"
+    "  --write-corpus FILE     save the corpus including the random pairs\n"
+    "  --repeat N              plans per pair and planner (default: 3)\n"
+    "  --costmap-cache DIR     map the costmap of each map from DIR/<map>.snap, written on the first run\n"
+    "  --output FILE           write the JSON report to FILE instead of stdout\n"
+    "  --baseline FILE         JSON report of an earlier run to compare with\n"
+    "  --tolerance T           relative increase of expanded nodes, memory, length or turning counted as a\n"
+    "                          regression, and absolute drop of the success rate (default: 0.1)\n"
+    "  --time-tolerance T      relative increase of the median planning time counted as a regression (default: 0.5)\n"
+    "The exit code is 0 without regressions, 1 with regressions and 2 on configure errors.\n";
+
+/**
+ * @brief A planning query of the corpus
+ */
+struct Query
+{
+  headless_sim::Pose2D start, goal;
+};
+
+/**
+ * @brief Results of all repetitions of one query with one planner
+ */
+struct QueryResult
+{
+  std::string planner, map;
+  int pair = 0;
+  int found = 0;                  // repetitions that found a path
+  double time = 0.0;              // median planning time [s]
+  double expanded = 0.0;          // median expanded nodes
+  size_t peak_memory = 0;         // largest heap growth during a plan [bytes]
+  double length = 0.0;            // median path length [m], of found paths
+  double turning = 0.0;           // median sum of heading changes along the path [rad], of found paths
+};
+
+/**
+ * @brief Results of one planner over the corpus
+ */
+struct Summary
+{
+  std::string planner;
+  int trials = 0;
+  double success_rate = 0.0;
+  double time_median = 0.0, time_max = 0.0;
+  double expanded_mean = 0.0;
+  double peak_memory_max = 0.0;
+  double length_mean = 0.0, turning_mean = 0.0;  // over queries with a found path
+};
+
+std::vector<std::string> split(const std::string& text)
+{
+  std::vector<std::string> items;
+  std::stringstream ss(text);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty())
+      items.push_back(item);
+  return items;
+}
+
+double median(std::vector<double> values)
+{
+  if (values.empty())
+    return 0.0;
+  std::sort(values.begin(), values.end());
+  const size_t n = values.size();
+  return n % 2 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+/**
+ * @brief Seed of the planners for a query, from --seed and the index of the query
+ */
+uint32_t querySeed(unsigned seed, size_t query)
+{
+  std::seed_seq seq{ static_cast<uint32_t>(seed), static_cast<uint32_t>(query) };
+  uint32_t value;
+  seq.generate(&value, &value + 1);
+  return value;
+}
+
+/**
+ * @brief Random queries free for the robot and connected for the graph planners, at least 3 m apart
+ */
+std::vector<Query> randomQueries(headless_sim::HeadlessWorld& world, int count, unsigned seed)
+{
+  double min_x, min_y, max_x, max_y;
+  world.getBounds(min_x, min_y, max_x, max_y);
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> ux(min_x, max_x), uy(min_y, max_y);
+
+  std::vector<Query> queries;
+  for (int attempt = 0; attempt < 100000 && static_cast<int>(queries.size()) < count; attempt++)
+  {
+    Query q;
+    q.start.x = ux(rng), q.start.y = uy(rng);
+    q.goal.x = ux(rng), q.goal.y = uy(rng);
+    if (std::hypot(q.goal.x - q.start.x, q.goal.y - q.start.y) >= 3.0 && world.isFree(q.start) &&
+        world.isFree(q.goal) && world.isReachable(q.start, q.goal))
+      queries.push_back(q);
+  }
+  return queries;
+}
+
+/**
+ * @brief Plan one query repeatedly with a fresh planner each time
+ */
+QueryResult runQuery(headless_sim::HeadlessWorld& world, const std::string& planner_name, const Query& query,
+                     int repeat, uint32_t seed)
+{
+  QueryResult result;
+  std::vector<double> times, expanded, lengths, turnings;
+  for (int r = 0; r < repeat; r++)
+  {
+    std::unique_ptr<global_planner::GlobalPlanner> planner = world.createPlanner(planner_name);
+    planner->setSeed(seed);  // sampling and evolutionary planners draw the same numbers in every run
+    std::vector<Eigen::Vector2d> plan;
+    size_t n_expanded = 0;
+
+    const size_t heap_before = heap_current.load();
+    heap_peak.store(heap_before);
+    const auto t = std::chrono::steady_clock::now();
+    const bool found = world.makePlan(*planner, Eigen::Vector2d(query.start.x, query.start.y),
+                                      Eigen::Vector2d(query.goal.x, query.goal.y), plan, &n_expanded);
+    times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count());
+    result.peak_memory = std::max(result.peak_memory, heap_peak.load() - heap_before);
+    expanded.push_back(static_cast<double>(n_expanded));
+    if (!found)
+      continue;
+
+    result.found++;
+    double length = 0.0, turning = 0.0;
+    for (size_t i = 1; i < plan.size(); i++)
+    {
+      length += (plan[i] - plan[i - 1]).norm();
+      if (i + 1 < plan.size())
+      {
+        const Eigen::Vector2d a = plan[i] - plan[i - 1], b = plan[i + 1] - plan[i];
+        if (a.squaredNorm() > 0 && b.squaredNorm() > 0)
+          turning += std::fabs(std::atan2(a.x() * b.y() - a.y() * b.x(), a.dot(b)));
+      }
+    }
+    lengths.push_back(length);
+    turnings.push_back(turning);
+  }
+  result.time = median(times);
+  result.expanded = median(expanded);
+  result.length = median(lengths);
+  result.turning = median(turnings);
+  return result;
+}
+
+Summary summarize(const std::string& planner, const std::vector<QueryResult>& results, int repeat)
+{
+  Summary s;
+  s.planner = planner;
+  std::vector<double> times;
+  int found = 0, solved = 0;
+  for (const QueryResult& r : results)
+  {
+    if (r.planner != planner)
+      continue;
+    s.trials += repeat;
+    found += r.found;
+    times.push_back(r.time);
+    s.time_max = std::max(s.time_max, r.time);
+    s.expanded_mean += r.expanded;
+    s.peak_memory_max = std::max(s.peak_memory_max, static_cast<double>(r.peak_memory));
+    if (r.found > 0)
+    {
+      solved++;
+      s.length_mean += r.length;
+      s.turning_mean += r.turning;
+    }
+  }
+  if (times.empty())
+    return s;
+  s.success_rate = s.trials > 0 ? static_cast<double>(found) / s.trials : 0.0;
+  s.time_median = median(times);
+  s.expanded_mean /= times.size();
+  if (solved > 0)
+  {
+    s.length_mean /= solved;
+    s.turning_mean /= solved;
+  }
+  return s;
+}
+
+/**
+ * @brief Ratio of a current to a baseline value, 1 if both are 0
+ */
+double ratio(double current, double baseline)
+{
+  if (baseline <= 0)
+    return current <= 0 ? 1.0 : std::numeric_limits<double>::infinity();
+  return current / baseline;
+}
+
+std::string jsonNumber(double value)
+{
+  if (!std::isfinite(value))
+    return "null";
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.6g", value);
+  return buf;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  std::string user_config_dir = HEADLESS_SIM_USER_CONFIG_DIR;
+  std::string sim_env_dir = HEADLESS_SIM_SIM_ENV_DIR;
+  std::string corpus_file = HEADLESS_SIM_BENCHMARK_CORPUS;
+  std::string write_corpus_file, output_file, baseline_file, costmap_cache_dir;
+  std::vector<std::string> maps, planners = headless_sim::HeadlessWorld::supportedPlanners();
+  int pairs = 10, repeat = 3;
+  unsigned seed = 0;
+  double tolerance = 0.1, time_tolerance = 0.5;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--user-config" && has_value)
+      user_config_dir = argv[++i];
+    else if (arg == "--sim-env" && has_value)
+      sim_env_dir = argv[++i];
+    else if (arg == "--maps" && has_value)
+      maps = split(argv[++i]);
+    else if (arg == "--planners" && has_value)
+      planners = split(argv[++i]);
+    else if (arg == "--corpus" && has_value)
+      corpus_file = argv[++i];
+    else if (arg == "--pairs" && has_value)
+      pairs = std::atoi(argv[++i]);
+    else if (arg == "--seed" && has_value)
+      seed = std::strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--write-corpus" && has_value)
+      write_corpus_file = argv[++i];
+    else if (arg == "--repeat" && has_value)
+      repeat = std::atoi(argv[++i]);
+    else if (arg == "--costmap-cache" && has_value)
+      costmap_cache_dir = argv[++i];
+    else if (arg == "--output" && has_value)
+      output_file = argv[++i];
+    else if (arg == "--baseline" && has_value)
+      baseline_file = argv[++i];
+    else if (arg == "--tolerance" && has_value)
+      tolerance = std::atof(argv[++i]);
+    else if (arg == "--time-tolerance" && has_value)
+      time_tolerance = std::atof(argv[++i]);
+    else
+    {
+      std::cerr << usage;
+      return arg == "--help" || arg == "-h" ? 0 : 2;
+    }
+  }
+  if (repeat < 1 || pairs < 0)
+  {
+    std::cerr << usage;
+    return 2;
+  }
+
+  // some planners log to std::cout, the report on stdout stays plain JSON
+  std::cout.rdbuf(std::cerr.rdbuf());
+  for (const std::string& planner : planners)
+  {
+    if (!headless_sim::HeadlessWorld::isPlannerSupported(planner))
+    {
+      std::cerr << "Global planner " << planner << " is not available headless" << std::endl;
+      return 2;
+    }
+  }
+
+  // robot footprint, inflation and planner parameters of user_config, no pedestrians or obstacles
+  headless_sim::Scenario scenario;
+  std::string error;
+  if (!headless_sim::loadScenario(user_config_dir, sim_env_dir, scenario, error))
+  {
+    std::cerr << "Failed to load the scenario: " << error << std::endl;
+    return 2;
+  }
+  scenario.pedestrians.clear();
+  scenario.obstacles.clear();
+
+  if (maps.empty())
+  {
+    for (const auto& entry : std::filesystem::directory_iterator(sim_env_dir + "/maps"))
+    {
+      const std::string name = entry.path().filename().string();
+      if (entry.is_directory() && std::filesystem::exists(entry.path() / (name + ".yaml")))
+        maps.push_back(name);
+    }
+    std::sort(maps.begin(), maps.end());
+  }
+
+  YAML::Node corpus;
+  if (std::filesystem::exists(corpus_file))
+  {
+    try
+    {
+      corpus = YAML::LoadFile(corpus_file);
+    }
+    catch (const YAML::Exception& e)
+    {
+      std::cerr << "Failed to load the corpus " << corpus_file << ": " << e.what() << std::endl;
+      return 2;
+    }
+  }
+
+  std::vector<QueryResult> results;
+  std::ostringstream written_corpus;
+  for (const std::string& map : maps)
+  {
+    scenario.map_file = sim_env_dir + "/maps/" + map + "/" + map + ".yaml";
+    headless_sim::HeadlessWorld world(scenario);
+    if (!world.load(error, costmap_cache_dir.empty() ? "" : costmap_cache_dir + "/" + map + ".snap"))
+    {
+      std::cerr << "Failed to load the world: " << error << std::endl;
+      return 2;
+    }
+
+    std::vector<Query> queries;
+    if (corpus[map])
+    {
+      for (const auto& pair : corpus[map])
+      {
+        Query q;
+        q.start.x = pair[0].as<double>(), q.start.y = pair[1].as<double>();
+        q.goal.x = pair[2].as<double>(), q.goal.y = pair[3].as<double>();
+        queries.push_back(q);
+      }
+    }
+    else
+    {
+      queries = randomQueries(world, pairs, seed);
+      std::cerr << "Map " << map << " is not in the corpus, using " << queries.size() << " random pairs" << std::endl;
+    }
+    written_corpus << map << ":\n";
+    for (const Query& q : queries)
+    {
+      char line[128];
+      snprintf(line, sizeof(line), "  - [%.3f, %.3f, %.3f, %.3f]\n", q.start.x, q.start.y, q.goal.x, q.goal.y);
+      written_corpus << line;
+    }
+
+    for (const std::string& planner : planners)
+    {
+      for (size_t k = 0; k < queries.size(); k++)
+      {
+        QueryResult r = runQuery(world, planner, queries[k], repeat, querySeed(seed, k));
+        r.planner = planner;
+        r.map = map;
+        r.pair = static_cast<int>(k);
+        results.push_back(r);
+      }
+      std::cerr << map << " " << planner << " done" << std::endl;
+    }
+  }
+
+  if (!write_corpus_file.empty())
+  {
+    std::ofstream out(write_corpus_file);
+    out << "# start and goal positions [start_x, start_y, goal_x, goal_y] of planner_benchmark, per map of sim_env/maps\n"
+        << written_corpus.str();
+  }
+
+  std::vector<Summary> summaries;
+  for (const std::string& planner : planners)
+    summaries.push_back(summarize(planner, results, repeat));
+
+  // baseline comparison, by summary of the same planner
+  std::ostringstream comparison;
+  bool regression = false;
+  if (!baseline_file.empty())
+  {
+    YAML::Node baseline;
+    try
+    {
+      baseline = YAML::LoadFile(baseline_file);
+    }
+    catch (const YAML::Exception& e)
+    {
+      std::cerr << "Failed to load the baseline " << baseline_file << ": " << e.what() << std::endl;
+      return 2;
+    }
+
+    bool first = true;
+    for (const Summary& s : summaries)
+    {
+      YAML::Node base;
+      for (const auto& b : baseline["summary"])
+        if (b["planner"].as<std::string>() == s.planner)
+          base.reset(b);
+      if (!base.IsMap())
+        continue;
+
+      const double success_change = s.success_rate - base["success_rate"].as<double>();
+      const double time_ratio = ratio(s.time_median, base["time_median"].as<double>());
+      const double expanded_ratio = ratio(s.expanded_mean, base["expanded_mean"].as<double>());
+      const double memory_ratio = ratio(s.peak_memory_max, base["peak_memory_max"].as<double>());
+      const double length_ratio = ratio(s.length_mean, base["length_mean"].as<double>());
+      const double turning_ratio = ratio(s.turning_mean, base["turning_mean"].as<double>());
+
+      std::vector<std::string> regressions;
+      if (success_change < -tolerance)
+        regressions.push_back("success_rate");
+      if (time_ratio > 1.0 + time_tolerance)
+        regressions.push_back("time");
+      if (expanded_ratio > 1.0 + tolerance)
+        regressions.push_back("expanded");
+      if (memory_ratio > 1.0 + tolerance)
+        regressions.push_back("peak_memory");
+      if (length_ratio > 1.0 + tolerance)
+        regressions.push_back("length");
+      if (turning_ratio > 1.0 + tolerance)
+        regressions.push_back("turning");
+      regression |= !regressions.empty();
+
+      comparison << (first ? "" : ",\n") << "    {\"planner\": \"" << s.planner
+                 << "\", \"success_rate_change\": " << jsonNumber(success_change)
+                 << ", \"time_ratio\": " << jsonNumber(time_ratio) << ", \"expanded_ratio\": " << jsonNumber(expanded_ratio)
+                 << ", \"peak_memory_ratio\": " << jsonNumber(memory_ratio)
+                 << ", \"length_ratio\": " << jsonNumber(length_ratio)
+                 << ", \"turning_ratio\": " << jsonNumber(turning_ratio) << ", \"regressions\": [";
+      for (size_t i = 0; i < regressions.size(); i++)
+        comparison << (i ? ", " : "") << "\"" << regressions[i] << "\"";
+      comparison << "]}";
+      first = false;
+
+      for (const std::string& metric : regressions)
+        std::cerr << "Regression of " << s.planner << ": " << metric << std::endl;
+    }
+  }
+
+  // report
+  FILE* out = output_file.empty() ? stdout : fopen(output_file.c_str(), "w");
+  if (!out)
+  {
+    std::cerr << "Failed to open " << output_file << std::endl;
+    return 2;
+  }
+  struct rusage usage_info;
+  getrusage(RUSAGE_SELF, &usage_info);
+  fprintf(out, "{\n  \"repeat\": %d,\n  \"max_rss_kb\": %ld,\n  \"results\": [\n", repeat, usage_info.ru_maxrss);
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const QueryResult& r = results[i];
+    fprintf(out,
+            "    {\"planner\": \"%s\", \"map\": \"%s\", \"pair\": %d, \"found\": %d, \"time\": %s, \"expanded\": %s, "
+            "\"peak_memory\": %zu, \"length\": %s, \"turning\": %s}%s\n",
+            r.planner.c_str(), r.map.c_str(), r.pair, r.found, jsonNumber(r.time).c_str(),
+            jsonNumber(r.expanded).c_str(), r.peak_memory, jsonNumber(r.length).c_str(),
+            jsonNumber(r.turning).c_str(), i + 1 < results.size() ? "," : "");
+  }
+  fprintf(out, "  ],\n  \"summary\": [\n");
+  for (size_t i = 0; i < summaries.size(); i++)
+  {
+    const Summary& s = summaries[i];
+    fprintf(out,
+            "    {\"planner\": \"%s\", \"trials\": %d, \"success_rate\": %s, \"time_median\": %s, \"time_max\": %s, "
+            "\"expanded_mean\": %s, \"peak_memory_max\": %s, \"length_mean\": %s, \"turning_mean\": %s}%s\n",
+            s.planner.c_str(), s.trials, jsonNumber(s.success_rate).c_str(), jsonNumber(s.time_median).c_str(),
+            jsonNumber(s.time_max).c_str(), jsonNumber(s.expanded_mean).c_str(),
+            jsonNumber(s.peak_memory_max).c_str(), jsonNumber(s.length_mean).c_str(),
+            jsonNumber(s.turning_mean).c_str(), i + 1 < summaries.size() ? "," : "");
+  }
+  fprintf(out, "  ]");
+  if (!baseline_file.empty())
+    fprintf(out, ",\n  \"baseline\": \"%s\",\n  \"comparison\": [\n%s\n  ]", baseline_file.c_str(),
+            comparison.str().c_str());
+  fprintf(out, "\n}\n");
+  if (out != stdout)
+    fclose(out);
+
+  return regression ? 1 : 0;
+}
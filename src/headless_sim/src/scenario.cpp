@@ -0,0 +1,239 @@
+/***********************************************************
+ *
+ * @file: scenario.cpp
+ * @breif: Scenario of the headless simulator, read from the user_config and sim_env configure files
+ * @author: Yang Haodong
+ * @update: 2023-10-1
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include <yaml-cpp/yaml.h>
+
+#include "headless_sim/scenario.h"
+
+namespace headless_sim
+{
+namespace
+{
+/**
+ * @brief Parse a Gazebo pose string "x y z roll pitch yaw"
+ */
+Pose2D parsePose(const std::string& text)
+{
+  Pose2D pose;
+  double z, roll, pitch;
+  std::istringstream(text) >> pose.x >> pose.y >> z >> roll >> pitch >> pose.theta;
+  return pose;
+}
+
+/**
+ * @brief Read node[key] into value if it exists
+ */
+template <typename T>
+void read(const YAML::Node& node, const std::string& key, T& value)
+{
+  if (node[key])
+    value = node[key].as<T>();
+}
+
+/**
+ * @brief Robot settings as the generated move_base launch file would load them
+ */
+void loadRobot(const YAML::Node& user_cfg, const std::string& sim_env_dir, RobotConfig& robot)
+{
+  // only the first robot is simulated
+  const YAML::Node robot_cfg = user_cfg["robots_config"][0];
+  robot.type = robot_cfg["robot1_type"].as<std::string>();
+  read(robot_cfg, "robot1_global_planner", robot.global_planner);
+  read(robot_cfg, "robot1_local_planner", robot.local_planner);
+  robot.pose.x = std::stod(robot_cfg["robot1_x_pos"].as<std::string>());
+  robot.pose.y = std::stod(robot_cfg["robot1_y_pos"].as<std::string>());
+  robot.pose.theta = std::stod(robot_cfg["robot1_yaw"].as<std::string>());
+
+  const std::string config_dir = sim_env_dir + "/config/";
+  const YAML::Node common =
+      YAML::LoadFile(config_dir + robot.type + "/costmap_common_params_" + robot.type + ".yaml");
+  if (common["footprint"])
+  {
+    for (const auto& point : common["footprint"])
+    {
+      Pose2D p;
+      p.x = point[0].as<double>();
+      p.y = point[1].as<double>();
+      robot.footprint.push_back(p);
+    }
+  }
+  else
+  {
+    // a circular robot as a 16-gon
+    double radius = common["robot_radius"] ? common["robot_radius"].as<double>() : 0.2;
+    for (int i = 0; i < 16; i++)
+    {
+      Pose2D p;
+      p.x = radius * std::cos(i * M_PI / 8);
+      p.y = radius * std::sin(i * M_PI / 8);
+      robot.footprint.push_back(p);
+    }
+  }
+  read(common, "inflation_radius", robot.inflation_radius);
+  read(common, "cost_scaling_factor", robot.cost_scaling_factor);
+
+  const YAML::Node move_base = YAML::LoadFile(config_dir + "move_base_params.yaml");
+  read(move_base, "controller_frequency", robot.controller_frequency);
+  read(move_base, "planner_frequency", robot.planner_frequency);
+
+  const YAML::Node pid = YAML::LoadFile(config_dir + "planner/pid_planner_params.yaml")["PIDPlanner"];
+  read(pid, "p_window", robot.p_window);
+  read(pid, "p_precision", robot.p_precision);
+  read(pid, "o_precision", robot.o_precision);
+  read(pid, "max_v", robot.max_v);
+  read(pid, "min_v", robot.min_v);
+  read(pid, "max_v_inc", robot.max_v_inc);
+  read(pid, "max_w", robot.max_w);
+  read(pid, "min_w", robot.min_w);
+  read(pid, "max_w_inc", robot.max_w_inc);
+  read(pid, "k_v_p", robot.k_v_p);
+  read(pid, "k_v_i", robot.k_v_i);
+  read(pid, "k_v_d", robot.k_v_d);
+  read(pid, "k_w_p", robot.k_w_p);
+  read(pid, "k_w_i", robot.k_w_i);
+  read(pid, "k_w_d", robot.k_w_d);
+  read(pid, "k_theta", robot.k_theta);
+}
+
+/**
+ * @brief Global planner parameters as the generated move_base launch file would load them
+ */
+void loadPlanner(const std::string& sim_env_dir, PlannerConfig& planner)
+{
+  const std::string config_dir = sim_env_dir + "/config/planner/";
+  const YAML::Node graph = YAML::LoadFile(config_dir + "graph_planner_params.yaml")["GraphPlanner"];
+  read(graph, "outline_map", planner.outline_map);
+
+  const YAML::Node sample = YAML::LoadFile(config_dir + "sample_planner_params.yaml")["SamplePlanner"];
+  read(sample, "sample_points", planner.sample_points);
+  read(sample, "sample_max_d", planner.sample_max_d);
+  read(sample, "optimization_r", planner.optimization_r);
+
+  const YAML::Node evolutionary =
+      YAML::LoadFile(config_dir + "evolutionary_planner_params.yaml")["EvolutionaryPlanner"];
+  read(evolutionary, "n_ants", planner.n_ants);
+  read(evolutionary, "alpha", planner.alpha);
+  read(evolutionary, "beta", planner.beta);
+  read(evolutionary, "rho", planner.rho);
+  read(evolutionary, "Q", planner.Q);
+  read(evolutionary, "max_iter", planner.max_iter);
+  read(evolutionary, "n_particles", planner.n_particles);
+  read(evolutionary, "n_inherited", planner.n_inherited);
+  read(evolutionary, "pointNum", planner.point_num);
+  read(evolutionary, "max_speed", planner.max_speed);
+  read(evolutionary, "w_inertial", planner.w_inertial);
+  read(evolutionary, "w_social", planner.w_social);
+  read(evolutionary, "w_cognitive", planner.w_cognitive);
+  read(evolutionary, "initposmode", planner.init_pos_mode);
+  read(evolutionary, "pso_max_iter", planner.pso_max_iter);
+}
+
+/**
+ * @brief Pedestrians and social force weights of pedestrian_config.yaml
+ */
+void loadPedestrians(const YAML::Node& cfg, Scenario& scenario)
+{
+  const YAML::Node sfm = cfg["social_force"];
+  read(sfm, "people_distance", scenario.social_force.people_distance);
+  read(sfm, "goal_weight", scenario.social_force.goal_weight);
+  read(sfm, "obstacle_weight", scenario.social_force.obstacle_weight);
+  read(sfm, "social_weight", scenario.social_force.social_weight);
+  read(sfm, "group_gaze_weight", scenario.social_force.group_gaze_weight);
+  read(sfm, "group_coh_weight", scenario.social_force.group_coh_weight);
+  read(sfm, "group_rep_weight", scenario.social_force.group_rep_weight);
+
+  for (const auto& human : cfg["pedestrians"]["ped_property"])
+  {
+    PedestrianConfig ped;
+    ped.name = human["name"].as<std::string>();
+    ped.pose = parsePose(human["pose"].as<std::string>());
+    read(human, "velocity", ped.velocity);
+    read(human, "radius", ped.radius);
+    read(human, "cycle", ped.cycle);
+    read(human, "time_delay", ped.time_delay);
+    for (const auto& model : human["ignore"])
+      ped.ignore.push_back(model.second.as<std::string>());
+    for (const auto& goal : human["trajectory"])
+      ped.goals.push_back(parsePose(goal.second.as<std::string>()));
+    scenario.pedestrians.push_back(ped);
+  }
+}
+
+/**
+ * @brief Static obstacles of obstacles_config.yaml
+ */
+void loadObstacles(const YAML::Node& cfg, Scenario& scenario)
+{
+  for (const auto& obs : cfg["obstacles"])
+  {
+    ObstacleConfig obstacle;
+    obstacle.type = obs["type"].as<std::string>();
+    obstacle.pose = parsePose(obs["pose"].as<std::string>());
+    read(obs["props"], "w", obstacle.w);
+    read(obs["props"], "d", obstacle.d);
+    read(obs["props"], "r", obstacle.r);
+    scenario.obstacles.push_back(obstacle);
+  }
+}
+}  // namespace
+
+/**
+ * @brief Load a scenario like main.sh does
+ * @param user_config_dir directory of user_config.yaml and its plugin files
+ * @param sim_env_dir     directory of the sim_env package (maps and robot configures)
+ * @param scenario        the loaded scenario
+ * @param error           reason of a failure
+ * @return true if successful, else false
+ */
+bool loadScenario(const std::string& user_config_dir, const std::string& sim_env_dir, Scenario& scenario,
+                  std::string& error)
+{
+  scenario = Scenario();
+  try
+  {
+    const YAML::Node user_cfg = YAML::LoadFile(user_config_dir + "/user_config.yaml");
+    const std::string map = user_cfg["map"].as<std::string>();
+    if (map.empty())
+    {
+      error = "user_config.yaml has no map";
+      return false;
+    }
+    scenario.map_file = sim_env_dir + "/maps/" + map + "/" + map + ".yaml";
+
+    loadRobot(user_cfg, sim_env_dir, scenario.robot);
+    loadPlanner(sim_env_dir, scenario.planner);
+
+    const YAML::Node plugins = user_cfg["plugins"];
+    if (plugins && plugins["pedestrians"])
+      loadPedestrians(YAML::LoadFile(user_config_dir + "/" + plugins["pedestrians"].as<std::string>()), scenario);
+    if (plugins && plugins["obstacles"])
+      loadObstacles(YAML::LoadFile(user_config_dir + "/" + plugins["obstacles"].as<std::string>()), scenario);
+  }
+  catch (const YAML::Exception& e)
+  {
+    error = e.what();
+    return false;
+  }
+  catch (const std::invalid_argument& e)
+  {
+    error = std::string("bad robot pose: ") + e.what();
+    return false;
+  }
+
+  return true;
+}
+}  // namespace headless_sim
@@ -15,7 +15,6 @@
 #define ACO_H
 
 #include <thread>
-#include <mutex>
 
 #include "global_planner.h"
 
@@ -71,7 +70,23 @@ public:
   bool plan(const unsigned char* global_costmap, const Node& start, const Node& goal, std::vector<Node>& path,
             std::vector<Node>& expand);
 
-  void antSearch(const unsigned char* global_costmap, const Node& start, const Node& goal);
+  /**
+   * @brief Walk one ant from start towards goal, on the pheromone of the previous iterations
+   * @param global_costmap global costmap
+   * @param start         start node
+   * @param goal          goal node
+   * @param seed          seed of the ant's roulette selection, drawn from the planner's generator
+   * @param checks        incremented by the collision checks of the ant, recorded by plan() after the join
+   * @param ant           the ant after its walk, rewarded by plan() after the join
+   */
+  void antSearch(const unsigned char* global_costmap, const Node& start, const Node& goal, uint32_t seed,
+                 uint64_t& checks, Ant& ant);
+
+  /**
+   * @brief Keep the path of an ant that found the goal if it is the best yet, and reward it with pheromone
+   * @param ant ant after its walk
+   */
+  void antReward(const Ant& ant);
 
 protected:
   int n_ants_;           // number of ants
@@ -86,8 +101,6 @@ protected:
   std::vector<Node> motion_;  // all possible motions
   double* pheromone_edges_;   // pheromone matrix
 
-private:
-  std::mutex lock_;
 };
 }  // namespace global_planner
 #endif
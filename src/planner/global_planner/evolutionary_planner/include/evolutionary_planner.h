@@ -21,8 +21,12 @@
 #include <geometry_msgs/PoseStamped.h>
 
 #include <nav_msgs/GetPlan.h>
+#include <std_srvs/Trigger.h>
+#include <visualization_msgs/Marker.h>
 
 #include "global_planner.h"
+#include "instrumentation.h"
+#include "plan_recording.h"
 
 namespace evolutionary_planner
 {
@@ -95,6 +99,13 @@ public:
    */
   bool makePlanService(nav_msgs::GetPlan::Request& req, nav_msgs::GetPlan::Response& resp);
 
+  /**
+   * @brief Write the current costmap as a snapshot into snapshot_dir, for offline replay
+   * @param req  request from client
+   * @param resp response from server, the snapshot file or the reason of a failure
+   */
+  bool dumpCostmapService(std_srvs::Trigger::Request& req, std_srvs::Trigger::Response& resp);
+
 protected:
   /**
    * @brief Calculate plan from planning path
@@ -104,6 +115,13 @@ protected:
    */
   bool _getPlanFromPath(std::vector<global_planner::Node>& path, std::vector<geometry_msgs::PoseStamped>& plan);
 
+  /**
+   * @brief Publish the positions of a PSO particle
+   * @param positions particle positions in grid map
+   * @param index     particle index
+   */
+  void _publishParticle(const std::vector<std::pair<int, int>>& positions, int index);
+
   /**
    * @brief Tranform from costmap(x, y) to world map(x, y)
    * @param mx  costmap x
@@ -133,14 +151,25 @@ protected:
   double resolution_;                              // costmap resolution
   ros::Publisher plan_pub_;                        // path planning publisher
   ros::ServiceServer make_plan_srv_;               // planning service
+  ros::ServiceServer dump_costmap_srv_;            // costmap snapshot service
+  std::string snapshot_dir_;                       // directory of the costmap snapshots
+  ros::Publisher particle_pub_;                    // PSO particles publisher
   // std::string planner_name_;                       // planner name
 
+  std::unique_ptr<global_planner::PlanRecorder> recorder_;          // plan recorder, if record_plans
+  global_planner::PlanRecord record_template_;                      // planner and parameters of the records
+  instrumentation::CostmapCopy record_costmap_;                     // costs of the plan being recorded
+
 private:
   boost::mutex mutex_;     // thread mutex
   double convert_offset_;  // offset of transform from world(x,y) to grid map(x,y)
   double tolerance_;       // tolerance
   double factor_;          // obstacle inflation factor
   bool is_outline_;        // whether outline the boudary of map
+
+  instrumentation::Histogram* make_plan_time_;  // latency of makePlan
+  instrumentation::Histogram* search_time_;     // latency of the search alone
+  instrumentation::Counter* expansions_;        // nodes expanded by the searches
 };
 }  // namespace graph_planner
 #endif
\ No newline at end of file
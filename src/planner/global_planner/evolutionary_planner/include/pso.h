@@ -14,14 +14,13 @@
 #ifndef PSO_H
 #define PSO_H
 
+#include <functional>
 #include <random>
 #include <thread>
 #include <mutex>
 #include <vector>
 #include "global_planner.h"
 #include "trajectoryGeneration.h"
-#include <ros/ros.h>
-#include <visualization_msgs/Marker.h>
 
 using PositionSequence = std::vector<std::vector<std::pair<int, int>>>;
 
@@ -49,6 +48,12 @@ namespace global_planner
     }
   };
 
+  /**
+   * @brief Visualization hook called with the grid positions of a particle and its index after each update, from the
+   *        optimization threads
+   */
+  using ParticleCallback = std::function<void(const std::vector<std::pair<int, int>>& positions, int index)>;
+
   /**
    * @brief Class for objects that plan using the PSO algorithm
    */
@@ -61,8 +66,6 @@ namespace global_planner
      * @param nx            pixel number in costmap x direction
      * @param ny            pixel number in costmap y direction
      * @param resolution    costmap resolution
-     * @param origin_x      origin coordinate in the x direction.
-     * @param origin_y      origin coordinate in the y direction.
      * @param n_particles	  number of particles
      * @param n_inherited   number of inherited particles
      * @param pointNum      number of position points contained in each particle
@@ -71,10 +74,9 @@ namespace global_planner
      * @param w_cognitive	  cognitive weight
      * @param max_speed		  The maximum movement speed of particles
      * @param initposmode	  Set the generation mode for the initial position points of the particle swarm
-     * @param pub_particles Boolean flag to publish particles.
      * @param max_iter		  maximum iterations
      */
-    PSO(int nx, int ny, double resolution, double origin_x, double origin_y, int n_particles,int n_inherited, int pointNum , double w_inertial, double w_social, double w_cognitive, int max_speed,int initposmode ,bool pub_particles,int max_iter);
+    PSO(int nx, int ny, double resolution, int n_particles,int n_inherited, int pointNum , double w_inertial, double w_social, double w_cognitive, int max_speed,int initposmode ,int max_iter);
     ~PSO();
 
     /**
@@ -109,9 +111,11 @@ namespace global_planner
      * @brief Calculate Obstacle avoidance cost
      * @param global_costmap   global costmap
      * @param pso_path         Path to perform collision detection
+     * @param checks           incremented by the number of collision checks
      * @return  The collision cost of the path
      */
-    double ObstacleCost(const unsigned char* global_costmap,const std::vector<std::pair<double, double>>& pso_path);
+    double ObstacleCost(const unsigned char* global_costmap,const std::vector<std::pair<double, double>>& pso_path,
+                        uint64_t& checks);
 
     /**
      * @brief A function to update the particle velocity
@@ -137,10 +141,11 @@ namespace global_planner
      * @param index_i        Particle ID
      * @param global_costmap global costmap
      * @param gen            randomizer
+     * @param checks         incremented by the collision checks of the particle, recorded by plan() after the join
      */
     void optimizeParticle(Particle& particle, Particle& best_particle, const unsigned char* global_costmap, 
                                const std::pair<double, double>& start_d, const std::pair<double, double>& goal_d,
-                               const int& index_i,std::mt19937& gen) ;
+                               const int& index_i,std::mt19937& gen, uint64_t& checks) ;
     
     /**
      * @brief Clamps a value within a specified range.
@@ -171,16 +176,13 @@ namespace global_planner
 
 
     /**
-     * @brief Publishes particle markers based on given positions and index.
-     * @param positions   Vector of pairs representing positions (x, y) of particles.
-     * @param index       Index identifier for the particles.
+     * @brief Set the visualization hook of the particles, none by default
+     * @param callback  called after each particle update
      */
-    void publishParticleMarkers(const std::vector<std::pair<int, int>>& positions, const int& index);
+    void setParticleCallback(const ParticleCallback& callback);
 
 
   protected:
-    double origin_x_,origin_y_;   // origin coordinate in the x、y direction.
-    bool pub_particles_;          // boolean flag to publish particles.
     int max_iter_;                // maximum iterations
     int n_particles_;             // number of particles
     int n_inherited_;             // number of inherited particles
@@ -190,7 +192,7 @@ namespace global_planner
     int initposmode_;             // Set the generation mode for the initial position points of the particle swarm
     
   private:
-    ros::Publisher particle_pub;                    //The publisher of real-time particle visualization 
+    ParticleCallback particle_callback_;            //real-time particle visualization
     int GlobalBest_particle_;                       //The ID of the globally optimal particle
     std::mutex particles_lock_;                     //thread lock
     std::vector<Particle> inherited_particles_;     //inherited particles
@@ -17,6 +17,7 @@
 #include <iostream>
 
 #include "aco.h"
+#include "instrumentation.h"
 
 namespace global_planner
 {
@@ -69,20 +70,31 @@ bool ACO::plan(const unsigned char* global_costmap, const Node& start, const Nod
   // heuristically set max steps
   int max_steps = nx_ * ny_ / 2;
 
-  // main loop
+  // main loop, the ants count their collision checks apart so that their short-lived threads never touch the metric,
+  // and are rewarded in their order after the join, so that a seed gives the same path whatever the thread timing
+  static instrumentation::Counter& collision_checks =
+      instrumentation::counter("evolutionary_planner_collision_checks_total");
+  std::vector<uint64_t> checks(n_ants_, 0);
   best_path_length_ = std::numeric_limits<int>::max();
+  best_path_.clear();
   for (size_t i = 0; i < max_iter_; i++)
   {
+    std::vector<Ant> ants(n_ants_);
     std::vector<std::thread> ants_list = std::vector<std::thread>(n_ants_);
     for (size_t j = 0; j < n_ants_; j++)
-      ants_list[j] = std::thread(&ACO::antSearch, this, global_costmap, start, goal);
+      ants_list[j] = std::thread(&ACO::antSearch, this, global_costmap, start, goal, static_cast<uint32_t>(rng_()),
+                                 std::ref(checks[j]), std::ref(ants[j]));
     for (size_t j = 0; j < n_ants_; j++)
       ants_list[j].join();
+    for (const Ant& ant : ants)
+      antReward(ant);
 
     // pheromone deterioration
     for (size_t k = 0; k < nx_ * ny_ * motion_.size(); k++)
       pheromone_edges_[k] *= (1 - rho_);
   }
+  for (size_t j = 0; j < n_ants_; j++)
+    collision_checks.add(checks[j]);
 
   if (best_path_.size() > 0)
   {
@@ -92,10 +104,12 @@ bool ACO::plan(const unsigned char* global_costmap, const Node& start, const Nod
   return false;
 }
 
-void ACO::antSearch(const unsigned char* global_costmap, const Node& start, const Node& goal)
+void ACO::antSearch(const unsigned char* global_costmap, const Node& start, const Node& goal, uint32_t seed,
+                    uint64_t& checks, Ant& ant)
 {
   int max_steps = nx_ * ny_ / 2;
-  Ant ant(start);
+  ant = Ant(start);
+  std::mt19937 engine(seed);
 
   while ((!ant.found_goal_) && (ant.cur_node_ != goal) && (ant.steps_ < max_steps))
   {
@@ -106,6 +120,7 @@ void ACO::antSearch(const unsigned char* global_costmap, const Node& start, cons
     std::vector<Node> next_positions;
     std::vector<double> next_probabilities;
 
+    checks += motion_.size();
     for (size_t z = 0; z < motion_.size(); z++)
     {
       Node node_n = ant.cur_node_ + motion_[z];
@@ -141,15 +156,15 @@ void ACO::antSearch(const unsigned char* global_costmap, const Node& start, cons
 
     // roulette selection
     std::for_each(next_probabilities.begin(), next_probabilities.end(), [&](double& p) { p /= prob_sum; });
-    std::random_device device;
-    std::mt19937 engine(device());
     std::discrete_distribution<> dist(next_probabilities.begin(), next_probabilities.end());
     ant.cur_node_ = next_positions[dist(engine)];
     ant.steps_ += 1;
   }
+}
 
+void ACO::antReward(const Ant& ant)
+{
   // pheromone update based on successful ants
-  lock_.lock();
   if (ant.found_goal_)
   {
     if (static_cast<int>(ant.path_.size()) < best_path_length_)
@@ -185,7 +200,6 @@ void ACO::antSearch(const unsigned char* global_costmap, const Node& start, cons
       pheromone_edges_[motion_.size() * px + nx_ * py + z] += c;
     }
   }
-  lock_.unlock();
 }
 
 }  // namespace global_planner
\ No newline at end of file
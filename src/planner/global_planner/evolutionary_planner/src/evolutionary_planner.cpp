@@ -13,10 +13,14 @@
  **********************************************************/
 #include "evolutionary_planner.h"
 #include <pluginlib/class_list_macros.h>
+#include <random>
 
 #include "aco.h"
 #include "pso.h"
 
+#include "costmap_dump.h"
+#include "metrics_publisher.h"
+
 PLUGINLIB_EXPORT_CLASS(evolutionary_planner::EvolutionaryPlanner, nav_core::BaseGlobalPlanner)
 
 namespace evolutionary_planner
@@ -24,7 +28,13 @@ namespace evolutionary_planner
 /**
  * @brief Construct a new Graph Planner object
  */
-EvolutionaryPlanner::EvolutionaryPlanner() : initialized_(false), costmap_(nullptr), g_planner_(nullptr)
+EvolutionaryPlanner::EvolutionaryPlanner()
+  : initialized_(false)
+  , costmap_(nullptr)
+  , g_planner_(nullptr)
+  , make_plan_time_(nullptr)
+  , search_time_(nullptr)
+  , expansions_(nullptr)
 {
 }
 
@@ -108,6 +118,9 @@ void EvolutionaryPlanner::initialize(std::string name, costmap_2d::Costmap2D* co
       private_nh.param("max_iter", max_iter, 100);  // maximum iterations
 
       g_planner_ = new global_planner::ACO(nx_, ny_, resolution_, n_ants, alpha, beta, rho, Q, max_iter);
+      record_template_.params = { { "n_ants", std::to_string(n_ants) }, { "alpha", std::to_string(alpha) },
+                                  { "beta", std::to_string(beta) },     { "rho", std::to_string(rho) },
+                                  { "Q", std::to_string(Q) },           { "max_iter", std::to_string(max_iter) } };
     }
     else if (planner_name == "pso")
     {
@@ -125,16 +138,70 @@ void EvolutionaryPlanner::initialize(std::string name, costmap_2d::Costmap2D* co
       private_nh.param("pub_particles", pub_particles, false);     // Whether to publish particles
       private_nh.param("pso_max_iter", pso_max_iter, 30);      // maximum iterations
 
-      g_planner_ = new global_planner::PSO(nx_, ny_, resolution_ ,origin_x_,origin_y_, n_particles,n_inherited, pointNum, w_inertial, w_social, w_cognitive,max_speed ,initposmode ,pub_particles,pso_max_iter);
+      global_planner::PSO* pso = new global_planner::PSO(nx_, ny_, resolution_, n_particles, n_inherited, pointNum,
+                                                         w_inertial, w_social, w_cognitive, max_speed, initposmode,
+                                                         pso_max_iter);
+      if (pub_particles)
+      {
+        ros::NodeHandle nh;
+        particle_pub_ = nh.advertise<visualization_msgs::Marker>("particle_swarm_markers", 10);
+        pso->setParticleCallback([this](const std::vector<std::pair<int, int>>& positions, int index) {
+          _publishParticle(positions, index);
+        });
+      }
+      g_planner_ = pso;
+      record_template_.params = { { "n_particles", std::to_string(n_particles) },
+                                  { "n_inherited", std::to_string(n_inherited) },
+                                  { "pointNum", std::to_string(pointNum) },
+                                  { "max_speed", std::to_string(max_speed) },
+                                  { "w_inertial", std::to_string(w_inertial) },
+                                  { "w_social", std::to_string(w_social) },
+                                  { "w_cognitive", std::to_string(w_cognitive) },
+                                  { "initposmode", std::to_string(initposmode) },
+                                  { "pso_max_iter", std::to_string(pso_max_iter) } };
     }
 
     ROS_INFO("Using global graph planner: %s", planner_name.c_str());
 
+    // latency and expansion metrics, published on ~metrics
+    const std::string labels = "planner=\"" + planner_name + "\"";
+    make_plan_time_ = &instrumentation::histogram("planner_latency_seconds", labels + ",phase=\"make_plan\"");
+    search_time_ = &instrumentation::histogram("planner_latency_seconds", labels + ",phase=\"search\"");
+    expansions_ = &instrumentation::counter("planner_expansions_total", labels);
+    instrumentation::startMetricsPublisher();
+
     // register planning publisher
     plan_pub_ = private_nh.advertise<nav_msgs::Path>("plan", 1);
 
     // register planning service
     make_plan_srv_ = private_nh.advertiseService("make_plan", &EvolutionaryPlanner::makePlanService, this);
+
+    // register costmap snapshot service
+    private_nh.param("snapshot_dir", snapshot_dir_, (std::string) "/tmp");
+    dump_costmap_srv_ = private_nh.advertiseService("dump_costmap", &EvolutionaryPlanner::dumpCostmapService, this);
+
+    // record every plan request, to replay it offline with headless_sim plan_replay
+    bool record_plans;
+    private_nh.param("record_plans", record_plans, false);
+    if (record_plans)
+    {
+      global_planner::PlanRecorder::Options options;
+      int max_file_size;
+      private_nh.param("record_dir", options.directory, (std::string) "/tmp");
+      private_nh.param("record_max_file_size", max_file_size, 64);  // [MB]
+      private_nh.param("record_max_files", options.max_files, 8);
+      options.prefix = name + "_" + planner_name;
+      options.max_file_size = static_cast<size_t>(max_file_size) << 20;
+      recorder_.reset(new global_planner::PlanRecorder(options));
+
+      // common parameters first, those of the algorithm were set above
+      record_template_.planner = planner_name;
+      record_template_.params.insert(record_template_.params.begin(),
+                                     { { "convert_offset", std::to_string(convert_offset_) },
+                                       { "outline_map", is_outline_ ? "true" : "false" },
+                                       { "obstacle_factor", std::to_string(factor_) } });
+      ROS_INFO("Recording plans into %s", options.directory.c_str());
+    }
   }
   else
   {
@@ -166,13 +233,17 @@ bool EvolutionaryPlanner::makePlan(const geometry_msgs::PoseStamped& start, cons
 bool EvolutionaryPlanner::makePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal,
                                    double tolerance, std::vector<geometry_msgs::PoseStamped>& plan)
 {
-  // start thread mutex
-  boost::mutex::scoped_lock lock(mutex_);
   if (!initialized_)
   {
     ROS_ERROR("This planner has not been initialized yet, but it is being used, please call initialize() before use");
     return false;
   }
+
+  // the costmap before the thread mutex, in the order of move_base, which calls makePlan with the costmap locked
+  boost::unique_lock<costmap_2d::Costmap2D::mutex_t> costmap_lock(*costmap_->getMutex());
+  boost::mutex::scoped_lock lock(mutex_);
+  instrumentation::ScopedTimer make_plan_timer(*make_plan_time_);
+
   // clear existing plan
   plan.clear();
 
@@ -226,10 +297,28 @@ bool EvolutionaryPlanner::makePlan(const geometry_msgs::PoseStamped& start, cons
   if (is_outline_)
     g_planner_->outlineMap(costmap_->getCharMap());
 
+  // a fresh seed per recorded plan, so that its replay draws the same numbers, and the costs the plan runs on
+  if (recorder_)
+  {
+    g_planner_->setSeed(std::random_device()());
+    instrumentation::copyCostmap(costmap_, record_costmap_);
+  }
+
   // calculate path
   std::vector<global_planner::Node> path;
   std::vector<global_planner::Node> expand;
-  bool path_found = g_planner_->plan(costmap_->getCharMap(), start_node, goal_node, path, expand);
+  bool path_found;
+  double search_time;
+  {
+    instrumentation::ScopedTimer search_timer(*search_time_);
+    path_found = g_planner_->plan(costmap_->getCharMap(), start_node, goal_node, path, expand);
+    search_time = search_timer.elapsed();
+  }
+  expansions_->add(expand.size());
+
+  if (recorder_)
+    instrumentation::recordPlan(*recorder_, record_template_, start, goal, start_node, goal_node, tolerance,
+                                g_planner_->getSeed(), path_found, path, expand.size(), search_time, record_costmap_);
 
   if (path_found)
   {
@@ -294,6 +383,54 @@ bool EvolutionaryPlanner::makePlanService(nav_msgs::GetPlan::Request& req, nav_m
   return true;
 }
 
+/**
+ * @brief Write the current costmap as a snapshot into snapshot_dir, for offline replay
+ * @param req  request from client
+ * @param resp response from server, the snapshot file or the reason of a failure
+ * @return true
+ */
+bool EvolutionaryPlanner::dumpCostmapService(std_srvs::Trigger::Request& req, std_srvs::Trigger::Response& resp)
+{
+  std::string result;
+  resp.success = global_planner::dumpCostmap(costmap_, mutex_, snapshot_dir_, result);
+  resp.message = result;
+
+  return true;
+}
+
+/**
+ * @brief Publish the positions of a PSO particle
+ * @param positions particle positions in grid map
+ * @param index     particle index
+ */
+void EvolutionaryPlanner::_publishParticle(const std::vector<std::pair<int, int>>& positions, int index)
+{
+  visualization_msgs::Marker marker;
+  marker.header.frame_id = frame_id_;
+  marker.header.stamp = ros::Time::now();
+  marker.ns = "particle_swarm";
+  marker.id = index;
+  marker.type = visualization_msgs::Marker::POINTS;
+  marker.action = visualization_msgs::Marker::ADD;
+  marker.pose.orientation.w = 1.0;
+  marker.scale.x = 0.1;
+  marker.scale.y = 0.1;
+  marker.color.r = 1.0;
+  marker.color.a = 1.0;
+
+  for (const auto& position : positions)
+  {
+    geometry_msgs::Point p;
+    p.x = origin_x_ + position.first * resolution_;
+    p.y = origin_y_ + position.second * resolution_;
+    p.z = 0.0;
+    marker.points.push_back(p);
+  }
+  marker.lifetime = ros::Duration(1.0);
+
+  particle_pub_.publish(marker);
+}
+
 /**
  * @brief Calculate plan from planning path
  * @param path  path generated by global planner
@@ -17,6 +17,7 @@
 #include <iostream>
 #include <cmath>
 #include "pso.h"
+#include "instrumentation.h"
 
 
 namespace global_planner
@@ -26,8 +27,6 @@ namespace global_planner
    * @param nx            pixel number in costmap x direction
    * @param ny            pixel number in costmap y direction
    * @param resolution    costmap resolution
-   * @param origin_x      origin coordinate in the x direction.
-   * @param origin_y      origin coordinate in the y direction.
    * @param n_particles	  number of particles
    * @param n_inherited   number of inherited particles
    * @param pointNum      number of position points contained in each particle
@@ -36,13 +35,10 @@ namespace global_planner
    * @param w_cognitive	  cognitive weight
    * @param max_speed		  The maximum movement speed of particles
    * @param initposmode	  Set the generation mode for the initial position points of the particle swarm
-   * @param pub_particles Boolean flag to publish particles.
    * @param max_iter		  maximum iterations
    */
-  PSO::PSO(int nx, int ny, double resolution, double origin_x, double origin_y,int n_particles,int n_inherited,int pointNum , double w_inertial, double w_social, double w_cognitive, int max_speed, int initposmode, bool pub_particles,int max_iter)
+  PSO::PSO(int nx, int ny, double resolution,int n_particles,int n_inherited,int pointNum , double w_inertial, double w_social, double w_cognitive, int max_speed, int initposmode,int max_iter)
     : GlobalPlanner(nx, ny, resolution)
-    , origin_x_(origin_x)
-    , origin_y_(origin_y)
     , n_particles_(n_particles)
     , n_inherited_(n_inherited)
     , pointNum_(pointNum)
@@ -51,15 +47,11 @@ namespace global_planner
     , w_cognitive_(w_cognitive)
     , max_speed_(max_speed)
     , initposmode_(initposmode)
-    , pub_particles_(pub_particles)
     , max_iter_(max_iter)
   {
      inherited_particles_.emplace_back(std::vector<std::pair<int, int>>(pointNum, std::make_pair(1, 1)),
                                  std::vector<std::pair<int, int>>(pointNum, std::make_pair(0, 0)),
                                  0.0);
-    // Initialize ROS publisher
-    ros::NodeHandle nh;
-    particle_pub = nh.advertise<visualization_msgs::Marker>("particle_swarm_markers", 10);
   }
 
   PSO::~PSO()
@@ -90,6 +82,10 @@ namespace global_planner
     std::vector<std::pair<double, double>> initial_point;
     std::pair<double, double> start_d(static_cast<double>(start.x_), static_cast<double>(start.y_));
     std::pair<double, double>  goal_d(static_cast<double>(goal.x_), static_cast<double>(goal.y_));
+    // counted apart per particle, so that the short-lived particle threads never touch the metric
+    static instrumentation::Counter& collision_checks =
+        instrumentation::counter("evolutionary_planner_collision_checks_total");
+    std::vector<uint64_t> checks(n_particles_ + 1, 0);
    
     //Generate initial position of particle swarm
     if(initposmode_==1){generateRandomInitialPositions(initialPositions,start_d,goal_d);}
@@ -119,7 +115,7 @@ namespace global_planner
       //Calculate path length
       pathLength = path_generation.calculatePathLength(initial_point);
       //collision detection
-      obstacle_cost=ObstacleCost(global_costmap,initial_point);
+      obstacle_cost=ObstacleCost(global_costmap,initial_point,checks[n_particles_]);
       //Calculate particle fitness
       initial_fitness = 100000.0 / (pathLength + 1000*obstacle_cost);
 
@@ -137,9 +133,10 @@ namespace global_planner
 
     std::cout<<"PSO:  Successfully generated initial particle swarm"<<std::endl;
 
-    //random data
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    //random data, one generator per particle thread, seeded from the planner's generator
+    std::vector<std::mt19937> gens;
+    for (size_t i = 0; i < n_particles_; ++i)
+      gens.emplace_back(rng_());
 
     std::cout<<"PSO:Particle swarm iteration progress : "<<std::endl;
 
@@ -150,12 +147,14 @@ namespace global_planner
 
       std::vector<std::thread> particle_list = std::vector<std::thread>(n_particles_);
       for (size_t i = 0; i < n_particles_; ++i)
-        particle_list[i] = std::thread(&PSO::optimizeParticle, this, std::ref(particles[i]), std::ref(Best_particle), std::cref(global_costmap), std::cref(start_d), std::cref(goal_d), i, std::ref(gen));
+        particle_list[i] = std::thread(&PSO::optimizeParticle, this, std::ref(particles[i]), std::ref(Best_particle), std::cref(global_costmap), std::cref(start_d), std::cref(goal_d), i, std::ref(gens[i]), std::ref(checks[i]));
       for (size_t i = 0; i < n_particles_; ++i)
         particle_list[i].join();
 
       Best_particle.position=particles[GlobalBest_particle_].personal_best_pos; 
     }
+    for (uint64_t n : checks)
+      collision_checks.add(n);
 
     //Generating Paths from Optimal Particles
     path_generation.GenerateControlPoints(start_d,goal_d,Best_particle.position,initial_point);
@@ -201,9 +200,8 @@ namespace global_planner
   // Generate n particles with pointNum_ positions each within the map range
   void PSO::generateRandomInitialPositions(PositionSequence &initialPositions,const std::pair<double, double> start_d,const std::pair<double, double> goal_d)
   {
-      // Use a random device and engine to generate random numbers
-      std::random_device rd;
-      std::mt19937 gen(rd());
+      // Use the planner's engine to generate random numbers
+      std::mt19937& gen = rng_;
       int x[pointNum_], y[pointNum_];
       int point_id;
 
@@ -251,9 +249,8 @@ namespace global_planner
   // Generate n particles with pointNum_ positions each within the map range
   void PSO::generateCircularInitialPositions(PositionSequence &initialPositions,const std::pair<double, double> start_d,const std::pair<double, double> goal_d)
   {
-      // Use a random device and engine to generate random numbers
-      std::random_device rd;
-      std::mt19937 gen(rd());
+      // Use the planner's engine to generate random numbers
+      std::mt19937& gen = rng_;
       int x[pointNum_], y[pointNum_];
       int point_id;
       //Calculate sequence direction
@@ -315,8 +312,11 @@ namespace global_planner
   }
 
   //Calculate Obstacle avoidance cost
-  double PSO::ObstacleCost(const unsigned char* global_costmap,const std::vector<std::pair<double, double>>& pso_path)
+  double PSO::ObstacleCost(const unsigned char* global_costmap,const std::vector<std::pair<double, double>>& pso_path,
+                           uint64_t& checks)
   {
+    checks += pso_path.empty() ? 0 : pso_path.size() - 1;
+
     int point_index;
     double Obscost=1;
 
@@ -376,7 +376,7 @@ namespace global_planner
   }
 
   // Particle update optimization iteration
-  void PSO::optimizeParticle(Particle& particle, Particle& best_particle, const unsigned char* global_costmap, const std::pair<double, double>& start_d, const std::pair<double, double>& goal_d,const int& index_i,std::mt19937& gen)
+  void PSO::optimizeParticle(Particle& particle, Particle& best_particle, const unsigned char* global_costmap, const std::pair<double, double>& start_d, const std::pair<double, double>& goal_d,const int& index_i,std::mt19937& gen, uint64_t& checks)
   {
 
     std::vector<std::pair<double, double>> process_path;
@@ -393,7 +393,7 @@ namespace global_planner
     //Calculate path length
     double pathLength = path_generation.calculatePathLength(process_path);
     //collision detection
-    double obstacle_cost=ObstacleCost(global_costmap,process_path);
+    double obstacle_cost=ObstacleCost(global_costmap,process_path,checks);
     //Calculate particle fitness
     particle.fitness = 100000.0 / (pathLength + 1000*obstacle_cost);
 
@@ -405,7 +405,7 @@ namespace global_planner
     }
 
     // Publish particle markers
-    if(pub_particles_){publishParticleMarkers(particle.position, index_i);}
+    if(particle_callback_){particle_callback_(particle.position, index_i);}
 
     //Update global optimal particles
     particles_lock_.lock();
@@ -421,36 +421,9 @@ namespace global_planner
   }
 
 
-  void PSO::publishParticleMarkers(const std::vector<std::pair<int, int>>& positions, const int& index) 
+  void PSO::setParticleCallback(const ParticleCallback& callback)
   {
-    visualization_msgs::Marker marker;
-    marker.header.frame_id = "map";
-    marker.header.stamp = ros::Time::now();
-    marker.ns = "particle_swarm";
-    marker.id = index;
-    marker.type = visualization_msgs::Marker::POINTS;
-    marker.action = visualization_msgs::Marker::ADD;
-    marker.pose.orientation.w = 1.0;
-    marker.scale.x = 0.1;
-    marker.scale.y = 0.1;
-    marker.color.r = 1.0;
-    marker.color.a = 1.0;
-
-    // Convert particle positions to geometry_msgs::Point
-    for (const auto& position : positions) {
-      geometry_msgs::Point p;
-      p.x = origin_x_ + position.first * resolution_;
-      p.y = origin_y_ + position.second * resolution_;
-      p.z = 0.0;
-      marker.points.push_back(p);
-    }
-
-    // Set the lifetime of the marker (e.g., 1 second)
-    marker.lifetime = ros::Duration(1.0);
-
-    particle_pub.publish(marker);
+    particle_callback_ = callback;
   }
 
-
-
 }  // namespace global_planner
\ No newline at end of file
@@ -0,0 +1,38 @@
+/***********************************************************
+ *
+ * @file: costmap_dump.h
+ * @breif: Costmap snapshots of a running planner plugin, for the dump_costmap service
+ * @author: Yang Haodong
+ * @update: 2023-10-8
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#ifndef COSTMAP_DUMP_H
+#define COSTMAP_DUMP_H
+
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+#include <costmap_2d/costmap_2d.h>
+
+namespace global_planner
+{
+/**
+ * @brief Write a costmap as a snapshot with obstacle bitmap and distance field into directory, named by the ROS time.
+ *        Only copying the costs holds the costmap lock (costmap updates) and then the planner mutex (outlineMap), the
+ *        distance field and the file write run on the copy.
+ * @param costmap       costmap of the planner
+ * @param planner_mutex mutex of the planner plugin, held while it writes into the costs
+ * @param directory     directory of the snapshots
+ * @param result        snapshot file, or the reason of a failure
+ * @return true if successful, else false
+ */
+bool dumpCostmap(costmap_2d::Costmap2D* costmap, boost::mutex& planner_mutex, const std::string& directory,
+                 std::string& result);
+}  // namespace global_planner
+
+#endif
@@ -0,0 +1,145 @@
+/***********************************************************
+ *
+ * @file: costmap_snapshot.h
+ * @breif: Memory-mapped binary costmap snapshots, for fast planner startup and offline replay
+ * @author: Yang Haodong
+ * @update: 2023-10-8
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#ifndef COSTMAP_SNAPSHOT_H
+#define COSTMAP_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace global_planner
+{
+/**
+ * @brief A costmap saved as one binary file that is mapped instead of parsed:
+ *          header (resolution, origin, size, section offsets), 128 bytes
+ *          raw cost bytes, nx * ny, row-major as Costmap2D::getCharMap()
+ *          optional obstacle bitmap, one bit per cell (cost >= OBSTACLE_COST), least significant bit first
+ *          optional distance field, one float per cell, distance to the nearest obstacle cell [m]
+ *        Every section starts on a 64 byte boundary. Numbers are stored in the byte order of the host.
+ *        The mapping is private: planners may write into costs(), e.g. outlineMap, without touching the file.
+ */
+class CostmapSnapshot
+{
+public:
+  enum Layer
+  {
+    OBSTACLE_BITMAP = 1 << 0,
+    DISTANCE_FIELD = 1 << 1
+  };
+
+  CostmapSnapshot() = default;
+  ~CostmapSnapshot();
+  CostmapSnapshot(const CostmapSnapshot&) = delete;
+  CostmapSnapshot& operator=(const CostmapSnapshot&) = delete;
+
+  /**
+   * @brief Save a costmap. The file is written next to path and renamed, so readers never map a partial snapshot.
+   * @param path       snapshot file
+   * @param costs      cost values, nx * ny
+   * @param nx         pixel number in costmap x direction
+   * @param ny         pixel number in costmap y direction
+   * @param resolution costmap resolution
+   * @param origin_x   costmap origin x in the world frame
+   * @param origin_y   costmap origin y in the world frame
+   * @param layers     optional layers to derive from the costs, OBSTACLE_BITMAP | DISTANCE_FIELD
+   * @param error      reason of a failure
+   * @return true if successful, else false
+   */
+  static bool write(const std::string& path, const unsigned char* costs, int nx, int ny, double resolution,
+                    double origin_x, double origin_y, int layers, std::string& error);
+
+  /**
+   * @brief Map a snapshot, closing the previous one
+   * @param path  snapshot file
+   * @param error reason of a failure
+   * @return true if successful, else false
+   */
+  bool open(const std::string& path, std::string& error);
+
+  /**
+   * @brief Unmap the snapshot
+   */
+  void close();
+
+  bool isOpen() const
+  {
+    return data_ != nullptr;
+  }
+
+  /**
+   * @brief Cost values, to be passed to GlobalPlanner::plan as they are
+   */
+  unsigned char* costs() const
+  {
+    return costs_;
+  }
+
+  /**
+   * @brief Obstacle bitmap, nullptr if the snapshot has none
+   */
+  const uint8_t* obstacleBitmap() const
+  {
+    return bitmap_;
+  }
+
+  /**
+   * @brief Check if a cell is an obstacle, from the bitmap
+   */
+  bool isObstacle(int x, int y) const
+  {
+    const size_t i = static_cast<size_t>(y) * nx_ + x;
+    return (bitmap_[i >> 3] >> (i & 7)) & 1;
+  }
+
+  /**
+   * @brief Distance field [m], nullptr if the snapshot has none
+   */
+  const float* distanceField() const
+  {
+    return distance_;
+  }
+
+  int sizeX() const
+  {
+    return nx_;
+  }
+  int sizeY() const
+  {
+    return ny_;
+  }
+  double resolution() const
+  {
+    return resolution_;
+  }
+  double originX() const
+  {
+    return origin_x_;
+  }
+  double originY() const
+  {
+    return origin_y_;
+  }
+
+private:
+  void* data_ = nullptr;
+  size_t size_ = 0;
+  unsigned char* costs_ = nullptr;
+  const uint8_t* bitmap_ = nullptr;
+  const float* distance_ = nullptr;
+  int nx_ = 0, ny_ = 0;
+  double resolution_ = 0.0, origin_x_ = 0.0, origin_y_ = 0.0;
+};
+}  // namespace global_planner
+
+#endif
@@ -18,8 +18,10 @@
 #define LETHAL_COST 253      // lethal cost
 #define NEUTRAL_COST 50      // neutral cost
 #define OBSTACLE_FACTOR 0.5  // obstacle factor
+#define OBSTACLE_COST 254    // obstacle cost, i.e. costmap_2d::LETHAL_OBSTACLE
 
-#include <costmap_2d/cost_values.h>
+#include <cstdint>
+#include <random>
 #include <unordered_set>
 
 #include "nodes.h"
@@ -89,6 +91,17 @@ public:
    */
   void setFactor(double factor);
 
+  /**
+   * @brief Seed the random number generator of the sample and evolutionary planners, for reproducible plans
+   * @param seed seed
+   */
+  void setSeed(uint32_t seed);
+
+  /**
+   * @brief Seed of the random number generator, set by setSeed or drawn at construction
+   */
+  uint32_t getSeed() const;
+
   /**
    * @brief Transform from grid map(x, y) to grid index(i)
    * @param x grid map x
@@ -170,6 +183,9 @@ protected:
   double resolution_;
   // obstacle factor(greater means obstacles)
   double factor_;
+  // random number generator and its seed
+  std::mt19937 rng_;
+  uint32_t seed_;
 };
 }  // namespace global_planner
 #endif  // PLANNER_HPP
\ No newline at end of file
@@ -0,0 +1,248 @@
+/***********************************************************
+ *
+ * @file: plan_recorder.h
+ * @breif: Asynchronous capture of plan requests into rolling binary files, and their reader for offline replay
+ * @author: Yang Haodong
+ * @update: 2023-10-9
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#ifndef PLAN_RECORDER_H
+#define PLAN_RECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace global_planner
+{
+/**
+ * @brief One makePlan call: the request, the planner and its parameters, and what came out
+ */
+struct PlanRecord
+{
+  double stamp = 0.0;                                       // wall time of the request [s]
+  std::string planner;                                      // planner name, e.g. a_star
+  std::vector<std::pair<std::string, std::string>> params;  // planner parameters, named as in the yaml files
+  double start_x = 0.0, start_y = 0.0;                      // start in the world frame [m]
+  double goal_x = 0.0, goal_y = 0.0;                        // goal in the world frame [m]
+  int start_gx = 0, start_gy = 0;                           // start cell given to the planner
+  int goal_gx = 0, goal_gy = 0;                             // goal cell given to the planner
+  double tolerance = 0.0;                                   // goal tolerance [m]
+  uint32_t seed = 0;                                        // seed of GlobalPlanner::setSeed
+  uint64_t costmap_version = 0;                             // costmap the plan ran on, set by the recorder
+  bool found = false;                                       // whether the planner found a path
+  std::vector<std::pair<int, int>> path;                    // cells of the path, as returned by the planner
+  uint64_t expanded = 0;                                    // nodes expanded by the search
+  double search_time = 0.0;                                 // duration of GlobalPlanner::plan [s]
+};
+
+/**
+ * @brief Writes plan records from a background thread, so that the planning thread never waits for the disk.
+ *        The costs a plan ran on are copied with it and stored as a full costmap when the size changes or a file
+ *        starts, else as the runs of cells changed since the previous record. Files roll over at max_file_size,
+ *        the oldest one is deleted beyond max_files.
+ */
+class PlanRecorder
+{
+public:
+  struct Options
+  {
+    std::string directory = "/tmp";         // directory of the record files
+    std::string prefix = "plans";           // file names are <prefix>_<date>_<time>_<n>.rec
+    size_t max_file_size = 64 << 20;        // roll over beyond this size [bytes]
+    int max_files = 8;                      // record files kept
+    size_t max_queued = 8;                  // records waiting for the writer before new ones are dropped
+  };
+
+  /**
+   * @brief Construct a new Plan Recorder object and start its writer thread
+   * @param options record files and queue
+   */
+  explicit PlanRecorder(const Options& options);
+
+  /**
+   * @brief Write the queued records and stop the writer thread
+   */
+  ~PlanRecorder();
+
+  PlanRecorder(const PlanRecorder&) = delete;
+  PlanRecorder& operator=(const PlanRecorder&) = delete;
+
+  /**
+   * @brief Queue a record with a copy of the costs it ran on. Never waits for the writer: the record is dropped if
+   *        too many are queued.
+   * @param record     plan record
+   * @param costs      cost values the planner got, nx * ny
+   * @param nx         pixel number in costmap x direction
+   * @param ny         pixel number in costmap y direction
+   * @param resolution costmap resolution
+   * @param origin_x   costmap origin x in the world frame
+   * @param origin_y   costmap origin y in the world frame
+   * @return true if queued, false if dropped
+   */
+  bool record(PlanRecord record, const unsigned char* costs, int nx, int ny, double resolution, double origin_x,
+              double origin_y);
+
+  /**
+   * @brief Queue a record with costs the caller already copied, without copying them again. Never waits for the
+   *        writer: the record is dropped if too many are queued.
+   * @param record     plan record
+   * @param costs      cost values the planner got, nx * ny. If queued, swapped with a buffer of an earlier record, so
+   *                   that a caller reusing it does not allocate once the buffers are warm.
+   * @param nx         pixel number in costmap x direction
+   * @param ny         pixel number in costmap y direction
+   * @param resolution costmap resolution
+   * @param origin_x   costmap origin x in the world frame
+   * @param origin_y   costmap origin y in the world frame
+   * @return true if queued, false if dropped
+   */
+  bool record(PlanRecord record, std::vector<unsigned char>&& costs, int nx, int ny, double resolution,
+              double origin_x, double origin_y);
+
+  /**
+   * @brief Number of records dropped so far
+   */
+  uint64_t dropped() const
+  {
+    return dropped_;
+  }
+
+  /**
+   * @brief Error of the last write, empty if it succeeded
+   */
+  std::string error() const;
+
+private:
+  struct Entry
+  {
+    PlanRecord record;
+    std::vector<unsigned char> costs;
+    int nx, ny;
+    double resolution, origin_x, origin_y;
+  };
+
+  /**
+   * @brief A free entry for the next record, nullptr (and the record counted as dropped) if too many are queued
+   */
+  std::unique_ptr<Entry> _acquire();
+
+  /**
+   * @brief Complete an entry holding the costs and hand it to the writer thread
+   */
+  void _queue(std::unique_ptr<Entry> entry, PlanRecord&& record, int nx, int ny, double resolution, double origin_x,
+              double origin_y);
+
+  /**
+   * @brief Writer thread: writes queued records until stopped and the queue is empty
+   */
+  void _run();
+
+  /**
+   * @brief Append the costmap changes and the plan record of an entry to the current file
+   * @param entry queued entry, its cost buffer is swapped with the previous costs
+   * @param error reason of a failure
+   * @return true if successful, else false
+   */
+  bool _write(Entry& entry, std::string& error);
+
+  /**
+   * @brief Close the current file, start a new one and delete the oldest beyond max_files
+   * @param error reason of a failure
+   * @return true if successful, else false
+   */
+  bool _roll(std::string& error);
+
+  Options options_;
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::unique_ptr<Entry>> queue_;
+  std::vector<std::unique_ptr<Entry>> free_;  // entries with cost buffers to reuse
+  bool stop_ = false;
+  std::atomic<uint64_t> dropped_{ 0 };
+  std::string error_;
+
+  // writer thread only
+  FILE* file_ = nullptr;
+  size_t file_size_ = 0;
+  int file_count_ = 0;
+  std::deque<std::string> files_;
+  std::vector<unsigned char> last_costs_;  // costs of the previous record of the file
+  int last_nx_ = 0, last_ny_ = 0;
+  double last_resolution_ = 0.0, last_origin_x_ = 0.0, last_origin_y_ = 0.0;
+  uint64_t version_ = 0;
+
+  std::thread thread_;
+};
+
+/**
+ * @brief Reads a record file of PlanRecorder and keeps the costmap of the record read last
+ */
+class PlanRecordReader
+{
+public:
+  ~PlanRecordReader();
+
+  /**
+   * @brief Open a record file
+   * @param path  record file
+   * @param error reason of a failure
+   * @return true if successful, else false
+   */
+  bool open(const std::string& path, std::string& error);
+
+  /**
+   * @brief Read the next plan record and apply the costmap changes before it
+   * @param record plan record
+   * @param error  reason of a failure, empty at the end of the file
+   * @return true if a record was read, else false
+   */
+  bool next(PlanRecord& record, std::string& error);
+
+  const std::vector<unsigned char>& costs() const
+  {
+    return costs_;
+  }
+  int sizeX() const
+  {
+    return nx_;
+  }
+  int sizeY() const
+  {
+    return ny_;
+  }
+  double resolution() const
+  {
+    return resolution_;
+  }
+  double originX() const
+  {
+    return origin_x_;
+  }
+  double originY() const
+  {
+    return origin_y_;
+  }
+
+private:
+  FILE* file_ = nullptr;
+  std::vector<unsigned char> costs_;
+  int nx_ = 0, ny_ = 0;
+  double resolution_ = 0.0, origin_x_ = 0.0, origin_y_ = 0.0;
+  uint64_t version_ = 0;
+};
+}  // namespace global_planner
+
+#endif
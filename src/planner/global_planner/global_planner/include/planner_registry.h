@@ -0,0 +1,114 @@
+/***********************************************************
+ *
+ * @file: planner_registry.h
+ * @breif: Named factories of global planners and the instances built from them, kept sized to the costmap
+ * @author: Yang Haodong
+ * @update: 2023-10-10
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#ifndef PLANNER_REGISTRY_H
+#define PLANNER_REGISTRY_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "global_planner.h"
+
+namespace global_planner
+{
+/**
+ * @brief Builds global planners by name and owns one instance per name. Instances are built on first use or ahead
+ *        of time by prewarm, so that switching between planners at runtime does not allocate, and are rebuilt when
+ *        the costmap size or resolution changes.
+ */
+class PlannerRegistry
+{
+public:
+  /**
+   * @brief Builds a planner for a costmap size, e.g. [](int nx, int ny, double r) { return new AStar(nx, ny, r); }
+   */
+  using Factory = std::function<GlobalPlanner*(int nx, int ny, double resolution)>;
+
+  /**
+   * @brief Construct a new Planner Registry object
+   * @param nx         pixel number in costmap x direction
+   * @param ny         pixel number in costmap y direction
+   * @param resolution costmap resolution
+   */
+  PlannerRegistry(int nx = 0, int ny = 0, double resolution = 0.0);
+
+  /**
+   * @brief Register a planner, replacing an earlier one of the same name and its instance
+   * @param name    planner name, e.g. a_star
+   * @param factory builds the planner
+   */
+  void add(const std::string& name, Factory factory);
+
+  /**
+   * @brief Check if a planner is registered
+   * @param name planner name
+   * @return true if registered, else false
+   */
+  bool contains(const std::string& name) const;
+
+  /**
+   * @brief Names of all registered planners, sorted
+   */
+  std::vector<std::string> names() const;
+
+  /**
+   * @brief Build a new planner, owned by the caller
+   * @param name       planner name
+   * @param nx         pixel number in costmap x direction
+   * @param ny         pixel number in costmap y direction
+   * @param resolution costmap resolution
+   * @return the planner, nullptr if the name is not registered
+   */
+  std::unique_ptr<GlobalPlanner> create(const std::string& name, int nx, int ny, double resolution) const;
+
+  /**
+   * @brief Instance of a planner for the current costmap size, built if there is none yet
+   * @param name planner name
+   * @return the instance, owned by the registry and valid until setSize, add or clear; nullptr if the name is not
+   *         registered
+   */
+  GlobalPlanner* acquire(const std::string& name);
+
+  /**
+   * @brief Build the instances of planners ahead of their first use
+   * @param names planner names, unregistered ones are skipped
+   * @return number of instances built or already there
+   */
+  int prewarm(const std::vector<std::string>& names);
+
+  /**
+   * @brief Follow a costmap size change: all instances are rebuilt for the new size
+   * @param nx         pixel number in costmap x direction
+   * @param ny         pixel number in costmap y direction
+   * @param resolution costmap resolution
+   * @return true if the size changed, false if it was the same
+   */
+  bool setSize(int nx, int ny, double resolution);
+
+  /**
+   * @brief Release all instances, the factories stay registered
+   */
+  void clear();
+
+private:
+  std::map<std::string, Factory> factories_;
+  std::map<std::string, std::unique_ptr<GlobalPlanner>> instances_;
+  int nx_, ny_;        // costmap size of the instances
+  double resolution_;  // costmap resolution of the instances
+};
+}  // namespace global_planner
+
+#endif
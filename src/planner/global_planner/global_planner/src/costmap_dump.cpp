@@ -0,0 +1,66 @@
+/***********************************************************
+ *
+ * @file: costmap_dump.cpp
+ * @breif: Costmap snapshots of a running planner plugin, for the dump_costmap service
+ * @author: Yang Haodong
+ * @update: 2023-10-8
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <cstdio>
+#include <vector>
+
+#include <ros/ros.h>
+
+#include "costmap_dump.h"
+#include "costmap_snapshot.h"
+
+namespace global_planner
+{
+/**
+ * @brief Write a costmap as a snapshot with obstacle bitmap and distance field into directory, named by the ROS time
+ * @param costmap       costmap of the planner
+ * @param planner_mutex mutex of the planner plugin, held while it writes into the costs
+ * @param directory     directory of the snapshots
+ * @param result        snapshot file, or the reason of a failure
+ * @return true if successful, else false
+ */
+bool dumpCostmap(costmap_2d::Costmap2D* costmap, boost::mutex& planner_mutex, const std::string& directory,
+                 std::string& result)
+{
+  std::vector<unsigned char> costs;
+  int nx, ny;
+  double resolution, origin_x, origin_y;
+  {
+    // the order of move_base, which calls makePlan with the costmap locked
+    boost::unique_lock<costmap_2d::Costmap2D::mutex_t> costmap_lock(*costmap->getMutex());
+    boost::mutex::scoped_lock lock(planner_mutex);
+    nx = costmap->getSizeInCellsX();
+    ny = costmap->getSizeInCellsY();
+    resolution = costmap->getResolution();
+    origin_x = costmap->getOriginX();
+    origin_y = costmap->getOriginY();
+    costs.assign(costmap->getCharMap(), costmap->getCharMap() + static_cast<size_t>(nx) * ny);
+  }
+
+  char stamp[32];
+  snprintf(stamp, sizeof(stamp), "%.3f", ros::Time::now().toSec());
+  const std::string path = directory + "/costmap_" + stamp + ".snap";
+  std::string error;
+  if (!CostmapSnapshot::write(path, costs.data(), nx, ny, resolution, origin_x, origin_y,
+                              CostmapSnapshot::OBSTACLE_BITMAP | CostmapSnapshot::DISTANCE_FIELD, error))
+  {
+    ROS_ERROR("%s", error.c_str());
+    result = error;
+    return false;
+  }
+
+  ROS_INFO("Costmap snapshot written to %s", path.c_str());
+  result = path;
+  return true;
+}
+}  // namespace global_planner
@@ -0,0 +1,332 @@
+/***********************************************************
+ *
+ * @file: costmap_snapshot.cpp
+ * @breif: Memory-mapped binary costmap snapshots, for fast planner startup and offline replay
+ * @author: Yang Haodong
+ * @update: 2023-10-8
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "costmap_snapshot.h"
+#include "global_planner.h"
+
+namespace global_planner
+{
+namespace
+{
+const char kMagic[8] = { 'C', 'M', 'S', 'N', 'A', 'P', '\0', '\0' };
+const uint32_t kVersion = 1;
+const uint64_t kAlignment = 64;
+
+/**
+ * @brief File header, followed by the sections it points to. An offset of 0 means the layer is absent.
+ */
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t layers;
+  int32_t nx, ny;
+  double resolution;
+  double origin_x, origin_y;
+  uint64_t costs_offset;
+  uint64_t bitmap_offset;
+  uint64_t distance_offset;
+  uint64_t file_size;
+  uint8_t reserved[48];
+};
+static_assert(sizeof(Header) % kAlignment == 0, "the costs must start on a 64 byte boundary");
+
+uint64_t align(uint64_t offset)
+{
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+/**
+ * @brief 1D squared Euclidean distance transform of Felzenszwalb and Huttenlocher, in place
+ * @param f squared distances along one line, infinity where unknown
+ * @param n line length
+ * @param v, z, d scratch buffers of n, n + 1 and n elements
+ */
+void distanceTransform1D(float* f, int n, std::vector<int>& v, std::vector<float>& z, std::vector<float>& d)
+{
+  const float inf = std::numeric_limits<float>::infinity();
+  int k = -1;
+  for (int q = 0; q < n; q++)
+  {
+    if (f[q] == inf)
+      continue;
+    // parabola of q replaces those it lies below at their intersection
+    float s = 0.0f;
+    while (k >= 0)
+    {
+      s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * (q - v[k]));
+      if (s > z[k])
+        break;
+      k--;
+    }
+    k++;
+    v[k] = q;
+    z[k] = k == 0 ? -inf : s;
+    z[k + 1] = inf;
+  }
+  if (k < 0)
+    return;
+
+  for (int q = 0, j = 0; q < n; q++)
+  {
+    while (z[j + 1] < q)
+      j++;
+    d[q] = (q - v[j]) * (q - v[j]) + f[v[j]];
+  }
+  std::memcpy(f, d.data(), n * sizeof(float));
+}
+
+/**
+ * @brief Exact distance from every cell to the nearest obstacle cell [m], infinity without obstacles
+ */
+std::vector<float> computeDistanceField(const unsigned char* costs, int nx, int ny, double resolution)
+{
+  const float inf = std::numeric_limits<float>::infinity();
+  std::vector<float> field(static_cast<size_t>(nx) * ny);
+  for (size_t i = 0; i < field.size(); i++)
+    field[i] = costs[i] >= OBSTACLE_COST ? 0.0f : inf;
+
+  const int n = std::max(nx, ny);
+  std::vector<int> v(n);
+  std::vector<float> z(n + 1), d(n), column(ny);
+  for (int y = 0; y < ny; y++)
+    distanceTransform1D(&field[static_cast<size_t>(y) * nx], nx, v, z, d);
+  for (int x = 0; x < nx; x++)
+  {
+    for (int y = 0; y < ny; y++)
+      column[y] = field[static_cast<size_t>(y) * nx + x];
+    distanceTransform1D(column.data(), ny, v, z, d);
+    for (int y = 0; y < ny; y++)
+      field[static_cast<size_t>(y) * nx + x] = std::sqrt(column[y]) * resolution;
+  }
+  return field;
+}
+
+bool writeAll(int fd, const void* data, size_t size, std::string& error)
+{
+  const char* p = static_cast<const char*>(data);
+  while (size > 0)
+  {
+    const ssize_t n = ::write(fd, p, size);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      error = std::strerror(errno);
+      return false;
+    }
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool writePadding(int fd, uint64_t& offset, std::string& error)
+{
+  static const char zeros[kAlignment] = {};
+  const uint64_t next = align(offset);
+  if (!writeAll(fd, zeros, next - offset, error))
+    return false;
+  offset = next;
+  return true;
+}
+}  // namespace
+
+CostmapSnapshot::~CostmapSnapshot()
+{
+  close();
+}
+
+/**
+ * @brief Save a costmap. The file is written next to path and renamed, so readers never map a partial snapshot.
+ * @param path       snapshot file
+ * @param costs      cost values, nx * ny
+ * @param nx         pixel number in costmap x direction
+ * @param ny         pixel number in costmap y direction
+ * @param resolution costmap resolution
+ * @param origin_x   costmap origin x in the world frame
+ * @param origin_y   costmap origin y in the world frame
+ * @param layers     optional layers to derive from the costs, OBSTACLE_BITMAP | DISTANCE_FIELD
+ * @param error      reason of a failure
+ * @return true if successful, else false
+ */
+bool CostmapSnapshot::write(const std::string& path, const unsigned char* costs, int nx, int ny, double resolution,
+                            double origin_x, double origin_y, int layers, std::string& error)
+{
+  if (nx <= 0 || ny <= 0)
+  {
+    error = "empty costmap";
+    return false;
+  }
+  const uint64_t cells = static_cast<uint64_t>(nx) * ny;
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.layers = layers & (OBSTACLE_BITMAP | DISTANCE_FIELD);
+  header.nx = nx, header.ny = ny;
+  header.resolution = resolution;
+  header.origin_x = origin_x, header.origin_y = origin_y;
+  header.costs_offset = sizeof(Header);
+  uint64_t end = header.costs_offset + cells;
+  if (header.layers & OBSTACLE_BITMAP)
+  {
+    header.bitmap_offset = align(end);
+    end = header.bitmap_offset + (cells + 7) / 8;
+  }
+  if (header.layers & DISTANCE_FIELD)
+  {
+    header.distance_offset = align(end);
+    end = header.distance_offset + cells * sizeof(float);
+  }
+  header.file_size = end;
+
+  const std::string tmp_path = path + ".tmp";
+  const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    error = "failed to create " + tmp_path + ": " + std::strerror(errno);
+    return false;
+  }
+
+  bool ok = writeAll(fd, &header, sizeof(header), error) && writeAll(fd, costs, cells, error);
+  uint64_t offset = header.costs_offset + cells;
+  if (ok && (header.layers & OBSTACLE_BITMAP))
+  {
+    std::vector<uint8_t> bitmap((cells + 7) / 8, 0);
+    for (uint64_t i = 0; i < cells; i++)
+      if (costs[i] >= OBSTACLE_COST)
+        bitmap[i >> 3] |= 1 << (i & 7);
+    ok = writePadding(fd, offset, error) && writeAll(fd, bitmap.data(), bitmap.size(), error);
+    offset += bitmap.size();
+  }
+  if (ok && (header.layers & DISTANCE_FIELD))
+  {
+    const std::vector<float> field = computeDistanceField(costs, nx, ny, resolution);
+    ok = writePadding(fd, offset, error) && writeAll(fd, field.data(), field.size() * sizeof(float), error);
+  }
+
+  if (::close(fd) != 0 && ok)
+  {
+    error = std::strerror(errno);
+    ok = false;
+  }
+  if (ok && std::rename(tmp_path.c_str(), path.c_str()) != 0)
+  {
+    error = std::strerror(errno);
+    ok = false;
+  }
+  if (!ok)
+  {
+    error = "failed to write " + path + ": " + error;
+    std::remove(tmp_path.c_str());
+  }
+  return ok;
+}
+
+/**
+ * @brief Map a snapshot, closing the previous one
+ * @param path  snapshot file
+ * @param error reason of a failure
+ * @return true if successful, else false
+ */
+bool CostmapSnapshot::open(const std::string& path, std::string& error)
+{
+  close();
+
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    error = "failed to open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)))
+  {
+    ::close(fd);
+    error = path + " is not a costmap snapshot";
+    return false;
+  }
+  // private and writable: the pages are shared with the page cache until a planner writes into the costs
+  void* data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+  {
+    error = "failed to map " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  data_ = data;
+  size_ = st.st_size;
+
+  const Header& header = *static_cast<const Header*>(data_);
+  const uint64_t cells = static_cast<uint64_t>(header.nx) * header.ny;
+  const auto fits = [&](uint64_t offset, uint64_t bytes) { return offset > 0 && offset + bytes <= size_; };
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+    error = path + " is not a costmap snapshot";
+  else if (header.version != kVersion)
+    error = path + " has snapshot version " + std::to_string(header.version) + ", expected " +
+            std::to_string(kVersion);
+  else if (header.nx <= 0 || header.ny <= 0 || header.file_size != size_ || !fits(header.costs_offset, cells) ||
+           ((header.layers & OBSTACLE_BITMAP) && !fits(header.bitmap_offset, (cells + 7) / 8)) ||
+           ((header.layers & DISTANCE_FIELD) && !fits(header.distance_offset, cells * sizeof(float))))
+    error = path + " is truncated or corrupt";
+  else
+    error.clear();
+  if (!error.empty())
+  {
+    close();
+    return false;
+  }
+
+  char* base = static_cast<char*>(data_);
+  nx_ = header.nx, ny_ = header.ny;
+  resolution_ = header.resolution;
+  origin_x_ = header.origin_x, origin_y_ = header.origin_y;
+  costs_ = reinterpret_cast<unsigned char*>(base + header.costs_offset);
+  if (header.layers & OBSTACLE_BITMAP)
+    bitmap_ = reinterpret_cast<const uint8_t*>(base + header.bitmap_offset);
+  if (header.layers & DISTANCE_FIELD)
+    distance_ = reinterpret_cast<const float*>(base + header.distance_offset);
+  return true;
+}
+
+/**
+ * @brief Unmap the snapshot
+ */
+void CostmapSnapshot::close()
+{
+  if (data_)
+    munmap(data_, size_);
+  data_ = nullptr;
+  size_ = 0;
+  costs_ = nullptr;
+  bitmap_ = nullptr;
+  distance_ = nullptr;
+  nx_ = ny_ = 0;
+  resolution_ = origin_x_ = origin_y_ = 0.0;
+}
+}  // namespace global_planner
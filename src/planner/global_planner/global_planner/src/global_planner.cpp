@@ -26,6 +26,7 @@ GlobalPlanner::GlobalPlanner(int nx, int ny, double resolution)
 {
   setSize(nx, ny);
   setResolution(resolution);
+  setSeed(std::random_device()());
 }
 
 /**
@@ -72,6 +73,24 @@ void GlobalPlanner::setFactor(double factor)
   factor_ = factor;
 }
 
+/**
+ * @brief Seed the random number generator of the sample and evolutionary planners, for reproducible plans
+ * @param seed seed
+ */
+void GlobalPlanner::setSeed(uint32_t seed)
+{
+  seed_ = seed;
+  rng_.seed(seed);
+}
+
+/**
+ * @brief Seed of the random number generator, set by setSeed or drawn at construction
+ */
+uint32_t GlobalPlanner::getSeed() const
+{
+  return seed_;
+}
+
 /**
  * @brief Transform from grid map(x, y) to grid index(i)
  * @param x grid map x
@@ -147,16 +166,16 @@ void GlobalPlanner::outlineMap(unsigned char* costarr)
 {
   unsigned char* pc = costarr;
   for (int i = 0; i < nx_; i++)
-    *pc++ = costmap_2d::LETHAL_OBSTACLE;
+    *pc++ = OBSTACLE_COST;
   pc = costarr + (ny_ - 1) * nx_;
   for (int i = 0; i < nx_; i++)
-    *pc++ = costmap_2d::LETHAL_OBSTACLE;
+    *pc++ = OBSTACLE_COST;
   pc = costarr;
   for (int i = 0; i < ny_; i++, pc += nx_)
-    *pc = costmap_2d::LETHAL_OBSTACLE;
+    *pc = OBSTACLE_COST;
   pc = costarr + nx_ - 1;
   for (int i = 0; i < ny_; i++, pc += nx_)
-    *pc = costmap_2d::LETHAL_OBSTACLE;
+    *pc = OBSTACLE_COST;
 }
 
 /**
@@ -0,0 +1,646 @@
+/***********************************************************
+ *
+ * @file: plan_recorder.cpp
+ * @breif: Asynchronous capture of plan requests into rolling binary files, and their reader for offline replay
+ * @author: Yang Haodong
+ * @update: 2023-10-9
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include "plan_recorder.h"
+
+namespace global_planner
+{
+namespace
+{
+/*
+ * A record file is the magic and the format version, followed by chunks of a 4 byte tag, a 4 byte payload size and
+ * the payload. Values are stored in the byte order of the host, as in the costmap snapshots.
+ *   COST: costmap version, size, resolution, origin and all costs
+ *   DLTA: costmap version and runs of (offset, length, costs) changed since the costmap before
+ *   PLAN: a PlanRecord, planned on the costmap of the chunks before it
+ */
+const char kMagic[8] = { 'P', 'L', 'A', 'N', 'R', 'E', 'C', '\0' };
+const uint32_t kVersion = 1;
+const uint32_t kCostTag = 0x54534f43;   // "COST"
+const uint32_t kDeltaTag = 0x41544c44;  // "DLTA"
+const uint32_t kPlanTag = 0x4e414c50;   // "PLAN"
+const size_t kRunGap = 16;  // unchanged cells a delta run spans rather than starting a new one
+const uint32_t kMaxChunk = 1u << 30;
+
+/**
+ * @brief Chunk under construction
+ */
+class ChunkWriter
+{
+public:
+  void begin(uint32_t tag)
+  {
+    data_.clear();
+    put(tag);
+    put(static_cast<uint32_t>(0));
+  }
+
+  template <typename T>
+  void put(const T& value)
+  {
+    putBytes(&value, sizeof(T));
+  }
+
+  void putBytes(const void* data, size_t size)
+  {
+    const char* p = static_cast<const char*>(data);
+    data_.insert(data_.end(), p, p + size);
+  }
+
+  void putString(const std::string& str)
+  {
+    put(static_cast<uint32_t>(str.size()));
+    putBytes(str.data(), str.size());
+  }
+
+  /**
+   * @brief Overwrite a value written before, e.g. a count only known at the end
+   */
+  template <typename T>
+  void patch(size_t offset, const T& value)
+  {
+    std::memcpy(&data_[offset], &value, sizeof(T));
+  }
+
+  size_t size() const
+  {
+    return data_.size();
+  }
+
+  /**
+   * @brief Write the chunk with its payload size
+   */
+  bool flush(FILE* file, size_t& file_size, std::string& error)
+  {
+    patch(sizeof(uint32_t), static_cast<uint32_t>(data_.size() - 2 * sizeof(uint32_t)));
+    if (fwrite(data_.data(), 1, data_.size(), file) != data_.size())
+    {
+      error = std::string("Failed to write plan record: ") + std::strerror(errno);
+      return false;
+    }
+    file_size += data_.size();
+    return true;
+  }
+
+private:
+  std::vector<char> data_;
+};
+
+/**
+ * @brief Payload of a chunk being read
+ */
+class ChunkReader
+{
+public:
+  explicit ChunkReader(const std::vector<char>& data) : data_(data), pos_(0), ok_(true)
+  {
+  }
+
+  template <typename T>
+  T get()
+  {
+    T value{};
+    getBytes(&value, sizeof(T));
+    return value;
+  }
+
+  void getBytes(void* data, size_t size)
+  {
+    if (!ok_ || size > data_.size() - pos_)
+    {
+      ok_ = false;
+      return;
+    }
+    std::memcpy(data, &data_[pos_], size);
+    pos_ += size;
+  }
+
+  std::string getString()
+  {
+    const uint32_t size = get<uint32_t>();
+    std::string str;
+    if (ok_ && size <= data_.size() - pos_)
+    {
+      str.assign(&data_[pos_], size);
+      pos_ += size;
+    }
+    else
+      ok_ = false;
+    return str;
+  }
+
+  bool ok() const
+  {
+    return ok_;
+  }
+
+private:
+  const std::vector<char>& data_;
+  size_t pos_;
+  bool ok_;
+};
+}  // namespace
+
+/**
+ * @brief Construct a new Plan Recorder object and start its writer thread
+ * @param options record files and queue
+ */
+PlanRecorder::PlanRecorder(const Options& options) : options_(options)
+{
+  thread_ = std::thread(&PlanRecorder::_run, this);
+}
+
+/**
+ * @brief Write the queued records and stop the writer thread
+ */
+PlanRecorder::~PlanRecorder()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_one();
+  thread_.join();
+}
+
+/**
+ * @brief Queue a record with a copy of the costs it ran on. Never waits for the writer: the record is dropped if
+ *        too many are queued.
+ * @param record     plan record
+ * @param costs      cost values the planner got, nx * ny
+ * @param nx         pixel number in costmap x direction
+ * @param ny         pixel number in costmap y direction
+ * @param resolution costmap resolution
+ * @param origin_x   costmap origin x in the world frame
+ * @param origin_y   costmap origin y in the world frame
+ * @return true if queued, false if dropped
+ */
+bool PlanRecorder::record(PlanRecord record, const unsigned char* costs, int nx, int ny, double resolution,
+                          double origin_x, double origin_y)
+{
+  std::unique_ptr<Entry> entry = _acquire();
+  if (!entry)
+    return false;
+
+  // the copy is the only work on the planning thread, diffing and writing happen on the writer thread
+  entry->costs.assign(costs, costs + static_cast<size_t>(nx) * ny);
+  _queue(std::move(entry), std::move(record), nx, ny, resolution, origin_x, origin_y);
+  return true;
+}
+
+/**
+ * @brief Queue a record with costs the caller already copied, without copying them again. Never waits for the
+ *        writer: the record is dropped if too many are queued.
+ * @param record     plan record
+ * @param costs      cost values the planner got, nx * ny. If queued, swapped with a buffer of an earlier record, so
+ *                   that a caller reusing it does not allocate once the buffers are warm.
+ * @param nx         pixel number in costmap x direction
+ * @param ny         pixel number in costmap y direction
+ * @param resolution costmap resolution
+ * @param origin_x   costmap origin x in the world frame
+ * @param origin_y   costmap origin y in the world frame
+ * @return true if queued, false if dropped
+ */
+bool PlanRecorder::record(PlanRecord record, std::vector<unsigned char>&& costs, int nx, int ny, double resolution,
+                          double origin_x, double origin_y)
+{
+  std::unique_ptr<Entry> entry = _acquire();
+  if (!entry)
+    return false;
+
+  entry->costs.swap(costs);
+  _queue(std::move(entry), std::move(record), nx, ny, resolution, origin_x, origin_y);
+  return true;
+}
+
+/**
+ * @brief A free entry for the next record, nullptr (and the record counted as dropped) if too many are queued
+ */
+std::unique_ptr<PlanRecorder::Entry> PlanRecorder::_acquire()
+{
+  std::unique_ptr<Entry> entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_.size() >= options_.max_queued)
+    {
+      dropped_++;
+      return nullptr;
+    }
+    if (!free_.empty())
+    {
+      entry = std::move(free_.back());
+      free_.pop_back();
+    }
+  }
+  if (!entry)
+    entry.reset(new Entry());
+  return entry;
+}
+
+/**
+ * @brief Complete an entry holding the costs and hand it to the writer thread
+ */
+void PlanRecorder::_queue(std::unique_ptr<Entry> entry, PlanRecord&& record, int nx, int ny, double resolution,
+                          double origin_x, double origin_y)
+{
+  entry->record = std::move(record);
+  entry->nx = nx;
+  entry->ny = ny;
+  entry->resolution = resolution;
+  entry->origin_x = origin_x;
+  entry->origin_y = origin_y;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(entry));
+  }
+  cond_.notify_one();
+}
+
+/**
+ * @brief Error of the last write, empty if it succeeded
+ */
+std::string PlanRecorder::error() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return error_;
+}
+
+/**
+ * @brief Writer thread: writes queued records until stopped and the queue is empty
+ */
+void PlanRecorder::_run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true)
+  {
+    cond_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty())
+      break;
+
+    std::unique_ptr<Entry> entry = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+
+    std::string error;
+    const bool written = _write(*entry, error);
+
+    lock.lock();
+    // the writer retries with the next record, e.g. after the disk was cleaned up
+    error_ = written ? "" : error;
+    free_.push_back(std::move(entry));
+  }
+
+  if (file_)
+  {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+/**
+ * @brief Append the costmap changes and the plan record of an entry to the current file
+ * @param entry queued entry, its cost buffer is swapped with the previous costs
+ * @param error reason of a failure
+ * @return true if successful, else false
+ */
+bool PlanRecorder::_write(Entry& entry, std::string& error)
+{
+  if (!file_ || file_size_ >= options_.max_file_size)
+  {
+    if (!_roll(error))
+      return false;
+  }
+
+  ChunkWriter chunk;
+  const size_t n = entry.costs.size();
+  if (last_costs_.size() != n || entry.nx != last_nx_ || entry.ny != last_ny_ ||
+      entry.resolution != last_resolution_ || entry.origin_x != last_origin_x_ || entry.origin_y != last_origin_y_)
+  {
+    // new file or another costmap: store it whole
+    chunk.begin(kCostTag);
+    chunk.put(++version_);
+    chunk.put(static_cast<int32_t>(entry.nx));
+    chunk.put(static_cast<int32_t>(entry.ny));
+    chunk.put(entry.resolution);
+    chunk.put(entry.origin_x);
+    chunk.put(entry.origin_y);
+    chunk.putBytes(entry.costs.data(), n);
+    if (!chunk.flush(file_, file_size_, error))
+      return false;
+  }
+  else
+  {
+    // runs of changed cells, short unchanged gaps are included to save run headers
+    const unsigned char* costs = entry.costs.data();
+    const unsigned char* last = last_costs_.data();
+    chunk.begin(kDeltaTag);
+    chunk.put(version_ + 1);
+    const size_t runs_offset = chunk.size();
+    chunk.put(static_cast<uint32_t>(0));
+    uint32_t runs = 0;
+    size_t i = 0;
+    while (i < n)
+    {
+      if (costs[i] == last[i])
+      {
+        i++;
+        continue;
+      }
+      size_t end = i + 1;
+      for (size_t j = end; j < n && j - end < kRunGap; j++)
+        if (costs[j] != last[j])
+          end = j + 1;
+      chunk.put(static_cast<uint32_t>(i));
+      chunk.put(static_cast<uint32_t>(end - i));
+      chunk.putBytes(costs + i, end - i);
+      runs++;
+      i = end;
+    }
+    if (runs > 0)
+    {
+      chunk.patch(runs_offset, runs);
+      version_++;
+      if (!chunk.flush(file_, file_size_, error))
+        return false;
+    }
+  }
+  last_costs_.swap(entry.costs);
+  last_nx_ = entry.nx, last_ny_ = entry.ny;
+  last_resolution_ = entry.resolution;
+  last_origin_x_ = entry.origin_x, last_origin_y_ = entry.origin_y;
+
+  const PlanRecord& record = entry.record;
+  chunk.begin(kPlanTag);
+  chunk.put(record.stamp);
+  chunk.putString(record.planner);
+  chunk.put(static_cast<uint32_t>(record.params.size()));
+  for (const auto& param : record.params)
+  {
+    chunk.putString(param.first);
+    chunk.putString(param.second);
+  }
+  chunk.put(record.start_x);
+  chunk.put(record.start_y);
+  chunk.put(record.goal_x);
+  chunk.put(record.goal_y);
+  chunk.put(static_cast<int32_t>(record.start_gx));
+  chunk.put(static_cast<int32_t>(record.start_gy));
+  chunk.put(static_cast<int32_t>(record.goal_gx));
+  chunk.put(static_cast<int32_t>(record.goal_gy));
+  chunk.put(record.tolerance);
+  chunk.put(record.seed);
+  chunk.put(version_);
+  chunk.put(static_cast<uint8_t>(record.found));
+  chunk.put(static_cast<uint32_t>(record.path.size()));
+  for (const auto& cell : record.path)
+  {
+    chunk.put(static_cast<int32_t>(cell.first));
+    chunk.put(static_cast<int32_t>(cell.second));
+  }
+  chunk.put(record.expanded);
+  chunk.put(record.search_time);
+  if (!chunk.flush(file_, file_size_, error))
+    return false;
+
+  // a crash loses at most the record being written
+  if (fflush(file_) != 0)
+  {
+    error = std::string("Failed to write plan record: ") + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Close the current file, start a new one and delete the oldest beyond max_files
+ * @param error reason of a failure
+ * @return true if successful, else false
+ */
+bool PlanRecorder::_roll(std::string& error)
+{
+  if (file_)
+  {
+    fclose(file_);
+    file_ = nullptr;
+  }
+  // the next record starts with a full costmap
+  last_costs_.clear();
+
+  char date[32];
+  const std::time_t now = std::time(nullptr);
+  std::tm local;
+  localtime_r(&now, &local);
+  std::strftime(date, sizeof(date), "%Y%m%d_%H%M%S", &local);
+  const std::string path =
+      options_.directory + "/" + options_.prefix + "_" + date + "_" + std::to_string(file_count_++) + ".rec";
+
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_)
+  {
+    error = "Failed to create " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  if (fwrite(kMagic, 1, sizeof(kMagic), file_) != sizeof(kMagic) ||
+      fwrite(&kVersion, 1, sizeof(kVersion), file_) != sizeof(kVersion))
+  {
+    error = "Failed to write " + path + ": " + std::strerror(errno);
+    fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+  file_size_ = sizeof(kMagic) + sizeof(kVersion);
+
+  files_.push_back(path);
+  while (options_.max_files > 0 && files_.size() > static_cast<size_t>(options_.max_files))
+  {
+    std::remove(files_.front().c_str());
+    files_.pop_front();
+  }
+  return true;
+}
+
+PlanRecordReader::~PlanRecordReader()
+{
+  if (file_)
+    fclose(file_);
+}
+
+/**
+ * @brief Open a record file
+ * @param path  record file
+ * @param error reason of a failure
+ * @return true if successful, else false
+ */
+bool PlanRecordReader::open(const std::string& path, std::string& error)
+{
+  if (file_)
+    fclose(file_);
+  costs_.clear();
+  nx_ = ny_ = 0;
+  version_ = 0;
+
+  file_ = fopen(path.c_str(), "rb");
+  if (!file_)
+  {
+    error = "Failed to open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  char magic[sizeof(kMagic)];
+  uint32_t version;
+  if (fread(magic, 1, sizeof(magic), file_) != sizeof(magic) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      fread(&version, 1, sizeof(version), file_) != sizeof(version))
+  {
+    error = path + " is not a plan record file";
+    return false;
+  }
+  if (version != kVersion)
+  {
+    error = path + " has record format " + std::to_string(version) + ", expected " + std::to_string(kVersion);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Read the next plan record and apply the costmap changes before it
+ * @param record plan record
+ * @param error  reason of a failure, empty at the end of the file
+ * @return true if a record was read, else false
+ */
+bool PlanRecordReader::next(PlanRecord& record, std::string& error)
+{
+  error.clear();
+  if (!file_)
+  {
+    error = "No record file open";
+    return false;
+  }
+
+  std::vector<char> payload;
+  while (true)
+  {
+    uint32_t header[2];
+    const size_t n = fread(header, 1, sizeof(header), file_);
+    if (n == 0 && feof(file_))
+      return false;
+    if (n != sizeof(header) || header[1] > kMaxChunk)
+    {
+      // e.g. the recorder was killed while writing
+      error = "Truncated record file";
+      return false;
+    }
+    payload.resize(header[1]);
+    if (fread(payload.data(), 1, payload.size(), file_) != payload.size())
+    {
+      error = "Truncated record file";
+      return false;
+    }
+
+    ChunkReader chunk(payload);
+    if (header[0] == kCostTag)
+    {
+      version_ = chunk.get<uint64_t>();
+      nx_ = chunk.get<int32_t>();
+      ny_ = chunk.get<int32_t>();
+      resolution_ = chunk.get<double>();
+      origin_x_ = chunk.get<double>();
+      origin_y_ = chunk.get<double>();
+      if (!chunk.ok() || nx_ < 0 || ny_ < 0)
+      {
+        error = "Corrupt costmap in record file";
+        return false;
+      }
+      costs_.resize(static_cast<size_t>(nx_) * ny_);
+      chunk.getBytes(costs_.data(), costs_.size());
+      if (!chunk.ok())
+      {
+        error = "Corrupt costmap in record file";
+        return false;
+      }
+    }
+    else if (header[0] == kDeltaTag)
+    {
+      version_ = chunk.get<uint64_t>();
+      const uint32_t runs = chunk.get<uint32_t>();
+      for (uint32_t i = 0; i < runs && chunk.ok(); i++)
+      {
+        const uint32_t offset = chunk.get<uint32_t>();
+        const uint32_t length = chunk.get<uint32_t>();
+        if (static_cast<size_t>(offset) + length > costs_.size())
+        {
+          error = "Costmap change outside the costmap in record file";
+          return false;
+        }
+        chunk.getBytes(costs_.data() + offset, length);
+      }
+      if (!chunk.ok())
+      {
+        error = "Corrupt costmap change in record file";
+        return false;
+      }
+    }
+    else if (header[0] == kPlanTag)
+      break;
+    // unknown chunks of later format additions are skipped
+  }
+
+  ChunkReader chunk(payload);
+  record = PlanRecord();
+  record.stamp = chunk.get<double>();
+  record.planner = chunk.getString();
+  const uint32_t params = chunk.get<uint32_t>();
+  for (uint32_t i = 0; i < params && chunk.ok(); i++)
+  {
+    std::string name = chunk.getString();
+    std::string value = chunk.getString();
+    record.params.emplace_back(std::move(name), std::move(value));
+  }
+  record.start_x = chunk.get<double>();
+  record.start_y = chunk.get<double>();
+  record.goal_x = chunk.get<double>();
+  record.goal_y = chunk.get<double>();
+  record.start_gx = chunk.get<int32_t>();
+  record.start_gy = chunk.get<int32_t>();
+  record.goal_gx = chunk.get<int32_t>();
+  record.goal_gy = chunk.get<int32_t>();
+  record.tolerance = chunk.get<double>();
+  record.seed = chunk.get<uint32_t>();
+  record.costmap_version = chunk.get<uint64_t>();
+  record.found = chunk.get<uint8_t>() != 0;
+  const uint32_t cells = chunk.get<uint32_t>();
+  for (uint32_t i = 0; i < cells && chunk.ok(); i++)
+  {
+    const int x = chunk.get<int32_t>();
+    const int y = chunk.get<int32_t>();
+    record.path.emplace_back(x, y);
+  }
+  record.expanded = chunk.get<uint64_t>();
+  record.search_time = chunk.get<double>();
+  if (!chunk.ok())
+  {
+    error = "Corrupt plan record in record file";
+    return false;
+  }
+  if (record.costmap_version != version_ || costs_.empty())
+  {
+    error = "Plan record without its costmap, the file does not start with a full costmap";
+    return false;
+  }
+  return true;
+}
+}  // namespace global_planner
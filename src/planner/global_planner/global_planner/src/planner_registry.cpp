@@ -0,0 +1,144 @@
+/***********************************************************
+ *
+ * @file: planner_registry.cpp
+ * @breif: Named factories of global planners and the instances built from them, kept sized to the costmap
+ * @author: Yang Haodong
+ * @update: 2023-10-10
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include "planner_registry.h"
+
+namespace global_planner
+{
+/**
+ * @brief Construct a new Planner Registry object
+ * @param nx         pixel number in costmap x direction
+ * @param ny         pixel number in costmap y direction
+ * @param resolution costmap resolution
+ */
+PlannerRegistry::PlannerRegistry(int nx, int ny, double resolution) : nx_(nx), ny_(ny), resolution_(resolution)
+{
+}
+
+/**
+ * @brief Register a planner, replacing an earlier one of the same name and its instance
+ * @param name    planner name, e.g. a_star
+ * @param factory builds the planner
+ */
+void PlannerRegistry::add(const std::string& name, Factory factory)
+{
+  factories_[name] = std::move(factory);
+  instances_.erase(name);
+}
+
+/**
+ * @brief Check if a planner is registered
+ * @param name planner name
+ * @return true if registered, else false
+ */
+bool PlannerRegistry::contains(const std::string& name) const
+{
+  return factories_.count(name) > 0;
+}
+
+/**
+ * @brief Names of all registered planners, sorted
+ */
+std::vector<std::string> PlannerRegistry::names() const
+{
+  std::vector<std::string> names;
+  names.reserve(factories_.size());
+  for (const auto& factory : factories_)
+    names.push_back(factory.first);
+  return names;
+}
+
+/**
+ * @brief Build a new planner, owned by the caller
+ * @param name       planner name
+ * @param nx         pixel number in costmap x direction
+ * @param ny         pixel number in costmap y direction
+ * @param resolution costmap resolution
+ * @return the planner, nullptr if the name is not registered
+ */
+std::unique_ptr<GlobalPlanner> PlannerRegistry::create(const std::string& name, int nx, int ny,
+                                                       double resolution) const
+{
+  auto factory = factories_.find(name);
+  if (factory == factories_.end())
+    return nullptr;
+  return std::unique_ptr<GlobalPlanner>(factory->second(nx, ny, resolution));
+}
+
+/**
+ * @brief Instance of a planner for the current costmap size, built if there is none yet
+ * @param name planner name
+ * @return the instance, owned by the registry and valid until setSize, add or clear; nullptr if the name is not
+ *         registered
+ */
+GlobalPlanner* PlannerRegistry::acquire(const std::string& name)
+{
+  std::unique_ptr<GlobalPlanner>& instance = instances_[name];
+  if (!instance)
+  {
+    instance = create(name, nx_, ny_, resolution_);
+    if (!instance)
+    {
+      instances_.erase(name);
+      return nullptr;
+    }
+  }
+  return instance.get();
+}
+
+/**
+ * @brief Build the instances of planners ahead of their first use
+ * @param names planner names, unregistered ones are skipped
+ * @return number of instances built or already there
+ */
+int PlannerRegistry::prewarm(const std::vector<std::string>& names)
+{
+  int count = 0;
+  for (const std::string& name : names)
+    if (acquire(name))
+      count++;
+  return count;
+}
+
+/**
+ * @brief Follow a costmap size change: all instances are rebuilt for the new size
+ * @param nx         pixel number in costmap x direction
+ * @param ny         pixel number in costmap y direction
+ * @param resolution costmap resolution
+ * @return true if the size changed, false if it was the same
+ */
+bool PlannerRegistry::setSize(int nx, int ny, double resolution)
+{
+  if (nx == nx_ && ny == ny_ && resolution == resolution_)
+    return false;
+  nx_ = nx, ny_ = ny;
+  resolution_ = resolution;
+
+  // planners size their maps and incremental search state in the constructor, so the instances are rebuilt rather
+  // than resized; those in use stay warm
+  for (auto& instance : instances_)
+  {
+    instance.second.reset();
+    instance.second = create(instance.first, nx_, ny_, resolution_);
+  }
+  return true;
+}
+
+/**
+ * @brief Release all instances, the factories stay registered
+ */
+void PlannerRegistry::clear()
+{
+  instances_.clear();
+}
+}  // namespace global_planner
@@ -14,10 +14,10 @@
 #ifndef D_STAR_H
 #define D_STAR_H
 
+#include <algorithm>
+#include <cstring>
 #include <map>
 
-#include <ros/ros.h>
-
 #include "global_planner.h"
 
 #define WINDOW_SIZE 70  // local costmap window size (in grid, 3.5m / 0.05 = 70)
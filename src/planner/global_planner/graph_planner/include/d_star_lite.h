@@ -14,10 +14,9 @@
 #ifndef D_STAR_LITE_H
 #define D_STAR_LITE_H
 
-#include <ros/ros.h>
-
 #include <map>
 #include <algorithm>
+#include <cstring>
 
 #include "global_planner.h"
 
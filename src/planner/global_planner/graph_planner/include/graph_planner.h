@@ -23,9 +23,15 @@
 
 // #include <nav_msgs/Path.h>
 #include <nav_msgs/GetPlan.h>
+#include <std_srvs/Trigger.h>
 // #include <geometry_msgs/Point.h>
+#include <dynamic_reconfigure/server.h>
+#include <graph_planner/GraphPlannerConfig.h>
 
 #include "global_planner.h"
+#include "instrumentation.h"
+#include "plan_recording.h"
+#include "planner_registry.h"
 
 namespace graph_planner
 {
@@ -96,7 +102,46 @@ public:
    */
   bool makePlanService(nav_msgs::GetPlan::Request& req, nav_msgs::GetPlan::Response& resp);
 
+  /**
+   * @brief Write the current costmap as a snapshot into snapshot_dir, for offline replay
+   * @param req  request from client
+   * @param resp response from server, the snapshot file or the reason of a failure
+   */
+  bool dumpCostmapService(std_srvs::Trigger::Request& req, std_srvs::Trigger::Response& resp);
+
+  /**
+   * @brief Callback of dynamic reconfigure, switches the graph search algorithm between plans
+   * @param config new configuration
+   * @param level  reconfiguration level
+   */
+  void reconfigureCB(GraphPlannerConfig& config, uint32_t level);
+
 protected:
+  /**
+   * @brief Register the factories of all graph search algorithms
+   * @param private_nh node handle of the planner parameters
+   */
+  void _registerPlanners(ros::NodeHandle& private_nh);
+
+  /**
+   * @brief Make a registered algorithm the one used by makePlan, with its metrics
+   * @param name planner name
+   * @return true if successful, false if the name is not registered
+   */
+  bool _selectPlanner(const std::string& name);
+
+  /**
+   * @brief Follow the costmap origin, size and resolution, and resize the planners when the size changed, e.g. after
+   *        a map reload
+   */
+  void _updateCostmapProperties();
+
+  /**
+   * @brief Rebuild the parameters of the plan records from the current values, after initialization and every
+   *        reconfiguration
+   */
+  void _updateRecordParams();
+
   /**
    * @brief publish expand zone
    * @param expand set of expand nodes
@@ -139,10 +184,17 @@ protected:
   costmap_2d::Costmap2D* costmap_;            // costmap
   std::string frame_id_;                      // costmap frame ID
   std::string planner_name_;                  // planner name
-  global_planner::GlobalPlanner* g_planner_;  // global graph planner
+  global_planner::PlannerRegistry planners_;  // graph planners by name
+  global_planner::GlobalPlanner* g_planner_;  // global graph planner in use, owned by planners_
   ros::Publisher plan_pub_;                   // path planning publisher
   ros::Publisher expand_pub_;                 // nodes explorer publisher
   ros::ServiceServer make_plan_srv_;          // planning service
+  ros::ServiceServer dump_costmap_srv_;       // costmap snapshot service
+  std::string snapshot_dir_;                  // directory of the costmap snapshots
+
+  std::unique_ptr<global_planner::PlanRecorder> recorder_;          // plan recorder, if record_plans
+  global_planner::PlanRecord record_template_;                      // planner and parameters of the records
+  instrumentation::CostmapCopy record_costmap_;                     // costs of the plan being recorded
 
 private:
   bool is_outline_;        // whether outline the boudary of map
@@ -150,7 +202,14 @@ private:
   double convert_offset_;  // offset of transform from world(x,y) to grid map(x,y)
   double tolerance_;       // tolerance
   double factor_;          // obstacle inflation factor
+  int coarse_corridor_;    // coarse cells around the coarse route the fine Voronoi search may use
   boost::mutex mutex_;     // thread mutex
+
+  std::unique_ptr<dynamic_reconfigure::Server<GraphPlannerConfig>> dsrv_;  // dynamic reconfigure server
+
+  instrumentation::Histogram* make_plan_time_;  // latency of makePlan
+  instrumentation::Histogram* search_time_;     // latency of the search alone
+  instrumentation::Counter* expansions_;        // nodes expanded by the searches
 };
 }  // namespace graph_planner
 #endif
\ No newline at end of file
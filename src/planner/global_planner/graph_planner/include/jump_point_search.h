@@ -16,7 +16,6 @@
 
 #include <queue>
 #include <unordered_set>
-#include <ros/ros.h>
 
 #include "global_planner.h"
 
@@ -14,10 +14,9 @@
 #ifndef LPA_STAR_H
 #define LPA_STAR_H
 
-#include <ros/ros.h>
-
 #include <map>
 #include <algorithm>
+#include <cstring>
 
 #include "global_planner.h"
 
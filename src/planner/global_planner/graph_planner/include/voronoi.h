@@ -21,12 +21,6 @@
 
 namespace global_planner
 {
-struct VoronoiData
-{
-  bool is_voronoi;  // whether the grid is in VD or not
-  double dist;      // the distance from the grid to the closest obstacle
-};
-
 /**
  * @brief Class for objects that plan using the Voronoi-based planning algorithm
  */
@@ -39,8 +33,10 @@ public:
    * @param ny                    pixel number in costmap y direction
    * @param resolution            costmap resolution
    * @param circumscribed_radius  the circumscribed radius of robot
+   * @param coarse_corridor       coarse cells around the coarse route the fine search may expand, < 0 ignores the
+   *                              coarse diagram
    */
-  VoronoiPlanner(int nx, int ny, double resolution, double circumscribed_radius);
+  VoronoiPlanner(int nx, int ny, double resolution, double circumscribed_radius, int coarse_corridor = 2);
 
   /**
    * @brief Voronoi-based planning implementation
@@ -53,22 +49,58 @@ public:
    */
   bool plan(const unsigned char* global_costmap, const Node& start, const Node& goal, std::vector<Node>& path,
             std::vector<Node>& expand);
-  bool plan(VoronoiData** voronoi_diagram, const Node& start, const Node& goal, std::vector<Node>& path);
+
+  /**
+   * @brief Voronoi-based planning on a diagram snapshot. If the snapshot has a coarse diagram, the route is searched
+   *        on the coarse skeleton first and then refined on the full-resolution diagram close to it.
+   * @param voronoi       Voronoi diagram with the size of the costmap
+   * @param start         start node
+   * @param goal          goal node
+   * @param path          optimal path consists of Node
+   * @return  true if path found, else false
+   */
+  bool plan(const costmap_2d::VoronoiSnapshot& voronoi, const Node& start, const Node& goal, std::vector<Node>& path);
 
 protected:
+  /**
+   * @brief One resolution level of the Voronoi diagram, cells are stored row-major
+   */
+  struct VoronoiGrid
+  {
+    int nx, ny;                       // pixel number in x and y direction
+    const float* dist;                // the distance from the grid to the closest obstacle in cells
+    const unsigned char* is_voronoi;  // whether the grid is in VD or not
+    double min_dist;                  // grids closer than this to an obstacle (in cells) are not traversable
+    // optional corridor limiting the search, grid (x, y) may be expanded if corridor[y / factor * nx + x / factor]
+    const unsigned char* corridor;
+    int corridor_factor, corridor_nx;
+  };
+
+  /**
+   * @brief start to VD, shortest path in VD, VD to goal
+   * @param grid          the diagram to plan on
+   * @param start         start node
+   * @param goal          goal node
+   * @param path          optimal path consists of Node
+   * @return  true if path found, else false
+   */
+  bool planOnGrid(const VoronoiGrid& grid, const Node& start, const Node& goal, std::vector<Node>& path);
+
   /**
    * @brief search the shortest path from start to VD, or search the shortest path in VD
+   * @param grid          the diagram to search on
    * @param start         start node
    * @param goal          goal node
    * @param v_goal        the voronoi node in VD which is closest to start node
    * @param path          shortest path from start to VD
    * @return  true if path found, else false
    */
-  bool searchPathWithVoronoi(const Node& start, const Node& goal, std::vector<Node>& path, Node* v_goal = nullptr);
+  bool searchPathWithVoronoi(const VoronoiGrid& grid, const Node& start, const Node& goal, std::vector<Node>& path,
+                             Node* v_goal = nullptr);
 
 private:
-  VoronoiData** voronoi_diagram_;  // voronoi diagram copy
-  double circumscribed_radius_;    // the circumscribed radius of robot
+  double circumscribed_radius_;  // the circumscribed radius of robot
+  int coarse_corridor_;          // coarse cells around the coarse route the fine search may expand
 };
 
 }  // namespace global_planner
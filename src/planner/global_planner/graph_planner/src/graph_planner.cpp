@@ -14,6 +14,11 @@
 #include "graph_planner.h"
 #include <pluginlib/class_list_macros.h>
 
+#include <random>
+
+#include "costmap_dump.h"
+#include "metrics_publisher.h"
+
 #include "a_star.h"
 #include "jump_point_search.h"
 #include "d_star.h"
@@ -30,7 +35,13 @@ namespace graph_planner
 /**
  * @brief Construct a new Graph Planner object
  */
-GraphPlanner::GraphPlanner() : initialized_(false), costmap_(nullptr), g_planner_(nullptr)
+GraphPlanner::GraphPlanner()
+  : initialized_(false)
+  , costmap_(nullptr)
+  , g_planner_(nullptr)
+  , make_plan_time_(nullptr)
+  , search_time_(nullptr)
+  , expansions_(nullptr)
 {
 }
 
@@ -49,11 +60,8 @@ GraphPlanner::GraphPlanner(std::string name, costmap_2d::Costmap2DROS* costmap_r
  */
 GraphPlanner::~GraphPlanner()
 {
-  if (g_planner_)
-  {
-    delete g_planner_;
-    g_planner_ = nullptr;
-  }
+  // the reconfigure callback must not run into a half destroyed planner
+  dsrv_.reset();
 }
 
 /**
@@ -101,32 +109,23 @@ void GraphPlanner::initialize(std::string name)
 
     // planner name
     private_nh.param("planner_name", planner_name_, (std::string) "a_star");
-    if (planner_name_ == "a_star")
-      g_planner_ = new global_planner::AStar(nx_, ny_, resolution_);
-    else if (planner_name_ == "dijkstra")
-      g_planner_ = new global_planner::AStar(nx_, ny_, resolution_, true);
-    else if (planner_name_ == "gbfs")
-      g_planner_ = new global_planner::AStar(nx_, ny_, resolution_, false, true);
-    else if (planner_name_ == "jps")
-      g_planner_ = new global_planner::JumpPointSearch(nx_, ny_, resolution_);
-    else if (planner_name_ == "d_star")
-      g_planner_ = new global_planner::DStar(nx_, ny_, resolution_);
-    else if (planner_name_ == "lpa_star")
-      g_planner_ = new global_planner::LPAStar(nx_, ny_, resolution_);
-    else if (planner_name_ == "d_star_lite")
-      g_planner_ = new global_planner::DStarLite(nx_, ny_, resolution_);
-    else if (planner_name_ == "voronoi")
-      g_planner_ = new global_planner::VoronoiPlanner(nx_, ny_, resolution_,
-                                                      costmap_ros_->getLayeredCostmap()->getCircumscribedRadius());
-    else if (planner_name_ == "theta_star")
-      g_planner_ = new global_planner::ThetaStar(nx_, ny_, resolution_);
-    else if (planner_name_ == "lazy_theta_star")
-      g_planner_ = new global_planner::LazyThetaStar(nx_, ny_, resolution_);
-    else
-      ROS_ERROR("Unknown planner name: %s", planner_name_.c_str());
+    planners_.setSize(nx_, ny_, resolution_);
+    _registerPlanners(private_nh);
+    if (!_selectPlanner(planner_name_))
+    {
+      ROS_ERROR("Unknown planner name: %s, using a_star", planner_name_.c_str());
+      _selectPlanner("a_star");
+    }
+
+    // planners built now, so that switching to them through dynamic reconfigure does not allocate
+    std::vector<std::string> prewarm_planners;
+    private_nh.param("prewarm_planners", prewarm_planners, std::vector<std::string>());
+    planners_.prewarm(prewarm_planners);
 
     ROS_INFO("Using global graph planner: %s", planner_name_.c_str());
 
+    instrumentation::startMetricsPublisher();
+
     // register planning publisher
     plan_pub_ = private_nh.advertise<nav_msgs::Path>("plan", 1);
 
@@ -135,6 +134,32 @@ void GraphPlanner::initialize(std::string name)
 
     // register planning service
     make_plan_srv_ = private_nh.advertiseService("make_plan", &GraphPlanner::makePlanService, this);
+
+    // register costmap snapshot service
+    private_nh.param("snapshot_dir", snapshot_dir_, (std::string) "/tmp");
+    dump_costmap_srv_ = private_nh.advertiseService("dump_costmap", &GraphPlanner::dumpCostmapService, this);
+
+    // record every plan request, to replay it offline with headless_sim plan_replay
+    bool record_plans;
+    private_nh.param("record_plans", record_plans, false);
+    if (record_plans)
+    {
+      global_planner::PlanRecorder::Options options;
+      int max_file_size;
+      private_nh.param("record_dir", options.directory, (std::string) "/tmp");
+      private_nh.param("record_max_file_size", max_file_size, 64);  // [MB]
+      private_nh.param("record_max_files", options.max_files, 8);
+      options.prefix = name;  // the planner may change, each record names its own
+      options.max_file_size = static_cast<size_t>(max_file_size) << 20;
+      recorder_.reset(new global_planner::PlanRecorder(options));
+
+      _updateRecordParams();
+      ROS_INFO("Recording plans into %s", options.directory.c_str());
+    }
+
+    // switch algorithms without restarting move_base
+    dsrv_.reset(new dynamic_reconfigure::Server<GraphPlannerConfig>(private_nh));
+    dsrv_->setCallback(boost::bind(&GraphPlanner::reconfigureCB, this, _1, _2));
   }
   else
   {
@@ -166,13 +191,17 @@ bool GraphPlanner::makePlan(const geometry_msgs::PoseStamped& start, const geome
 bool GraphPlanner::makePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal,
                             double tolerance, std::vector<geometry_msgs::PoseStamped>& plan)
 {
-  // start thread mutex
-  boost::mutex::scoped_lock lock(mutex_);
   if (!initialized_)
   {
     ROS_ERROR("This planner has not been initialized yet, but it is being used, please call initialize() before use");
     return false;
   }
+
+  // the costmap before the thread mutex, in the order of move_base, which calls makePlan with the costmap locked
+  boost::unique_lock<costmap_2d::Costmap2D::mutex_t> costmap_lock(*costmap_->getMutex());
+  boost::mutex::scoped_lock lock(mutex_);
+  instrumentation::ScopedTimer make_plan_timer(*make_plan_time_);
+
   // clear existing plan
   plan.clear();
 
@@ -191,6 +220,8 @@ bool GraphPlanner::makePlan(const geometry_msgs::PoseStamped& start, const geome
     return false;
   }
 
+  _updateCostmapProperties();
+
   // get goal and start node coordinate tranform from world to costmap
   double wx = start.pose.position.x, wy = start.pose.position.y;
   double m_start_x, m_start_y, m_goal_x, m_goal_y;
@@ -223,48 +254,45 @@ bool GraphPlanner::makePlan(const geometry_msgs::PoseStamped& start, const geome
   if (is_outline_)
     g_planner_->outlineMap(costmap_->getCharMap());
 
+  // a fresh seed per recorded plan, so that its replay draws the same numbers, and the costs the plan runs on
+  if (recorder_)
+  {
+    g_planner_->setSeed(std::random_device()());
+    instrumentation::copyCostmap(costmap_, record_costmap_);
+  }
+
   // calculate path
   std::vector<global_planner::Node> path;
   std::vector<global_planner::Node> expand;
   bool path_found = false;
+  double search_time;
 
-  if (planner_name_ == "voronoi")
   {
-    bool voronoi_layer_exist = false;
-    // check if the costmap has a Voronoi layer
-    for (auto layer = costmap_ros_->getLayeredCostmap()->getPlugins()->begin();
-         layer != costmap_ros_->getLayeredCostmap()->getPlugins()->end(); ++layer)
+    instrumentation::ScopedTimer search_timer(*search_time_);
+    if (planner_name_ == "voronoi")
     {
-      boost::shared_ptr<costmap_2d::VoronoiLayer> voronoi_layer =
-          boost::dynamic_pointer_cast<costmap_2d::VoronoiLayer>(*layer);
-      if (voronoi_layer)
-      {
-        voronoi_layer_exist = true;
-        global_planner::VoronoiData** voronoi_diagram;
-        voronoi_diagram = new global_planner::VoronoiData*[nx_];
-        for (unsigned int i = 0; i < nx_; i++)
-          voronoi_diagram[i] = new global_planner::VoronoiData[ny_];
-
-        boost::unique_lock<boost::mutex> lock(voronoi_layer->getMutex());
-        const DynamicVoronoi& voronoi = voronoi_layer->getVoronoi();
-        for (unsigned int j = 0; j < ny_; j++)
-        {
-          for (unsigned int i = 0; i < nx_; i++)
-          {
-            voronoi_diagram[i][j].dist = voronoi.getDistance(i, j) * resolution_;
-            voronoi_diagram[i][j].is_voronoi = voronoi.isVoronoi(i, j);
-          }
-        }
+      // latest finished diagram, the layer keeps updating in the background
+      boost::shared_ptr<const costmap_2d::VoronoiSnapshot> voronoi =
+          costmap_2d::VoronoiLayer::getSnapshot(costmap_ros_->getLayeredCostmap());
+      if (!voronoi)
+        ROS_ERROR("Failed to get a Voronoi layer for Voronoi planner");
+      // the same size is not enough, a rolling window moves the origin and the cells with it
+      else if (voronoi->size_x != nx_ || voronoi->size_y != ny_ || voronoi->resolution != resolution_ ||
+               voronoi->origin_x != origin_x_ || voronoi->origin_y != origin_y_)
+        ROS_WARN("The Voronoi diagram is not ready yet");
+      else
         path_found = dynamic_cast<global_planner::VoronoiPlanner*>(g_planner_)
-                         ->plan(voronoi_diagram, start_node, goal_node, path);
-        break;
-      }
+                         ->plan(*voronoi, start_node, goal_node, path);
     }
-    if (!voronoi_layer_exist)
-      ROS_ERROR("Failed to get a Voronoi layer for Voronoi planner");
+    else
+      path_found = g_planner_->plan(costmap_->getCharMap(), start_node, goal_node, path, expand);
+    search_time = search_timer.elapsed();
   }
-  else
-    path_found = g_planner_->plan(costmap_->getCharMap(), start_node, goal_node, path, expand);
+  expansions_->add(expand.size());
+
+  if (recorder_)
+    instrumentation::recordPlan(*recorder_, record_template_, start, goal, start_node, goal_node, tolerance,
+                                g_planner_->getSeed(), path_found, path, expand.size(), search_time, record_costmap_);
 
   if (path_found)
   {
@@ -329,6 +357,148 @@ bool GraphPlanner::makePlanService(nav_msgs::GetPlan::Request& req, nav_msgs::Ge
   return true;
 }
 
+/**
+ * @brief Write the current costmap as a snapshot into snapshot_dir, for offline replay
+ * @param req  request from client
+ * @param resp response from server, the snapshot file or the reason of a failure
+ * @return true
+ */
+bool GraphPlanner::dumpCostmapService(std_srvs::Trigger::Request& req, std_srvs::Trigger::Response& resp)
+{
+  std::string result;
+  resp.success = global_planner::dumpCostmap(costmap_, mutex_, snapshot_dir_, result);
+  resp.message = result;
+
+  return true;
+}
+
+/**
+ * @brief Callback of dynamic reconfigure, switches the graph search algorithm between plans
+ * @param config new configuration
+ * @param level  reconfiguration level
+ */
+void GraphPlanner::reconfigureCB(GraphPlannerConfig& config, uint32_t level)
+{
+  // a running plan finishes with the planner it started with
+  boost::mutex::scoped_lock lock(mutex_);
+  tolerance_ = config.default_tolerance;
+  is_outline_ = config.outline_map;
+  is_expand_ = config.expand_zone;
+  if (recorder_)
+    _updateRecordParams();
+
+  if (config.planner_name != planner_name_)
+  {
+    const std::string previous = planner_name_;
+    if (_selectPlanner(config.planner_name))
+      ROS_INFO("Switched global graph planner from %s to %s", previous.c_str(), planner_name_.c_str());
+    else
+    {
+      ROS_ERROR("Unknown planner name: %s, keeping %s", config.planner_name.c_str(), planner_name_.c_str());
+      config.planner_name = planner_name_;
+    }
+  }
+}
+
+/**
+ * @brief Register the factories of all graph search algorithms
+ * @param private_nh node handle of the planner parameters
+ */
+void GraphPlanner::_registerPlanners(ros::NodeHandle& private_nh)
+{
+  planners_.add("a_star", [](int nx, int ny, double resolution) {
+    return new global_planner::AStar(nx, ny, resolution);
+  });
+  planners_.add("dijkstra", [](int nx, int ny, double resolution) {
+    return new global_planner::AStar(nx, ny, resolution, true);
+  });
+  planners_.add("gbfs", [](int nx, int ny, double resolution) {
+    return new global_planner::AStar(nx, ny, resolution, false, true);
+  });
+  planners_.add("jps", [](int nx, int ny, double resolution) {
+    return new global_planner::JumpPointSearch(nx, ny, resolution);
+  });
+  planners_.add("d_star", [](int nx, int ny, double resolution) {
+    return new global_planner::DStar(nx, ny, resolution);
+  });
+  planners_.add("lpa_star", [](int nx, int ny, double resolution) {
+    return new global_planner::LPAStar(nx, ny, resolution);
+  });
+  planners_.add("d_star_lite", [](int nx, int ny, double resolution) {
+    return new global_planner::DStarLite(nx, ny, resolution);
+  });
+
+  // coarse cells around the route on the coarse diagram (voronoi_layer coarse_factor) the fine search may use
+  private_nh.param("voronoi_coarse_corridor", coarse_corridor_, 2);
+  const int coarse_corridor = coarse_corridor_;
+  planners_.add("voronoi", [this, coarse_corridor](int nx, int ny, double resolution) {
+    return new global_planner::VoronoiPlanner(nx, ny, resolution,
+                                              costmap_ros_->getLayeredCostmap()->getCircumscribedRadius(),
+                                              coarse_corridor);
+  });
+
+  planners_.add("theta_star", [](int nx, int ny, double resolution) {
+    return new global_planner::ThetaStar(nx, ny, resolution);
+  });
+  planners_.add("lazy_theta_star", [](int nx, int ny, double resolution) {
+    return new global_planner::LazyThetaStar(nx, ny, resolution);
+  });
+}
+
+/**
+ * @brief Make a registered algorithm the one used by makePlan, with its metrics
+ * @param name planner name
+ * @return true if successful, false if the name is not registered
+ */
+bool GraphPlanner::_selectPlanner(const std::string& name)
+{
+  global_planner::GlobalPlanner* planner = planners_.acquire(name);
+  if (!planner)
+    return false;
+  planner_name_ = name;
+  g_planner_ = planner;
+
+  // latency and expansion metrics, published on ~metrics
+  const std::string labels = "planner=\"" + planner_name_ + "\"";
+  make_plan_time_ = &instrumentation::histogram("planner_latency_seconds", labels + ",phase=\"make_plan\"");
+  search_time_ = &instrumentation::histogram("planner_latency_seconds", labels + ",phase=\"search\"");
+  expansions_ = &instrumentation::counter("planner_expansions_total", labels);
+
+  record_template_.planner = planner_name_;
+  return true;
+}
+
+/**
+ * @brief Follow the costmap origin, size and resolution, and resize the planners when the size changed, e.g. after
+ *        a map reload
+ */
+void GraphPlanner::_updateCostmapProperties()
+{
+  origin_x_ = costmap_->getOriginX(), origin_y_ = costmap_->getOriginY();
+  const unsigned int nx = costmap_->getSizeInCellsX(), ny = costmap_->getSizeInCellsY();
+  const double resolution = costmap_->getResolution();
+  if (nx == nx_ && ny == ny_ && resolution == resolution_)
+    return;
+
+  ROS_INFO("Costmap resized from %u x %u to %u x %u cells, resizing the global graph planners", nx_, ny_, nx, ny);
+  nx_ = nx, ny_ = ny;
+  resolution_ = resolution;
+  planners_.setSize(nx_, ny_, resolution_);
+  g_planner_ = planners_.acquire(planner_name_);
+}
+
+/**
+ * @brief Rebuild the parameters of the plan records from the current values, after initialization and every
+ *        reconfiguration
+ */
+void GraphPlanner::_updateRecordParams()
+{
+  record_template_.params = { { "convert_offset", std::to_string(convert_offset_) },
+                              { "outline_map", is_outline_ ? "true" : "false" },
+                              { "obstacle_factor", std::to_string(factor_) },
+                              { "voronoi_coarse_corridor", std::to_string(coarse_corridor_) } };
+}
+
 /**
  * @brief publish expand zone
  * @param expand set of expand nodes
@@ -27,11 +27,14 @@ namespace global_planner
  * @param ny                    pixel number in costmap y direction
  * @param resolution            costmap resolution
  * @param circumscribed_radius  the circumscribed radius of robot
+ * @param coarse_corridor       coarse cells around the coarse route the fine search may expand, < 0 ignores the
+ *                              coarse diagram
  */
-VoronoiPlanner::VoronoiPlanner(int nx, int ny, double resolution, double circumscribed_radius)
+VoronoiPlanner::VoronoiPlanner(int nx, int ny, double resolution, double circumscribed_radius, int coarse_corridor)
   : GlobalPlanner(nx, ny, resolution)
 {
   circumscribed_radius_ = circumscribed_radius;
+  coarse_corridor_ = coarse_corridor;
 }
 
 /**
@@ -48,10 +51,67 @@ bool VoronoiPlanner::plan(const unsigned char* global_costmap, const Node& start
 {
   return true;
 }
-bool VoronoiPlanner::plan(VoronoiData** voronoi_diagram, const Node& start, const Node& goal, std::vector<Node>& path)
+
+/**
+ * @brief Voronoi-based planning on a diagram snapshot. If the snapshot has a coarse diagram, the route is searched
+ *        on the coarse skeleton first and then refined on the full-resolution diagram close to it.
+ * @param voronoi       Voronoi diagram with the size of the costmap
+ * @param start         start node
+ * @param goal          goal node
+ * @param path          optimal path consists of Node
+ * @return  true if path found, else false
+ */
+bool VoronoiPlanner::plan(const costmap_2d::VoronoiSnapshot& voronoi, const Node& start, const Node& goal,
+                          std::vector<Node>& path)
 {
-  voronoi_diagram_ = voronoi_diagram;
+  VoronoiGrid fine = { nx_, ny_, voronoi.dist.data(), voronoi.is_voronoi.data(), circumscribed_radius_ / resolution_,
+                       nullptr, 1, 0 };
 
+  if (voronoi.hasCoarse() && coarse_corridor_ >= 0)
+  {
+    const int f = voronoi.coarse_factor;
+    const int cnx = voronoi.coarse_size_x, cny = voronoi.coarse_size_y;
+    // pooling moves obstacles by up to one coarse cell, the fine search checks the real clearance
+    VoronoiGrid coarse = { cnx, cny, voronoi.coarse_dist.data(), voronoi.coarse_is_voronoi.data(),
+                           std::max(0.0, circumscribed_radius_ / (resolution_ * f) - 1.0), nullptr, 1, 0 };
+
+    // node ids keep the stride of the costmap on every level, so the closed list can be converted as usual
+    Node c_start(start.x_ / f, start.y_ / f, 0, 0, grid2Index(start.x_ / f, start.y_ / f), 0);
+    Node c_goal(goal.x_ / f, goal.y_ / f, 0, 0, grid2Index(goal.x_ / f, goal.y_ / f), 0);
+    std::vector<Node> coarse_path;
+    if (planOnGrid(coarse, c_start, c_goal, coarse_path))
+    {
+      std::vector<unsigned char> corridor(cnx * cny, 0);
+      for (const auto& n : coarse_path)
+      {
+        for (int y = std::max(n.y_ - coarse_corridor_, 0); y <= std::min(n.y_ + coarse_corridor_, cny - 1); y++)
+          for (int x = std::max(n.x_ - coarse_corridor_, 0); x <= std::min(n.x_ + coarse_corridor_, cnx - 1); x++)
+            corridor[y * cnx + x] = 1;
+      }
+
+      fine.corridor = corridor.data();
+      fine.corridor_factor = f;
+      fine.corridor_nx = cnx;
+      if (planOnGrid(fine, start, goal, path))
+        return true;
+      fine.corridor = nullptr;
+    }
+    // passages narrower than a coarse cell are closed on the coarse diagram, fall back to the full one
+  }
+
+  return planOnGrid(fine, start, goal, path);
+}
+
+/**
+ * @brief start to VD, shortest path in VD, VD to goal
+ * @param grid          the diagram to plan on
+ * @param start         start node
+ * @param goal          goal node
+ * @param path          optimal path consists of Node
+ * @return  true if path found, else false
+ */
+bool VoronoiPlanner::planOnGrid(const VoronoiGrid& grid, const Node& start, const Node& goal, std::vector<Node>& path)
+{
   // clear vector
   path.clear();
 
@@ -61,14 +121,14 @@ bool VoronoiPlanner::plan(VoronoiData** voronoi_diagram, const Node& start, cons
   // start/goal point in Voronoi Diagram
   Node v_start, v_goal;
 
-  if (!searchPathWithVoronoi(start, goal, path_s, &v_start))
+  if (!searchPathWithVoronoi(grid, start, goal, path_s, &v_start))
     return false;
 
-  if (!searchPathWithVoronoi(goal, start, path_g, &v_goal))
+  if (!searchPathWithVoronoi(grid, goal, start, path_g, &v_goal))
     return false;
   std::reverse(path_g.begin(), path_g.end());
 
-  if (!searchPathWithVoronoi(v_start, v_goal, path_v))
+  if (!searchPathWithVoronoi(grid, v_start, v_goal, path_v))
     return false;
 
   path_g.insert(path_g.end(), path_v.begin(), path_v.end());
@@ -80,13 +140,15 @@ bool VoronoiPlanner::plan(VoronoiData** voronoi_diagram, const Node& start, cons
 
 /**
  * @brief search the shortest path from start to VD, or search the shortest path in VD
+ * @param grid          the diagram to search on
  * @param start         start node
  * @param goal          goal node
  * @param v_goal        the voronoi node in VD which is closest to start node
  * @param path          shortest path from start to VD
  * @return  true if path found, else false
  */
-bool VoronoiPlanner::searchPathWithVoronoi(const Node& start, const Node& goal, std::vector<Node>& path, Node* v_goal)
+bool VoronoiPlanner::searchPathWithVoronoi(const VoronoiGrid& grid, const Node& start, const Node& goal,
+                                           std::vector<Node>& path, Node* v_goal)
 {
   path.clear();
 
@@ -112,7 +174,7 @@ bool VoronoiPlanner::searchPathWithVoronoi(const Node& start, const Node& goal,
     closed_list.insert(current);
 
     // goal found
-    if ((current == goal) || (v_goal == nullptr ? false : voronoi_diagram_[current.x_][current.y_].is_voronoi))
+    if ((current == goal) || (v_goal == nullptr ? false : grid.is_voronoi[current.y_ * grid.nx + current.x_]))
     {
       path = _convertClosedListToPath(closed_list, start, current);
       if (v_goal != nullptr)
@@ -133,17 +195,24 @@ bool VoronoiPlanner::searchPathWithVoronoi(const Node& start, const Node& goal,
       if (closed_list.find(node_new) != closed_list.end())
         continue;
 
+      // next node hit the boundary
+      if ((node_new.x_ < 0) || (node_new.x_ >= grid.nx) || (node_new.y_ < 0) || (node_new.y_ >= grid.ny))
+        continue;
+
       // explore a new node
       node_new.id_ = grid2Index(node_new.x_, node_new.y_);
       node_new.pid_ = current.id_;
 
-      // next node hit the boundary or obstacle
-      if ((node_new.id_ < 0) || (node_new.id_ >= ns_) ||
-          (voronoi_diagram_[node_new.x_][node_new.y_].dist < circumscribed_radius_))
+      // next node hit the obstacle or leaves the corridor
+      const int i = node_new.y_ * grid.nx + node_new.x_;
+      if (grid.dist[i] < grid.min_dist)
+        continue;
+      if (grid.corridor && !grid.corridor[node_new.y_ / grid.corridor_factor * grid.corridor_nx +
+                                          node_new.x_ / grid.corridor_factor])
         continue;
 
       // search in VD
-      if ((v_goal == nullptr) && (!voronoi_diagram_[node_new.x_][node_new.y_].is_voronoi))
+      if ((v_goal == nullptr) && (!grid.is_voronoi[i]))
         continue;
 
       node_new.h_ = std::hypot(node_new.x_ - goal.x_, node_new.y_ - goal.y_);
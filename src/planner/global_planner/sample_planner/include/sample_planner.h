@@ -17,6 +17,7 @@
 #include <nav_core/base_global_planner.h>
 #include <nav_msgs/Path.h>
 #include <nav_msgs/GetPlan.h>
+#include <std_srvs/Trigger.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/Point.h>
 #include <std_msgs/ColorRGBA.h>
@@ -24,6 +25,8 @@
 #include <visualization_msgs/Marker.h>
 
 #include "global_planner.h"
+#include "instrumentation.h"
+#include "plan_recording.h"
 
 namespace sample_planner
 {
@@ -91,6 +94,13 @@ public:
    */
   bool makePlanService(nav_msgs::GetPlan::Request& req, nav_msgs::GetPlan::Response& resp);
 
+  /**
+   * @brief Write the current costmap as a snapshot into snapshot_dir, for offline replay
+   * @param req  request from client
+   * @param resp response from server, the snapshot file or the reason of a failure
+   */
+  bool dumpCostmapService(std_srvs::Trigger::Request& req, std_srvs::Trigger::Response& resp);
+
 protected:
   /**
    * @brief  publish expand zone
@@ -144,6 +154,12 @@ protected:
   global_planner::GlobalPlanner* g_planner_;  // global graph planner
   ros::Publisher expand_pub_;                 // nodes explorer publisher
   ros::ServiceServer make_plan_srv_;          // planning service
+  ros::ServiceServer dump_costmap_srv_;       // costmap snapshot service
+  std::string snapshot_dir_;                  // directory of the costmap snapshots
+
+  std::unique_ptr<global_planner::PlanRecorder> recorder_;          // plan recorder, if record_plans
+  global_planner::PlanRecord record_template_;                      // planner and parameters of the records
+  instrumentation::CostmapCopy record_costmap_;                     // costs of the plan being recorded
 
 private:
   boost::mutex mutex_;     // thread mutex
@@ -155,6 +171,10 @@ private:
   int sample_points_;      // random sample points
   double sample_max_d_;    // max distance between sample points
   double opt_r_;           // optimization raidus
+
+  instrumentation::Histogram* make_plan_time_;  // latency of makePlan
+  instrumentation::Histogram* search_time_;     // latency of the search alone
+  instrumentation::Counter* expansions_;        // nodes expanded by the searches
 };
 }  // namespace sample_planner
 #endif
\ No newline at end of file
@@ -116,13 +116,11 @@ Node InformedRRT::_generateRandomNode()
     {
       // unit ball sample
       double x, y;
-      std::random_device rd;
-      std::mt19937 eng(rd());
       std::uniform_real_distribution<float> p(-1, 1);
       while (true)
       {
-        x = p(eng);
-        y = p(eng);
+        x = p(rng_);
+        y = p(rng_);
         if (x * x + y * y < 1)
           break;
       }
@@ -15,6 +15,7 @@
 #include <random>
 
 #include "rrt.h"
+#include "instrumentation.h"
 
 namespace global_planner
 {
@@ -96,18 +97,14 @@ bool RRT::plan(const unsigned char* global_costmap, const Node& start, const Nod
  */
 Node RRT::_generateRandomNode()
 {
-  // obtain a random number from hardware
-  std::random_device rd;
-  // seed the generator
-  std::mt19937 eng(rd());
   // define the range
   std::uniform_real_distribution<float> p(0, 1);
   // heuristic
-  if (p(eng) > 0.05)
+  if (p(rng_) > 0.05)
   {
     // generate node
     std::uniform_int_distribution<int> distr(0, ns_ - 1);
-    const int id = distr(eng);
+    const int id = distr(rng_);
     int x, y;
     index2Grid(id, x, y);
     return Node(x, y, 0, 0, id, 0);
@@ -169,6 +166,9 @@ Node RRT::_findNearestPoint(std::unordered_set<Node, NodeIdAsHash, compare_coord
  */
 bool RRT::_isAnyObstacleInPath(const Node& n1, const Node& n2)
 {
+  static instrumentation::Counter& collision_checks = instrumentation::counter("sample_planner_collision_checks_total");
+  collision_checks.add();
+
   double theta = angle(n1, n2);
   double dist_ = dist(n1, n2);
 
@@ -12,6 +12,7 @@
  *
  **********************************************************/
 #include <pluginlib/class_list_macros.h>
+#include <random>
 #include <cmath>
 
 #include "sample_planner.h"
@@ -20,6 +21,9 @@
 #include "rrt_connect.h"
 #include "informed_rrt.h"
 
+#include "costmap_dump.h"
+#include "metrics_publisher.h"
+
 PLUGINLIB_EXPORT_CLASS(sample_planner::SamplePlanner, nav_core::BaseGlobalPlanner)
 
 namespace sample_planner
@@ -27,7 +31,13 @@ namespace sample_planner
 /**
  * @brief  Constructor(default)
  */
-SamplePlanner::SamplePlanner() : costmap_(NULL), initialized_(false), g_planner_(NULL)
+SamplePlanner::SamplePlanner()
+  : costmap_(NULL)
+  , initialized_(false)
+  , g_planner_(NULL)
+  , make_plan_time_(nullptr)
+  , search_time_(nullptr)
+  , expansions_(nullptr)
 {
 }
 /**
@@ -105,6 +115,13 @@ void SamplePlanner::initialize(std::string name, costmap_2d::Costmap2D* costmap,
 
     ROS_INFO("Using global sample planner: %s", planner_name.c_str());
 
+    // latency and expansion metrics, published on ~metrics
+    const std::string labels = "planner=\"" + planner_name + "\"";
+    make_plan_time_ = &instrumentation::histogram("planner_latency_seconds", labels + ",phase=\"make_plan\"");
+    search_time_ = &instrumentation::histogram("planner_latency_seconds", labels + ",phase=\"search\"");
+    expansions_ = &instrumentation::counter("planner_expansions_total", labels);
+    instrumentation::startMetricsPublisher();
+
     /*====================== register topics and services =======================*/
     // register planning publisher
     plan_pub_ = private_nh.advertise<nav_msgs::Path>("plan", 1);
@@ -113,6 +130,34 @@ void SamplePlanner::initialize(std::string name, costmap_2d::Costmap2D* costmap,
     // register planning service
     make_plan_srv_ = private_nh.advertiseService("make_plan", &SamplePlanner::makePlanService, this);
 
+    // register costmap snapshot service
+    private_nh.param("snapshot_dir", snapshot_dir_, (std::string) "/tmp");
+    dump_costmap_srv_ = private_nh.advertiseService("dump_costmap", &SamplePlanner::dumpCostmapService, this);
+
+    // record every plan request, to replay it offline with headless_sim plan_replay
+    bool record_plans;
+    private_nh.param("record_plans", record_plans, false);
+    if (record_plans)
+    {
+      global_planner::PlanRecorder::Options options;
+      int max_file_size;
+      private_nh.param("record_dir", options.directory, (std::string) "/tmp");
+      private_nh.param("record_max_file_size", max_file_size, 64);  // [MB]
+      private_nh.param("record_max_files", options.max_files, 8);
+      options.prefix = name + "_" + planner_name;
+      options.max_file_size = static_cast<size_t>(max_file_size) << 20;
+      recorder_.reset(new global_planner::PlanRecorder(options));
+
+      record_template_.planner = planner_name;
+      record_template_.params = { { "convert_offset", std::to_string(convert_offset_) },
+                                  { "outline_map", is_outline_ ? "true" : "false" },
+                                  { "obstacle_factor", std::to_string(factor_) },
+                                  { "sample_points", std::to_string(sample_points_) },
+                                  { "sample_max_d", std::to_string(sample_max_d_) },
+                                  { "optimization_r", std::to_string(opt_r_) } };
+      ROS_INFO("Recording plans into %s", options.directory.c_str());
+    }
+
     // set initialization flag
     initialized_ = true;
   }
@@ -136,13 +181,17 @@ bool SamplePlanner::makePlan(const geometry_msgs::PoseStamped& start, const geom
 bool SamplePlanner::makePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal,
                              double tolerance, std::vector<geometry_msgs::PoseStamped>& plan)
 {
-  // start thread mutex
-  boost::mutex::scoped_lock lock(mutex_);
   if (!initialized_)
   {
     ROS_ERROR("This planner has not been initialized yet, but it is being used, please call initialize() before use");
     return false;
   }
+
+  // the costmap before the thread mutex, in the order of move_base, which calls makePlan with the costmap locked
+  boost::unique_lock<costmap_2d::Costmap2D::mutex_t> costmap_lock(*costmap_->getMutex());
+  boost::mutex::scoped_lock lock(mutex_);
+  instrumentation::ScopedTimer make_plan_timer(*make_plan_time_);
+
   // clear existing plan
   plan.clear();
 
@@ -192,10 +241,28 @@ bool SamplePlanner::makePlan(const geometry_msgs::PoseStamped& start, const geom
   if (is_outline_)
     g_planner_->outlineMap(costmap_->getCharMap());
 
+  // a fresh seed per recorded plan, so that its replay draws the same numbers, and the costs the plan runs on
+  if (recorder_)
+  {
+    g_planner_->setSeed(std::random_device()());
+    instrumentation::copyCostmap(costmap_, record_costmap_);
+  }
+
   // calculate path
   std::vector<global_planner::Node> path;
   std::vector<global_planner::Node> expand;
-  bool path_found = g_planner_->plan(costmap_->getCharMap(), n_start, n_goal, path, expand);
+  bool path_found;
+  double search_time;
+  {
+    instrumentation::ScopedTimer search_timer(*search_time_);
+    path_found = g_planner_->plan(costmap_->getCharMap(), n_start, n_goal, path, expand);
+    search_time = search_timer.elapsed();
+  }
+  expansions_->add(expand.size());
+
+  if (recorder_)
+    instrumentation::recordPlan(*recorder_, record_template_, start, goal, n_start, n_goal, tolerance,
+                                g_planner_->getSeed(), path_found, path, expand.size(), search_time, record_costmap_);
 
   if (path_found)
   {
@@ -254,6 +321,21 @@ bool SamplePlanner::makePlanService(nav_msgs::GetPlan::Request& req, nav_msgs::G
   return true;
 }
 
+/**
+ * @brief Write the current costmap as a snapshot into snapshot_dir, for offline replay
+ * @param req  request from client
+ * @param resp response from server, the snapshot file or the reason of a failure
+ * @return true
+ */
+bool SamplePlanner::dumpCostmapService(std_srvs::Trigger::Request& req, std_srvs::Trigger::Response& resp)
+{
+  std::string result;
+  resp.success = global_planner::dumpCostmap(costmap_, mutex_, snapshot_dir_, result);
+  resp.message = result;
+
+  return true;
+}
+
 /**
  * @brief  publish expand zone
  * @param  expand  set of expand nodes
@@ -30,6 +30,7 @@
 #include <Eigen/Dense>
 
 #include "local_planner.h"
+#include "voronoi_layer.h"
 
 namespace apf_planner
 {
@@ -143,6 +144,8 @@ private:
 
   double inflation_radius_; // the costmap inflation radius of obstacles
 
+  bool use_clearance_field_;  // whether to take obstacle distances from a Voronoi layer instead of costs
+
   std::deque<Eigen::Vector2d> hist_nf_;  // historical net forces
 
   base_local_planner::OdometryHelperRos* odom_helper_;
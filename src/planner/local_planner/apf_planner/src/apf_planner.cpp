@@ -15,6 +15,9 @@
 #include "apf_planner.h"
 #include <pluginlib/class_list_macros.h>
 
+#include "instrumentation.h"
+#include "metrics_publisher.h"
+
 PLUGINLIB_EXPORT_CLASS(apf_planner::APFPlanner, nav_core::BaseLocalPlanner)
 
 namespace apf_planner
@@ -90,6 +93,9 @@ void APFPlanner::initialize(std::string name, tf2_ros::Buffer* tf, costmap_2d::C
 
     nh.param("inflation_radius", inflation_radius_, 1.0);
 
+    // use the distance field of a Voronoi layer (export_clearance) in the local costmap for the repulsive force
+    nh.param("use_clearance_field", use_clearance_field_, false);
+
     nh.param("base_frame", base_frame_, base_frame_);
     nh.param("map_frame", map_frame_, map_frame_);
 
@@ -106,6 +112,8 @@ void APFPlanner::initialize(std::string name, tf2_ros::Buffer* tf, costmap_2d::C
     costmap_sub_ = nh.subscribe<nav_msgs::OccupancyGrid>(
         "/move_base/local_costmap/costmap", 10, &APFPlanner::publishPotentialMap, this);
 
+    instrumentation::startMetricsPublisher();
+
     ROS_INFO("APF planner initialized!");
   }
   else
@@ -176,6 +184,11 @@ bool APFPlanner::computeVelocityCommands(geometry_msgs::Twist& cmd_vel)
     ROS_ERROR("APF planner has not been initialized");
     return false;
   }
+  static instrumentation::Histogram& compute_time =
+      instrumentation::histogram("planner_latency_seconds", "planner=\"apf\",phase=\"compute_velocity_commands\"");
+  static instrumentation::Histogram& repulsion_time =
+      instrumentation::histogram("planner_latency_seconds", "planner=\"apf\",phase=\"repulsive_force\"");
+  instrumentation::ScopedTimer compute_timer(compute_time);
 
   // odometry observation - getting robot velocities in robot frame
   nav_msgs::Odometry base_odom;
@@ -193,7 +206,10 @@ bool APFPlanner::computeVelocityCommands(geometry_msgs::Twist& cmd_vel)
 
   // compute the tatget pose and force at the current step
   Eigen::Vector2d attr_force, rep_force, net_force;
-  rep_force = getRepulsiveForce();
+  {
+    instrumentation::ScopedTimer repulsion_timer(repulsion_time);
+    rep_force = getRepulsiveForce();
+  }
   while (plan_index_ < global_plan_.size())
   {
     target_ps_ = global_plan_[plan_index_];
@@ -362,6 +378,35 @@ Eigen::Vector2d APFPlanner::getRepulsiveForce()
     return rep_force;
   }
 
+  if (use_clearance_field_)
+  {
+    boost::shared_ptr<const costmap_2d::VoronoiSnapshot> field =
+        costmap_2d::VoronoiLayer::getSnapshot(costmap_ros_->getLayeredCostmap());
+    // the field lags the rolling window by at least one update, so the robot's cell is located through the origins
+    const costmap_2d::Costmap2D* costmap = costmap_ros_->getCostmap();
+    int fx = -1, fy = -1;
+    if (field && field->hasGradient() && field->resolution == resolution_)
+    {
+      fx = (int)std::floor((costmap->getOriginX() - field->origin_x) / resolution_ + mx + 0.5);
+      fy = (int)std::floor((costmap->getOriginY() - field->origin_y) / resolution_ + my + 0.5);
+    }
+    if (fx >= 0 && fy >= 0 && fx < (int)field->size_x && fy < (int)field->size_y)
+    {
+      // exact obstacle distance normalized by the inflation radius instead of the estimate from costs below
+      double dist = field->getClearance(fx, fy) / inflation_radius_;
+      if (dist <= 0.0 || dist >= 1.0)
+        return rep_force;
+
+      double k = (1.0 - 1.0 / dist) / (dist * dist);
+      double gx, gy;
+      field->getClearanceGradient(fx, fy, gx, gy);
+      Eigen::Vector2d grad_dist(gx * resolution_ / inflation_radius_, gy * resolution_ / inflation_radius_);
+
+      rep_force = -k * grad_dist;
+      return rep_force;
+    }
+  }
+
   double current_cost = local_costmap_[mx + nx_ * my];
 
   if (current_cost >= cost_ub_ || current_cost < cost_lb_)
@@ -13,6 +13,9 @@
 
 #include <nav_core/parameter_magic.h>
 
+#include "instrumentation.h"
+#include "metrics_publisher.h"
+
 // register this planner as a BaseLocalPlanner plugin
 PLUGINLIB_EXPORT_CLASS(dwa_planner::DWAPlanner, nav_core::BaseLocalPlanner)
 
@@ -85,6 +88,7 @@ void DWAPlanner::initialize(std::string name, tf2_ros::Buffer* tf, costmap_2d::C
     }
 
     initialized_ = true;
+    instrumentation::startMetricsPublisher();
 
     ROS_INFO("Using local planner: %s", name.c_str());
 
@@ -165,28 +169,20 @@ bool DWAPlanner::dwaComputeVelocityCommands(geometry_msgs::PoseStamped& global_p
   geometry_msgs::PoseStamped robot_vel;
   odom_helper_.getRobotVel(robot_vel);
 
-  /* For timing uncomment
-  struct timeval start, end;
-  double start_t, end_t, t_diff;
-  gettimeofday(&start, NULL);
-  */
-
   // compute what trajectory to drive along
   geometry_msgs::PoseStamped drive_cmds;
   drive_cmds.header.frame_id = costmap_ros_->getBaseFrameID();
 
   // call with updated footprint
-  base_local_planner::Trajectory path = dp_->findBestPath(global_pose, robot_vel, drive_cmds);
+  static instrumentation::Histogram& search_time =
+      instrumentation::histogram("planner_latency_seconds", "planner=\"dwa\",phase=\"find_best_path\"");
+  base_local_planner::Trajectory path;
+  {
+    instrumentation::ScopedTimer search_timer(search_time);
+    path = dp_->findBestPath(global_pose, robot_vel, drive_cmds);
+  }
   // ROS_ERROR("Best: %.2f, %.2f, %.2f, %.2f", path.xv_, path.yv_, path.thetav_, path.cost_);
 
-  /* For timing uncomment
-  gettimeofday(&end, NULL);
-  start_t = start.tv_sec + double(start.tv_usec) / 1e6;
-  end_t = end.tv_sec + double(end.tv_usec) / 1e6;
-  t_diff = end_t - start_t;
-  ROS_INFO("Cycle time: %.9f", t_diff);
-  */
-
   // pass along drive commands
   cmd_vel.linear.x = drive_cmds.pose.position.x;
   cmd_vel.linear.y = drive_cmds.pose.position.y;
@@ -233,6 +229,10 @@ bool DWAPlanner::dwaComputeVelocityCommands(geometry_msgs::PoseStamped& global_p
 
 bool DWAPlanner::computeVelocityCommands(geometry_msgs::Twist& cmd_vel)
 {
+  static instrumentation::Histogram& compute_time =
+      instrumentation::histogram("planner_latency_seconds", "planner=\"dwa\",phase=\"compute_velocity_commands\"");
+  instrumentation::ScopedTimer compute_timer(compute_time);
+
   // dispatches to either dwa sampling control or stop and rotate control, depending on whether we have been close
   // enough to goal
   if (!costmap_ros_->getRobotPose(current_pose_))
@@ -0,0 +1,157 @@
+/***********************************************************
+ *
+ * @file: pid_controller.h
+ * @breif: Contains the ROS-free path tracking core of the PID local planner
+ * @author: Yang Haodong, Guo Zhanyu, Wu Maojia
+ * @update: 2023-10-1
+ * @version: 1.1
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+
+#ifndef PID_CONTROLLER_H_
+#define PID_CONTROLLER_H_
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace pid_planner
+{
+/**
+ * @brief PID path tracking in the plane, everything in the map frame. PIDPlanner wraps it for move_base, simulators
+ *        and tests may use it directly.
+ */
+class PIDController
+{
+public:
+  /**
+   * @brief Construct a new PIDController object with the defaults of pid_planner_params.yaml
+   */
+  PIDController();
+
+  /**
+   * @brief Set the control time step
+   * @param d_t control time step, i.e. 1 / controller_frequency
+   */
+  void setTimeStep(double d_t);
+
+  /**
+   * @brief Set the distance to the next plan point and the goal reached tolerances
+   * @param p_window    next point distance
+   * @param p_precision goal position tolerance
+   * @param o_precision goal orientation tolerance
+   */
+  void setTolerances(double p_window, double p_precision, double o_precision);
+
+  /**
+   * @brief Set the linear velocity limits
+   * @param max_v     maximum linear velocity
+   * @param min_v     minimum linear velocity
+   * @param max_v_inc maximum linear velocity increment per step
+   */
+  void setLinearLimits(double max_v, double min_v, double max_v_inc);
+
+  /**
+   * @brief Set the angular velocity limits
+   * @param max_w     maximum angular velocity
+   * @param min_w     minimum angular velocity
+   * @param max_w_inc maximum angular velocity increment per step
+   */
+  void setAngularLimits(double max_w, double min_w, double max_w_inc);
+
+  /**
+   * @brief Set the linear PID gains
+   */
+  void setLinearGains(double k_p, double k_i, double k_d);
+
+  /**
+   * @brief Set the angular PID gains
+   */
+  void setAngularGains(double k_p, double k_i, double k_d);
+
+  /**
+   * @brief Set the weight of the direction to the plan point against the direction of the plan
+   * @param k_theta 0 follows the plan direction, 1 heads to the plan point
+   */
+  void setThetaWeight(double k_theta);
+
+  /**
+   * @brief Set the plan to follow, the PID errors are reset if its goal changed
+   * @param plan     plan points (x, y)
+   * @param goal_yaw orientation at the goal
+   */
+  void setPlan(const std::vector<Eigen::Vector2d>& plan, double goal_yaw);
+
+  /**
+   * @brief Compute the velocity command following the plan
+   * @param pose  robot pose (x, y, theta)
+   * @param v     current linear velocity
+   * @param w     current angular velocity
+   * @param v_cmd linear velocity command
+   * @param w_cmd angular velocity command
+   * @return false if there is no plan, else true
+   */
+  bool computeVelocityCommands(const Eigen::Vector3d& pose, double v, double w, double& v_cmd, double& w_cmd);
+
+  /**
+   * @brief Check if the goal pose has been achieved
+   * @return True if achieved, false otherwise
+   */
+  bool isGoalReached() const;
+
+  /**
+   * @brief The plan point tracked by the last command
+   * @return target pose (x, y, theta)
+   */
+  const Eigen::Vector3d& getTarget() const;
+
+  /**
+   * @brief PID controller in linear
+   * @param v     current linear velocity
+   * @param b_x_d desired x in body frame
+   * @param b_y_d desired y in body frame
+   * @return linear velocity
+   */
+  double linearController(double v, double b_x_d, double b_y_d);
+
+  /**
+   * @brief PID controller in angular
+   * @param w       current angular velocity
+   * @param e_theta the error between the current and desired theta
+   * @return angular velocity
+   */
+  double angularController(double w, double e_theta);
+
+  /**
+   * @brief Regularize an angle into [-pi, pi)
+   */
+  static double regularizeAngle(double angle);
+
+private:
+  bool goal_reached_;
+  int plan_index_;
+  std::vector<Eigen::Vector2d> plan_;
+  double goal_yaw_;
+  Eigen::Vector3d target_;
+
+  double p_window_;                   // next point distance
+  double p_precision_, o_precision_;  // goal reached tolerance
+  double d_t_;                        // control time step
+
+  double max_v_, min_v_, max_v_inc_;  // linear velocity
+  double max_w_, min_w_, max_w_inc_;  // angular velocity
+
+  double k_v_p_, k_v_i_, k_v_d_;  // pid controller params
+  double k_w_p_, k_w_i_, k_w_d_;  // pid controller params
+  double k_theta_;                // pid controller params
+
+  double e_v_, e_w_;
+  double i_v_, i_w_;
+};
+}  // namespace pid_planner
+
+#endif
@@ -28,6 +28,7 @@
 #include <Eigen/Dense>
 
 #include "local_planner.h"
+#include "pid_controller.h"
 
 namespace pid_planner
 {
@@ -98,33 +99,16 @@ public:
   double AngularPIDController(nav_msgs::Odometry& base_odometry, double e_theta);
 
 private:
-  bool initialized_, goal_reached_;
+  bool initialized_;
   tf2_ros::Buffer* tf_;
   costmap_2d::Costmap2DROS* costmap_ros_;
 
-  int plan_index_;
-  std::vector<geometry_msgs::PoseStamped> global_plan_;
   geometry_msgs::PoseStamped target_ps_, current_ps_;
 
-  double p_window_;                   // next point distance
-  double p_precision_, o_precision_;  // goal reached tolerance
-  double d_t_;                        // control time step
-
-  double max_v_, min_v_, max_v_inc_;  // linear velocity
-  double max_w_, min_w_, max_w_inc_;  // angular velocity
-
-  double k_v_p_, k_v_i_, k_v_d_;  // pid controller params
-  double k_w_p_, k_w_i_, k_w_d_;  // pid controller params
-  double k_theta_;                // pid controller params
-
-  double e_v_, e_w_;
-  double i_v_, i_w_;
+  PIDController controller_;  // path tracking core
 
   base_local_planner::OdometryHelperRos* odom_helper_;
   ros::Publisher target_pose_pub_, current_pose_pub_;
-
-  double goal_x_, goal_y_;
-  Eigen::Vector3d goal_rpy_;
 };
 };  // namespace pid_planner
 
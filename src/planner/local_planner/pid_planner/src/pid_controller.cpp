@@ -0,0 +1,340 @@
+/***********************************************************
+ *
+ * @file: pid_controller.cpp
+ * @breif: Contains the ROS-free path tracking core of the PID local planner
+ * @author: Yang Haodong, Guo Zhanyu, Wu Maojia
+ * @update: 2023-10-1
+ * @version: 1.1
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <algorithm>
+#include <cmath>
+
+#include "pid_controller.h"
+
+namespace pid_planner
+{
+/**
+ * @brief Construct a new PIDController object with the defaults of pid_planner_params.yaml
+ */
+PIDController::PIDController()
+  : goal_reached_(false)
+  , plan_index_(0)
+  , goal_yaw_(0.0)
+  , target_(Eigen::Vector3d::Zero())
+  , p_window_(0.5)
+  , p_precision_(0.2)
+  , o_precision_(0.5)
+  , d_t_(0.1)
+  , max_v_(0.5)
+  , min_v_(0.0)
+  , max_v_inc_(0.5)
+  , max_w_(1.57)
+  , min_w_(0.0)
+  , max_w_inc_(1.57)
+  , k_v_p_(1.00)
+  , k_v_i_(0.01)
+  , k_v_d_(0.10)
+  , k_w_p_(1.00)
+  , k_w_i_(0.01)
+  , k_w_d_(0.10)
+  , k_theta_(0.5)
+  , e_v_(0.0)
+  , e_w_(0.0)
+  , i_v_(0.0)
+  , i_w_(0.0)
+{
+}
+
+/**
+ * @brief Set the control time step
+ * @param d_t control time step, i.e. 1 / controller_frequency
+ */
+void PIDController::setTimeStep(double d_t)
+{
+  d_t_ = d_t;
+}
+
+/**
+ * @brief Set the distance to the next plan point and the goal reached tolerances
+ * @param p_window    next point distance
+ * @param p_precision goal position tolerance
+ * @param o_precision goal orientation tolerance
+ */
+void PIDController::setTolerances(double p_window, double p_precision, double o_precision)
+{
+  p_window_ = p_window;
+  p_precision_ = p_precision;
+  o_precision_ = o_precision;
+}
+
+/**
+ * @brief Set the linear velocity limits
+ * @param max_v     maximum linear velocity
+ * @param min_v     minimum linear velocity
+ * @param max_v_inc maximum linear velocity increment per step
+ */
+void PIDController::setLinearLimits(double max_v, double min_v, double max_v_inc)
+{
+  max_v_ = max_v;
+  min_v_ = min_v;
+  max_v_inc_ = max_v_inc;
+}
+
+/**
+ * @brief Set the angular velocity limits
+ * @param max_w     maximum angular velocity
+ * @param min_w     minimum angular velocity
+ * @param max_w_inc maximum angular velocity increment per step
+ */
+void PIDController::setAngularLimits(double max_w, double min_w, double max_w_inc)
+{
+  max_w_ = max_w;
+  min_w_ = min_w;
+  max_w_inc_ = max_w_inc;
+}
+
+/**
+ * @brief Set the linear PID gains
+ */
+void PIDController::setLinearGains(double k_p, double k_i, double k_d)
+{
+  k_v_p_ = k_p;
+  k_v_i_ = k_i;
+  k_v_d_ = k_d;
+}
+
+/**
+ * @brief Set the angular PID gains
+ */
+void PIDController::setAngularGains(double k_p, double k_i, double k_d)
+{
+  k_w_p_ = k_p;
+  k_w_i_ = k_i;
+  k_w_d_ = k_d;
+}
+
+/**
+ * @brief Set the weight of the direction to the plan point against the direction of the plan
+ * @param k_theta 0 follows the plan direction, 1 heads to the plan point
+ */
+void PIDController::setThetaWeight(double k_theta)
+{
+  k_theta_ = k_theta;
+}
+
+/**
+ * @brief Set the plan to follow, the PID errors are reset if its goal changed
+ * @param plan     plan points (x, y)
+ * @param goal_yaw orientation at the goal
+ */
+void PIDController::setPlan(const std::vector<Eigen::Vector2d>& plan, double goal_yaw)
+{
+  // receive a plan for a new goal
+  if (!plan.empty() && (plan_.empty() || plan.back() != plan_.back()))
+  {
+    goal_reached_ = false;
+    e_v_ = i_v_ = 0.0;
+    e_w_ = i_w_ = 0.0;
+  }
+
+  plan_ = plan;
+  goal_yaw_ = goal_yaw;
+
+  // help getting a future plan, since the plan may delay
+  plan_index_ = std::min(4, (int)plan_.size() - 1);
+}
+
+/**
+ * @brief Compute the velocity command following the plan
+ * @param pose  robot pose (x, y, theta)
+ * @param v     current linear velocity
+ * @param w     current angular velocity
+ * @param v_cmd linear velocity command
+ * @param w_cmd angular velocity command
+ * @return false if there is no plan, else true
+ */
+bool PIDController::computeVelocityCommands(const Eigen::Vector3d& pose, double v, double w, double& v_cmd,
+                                            double& w_cmd)
+{
+  if (plan_.empty())
+    return false;
+
+  const double theta = pose.z();
+  const double cos_theta = std::cos(theta), sin_theta = std::sin(theta);
+
+  double theta_d = theta, theta_dir, theta_trj;
+  double b_x_d = 0.0, b_y_d = 0.0;  // desired x, y in base frame
+  double e_theta = 0.0;
+
+  while (plan_index_ < (int)plan_.size())
+  {
+    const Eigen::Vector2d& target = plan_[plan_index_];
+
+    // from robot to plan point
+    theta_dir = std::atan2(target.y() - pose.y(), target.x() - pose.x());
+
+    // theta on the trajectory, the last point has none
+    theta_trj = theta_dir;
+    if (plan_index_ + 1 < (int)plan_.size())
+      theta_trj = std::atan2(plan_[plan_index_ + 1].y() - target.y(), plan_[plan_index_ + 1].x() - target.x());
+
+    // if the difference is greater than PI, it will get a wrong result
+    if (std::fabs(theta_trj - theta_dir) > M_PI)
+    {
+      // add 2*PI to the smaller one
+      if (theta_trj > theta_dir)
+        theta_dir += 2 * M_PI;
+      else
+        theta_trj += 2 * M_PI;
+    }
+
+    // weighting between two angle
+    theta_d = regularizeAngle((1 - k_theta_) * theta_trj + k_theta_ * theta_dir);
+    target_ = Eigen::Vector3d(target.x(), target.y(), theta_d);
+
+    // from map into base frame
+    const double dx = target.x() - pose.x(), dy = target.y() - pose.y();
+    b_x_d = cos_theta * dx + sin_theta * dy;
+    b_y_d = -sin_theta * dx + cos_theta * dy;
+
+    e_theta = regularizeAngle(theta_d - theta);
+
+    if (std::hypot(b_x_d, b_y_d) > p_window_)
+      break;
+
+    ++plan_index_;
+  }
+
+  // position reached
+  if ((plan_.back() - pose.head<2>()).norm() < p_precision_)
+  {
+    e_theta = regularizeAngle(goal_yaw_ - theta);
+
+    // orientation reached
+    if (std::fabs(e_theta) < o_precision_)
+    {
+      v_cmd = 0.0;
+      w_cmd = 0.0;
+
+      goal_reached_ = true;
+    }
+    // orientation not reached
+    else
+    {
+      v_cmd = 0.0;
+      w_cmd = angularController(w, e_theta);
+    }
+  }
+  // large angle, turn first
+  else if (std::fabs(e_theta) > M_PI_2)
+  {
+    v_cmd = 0.0;
+    w_cmd = angularController(w, e_theta);
+  }
+  // posistion not reached
+  else
+  {
+    v_cmd = linearController(v, b_x_d, b_y_d);
+    w_cmd = angularController(w, e_theta);
+  }
+
+  return true;
+}
+
+/**
+ * @brief Check if the goal pose has been achieved
+ * @return True if achieved, false otherwise
+ */
+bool PIDController::isGoalReached() const
+{
+  return goal_reached_;
+}
+
+/**
+ * @brief The plan point tracked by the last command
+ * @return target pose (x, y, theta)
+ */
+const Eigen::Vector3d& PIDController::getTarget() const
+{
+  return target_;
+}
+
+/**
+ * @brief PID controller in linear
+ * @param v     current linear velocity
+ * @param b_x_d desired x in body frame
+ * @param b_y_d desired y in body frame
+ * @return linear velocity
+ */
+double PIDController::linearController(double v, double b_x_d, double b_y_d)
+{
+  double v_d = std::hypot(b_x_d, b_y_d) / d_t_;
+  if (std::fabs(v_d) > max_v_)
+    v_d = std::copysign(max_v_, v_d);
+
+  double e_v = v_d - v;
+  i_v_ += e_v * d_t_;
+  double d_v = (e_v - e_v_) / d_t_;
+  e_v_ = e_v;
+
+  double v_inc = k_v_p_ * e_v + k_v_i_ * i_v_ + k_v_d_ * d_v;
+
+  if (std::fabs(v_inc) > max_v_inc_)
+    v_inc = std::copysign(max_v_inc_, v_inc);
+
+  double v_cmd = v + v_inc;
+  if (std::fabs(v_cmd) > max_v_)
+    v_cmd = std::copysign(max_v_, v_cmd);
+  else if (std::fabs(v_cmd) < min_v_)
+    v_cmd = std::copysign(min_v_, v_cmd);
+
+  return v_cmd;
+}
+
+/**
+ * @brief PID controller in angular
+ * @param w       current angular velocity
+ * @param e_theta the error between the current and desired theta
+ * @return angular velocity
+ */
+double PIDController::angularController(double w, double e_theta)
+{
+  e_theta = regularizeAngle(e_theta);
+
+  double w_d = e_theta / d_t_;
+  if (std::fabs(w_d) > max_w_)
+    w_d = std::copysign(max_w_, w_d);
+
+  double e_w = w_d - w;
+  i_w_ += e_w * d_t_;
+  double d_w = (e_w - e_w_) / d_t_;
+  e_w_ = e_w;
+
+  double w_inc = k_w_p_ * e_w + k_w_i_ * i_w_ + k_w_d_ * d_w;
+
+  if (std::fabs(w_inc) > max_w_inc_)
+    w_inc = std::copysign(max_w_inc_, w_inc);
+
+  double w_cmd = w + w_inc;
+  if (std::fabs(w_cmd) > max_w_)
+    w_cmd = std::copysign(max_w_, w_cmd);
+  else if (std::fabs(w_cmd) < min_w_)
+    w_cmd = std::copysign(min_w_, w_cmd);
+
+  return w_cmd;
+}
+
+/**
+ * @brief Regularize an angle into [-pi, pi)
+ */
+double PIDController::regularizeAngle(double angle)
+{
+  return angle - 2.0 * M_PI * std::floor((angle + M_PI) / (2.0 * M_PI));
+}
+
+}  // namespace pid_planner
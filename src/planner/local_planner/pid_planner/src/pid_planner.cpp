@@ -14,6 +14,8 @@
 #include <pluginlib/class_list_macros.h>
 
 #include "pid_planner.h"
+#include "instrumentation.h"
+#include "metrics_publisher.h"
 
 PLUGINLIB_EXPORT_CLASS(pid_planner::PIDPlanner, nav_core::BaseLocalPlanner)
 
@@ -22,8 +24,7 @@ namespace pid_planner
 /**
  * @brief Construct a new PIDPlanner object
  */
-PIDPlanner::PIDPlanner()
-  : initialized_(false), tf_(nullptr), costmap_ros_(nullptr), goal_reached_(false), plan_index_(0)
+PIDPlanner::PIDPlanner() : initialized_(false), tf_(nullptr), costmap_ros_(nullptr)
 {
 }
 
@@ -58,40 +59,50 @@ void PIDPlanner::initialize(std::string name, tf2_ros::Buffer* tf, costmap_2d::C
 
     ros::NodeHandle nh = ros::NodeHandle("~/" + name);
 
-    nh.param("p_window", p_window_, 0.5);
+    double p_window, p_precision, o_precision;
+    nh.param("p_window", p_window, 0.5);
 
-    nh.param("p_precision", p_precision_, 0.2);
-    nh.param("o_precision", o_precision_, 0.5);
+    nh.param("p_precision", p_precision, 0.2);
+    nh.param("o_precision", o_precision, 0.5);
+    controller_.setTolerances(p_window, p_precision, o_precision);
 
-    nh.param("max_v", max_v_, 0.5);
-    nh.param("min_v", min_v_, 0.0);
-    nh.param("max_v_inc", max_v_inc_, 0.5);
+    double max_v, min_v, max_v_inc;
+    nh.param("max_v", max_v, 0.5);
+    nh.param("min_v", min_v, 0.0);
+    nh.param("max_v_inc", max_v_inc, 0.5);
+    controller_.setLinearLimits(max_v, min_v, max_v_inc);
 
-    nh.param("max_w", max_w_, 1.57);
-    nh.param("min_w", min_w_, 0.0);
-    nh.param("max_w_inc", max_w_inc_, 1.57);
+    double max_w, min_w, max_w_inc;
+    nh.param("max_w", max_w, 1.57);
+    nh.param("min_w", min_w, 0.0);
+    nh.param("max_w_inc", max_w_inc, 1.57);
+    controller_.setAngularLimits(max_w, min_w, max_w_inc);
 
-    nh.param("k_v_p", k_v_p_, 1.00);
-    nh.param("k_v_i", k_v_i_, 0.01);
-    nh.param("k_v_d", k_v_d_, 0.10);
+    double k_p, k_i, k_d;
+    nh.param("k_v_p", k_p, 1.00);
+    nh.param("k_v_i", k_i, 0.01);
+    nh.param("k_v_d", k_d, 0.10);
+    controller_.setLinearGains(k_p, k_i, k_d);
 
-    nh.param("k_w_p", k_w_p_, 1.00);
-    nh.param("k_w_i", k_w_i_, 0.01);
-    nh.param("k_w_d", k_w_d_, 0.10);
+    nh.param("k_w_p", k_p, 1.00);
+    nh.param("k_w_i", k_i, 0.01);
+    nh.param("k_w_d", k_d, 0.10);
+    controller_.setAngularGains(k_p, k_i, k_d);
 
-    nh.param("k_theta", k_theta_, 0.5);
+    double k_theta;
+    nh.param("k_theta", k_theta, 0.5);
+    controller_.setThetaWeight(k_theta);
 
     double controller_freqency;
     nh.param("/move_base/controller_frequency", controller_freqency, 10.0);
-    d_t_ = 1 / controller_freqency;
-
-    e_v_ = i_v_ = 0.0;
-    e_w_ = i_w_ = 0.0;
+    controller_.setTimeStep(1 / controller_freqency);
 
     odom_helper_ = new base_local_planner::OdometryHelperRos("/odom");
     target_pose_pub_ = nh.advertise<geometry_msgs::PoseStamped>("/target_pose", 10);
     current_pose_pub_ = nh.advertise<geometry_msgs::PoseStamped>("/current_pose", 10);
 
+    instrumentation::startMetricsPublisher();
+
     ROS_INFO("PID planner initialized!");
   }
   else
@@ -114,23 +125,18 @@ bool PIDPlanner::setPlan(const std::vector<geometry_msgs::PoseStamped>& orig_glo
   ROS_INFO("Got new plan");
 
   // set new plan
-  global_plan_.clear();
-  global_plan_ = orig_global_plan;
-
-  // reset plan parameters
-  plan_index_ = std::min(4, (int)global_plan_.size() - 1);  // help getting a future plan, since the plan may delay
+  std::vector<Eigen::Vector2d> plan;
+  plan.reserve(orig_global_plan.size());
+  for (const auto& ps : orig_global_plan)
+    plan.emplace_back(ps.pose.position.x, ps.pose.position.y);
 
-  // receive a plan for a new goal
-  if (goal_x_ != global_plan_.back().pose.position.x || goal_y_ != global_plan_.back().pose.position.y)
+  double goal_yaw = 0.0;
+  if (!orig_global_plan.empty())
   {
-    goal_x_ = global_plan_.back().pose.position.x;
-    goal_y_ = global_plan_.back().pose.position.y;
-    goal_rpy_ = getEulerAngles(global_plan_.back());
-    goal_reached_ = false;
-
-    e_v_ = i_v_ = 0.0;
-    e_w_ = i_w_ = 0.0;
+    geometry_msgs::PoseStamped goal = orig_global_plan.back();
+    goal_yaw = getEulerAngles(goal)[2];
   }
+  controller_.setPlan(plan, goal_yaw);
 
   return true;
 }
@@ -147,7 +153,7 @@ bool PIDPlanner::isGoalReached()
     return false;
   }
 
-  if (goal_reached_)
+  if (controller_.isGoalReached())
   {
     ROS_INFO("GOAL Reached!");
     return true;
@@ -167,6 +173,11 @@ bool PIDPlanner::computeVelocityCommands(geometry_msgs::Twist& cmd_vel)
     ROS_ERROR("PID planner has not been initialized");
     return false;
   }
+  static instrumentation::Histogram& compute_time =
+      instrumentation::histogram("planner_latency_seconds", "planner=\"pid\",phase=\"compute_velocity_commands\"");
+  static instrumentation::Histogram& control_time =
+      instrumentation::histogram("planner_latency_seconds", "planner=\"pid\",phase=\"control\"");
+  instrumentation::ScopedTimer compute_timer(compute_time);
 
   // current pose
   geometry_msgs::PoseStamped current_ps_odom;
@@ -178,100 +189,34 @@ bool PIDPlanner::computeVelocityCommands(geometry_msgs::Twist& cmd_vel)
   // current angle
   double theta = tf2::getYaw(current_ps_.pose.orientation);  // [-pi, pi]
 
-  double theta_d, theta_dir, theta_trj;
-  double b_x_d, b_y_d;  // desired x, y in base frame
-  double e_theta;
-
-  while (plan_index_ < global_plan_.size())
-  {
-    target_ps_ = global_plan_[plan_index_];
-    double x_d = target_ps_.pose.position.x;
-    double y_d = target_ps_.pose.position.y;
-
-    // from robot to plan point
-    theta_dir = atan2((y_d - current_ps_.pose.position.y), (x_d - current_ps_.pose.position.x));
-
-    int next_plan_index = plan_index_ + 1;
-    if (next_plan_index < global_plan_.size())
-    {
-      // theta on the trajectory
-      theta_trj = atan2((global_plan_[next_plan_index].pose.position.y - y_d),
-                        (global_plan_[next_plan_index].pose.position.x - x_d));
-    }
-
-    // if the difference is greater than PI, it will get a wrong result
-    if (fabs(theta_trj - theta_dir) > M_PI)
-    {
-      // add 2*PI to the smaller one
-      if (theta_trj > theta_dir)
-        theta_dir += 2 * M_PI;
-      else
-        theta_trj += 2 * M_PI;
-    }
-
-    // weighting between two angle
-    theta_d = (1 - k_theta_) * theta_trj + k_theta_ * theta_dir;
-    regularizeAngle(theta_d);
-
-    tf2::Quaternion q;
-    q.setRPY(0, 0, theta_d);
-    tf2::convert(q, target_ps_.pose.orientation);
-
-    // transform from map into base_frame
-    geometry_msgs::PoseStamped dst;
-    target_ps_.header.stamp = ros::Time(0);
-    tf_->transform(target_ps_, dst, base_frame_);
-    b_x_d = dst.pose.position.x;
-    b_y_d = dst.pose.position.y;
-
-    e_theta = theta_d - theta;
-    regularizeAngle(e_theta);
-
-    if (std::hypot(b_x_d, b_y_d) > p_window_)
-      break;
-
-    ++plan_index_;
-  }
-
   // odometry observation - getting robot velocities in robot frame
   nav_msgs::Odometry base_odom;
   odom_helper_->getOdom(base_odom);
+  double v = std::hypot(base_odom.twist.twist.linear.x, base_odom.twist.twist.linear.y);
+  double w = base_odom.twist.twist.angular.z;
 
-  // position reached
-  if (dist(Eigen::Vector2d(global_plan_.back().pose.position.x, global_plan_.back().pose.position.y),
-           Eigen::Vector2d(current_ps_.pose.position.x, current_ps_.pose.position.y)) < p_precision_)
-  {
-    e_theta = goal_rpy_[2] - theta;
-    regularizeAngle(e_theta);
-
-    // orientation reached
-    if (std::fabs(e_theta) < o_precision_)
-    {
-      cmd_vel.linear.x = 0.0;
-      cmd_vel.angular.z = 0.0;
-
-      goal_reached_ = true;
-    }
-    // orientation not reached
-    else
-    {
-      cmd_vel.linear.x = 0.0;
-      cmd_vel.angular.z = AngularPIDController(base_odom, e_theta);
-    }
-  }
-  // large angle, turn first
-  else if (std::fabs(e_theta) > M_PI_2)
+  bool has_target;
   {
-    cmd_vel.linear.x = 0.0;
-    cmd_vel.angular.z = AngularPIDController(base_odom, e_theta);
+    instrumentation::ScopedTimer control_timer(control_time);
+    has_target = controller_.computeVelocityCommands(
+        Eigen::Vector3d(current_ps_.pose.position.x, current_ps_.pose.position.y, theta), v, w, cmd_vel.linear.x,
+        cmd_vel.angular.z);
   }
-  // posistion not reached
-  else
+  if (!has_target)
   {
-    cmd_vel.linear.x = LinearPIDController(base_odom, b_x_d, b_y_d);
-    cmd_vel.angular.z = AngularPIDController(base_odom, e_theta);
+    ROS_ERROR("PID planner has no plan to follow");
+    return false;
   }
 
+  // next target pose
+  const Eigen::Vector3d& target = controller_.getTarget();
+  target_ps_.header.frame_id = map_frame_;
+  target_ps_.pose.position.x = target.x();
+  target_ps_.pose.position.y = target.y();
+  tf2::Quaternion q;
+  q.setRPY(0, 0, target.z());
+  tf2::convert(q, target_ps_.pose.orientation);
+
   // publish next target_ps_ pose
   // target_ps_.header.frame_id = "map";
   // target_ps_.header.stamp = ros::Time::now();
@@ -295,27 +240,7 @@ bool PIDPlanner::computeVelocityCommands(geometry_msgs::Twist& cmd_vel)
 double PIDPlanner::LinearPIDController(nav_msgs::Odometry& base_odometry, double b_x_d, double b_y_d)
 {
   double v = std::hypot(base_odometry.twist.twist.linear.x, base_odometry.twist.twist.linear.y);
-  double v_d = std::hypot(b_x_d, b_y_d) / d_t_;
-  if (std::fabs(v_d) > max_v_)
-    v_d = std::copysign(max_v_, v_d);
-
-  double e_v = v_d - v;
-  i_v_ += e_v * d_t_;
-  double d_v = (e_v - e_v_) / d_t_;
-  e_v_ = e_v;
-
-  double v_inc = k_v_p_ * e_v + k_v_i_ * i_v_ + k_v_d_ * d_v;
-
-  if (std::fabs(v_inc) > max_v_inc_)
-    v_inc = std::copysign(max_v_inc_, v_inc);
-
-  double v_cmd = v + v_inc;
-  if (std::fabs(v_cmd) > max_v_)
-    v_cmd = std::copysign(max_v_, v_cmd);
-  else if (std::fabs(v_cmd) < min_v_)
-    v_cmd = std::copysign(min_v_, v_cmd);
-
-  return v_cmd;
+  return controller_.linearController(v, b_x_d, b_y_d);
 }
 
 /**
@@ -326,30 +251,7 @@ double PIDPlanner::LinearPIDController(nav_msgs::Odometry& base_odometry, double
  */
 double PIDPlanner::AngularPIDController(nav_msgs::Odometry& base_odometry, double e_theta)
 {
-  regularizeAngle(e_theta);
-
-  double w_d = e_theta / d_t_;
-  if (std::fabs(w_d) > max_w_)
-    w_d = std::copysign(max_w_, w_d);
-
-  double w = base_odometry.twist.twist.angular.z;
-  double e_w = w_d - w;
-  i_w_ += e_w * d_t_;
-  double d_w = (e_w - e_w_) / d_t_;
-  e_w_ = e_w;
-
-  double w_inc = k_w_p_ * e_w + k_w_i_ * i_w_ + k_w_d_ * d_w;
-
-  if (std::fabs(w_inc) > max_w_inc_)
-    w_inc = std::copysign(max_w_inc_, w_inc);
-
-  double w_cmd = w + w_inc;
-  if (std::fabs(w_cmd) > max_w_)
-    w_cmd = std::copysign(max_w_, w_cmd);
-  else if (std::fabs(w_cmd) < min_w_)
-    w_cmd = std::copysign(min_w_, w_cmd);
-
-  return w_cmd;
+  return controller_.angularController(base_odometry.twist.twist.angular.z, e_theta);
 }
 
 }  // namespace pid_planner
\ No newline at end of file
@@ -14,6 +14,9 @@
 #include "static_planner.h"
 #include <pluginlib/class_list_macros.h>
 
+#include "instrumentation.h"
+#include "metrics_publisher.h"
+
 PLUGINLIB_EXPORT_CLASS(static_planner::StaticPlanner, nav_core::BaseLocalPlanner)
 
 namespace static_planner
@@ -53,6 +56,7 @@ void StaticPlanner::initialize(std::string name, tf2_ros::Buffer* tf, costmap_2d
   {
     initialized_ = true;
     ros::NodeHandle nh = ros::NodeHandle("~/" + name);
+    instrumentation::startMetricsPublisher();
 
     ROS_INFO("Static planner initialized!");
   }
@@ -107,6 +111,9 @@ bool StaticPlanner::computeVelocityCommands(geometry_msgs::Twist& cmd_vel)
     ROS_ERROR("Static planner has not been initialized");
     return false;
   }
+  static instrumentation::Histogram& compute_time =
+      instrumentation::histogram("planner_latency_seconds", "planner=\"static\",phase=\"compute_velocity_commands\"");
+  instrumentation::ScopedTimer compute_timer(compute_time);
 
   cmd_vel.linear.x = 0.0;
   cmd_vel.angular.z = 0.0;
@@ -0,0 +1,291 @@
+/***********************************************************
+ *
+ * @file: instrumentation.h
+ * @breif: Low overhead scoped timers, latency histograms and counters for the planner hot paths
+ * @author: Yang Haodong
+ * @update: 2023-10-1
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace instrumentation
+{
+/**
+ * @brief Time stamp counter clock, the steady clock in nanoseconds where there is no TSC. The TSC is assumed to be
+ *        invariant (constant_tsc), as on every x86 CPU of the last decade.
+ */
+class Clock
+{
+public:
+  /**
+   * @brief Current tick count
+   */
+  static inline uint64_t now()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  /**
+   * @brief Length of a tick in nanoseconds, calibrated against the steady clock on the first call
+   */
+  static double nanosecondsPerTick();
+};
+
+/**
+ * @brief Slot of the calling thread for the metric with the given ID
+ */
+void*& threadSlot(size_t id);
+
+/**
+ * @brief Process wide unique metric ID, indexing the thread slots
+ */
+size_t newMetricId();
+
+/**
+ * @brief Metric whose values are kept in one shard per writing thread, so that recording never locks or shares a
+ *        cache line with another thread. Readers merge the shards.
+ */
+template <class Shard>
+class ShardedMetric
+{
+public:
+  ShardedMetric(const std::string& name, const std::string& labels);
+  ShardedMetric(const ShardedMetric&) = delete;
+  ShardedMetric& operator=(const ShardedMetric&) = delete;
+
+  const std::string& name() const
+  {
+    return name_;
+  }
+  const std::string& labels() const
+  {
+    return labels_;
+  }
+
+protected:
+  /**
+   * @brief Shard of the calling thread, created on its first record
+   */
+  inline Shard& local()
+  {
+    void*& slot = threadSlot(id_);
+    if (!slot)
+      slot = addShard();
+    return *static_cast<Shard*>(slot);
+  }
+
+  /**
+   * @brief Add n to a value only the calling thread writes, without a locked instruction
+   */
+  static inline void bump(std::atomic<uint64_t>& value, uint64_t n)
+  {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  Shard* addShard();
+
+  std::string name_, labels_;
+  size_t id_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+struct CounterShard
+{
+  std::atomic<uint64_t> value{ 0 };
+  char padding[56];  // a cache line of its own (alignas would need the C++17 aligned new)
+};
+
+/**
+ * @brief Monotonic event counter, e.g. node expansions or collision checks
+ */
+class Counter : public ShardedMetric<CounterShard>
+{
+public:
+  using ShardedMetric::ShardedMetric;
+
+  inline void add(uint64_t n = 1)
+  {
+    bump(local().value, n);
+  }
+
+  /**
+   * @brief Sum over all threads
+   */
+  uint64_t value() const;
+};
+
+/**
+ * @brief Merged state of a histogram
+ */
+struct HistogramSnapshot
+{
+  std::vector<uint64_t> buckets;
+  uint64_t count = 0;
+  uint64_t sum = 0;  // [ns]
+
+  /**
+   * @brief Approximate quantile, NaN if there are no samples
+   * @param q quantile in [0, 1]
+   * @return value at the quantile [s]
+   */
+  double quantile(double q) const;
+
+  /**
+   * @brief Samples recorded after base
+   */
+  HistogramSnapshot since(const HistogramSnapshot& base) const;
+};
+
+struct HistogramShard
+{
+  // log-linear buckets, 2^kSubBits per power of two (12.5% relative error), values below kLinear exactly
+  static constexpr int kSubBits = 3;
+  static constexpr int kLinear = 2 << kSubBits;
+  static constexpr int kBuckets = kLinear + (64 - kSubBits - 1) * (1 << kSubBits);
+
+  std::atomic<uint64_t> buckets[kBuckets];
+  std::atomic<uint64_t> count{ 0 };
+  std::atomic<uint64_t> sum{ 0 };
+
+  HistogramShard()
+  {
+    for (auto& b : buckets)
+      b.store(0, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * @brief Latency histogram in nanoseconds
+ */
+class Histogram : public ShardedMetric<HistogramShard>
+{
+public:
+  using ShardedMetric::ShardedMetric;
+
+  /**
+   * @brief Bucket of a value
+   */
+  static inline int bucket(uint64_t ns)
+  {
+    if (ns < HistogramShard::kLinear)
+      return static_cast<int>(ns);
+    const int sub_bits = HistogramShard::kSubBits;
+    const int msb = 63 - __builtin_clzll(ns);
+    const int sub = static_cast<int>(ns >> (msb - sub_bits)) & ((1 << sub_bits) - 1);
+    return HistogramShard::kLinear + (msb - sub_bits - 1) * (1 << sub_bits) + sub;
+  }
+
+  /**
+   * @brief Smallest value of a bucket and its width
+   */
+  static void bucketRange(int b, uint64_t& lower, uint64_t& width);
+
+  inline void record(uint64_t ns)
+  {
+    HistogramShard& shard = local();
+    bump(shard.buckets[bucket(ns)], 1);
+    bump(shard.count, 1);
+    bump(shard.sum, ns);
+  }
+
+  HistogramSnapshot snapshot() const;
+};
+
+/**
+ * @brief Records the lifetime of the scope into a histogram
+ */
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(Histogram& histogram) : histogram_(histogram), start_(Clock::now())
+  {
+  }
+  ~ScopedTimer()
+  {
+    histogram_.record(static_cast<uint64_t>((Clock::now() - start_) * Clock::nanosecondsPerTick()));
+  }
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+  /**
+   * @brief Time since construction [s]
+   */
+  double elapsed() const
+  {
+    return (Clock::now() - start_) * Clock::nanosecondsPerTick() * 1e-9;
+  }
+
+private:
+  Histogram& histogram_;
+  uint64_t start_;
+};
+
+/**
+ * @brief Counter of the process registry, created on the first call. Metrics live until the process exits, so call
+ *        sites may keep the reference.
+ * @param name   metric name, e.g. planner_expansions_total
+ * @param labels Prometheus labels without braces, e.g. planner="a_star"
+ */
+Counter& counter(const std::string& name, const std::string& labels = "");
+
+/**
+ * @brief Histogram of the process registry, created on the first call
+ * @param name   metric name, e.g. planner_latency_seconds
+ * @param labels Prometheus labels without braces, e.g. planner="a_star",phase="search"
+ */
+Histogram& histogram(const std::string& name, const std::string& labels = "");
+
+/**
+ * @brief Renders the process registry in the Prometheus text exposition format. Histograms become summaries whose
+ *        p50 and p99 cover the samples since the previous render and whose sum and count are cumulative.
+ */
+class PrometheusWriter
+{
+public:
+  std::string render();
+
+private:
+  std::map<const Histogram*, HistogramSnapshot> last_;
+};
+
+template <class Shard>
+ShardedMetric<Shard>::ShardedMetric(const std::string& name, const std::string& labels)
+  : name_(name), labels_(labels), id_(newMetricId())
+{
+}
+
+template <class Shard>
+Shard* ShardedMetric<Shard>::addShard()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  shards_.emplace_back(new Shard());
+  return shards_.back().get();
+}
+}  // namespace instrumentation
+
+#endif
@@ -0,0 +1,26 @@
+/***********************************************************
+ *
+ * @file: metrics_publisher.h
+ * @breif: Periodic Prometheus text of the instrumentation registry on a ROS topic
+ * @author: Yang Haodong
+ * @update: 2023-10-1
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#ifndef METRICS_PUBLISHER_H
+#define METRICS_PUBLISHER_H
+
+namespace instrumentation
+{
+/**
+ * @brief Publish the metrics of the process as std_msgs/String on ~metrics every ~metrics_period seconds (default 1,
+ *        0 disables). Every planner plugin calls it on initialization, only the first call of the process advertises.
+ */
+void startMetricsPublisher();
+}  // namespace instrumentation
+
+#endif
@@ -0,0 +1,71 @@
+/***********************************************************
+ *
+ * @file: plan_recording.h
+ * @breif: Plan records of the global planner plugins, with the costs the planner got
+ * @author: Yang Haodong
+ * @update: 2023-10-8
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#ifndef PLAN_RECORDING_H
+#define PLAN_RECORDING_H
+
+#include <cstdint>
+#include <vector>
+
+#include <costmap_2d/costmap_2d.h>
+#include <geometry_msgs/PoseStamped.h>
+
+#include "nodes.h"
+#include "plan_recorder.h"
+
+namespace instrumentation
+{
+/**
+ * @brief Copy of a costmap, kept by a plugin between plans to reuse the buffer
+ */
+struct CostmapCopy
+{
+  std::vector<unsigned char> costs;
+  int nx = 0, ny = 0;
+  double resolution = 0.0, origin_x = 0.0, origin_y = 0.0;
+};
+
+/**
+ * @brief Copy the costs. Called with the costmap locked, after outlineMap and before GlobalPlanner::plan, the copy holds
+ *        the costs the planner gets, not those a costmap update left by the time the plan is recorded.
+ * @param costmap costmap of the planner, locked by the caller
+ * @param copy    copy of the costs and their geometry
+ */
+void copyCostmap(costmap_2d::Costmap2D* costmap, CostmapCopy& copy);
+
+/**
+ * @brief Complete a plan record and queue it with the copied costs, warning (throttled) about dropped records and
+ *        write errors
+ * @param recorder    plan recorder of the plugin
+ * @param record      planner and parameters, the rest is filled in here
+ * @param start       start pose of the request
+ * @param goal        goal pose of the request
+ * @param start_node  start cell given to the planner
+ * @param goal_node   goal cell given to the planner
+ * @param tolerance   goal tolerance [m]
+ * @param seed        seed of the planner
+ * @param found       whether the planner found a path
+ * @param path        path returned by the planner
+ * @param expanded    nodes expanded by the search
+ * @param search_time duration of GlobalPlanner::plan [s]
+ * @param costmap     costs the planner got, see copyCostmap. Queued without a copy, the buffer is swapped with that of
+ *                    an earlier record.
+ */
+void recordPlan(global_planner::PlanRecorder& recorder, global_planner::PlanRecord record,
+                const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal,
+                const global_planner::Node& start_node, const global_planner::Node& goal_node, double tolerance,
+                uint32_t seed, bool found, const std::vector<global_planner::Node>& path, uint64_t expanded,
+                double search_time, CostmapCopy& costmap);
+}  // namespace instrumentation
+
+#endif
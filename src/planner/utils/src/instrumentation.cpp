@@ -0,0 +1,236 @@
+/***********************************************************
+ *
+ * @file: instrumentation.cpp
+ * @breif: Low overhead scoped timers, latency histograms and counters for the planner hot paths
+ * @author: Yang Haodong
+ * @update: 2023-10-1
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <sstream>
+
+#include "instrumentation.h"
+
+namespace instrumentation
+{
+namespace
+{
+/**
+ * @brief All metrics of the process, ordered by name so that the series of a metric are rendered together
+ */
+struct Registry
+{
+  std::mutex mutex;
+  std::map<std::string, std::unique_ptr<Counter>> counters;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms;
+
+  static Registry& instance()
+  {
+    // never destroyed, the planners may still record while other statics are torn down
+    static Registry* registry = new Registry();
+    return *registry;
+  }
+};
+
+std::string key(const std::string& name, const std::string& labels)
+{
+  return name + "{" + labels + "}";
+}
+
+/**
+ * @brief name{labels} or name{labels,extra}
+ */
+std::string series(const std::string& name, const std::string& labels, const std::string& extra = "")
+{
+  std::string s = labels;
+  if (!extra.empty())
+    s += (s.empty() ? "" : ",") + extra;
+  return s.empty() ? name : name + "{" + s + "}";
+}
+
+void appendValue(std::ostringstream& out, const std::string& series, double value)
+{
+  char buf[32];
+  if (std::isnan(value))
+    snprintf(buf, sizeof(buf), "NaN");
+  else
+    snprintf(buf, sizeof(buf), "%.9g", value);
+  out << series << " " << buf << "\n";
+}
+}  // namespace
+
+double Clock::nanosecondsPerTick()
+{
+  static const double ns_per_tick = [] {
+#if defined(__x86_64__) || defined(__i386__)
+    const auto t0 = std::chrono::steady_clock::now();
+    const uint64_t c0 = __rdtsc();
+    std::chrono::steady_clock::time_point t1;
+    do
+      t1 = std::chrono::steady_clock::now();
+    while (t1 - t0 < std::chrono::milliseconds(2));
+    const uint64_t c1 = __rdtsc();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(c1 - c0);
+#else
+    return 1.0;
+#endif
+  }();
+  return ns_per_tick;
+}
+
+void*& threadSlot(size_t id)
+{
+  thread_local std::vector<void*> slots;
+  if (id >= slots.size())
+    slots.resize(id + 1, nullptr);
+  return slots[id];
+}
+
+size_t newMetricId()
+{
+  static std::atomic<size_t> next_id(0);
+  return next_id++;
+}
+
+uint64_t Counter::value() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t sum = 0;
+  for (const auto& shard : shards_)
+    sum += shard->value.load(std::memory_order_relaxed);
+  return sum;
+}
+
+void Histogram::bucketRange(int b, uint64_t& lower, uint64_t& width)
+{
+  const int sub_bits = HistogramShard::kSubBits;
+  if (b < HistogramShard::kLinear)
+  {
+    lower = b;
+    width = 1;
+    return;
+  }
+  const int msb = (b - HistogramShard::kLinear) / (1 << sub_bits) + sub_bits + 1;
+  const uint64_t sub = (b - HistogramShard::kLinear) % (1 << sub_bits);
+  width = uint64_t(1) << (msb - sub_bits);
+  lower = ((uint64_t(1) << sub_bits) + sub) * width;
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+  HistogramSnapshot snapshot;
+  snapshot.buckets.assign(HistogramShard::kBuckets, 0);
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& shard : shards_)
+  {
+    for (int b = 0; b < HistogramShard::kBuckets; b++)
+      snapshot.buckets[b] += shard->buckets[b].load(std::memory_order_relaxed);
+    snapshot.count += shard->count.load(std::memory_order_relaxed);
+    snapshot.sum += shard->sum.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+double HistogramSnapshot::quantile(double q) const
+{
+  // the buckets are read one by one while writers go on, their total may differ from count
+  uint64_t total = 0;
+  for (uint64_t n : buckets)
+    total += n;
+  if (total == 0)
+    return std::numeric_limits<double>::quiet_NaN();
+
+  const uint64_t rank = std::min(total - 1, static_cast<uint64_t>(q * total));
+  uint64_t seen = 0;
+  for (size_t b = 0; b < buckets.size(); b++)
+  {
+    seen += buckets[b];
+    if (seen > rank)
+    {
+      uint64_t lower, width;
+      Histogram::bucketRange(static_cast<int>(b), lower, width);
+      return (lower + 0.5 * (width - 1)) * 1e-9;
+    }
+  }
+  return std::numeric_limits<double>::quiet_NaN();
+}
+
+HistogramSnapshot HistogramSnapshot::since(const HistogramSnapshot& base) const
+{
+  HistogramSnapshot delta = *this;
+  if (base.buckets.size() != buckets.size())
+    return delta;
+  for (size_t b = 0; b < buckets.size(); b++)
+    delta.buckets[b] -= std::min(delta.buckets[b], base.buckets[b]);
+  delta.count -= std::min(count, base.count);
+  delta.sum -= std::min(sum, base.sum);
+  return delta;
+}
+
+Counter& counter(const std::string& name, const std::string& labels)
+{
+  Registry& registry = Registry::instance();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::unique_ptr<Counter>& c = registry.counters[key(name, labels)];
+  if (!c)
+    c.reset(new Counter(name, labels));
+  return *c;
+}
+
+Histogram& histogram(const std::string& name, const std::string& labels)
+{
+  Registry& registry = Registry::instance();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::unique_ptr<Histogram>& h = registry.histograms[key(name, labels)];
+  if (!h)
+    h.reset(new Histogram(name, labels));
+  return *h;
+}
+
+std::string PrometheusWriter::render()
+{
+  std::vector<const Counter*> counters;
+  std::vector<const Histogram*> histograms;
+  {
+    Registry& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& c : registry.counters)
+      counters.push_back(c.second.get());
+    for (const auto& h : registry.histograms)
+      histograms.push_back(h.second.get());
+  }
+
+  std::ostringstream out;
+  std::string type_of;
+  for (const Counter* c : counters)
+  {
+    if (c->name() != type_of)
+      out << "# TYPE " << (type_of = c->name()) << " counter\n";
+    appendValue(out, series(c->name(), c->labels()), static_cast<double>(c->value()));
+  }
+
+  type_of.clear();
+  for (const Histogram* h : histograms)
+  {
+    if (h->name() != type_of)
+      out << "# TYPE " << (type_of = h->name()) << " summary\n";
+
+    const HistogramSnapshot now = h->snapshot();
+    const HistogramSnapshot window = now.since(last_[h]);
+    last_[h] = now;
+    appendValue(out, series(h->name(), h->labels(), "quantile=\"0.5\""), window.quantile(0.5));
+    appendValue(out, series(h->name(), h->labels(), "quantile=\"0.99\""), window.quantile(0.99));
+    appendValue(out, series(h->name() + "_sum", h->labels()), now.sum * 1e-9);
+    appendValue(out, series(h->name() + "_count", h->labels()), static_cast<double>(now.count));
+  }
+  return out.str();
+}
+}  // namespace instrumentation
@@ -0,0 +1,59 @@
+/***********************************************************
+ *
+ * @file: metrics_publisher.cpp
+ * @breif: Periodic Prometheus text of the instrumentation registry on a ROS topic
+ * @author: Yang Haodong
+ * @update: 2023-10-1
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <ros/ros.h>
+#include <std_msgs/String.h>
+
+#include "instrumentation.h"
+#include "metrics_publisher.h"
+
+namespace instrumentation
+{
+namespace
+{
+struct MetricsPublisher
+{
+  ros::Publisher pub;
+  ros::Timer timer;
+  PrometheusWriter writer;
+
+  void publish(const ros::TimerEvent&)
+  {
+    std_msgs::String msg;
+    msg.data = writer.render();
+    pub.publish(msg);
+  }
+};
+}  // namespace
+
+void startMetricsPublisher()
+{
+  static std::mutex mutex;
+  static bool started = false;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (started)
+    return;
+  started = true;
+
+  ros::NodeHandle nh("~");
+  double period;
+  nh.param("metrics_period", period, 1.0);
+  if (period <= 0)
+    return;
+
+  // never destroyed, like the registry it reads
+  MetricsPublisher* publisher = new MetricsPublisher();
+  publisher->pub = nh.advertise<std_msgs::String>("metrics", 1);
+  publisher->timer = nh.createTimer(ros::Duration(period), &MetricsPublisher::publish, publisher);
+}
+}  // namespace instrumentation
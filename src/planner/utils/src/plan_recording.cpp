@@ -0,0 +1,80 @@
+/***********************************************************
+ *
+ * @file: plan_recording.cpp
+ * @breif: Plan records of the global planner plugins, with the costs the planner got
+ * @author: Yang Haodong
+ * @update: 2023-10-8
+ * @version: 1.0
+ *
+ * Copyright (c) 2023，Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <string>
+#include <utility>
+
+#include <ros/ros.h>
+
+#include "plan_recording.h"
+
+namespace instrumentation
+{
+/**
+ * @brief Copy the costs, with the costmap locked by the caller
+ * @param costmap costmap of the planner, locked by the caller
+ * @param copy    copy of the costs and their geometry
+ */
+void copyCostmap(costmap_2d::Costmap2D* costmap, CostmapCopy& copy)
+{
+  copy.nx = costmap->getSizeInCellsX();
+  copy.ny = costmap->getSizeInCellsY();
+  copy.resolution = costmap->getResolution();
+  copy.origin_x = costmap->getOriginX();
+  copy.origin_y = costmap->getOriginY();
+  copy.costs.assign(costmap->getCharMap(), costmap->getCharMap() + static_cast<size_t>(copy.nx) * copy.ny);
+}
+
+/**
+ * @brief Complete a plan record and queue it with the copied costs
+ * @param recorder    plan recorder of the plugin
+ * @param record      planner and parameters, the rest is filled in here
+ * @param start       start pose of the request
+ * @param goal        goal pose of the request
+ * @param start_node  start cell given to the planner
+ * @param goal_node   goal cell given to the planner
+ * @param tolerance   goal tolerance [m]
+ * @param seed        seed of the planner
+ * @param found       whether the planner found a path
+ * @param path        path returned by the planner
+ * @param expanded    nodes expanded by the search
+ * @param search_time duration of GlobalPlanner::plan [s]
+ * @param costmap     costs the planner got, see copyCostmap, its buffer is swapped into the recorder
+ */
+void recordPlan(global_planner::PlanRecorder& recorder, global_planner::PlanRecord record,
+                const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal,
+                const global_planner::Node& start_node, const global_planner::Node& goal_node, double tolerance,
+                uint32_t seed, bool found, const std::vector<global_planner::Node>& path, uint64_t expanded,
+                double search_time, CostmapCopy& costmap)
+{
+  record.stamp = ros::Time::now().toSec();
+  record.start_x = start.pose.position.x, record.start_y = start.pose.position.y;
+  record.goal_x = goal.pose.position.x, record.goal_y = goal.pose.position.y;
+  record.start_gx = start_node.x_, record.start_gy = start_node.y_;
+  record.goal_gx = goal_node.x_, record.goal_gy = goal_node.y_;
+  record.tolerance = tolerance;
+  record.seed = seed;
+  record.found = found;
+  for (const auto& node : path)
+    record.path.emplace_back(node.x_, node.y_);
+  record.expanded = expanded;
+  record.search_time = search_time;
+  if (!recorder.record(std::move(record), std::move(costmap.costs), costmap.nx, costmap.ny, costmap.resolution,
+                       costmap.origin_x, costmap.origin_y))
+    ROS_WARN_THROTTLE(10.0, "Plan recorder is behind, %lu plans dropped",
+                      static_cast<unsigned long>(recorder.dropped()));
+  const std::string error = recorder.error();
+  if (!error.empty())
+    ROS_WARN_THROTTLE(10.0, "%s", error.c_str());
+}
+}  // namespace instrumentation
@@ -145,6 +145,11 @@ class PedGenerator(XMLGenerator):
             plugin.append(PedGenerator.createElement("group_coh_weight", text=str(sfm["group_coh_weight"])))
             plugin.append(PedGenerator.createElement("group_rep_weight", text=str(sfm["group_rep_weight"])))
 
+            # static obstacles from the occupancy map of user_config.yaml instead of model bounding boxes
+            if config["pedestrians"].get("obstacle_map", False):
+                map_file = self.root_path + "sim_env/maps/" + self.user_cfg["map"] + "/" + self.user_cfg["map"] + ".yaml"
+                plugin.append(PedGenerator.createElement("obstacle_map", text=map_file))
+
             if "time_delay" in human.keys():
                 plugin.append(PedGenerator.createElement("time_delay", text=str(human["time_delay"])))
 
@@ -180,5 +185,15 @@ class PedGenerator(XMLGenerator):
             for i in range(human_num):
                 world.append(createHuman(self.ped_cfg, i))
 
+            # step all pedestrians in one world plugin instead of one update per actor
+            if self.ped_cfg["pedestrians"].get("crowd", False):
+                crowd = PedGenerator.createElement("plugin", props={"name": "pedestrian_crowd", "filename": "libPedestrianCrowdPlugin.so"})
+                if "fixed_step" in self.ped_cfg["pedestrians"].keys():
+                    crowd.append(PedGenerator.createElement("fixed_step", text=str(self.ped_cfg["pedestrians"]["fixed_step"])))
+                if "integrator" in self.ped_cfg["pedestrians"].keys():
+                    crowd.append(PedGenerator.createElement("integrator", text=self.ped_cfg["pedestrians"]["integrator"]))
+                PedGenerator.indent(crowd)
+                world.append(crowd)
+
             with open(path, "wb+") as f:
                 tree.write(f, encoding="utf-8", xml_declaration=True)
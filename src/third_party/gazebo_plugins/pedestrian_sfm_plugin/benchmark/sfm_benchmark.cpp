@@ -0,0 +1,93 @@
+/***********************************************************
+ *
+ * @file: sfm_benchmark.cpp
+ * @breif: Gazebo-free agent-steps per second of the social force model
+ * @author: Yang Haodong
+ * @update: 2023-03-22
+ * @version: 1.0
+ *
+ * Copyright (c) 2023， Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+// usage: sfm_benchmark [neighbor_distance=0 (all pairs)] [threads=hardware]
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <lightsfm/sfm.hpp>
+
+namespace
+{
+/**
+ * @brief Pedestrians spread uniformly at a density of about one per 9 m^2, walking between random goals, with
+ *        every seventh pair forming a group and one obstacle point each, like handleObstacles() provides.
+ */
+std::vector<sfm::Agent> makeCrowd(int n)
+{
+  const double side = std::sqrt(n) * 3.0;
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> u(0.0, side);
+
+  std::vector<sfm::Agent> agents(n);
+  for (int i = 0; i < n; i++)
+  {
+    agents[i].id = i;
+    agents[i].position.set(u(rng), u(rng));
+    agents[i].desiredVelocity = 1.2;
+    agents[i].cyclicGoals = true;
+    for (int g = 0; g < 2; g++)
+    {
+      sfm::Goal goal;
+      goal.center.set(u(rng), u(rng));
+      goal.radius = 0.3;
+      agents[i].goals.push_back(goal);
+    }
+    agents[i].groupId = i % 7 < 2 ? i / 7 : -1;
+    agents[i].obstacles1.push_back(utils::Vector2d(u(rng), u(rng)));
+  }
+  return agents;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const double neighbor_distance = argc > 1 ? atof(argv[1]) : 0.0;
+  const unsigned threads = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+  sfm::SFM.setNeighborDistance(neighbor_distance);
+  sfm::SFM.setThreads(threads);
+  std::cout << "neighbor distance " << neighbor_distance << ", " << sfm::SFM.getThreads() << " threads" << std::endl;
+
+  const double dt = 0.01;
+  sfm::Workspace workspace;
+  for (int n : { 10, 100, 1000 })
+  {
+    std::vector<sfm::Agent> agents = makeCrowd(n);
+    for (int s = 0; s < 10; s++)
+    {
+      sfm::SFM.computeForces(agents, workspace);
+      sfm::SFM.updatePosition(agents, dt, workspace);
+    }
+
+    // at least half a second per crowd size
+    int steps = 0;
+    double seconds = 0.0;
+    auto t = std::chrono::steady_clock::now();
+    while (seconds < 0.5)
+    {
+      sfm::SFM.computeForces(agents, workspace);
+      sfm::SFM.updatePosition(agents, dt, workspace);
+      steps++;
+      seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+    }
+    printf("%5d agents: %10.0f agent-steps/s (%.3f ms/step)\n", n, n * steps / seconds, 1e3 * seconds / steps);
+  }
+
+  return 0;
+}
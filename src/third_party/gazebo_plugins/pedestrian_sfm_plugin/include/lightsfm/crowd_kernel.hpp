@@ -0,0 +1,318 @@
+/***********************************************************************/
+/**                                                                    */
+/** crowd_kernel.hpp                                                   */
+/**                                                                    */
+/** Structure-of-arrays copy of the crowd and branch-free force loops  */
+/** written so that the compiler can vectorise them (AVX2 at -O3      */
+/** -mavx2), plus a small persistent worker pool.                      */
+/**                                                                    */
+/** This software may be modified and distributed under the terms      */
+/** of the BSD license. See the LICENSE file for details.              */
+/**                                                                    */
+/** http://www.opensource.org/licenses/BSD-3-Clause                    */
+/**                                                                    */
+/***********************************************************************/
+
+#ifndef _CROWD_KERNEL_HPP_
+#define _CROWD_KERNEL_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sfm
+{
+namespace kernel
+{
+// Divisors are clamped to tiny instead of tested for zero: a zero vector
+// still normalises to zero, and the loops stay free of branches.
+const double tiny = 1e-300;
+
+// exp(x) with a relative error below 2e-9 for x in [-700, 700] (clamped
+// outside). x = n ln2 + r with |r| <= ln2 / 2, exp(r) by a degree 8
+// Taylor polynomial and 2^n written straight into the exponent bits. No
+// branches and no library call, so loops using it still vectorise.
+inline double fastExp(double x)
+{
+  x = std::min(std::max(x, -700.0), 700.0);
+  // adding 1.5 * 2^52 rounds to an integer kept in the low mantissa bits
+  const double shifter = 6755399441055744.0;
+  const double t = x * 1.4426950408889634 + shifter;
+  const double n = t - shifter;
+  const double r = (x - n * 6.93147180369123816490e-01) - n * 1.90821492927058770002e-10;
+  const double p =
+      1.0 +
+      r * (1.0 +
+           r * (1.0 / 2 +
+                r * (1.0 / 6 +
+                     r * (1.0 / 24 + r * (1.0 / 120 + r * (1.0 / 720 + r * (1.0 / 5040 + r * (1.0 / 40320))))))));
+  std::uint64_t bits;
+  std::memcpy(&bits, &t, sizeof(bits));
+  bits = (bits + 1023) << 52;
+  double scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return p * scale;
+}
+
+// atan2(y, x) with an absolute error below 2e-6 rad, in (-pi, pi] like
+// utils::Angle. atan on [0, 1] is a degree 11 odd minimax polynomial, the
+// octant is restored with selects instead of branches.
+inline double fastAtan2(double y, double x)
+{
+  const double ax = std::fabs(x), ay = std::fabs(y);
+  const double mx = std::max(ax, ay), mn = std::min(ax, ay);
+  const double a = mn / std::max(mx, tiny);
+  const double s = a * a;
+  double r =
+      a * (0.99997726 + s * (-0.33262347 + s * (0.19354346 + s * (-0.11643287 + s * (0.05265332 + s * -0.01172120)))));
+  r = ay > ax ? 1.57079632679489662 - r : r;
+  r = x < 0 ? 3.14159265358979324 - r : r;
+  return y < 0 ? -r : r;
+}
+
+// Threads started on first use and kept until destruction, so that stepping
+// a crowd does not create and join threads every call. Used by one caller
+// at a time.
+class WorkerPool
+{
+public:
+  WorkerPool() : generation(0), active(0), pending(0), size(0), chunk(0), stopping(false)
+  {
+  }
+  WorkerPool(const WorkerPool&) = delete;
+  void operator=(const WorkerPool&) = delete;
+  ~WorkerPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers)
+    {
+      worker.join();
+    }
+  }
+
+  // Calls f(begin, end, slice) on up to threads contiguous slices of
+  // [0, size), the last slice on the calling thread.
+  template <typename F>
+  void run(unsigned size, unsigned threads, F f)
+  {
+    threads = std::max(1u, std::min(threads, size));
+    if (threads == 1)
+    {
+      f(0u, size, 0u);
+      return;
+    }
+    const unsigned chunk = (size + threads - 1) / threads;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      while (workers.size() + 1 < threads)
+      {
+        workers.emplace_back(&WorkerPool::work, this, (unsigned)workers.size());
+      }
+      job = [&f](unsigned begin, unsigned end, unsigned slice) { f(begin, end, slice); };
+      this->size = size;
+      this->chunk = chunk;
+      active = pending = threads - 1;
+      generation++;
+    }
+    wake.notify_all();
+    f((threads - 1) * chunk, size, threads - 1);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return pending == 0; });
+  }
+
+private:
+  void work(unsigned slice)
+  {
+    unsigned seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+      wake.wait(lock, [&] { return stopping || generation != seen; });
+      if (stopping)
+      {
+        return;
+      }
+      seen = generation;
+      if (slice >= active)
+      {
+        continue;
+      }
+      const unsigned begin = slice * chunk, end = std::min(size, (slice + 1) * chunk);
+      lock.unlock();
+      job(begin, end, slice);
+      lock.lock();
+      if (--pending == 0)
+      {
+        done.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake, done;
+  std::function<void(unsigned, unsigned, unsigned)> job;
+  unsigned generation, active, pending;  // the job of a generation runs on the first active workers
+  unsigned size, chunk;
+  bool stopping;
+};
+
+// Per thread gather buffers of the social force kernel.
+struct Neighbors
+{
+  void clear()
+  {
+    x.clear();
+    y.clear();
+    vx.clear();
+    vy.clear();
+  }
+
+  std::vector<double> x, y, vx, vy;
+  std::vector<double> fx, fy;  // force of every neighbour, summed after the loop
+};
+
+// The crowd as one array per field. The agents are copied in once per
+// step, the outputs are copied back by the caller.
+struct CrowdState
+{
+  void resize(unsigned count)
+  {
+    size = count;
+    std::vector<double>* fields[] = { &x,          &y,           &vx,           &vy,           &radius,
+                                      &desiredVelocity, &relaxationTime, &factorDesired, &factorObstacle,
+                                      &sigmaObstacle, &factorSocial, &lambda,       &gamma,        &n,
+                                      &nPrime,     &goalX,       &goalY,        &goalRadius,   &hasGoal,
+                                      &obstacleX,  &obstacleY,   &obstacleMode, &desiredX,     &desiredY,
+                                      &directionX, &directionY,  &antimove,     &obstacleFx,   &obstacleFy };
+    for (std::vector<double>* field : fields)
+    {
+      field->resize(count);
+    }
+  }
+
+  // Desired force, direction towards the goal and antimove flag of all agents.
+  void computeDesiredForces()
+  {
+    // raw pointers to separate arrays, so no dependencies between iterations (ivdep)
+    const double *px = x.data(), *py = y.data(), *pvx = vx.data(), *pvy = vy.data();
+    const double *gx = goalX.data(), *gy = goalY.data(), *gr = goalRadius.data(), *goal = hasGoal.data();
+    const double *v0 = desiredVelocity.data(), *tau = relaxationTime.data(), *factor = factorDesired.data();
+    double* dirX = directionX.data();
+    double* dirY = directionY.data();
+    double* forceX = desiredX.data();
+    double* forceY = desiredY.data();
+    double* stop = antimove.data();
+    const unsigned count = size;
+#pragma GCC ivdep
+    for (unsigned i = 0; i < count; i++)
+    {
+      const double dx = gx[i] - px[i], dy = gy[i] - py[i];
+      const double d = std::sqrt(dx * dx + dy * dy);
+      const double active = (goal[i] > 0) & (d > gr[i]) ? 1.0 : 0.0;
+      const double inv = active / std::max(d, tiny);
+      dirX[i] = dx * inv;
+      dirY[i] = dy * inv;
+      // -v / tau without a goal, factor * (dir * v0 - v) / tau with one
+      const double k = (active * factor[i] + (1 - active)) / tau[i];
+      forceX[i] = k * (dirX[i] * v0[i] - pvx[i]);
+      forceY[i] = k * (dirY[i] * v0[i] - pvy[i]);
+      stop[i] = 1 - active;
+    }
+  }
+
+  // Obstacle force of all agents with a single obstacle point (mode 1), the
+  // other agents keep the force stored at load time (mode 0 or 2).
+  void computeObstacleForces()
+  {
+    const double *px = x.data(), *py = y.data(), *ox = obstacleX.data(), *oy = obstacleY.data();
+    const double *r = radius.data(), *factor = factorObstacle.data(), *sigma = sigmaObstacle.data();
+    const double* mode = obstacleMode.data();
+    double* forceX = obstacleFx.data();
+    double* forceY = obstacleFy.data();
+    const unsigned count = size;
+#pragma GCC ivdep
+    for (unsigned i = 0; i < count; i++)
+    {
+      const double dx = px[i] - ox[i], dy = py[i] - oy[i];
+      const double d = std::sqrt(dx * dx + dy * dy);
+      const double amount = factor[i] * fastExp(-(d - r[i]) / sigma[i]) / std::max(d, tiny);
+      const bool point = mode[i] == 1;
+      forceX[i] = point ? amount * dx : forceX[i];
+      forceY[i] = point ? amount * dy : forceY[i];
+    }
+  }
+
+  // Social force on agent i from the gathered neighbours, which must not
+  // contain i itself.
+  void computeSocialForce(unsigned i, Neighbors& others, double& fx, double& fy) const
+  {
+    const double px = x[i], py = y[i], pvx = vx[i], pvy = vy[i];
+    const double lambdaI = lambda[i], gammaI = gamma[i], nI = n[i], nPrimeI = nPrime[i];
+    const double* ox = others.x.data();
+    const double* oy = others.y.data();
+    const double* ovx = others.vx.data();
+    const double* ovy = others.vy.data();
+    const unsigned count = others.x.size();
+    others.fx.resize(count);
+    others.fy.resize(count);
+    double* forceX = others.fx.data();
+    double* forceY = others.fy.data();
+    for (unsigned k = 0; k < count; k++)
+    {
+      const double dx = ox[k] - px, dy = oy[k] - py;
+      const double d = std::sqrt(dx * dx + dy * dy);
+      const double invD = 1.0 / std::max(d, tiny);
+      const double ex = dx * invD, ey = dy * invD;
+      // interaction vector lambda * (v_i - v_k) + e
+      const double ix = lambdaI * (pvx - ovx[k]) + ex, iy = lambdaI * (pvy - ovy[k]) + ey;
+      const double iLength = std::sqrt(ix * ix + iy * iy);
+      const double invI = 1.0 / std::max(iLength, tiny);
+      const double tx = ix * invI, ty = iy * invI;
+      const double theta = fastAtan2(tx * ey - ty * ex, tx * ex + ty * ey);
+      const double B = gammaI * iLength;
+      const double invB = 1.0 / std::max(B, tiny);
+      const double sign = (theta > 0 ? 1.0 : 0.0) - (theta < 0 ? 1.0 : 0.0);
+      const double velocityAmount = -fastExp(-d * invB - (nPrimeI * B * theta) * (nPrimeI * B * theta));
+      const double angleAmount = -sign * fastExp(-d * invB - (nI * B * theta) * (nI * B * theta));
+      forceX[k] = velocityAmount * tx - angleAmount * ty;
+      forceY[k] = velocityAmount * ty + angleAmount * tx;
+    }
+
+    // a separate sum keeps the loop above vectorisable without -ffast-math
+    double sumX = 0, sumY = 0;
+    for (unsigned k = 0; k < count; k++)
+    {
+      sumX += forceX[k];
+      sumY += forceY[k];
+    }
+    fx = factorSocial[i] * sumX;
+    fy = factorSocial[i] * sumY;
+  }
+
+  unsigned size = 0;
+  // inputs
+  std::vector<double> x, y, vx, vy, radius, desiredVelocity;
+  std::vector<double> relaxationTime, factorDesired, factorObstacle, sigmaObstacle, factorSocial;
+  std::vector<double> lambda, gamma, n, nPrime;
+  std::vector<double> goalX, goalY, goalRadius, hasGoal;
+  std::vector<double> obstacleX, obstacleY, obstacleMode;  // mode 0: none, 1: point, 2: force given
+  // outputs
+  std::vector<double> desiredX, desiredY, directionX, directionY, antimove;
+  std::vector<double> obstacleFx, obstacleFy;
+  std::vector<Neighbors> scratch;
+};
+}  // namespace kernel
+}  // namespace sfm
+
+#endif
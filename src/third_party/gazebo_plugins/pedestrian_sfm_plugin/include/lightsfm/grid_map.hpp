@@ -0,0 +1,333 @@
+/***********************************************************************/
+/**                                                                    */
+/** grid_map.hpp                                                       */
+/**                                                                    */
+/** sfm::Map over an occupancy grid (a map_server yaml + pgm). The     */
+/** nearest occupied cell of every cell is precomputed with an exact   */
+/** Euclidean distance transform, so obstacle queries are O(1).        */
+/**                                                                    */
+/** This software may be modified and distributed under the terms      */
+/** of the BSD license. See the LICENSE file for details.              */
+/**                                                                    */
+/** http://www.opensource.org/licenses/BSD-3-Clause                    */
+/**                                                                    */
+/***********************************************************************/
+
+#ifndef _GRID_MAP_HPP_
+#define _GRID_MAP_HPP_
+
+#include "map.hpp"
+#include "vector2d.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace sfm
+{
+class GridMap : public Map
+{
+public:
+  GridMap() : resolution(0.05), originX(0), originY(0), width(0), height(0)
+  {
+  }
+  virtual ~GridMap()
+  {
+  }
+
+  // Loads a map_server map description (image, resolution, origin, negate,
+  // occupied_thresh). Only binary pgm (P5) images are supported.
+  bool load(const std::string& yamlFile);
+
+  // Occupancy given directly, row-major from the bottom-left cell like
+  // nav_msgs/OccupancyGrid.
+  void setOccupancy(const std::vector<bool>& occupied, unsigned width, unsigned height, double resolution,
+                    double originX, double originY);
+
+  // Closest point of the closest occupied cell, accurate to one cell. Points
+  // outside the map use the nearest border cell. Without any obstacle the
+  // distance stays -1 and the position is x itself, which gives no force.
+  Obstacle nearestObstacle(const utils::Vector2d& x) const;
+
+  virtual const Obstacle& getNearestObstacle(const utils::Vector2d& x)
+  {
+    lastObstacle = nearestObstacle(x);
+    return lastObstacle;
+  }
+  virtual bool isObstacle(const utils::Vector2d& x) const;
+
+  unsigned getWidth() const
+  {
+    return width;
+  }
+  unsigned getHeight() const
+  {
+    return height;
+  }
+  double getResolution() const
+  {
+    return resolution;
+  }
+  double getOriginX() const
+  {
+    return originX;
+  }
+  double getOriginY() const
+  {
+    return originY;
+  }
+  const std::vector<bool>& getOccupancy() const
+  {
+    return occupied;
+  }
+
+private:
+  int cellOf(double v, double origin, unsigned n) const
+  {
+    int c = (int)std::floor((v - origin) / resolution);
+    return std::min(std::max(c, 0), (int)n - 1);
+  }
+  void computeDistanceTransform();
+
+  double resolution;
+  double originX, originY;
+  unsigned width, height;
+  std::vector<bool> occupied;
+  std::vector<int> nearest;  // index of the closest occupied cell, -1 if there is none
+  Obstacle lastObstacle;
+};
+
+inline bool GridMap::load(const std::string& yamlFile)
+{
+  std::ifstream yaml(yamlFile);
+  if (!yaml)
+  {
+    return false;
+  }
+
+  std::string image;
+  double res = 0.05, ox = 0, oy = 0, occupiedThresh = 0.65;
+  bool negate = false;
+  std::string line;
+  while (std::getline(yaml, line))
+  {
+    std::size_t colon = line.find(':');
+    if (colon == std::string::npos)
+    {
+      continue;
+    }
+    std::string key = line.substr(0, colon);
+    std::string value = line.substr(colon + 1);
+    key.erase(0, key.find_first_not_of(" \t"));
+    key.erase(key.find_last_not_of(" \t") + 1);
+    value.erase(0, value.find_first_not_of(" \t\"'"));
+    value.erase(value.find_last_not_of(" \t\r\"'") + 1);
+    if (key == "image")
+    {
+      image = value;
+    }
+    else if (key == "resolution")
+    {
+      res = std::atof(value.c_str());
+    }
+    else if (key == "origin")
+    {
+      std::replace(value.begin(), value.end(), '[', ' ');
+      std::replace(value.begin(), value.end(), ',', ' ');
+      std::istringstream(value) >> ox >> oy;
+    }
+    else if (key == "negate")
+    {
+      negate = std::atoi(value.c_str()) != 0;
+    }
+    else if (key == "occupied_thresh")
+    {
+      occupiedThresh = std::atof(value.c_str());
+    }
+  }
+  if (image.empty() || res <= 0)
+  {
+    return false;
+  }
+  if (image[0] != '/')
+  {
+    std::size_t slash = yamlFile.find_last_of('/');
+    image = (slash == std::string::npos ? std::string() : yamlFile.substr(0, slash + 1)) + image;
+  }
+
+  std::ifstream in(image, std::ios::binary);
+  std::string magic;
+  in >> magic;
+  if (magic != "P5")
+  {
+    return false;
+  }
+  int values[3];
+  for (int k = 0; k < 3;)
+  {
+    in >> std::ws;
+    if (in.peek() == '#')
+    {
+      std::getline(in, line);
+      continue;
+    }
+    if (!(in >> values[k++]))
+    {
+      return false;
+    }
+  }
+  in.get();
+  if (values[0] <= 0 || values[1] <= 0 || values[2] <= 0 || values[2] > 255)
+  {
+    return false;
+  }
+  std::vector<unsigned char> pixels(values[0] * values[1]);
+  if (!in.read(reinterpret_cast<char*>(pixels.data()), pixels.size()))
+  {
+    return false;
+  }
+
+  // image rows run top-down, the map bottom-up; dark is occupied unless negated
+  std::vector<bool> grid(pixels.size());
+  for (int y = 0; y < values[1]; y++)
+  {
+    for (int x = 0; x < values[0]; x++)
+    {
+      double p = pixels[(values[1] - 1 - y) * values[0] + x] / (double)values[2];
+      grid[y * values[0] + x] = (negate ? p : 1 - p) > occupiedThresh;
+    }
+  }
+  setOccupancy(grid, values[0], values[1], res, ox, oy);
+  return true;
+}
+
+inline void GridMap::setOccupancy(const std::vector<bool>& occupied, unsigned width, unsigned height,
+                                  double resolution, double originX, double originY)
+{
+  this->occupied = occupied;
+  this->width = width;
+  this->height = height;
+  this->resolution = resolution;
+  this->originX = originX;
+  this->originY = originY;
+  computeDistanceTransform();
+}
+
+inline void GridMap::computeDistanceTransform()
+{
+  // Felzenszwalb & Huttenlocher: nearest occupied row per column, then the
+  // lower envelope of the parabolas (x - q)^2 + dy(q)^2 along every row,
+  // keeping the argmin instead of only the distance
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<int> columnSite(width * height, -1);
+  for (unsigned x = 0; x < width; x++)
+  {
+    int last = -1;
+    for (unsigned y = 0; y < height; y++)
+    {
+      last = occupied[y * width + x] ? (int)y : last;
+      columnSite[y * width + x] = last;
+    }
+    last = -1;
+    for (int y = (int)height - 1; y >= 0; y--)
+    {
+      last = occupied[y * width + x] ? y : last;
+      int& site = columnSite[y * width + x];
+      if (last >= 0 && (site < 0 || last - y < y - site))
+      {
+        site = last;
+      }
+    }
+  }
+
+  nearest.assign(width * height, -1);
+  std::vector<double> f(width);
+  std::vector<int> v(width);
+  std::vector<double> z(width + 1);
+  for (unsigned y = 0; y < height; y++)
+  {
+    for (unsigned x = 0; x < width; x++)
+    {
+      int site = columnSite[y * width + x];
+      f[x] = site < 0 ? inf : (double)(site - (int)y) * (site - (int)y);
+    }
+
+    int k = -1;
+    for (unsigned q = 0; q < width; q++)
+    {
+      if (f[q] == inf)
+      {
+        continue;
+      }
+      double s = 0;
+      while (k >= 0)
+      {
+        s = ((f[q] + (double)q * q) - (f[v[k]] + (double)v[k] * v[k])) / (2.0 * q - 2.0 * v[k]);
+        if (s > z[k])
+        {
+          break;
+        }
+        k--;
+      }
+      k++;
+      v[k] = q;
+      z[k] = k == 0 ? -inf : s;
+      z[k + 1] = inf;
+    }
+    if (k < 0)
+    {
+      continue;  // no occupied cell in any column, nor in the whole map
+    }
+
+    int j = 0;
+    for (unsigned q = 0; q < width; q++)
+    {
+      while (z[j + 1] < q)
+      {
+        j++;
+      }
+      nearest[y * width + q] = columnSite[y * width + v[j]] * width + v[j];
+    }
+  }
+}
+
+inline Map::Obstacle GridMap::nearestObstacle(const utils::Vector2d& x) const
+{
+  Obstacle obstacle;
+  obstacle.position = x;
+  if (nearest.empty())
+  {
+    return obstacle;
+  }
+  int site = nearest[cellOf(x.getY(), originY, height) * width + cellOf(x.getX(), originX, width)];
+  if (site < 0)
+  {
+    return obstacle;
+  }
+
+  // closest point of the occupied cell rather than its center
+  double minX = originX + (site % width) * resolution;
+  double minY = originY + (site / width) * resolution;
+  obstacle.position.set(std::min(std::max(x.getX(), minX), minX + resolution),
+                        std::min(std::max(x.getY(), minY), minY + resolution));
+  obstacle.distance = (x - obstacle.position).norm();
+  return obstacle;
+}
+
+inline bool GridMap::isObstacle(const utils::Vector2d& x) const
+{
+  if (occupied.empty() || x.getX() < originX || x.getY() < originY || x.getX() >= originX + width * resolution ||
+      x.getY() >= originY + height * resolution)
+  {
+    return false;
+  }
+  return occupied[cellOf(x.getY(), originY, height) * width + cellOf(x.getX(), originX, width)];
+}
+
+}  // namespace sfm
+
+#endif
@@ -0,0 +1,134 @@
+/***********************************************************************/
+/**                                                                    */
+/** neighbor_grid.hpp                                                  */
+/**                                                                    */
+/** Uniform grid over the agent positions, rebuilt once per step, so   */
+/** that the social force only visits agents within a cutoff radius.   */
+/**                                                                    */
+/** This software may be modified and distributed under the terms      */
+/** of the BSD license. See the LICENSE file for details.              */
+/**                                                                    */
+/** http://www.opensource.org/licenses/BSD-3-Clause                    */
+/**                                                                    */
+/***********************************************************************/
+
+#ifndef _NEIGHBOR_GRID_HPP_
+#define _NEIGHBOR_GRID_HPP_
+
+#include "vector2d.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace sfm
+{
+class NeighborGrid
+{
+public:
+  NeighborGrid() : cellSize(1.0), minX(0), minY(0), nx(0), ny(0)
+  {
+  }
+
+  // Sorts the positions into square cells of side cellSize (the query radius).
+  // positions(i) returns the position of agent i. The storage is kept between
+  // calls, so rebuilding does not allocate once the crowd size is stable.
+  template <typename Positions>
+  void build(const Positions& positions, unsigned size, double cellSize);
+
+  // Calls f(index) for every agent in the cells around p, i.e. at least all
+  // agents within cellSize of p. The caller checks the exact distance.
+  template <typename F>
+  void forEachNear(const utils::Vector2d& p, F f) const;
+
+private:
+  int cellOf(double v, double min, int n) const
+  {
+    int c = (int)std::floor((v - min) / cellSize);
+    return std::min(std::max(c, 0), n - 1);
+  }
+
+  double cellSize;
+  double minX, minY;
+  int nx, ny;
+  std::vector<unsigned> cellStart;  // agents of cell c are items[cellStart[c] .. cellStart[c + 1])
+  std::vector<unsigned> cellIndex;  // cell of every agent
+  std::vector<unsigned> cursor;
+  std::vector<unsigned> items;
+};
+
+template <typename Positions>
+inline void NeighborGrid::build(const Positions& positions, unsigned size, double cellSize)
+{
+  this->cellSize = cellSize;
+  if (size == 0)
+  {
+    nx = ny = 0;
+    return;
+  }
+
+  double maxX, maxY;
+  minX = maxX = positions(0).getX();
+  minY = maxY = positions(0).getY();
+  for (unsigned i = 1; i < size; i++)
+  {
+    minX = std::min(minX, positions(i).getX());
+    maxX = std::max(maxX, positions(i).getX());
+    minY = std::min(minY, positions(i).getY());
+    maxY = std::max(maxY, positions(i).getY());
+  }
+
+  // a sparse crowd over a large area must not blow up the cell table, the
+  // cells are then made coarser, which only costs extra distance checks
+  const double maxCells = 4.0 * size + 64;
+  while (((maxX - minX) / this->cellSize + 1) * ((maxY - minY) / this->cellSize + 1) > maxCells)
+  {
+    this->cellSize *= 2;
+  }
+  nx = (int)((maxX - minX) / this->cellSize) + 1;
+  ny = (int)((maxY - minY) / this->cellSize) + 1;
+
+  // counting sort of the agents by cell
+  cellStart.assign(nx * ny + 1, 0);
+  cellIndex.resize(size);
+  for (unsigned i = 0; i < size; i++)
+  {
+    cellIndex[i] = cellOf(positions(i).getY(), minY, ny) * nx + cellOf(positions(i).getX(), minX, nx);
+    cellStart[cellIndex[i] + 1]++;
+  }
+  for (int c = 0; c < nx * ny; c++)
+  {
+    cellStart[c + 1] += cellStart[c];
+  }
+  cursor.assign(cellStart.begin(), cellStart.end() - 1);
+  items.resize(size);
+  for (unsigned i = 0; i < size; i++)
+  {
+    items[cursor[cellIndex[i]]++] = i;
+  }
+}
+
+template <typename F>
+inline void NeighborGrid::forEachNear(const utils::Vector2d& p, F f) const
+{
+  if (nx == 0)
+  {
+    return;
+  }
+  const int cx = cellOf(p.getX(), minX, nx);
+  const int cy = cellOf(p.getY(), minY, ny);
+  for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, ny - 1); y++)
+  {
+    for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, nx - 1); x++)
+    {
+      const int c = y * nx + x;
+      for (unsigned k = cellStart[c]; k < cellStart[c + 1]; k++)
+      {
+        f(items[k]);
+      }
+    }
+  }
+}
+
+}  // namespace sfm
+
+#endif
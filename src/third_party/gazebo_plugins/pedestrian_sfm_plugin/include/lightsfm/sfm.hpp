@@ -23,9 +23,13 @@
 #ifndef _SFM_HPP_
 #define _SFM_HPP_
 
+#include "crowd_kernel.hpp"
 #include "map.hpp"
+#include "neighbor_grid.hpp"
 #include "vector2d.hpp"
+#include <algorithm>
 #include <cmath>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -157,6 +161,26 @@ struct Group
   std::vector<unsigned> agents;
 };
 
+// Scratch of the crowd methods of SocialForceModel, kept between calls to
+// avoid reallocating. The model itself is shared by the whole process, so
+// every caller stepping a crowd owns a workspace and passes it in; calls with
+// different workspaces may run concurrently.
+struct Workspace
+{
+  // structure-of-arrays copy of the agents for the vectorised force loops
+  kernel::CrowdState crowd;
+  kernel::WorkerPool pool;
+  NeighborGrid neighbors;
+  // group table, sorted by group id and kept between steps; only the member
+  // lists are refilled
+  std::vector<int> groupIds;
+  std::vector<Group> groups;
+  std::vector<int> agentGroup;  // index into groups for every agent, -1 if none
+  // unscaled group repulsion of every agent, summed once per pair of members
+  std::vector<utils::Vector2d> groupRepulsion;
+  std::vector<utils::Vector2d> stepStart;  // positions before step(), for the movement
+};
+
 class SocialForceModel
 {
 public:
@@ -174,24 +198,115 @@ public:
 
 #define SFM SocialForceModel::getInstance()
 
+  enum Integrator
+  {
+    SEMI_IMPLICIT_EULER,  // velocity first, then the position with the new velocity
+    EXPLICIT_EULER        // position with the velocity at the start of the step
+  };
+
+  // Only agents closer than distance interact socially in computeForces(agents),
+  // looked up through a grid rebuilt every call. <= 0 (the default) means all.
+  void setNeighborDistance(double distance)
+  {
+    neighborDistance = distance;
+  }
+  double getNeighborDistance() const
+  {
+    return neighborDistance;
+  }
+
+  // Threads used by computeForces(agents) and updatePosition(agents, dt) for
+  // crowds of at least parallelThreshold agents; smaller crowds run on the
+  // calling thread, where splitting the work would cost more than it saves.
+  // The threads belong to the workspace and are started on its first use.
+  void setThreads(unsigned threads, unsigned parallelThreshold = 256)
+  {
+    this->threads = std::max(1u, threads);
+    this->parallelThreshold = parallelThreshold;
+  }
+  unsigned getThreads() const
+  {
+    return threads;
+  }
+
+  // How updatePosition() and step() move the agents that are not teleoperated.
+  // SEMI_IMPLICIT_EULER (the default) is the original update.
+  void setIntegrator(Integrator integrator)
+  {
+    this->integrator = integrator;
+  }
+  Integrator getIntegrator() const
+  {
+    return integrator;
+  }
+
+  // Substep length of step(agents, dt, pendingTime). <= 0 (the default) steps
+  // by the given dt at once. At most maxSubsteps are taken per call, the time
+  // beyond is dropped so that a stalled simulation does not have to catch up.
+  void setFixedStep(double step, unsigned maxSubsteps = 50)
+  {
+    fixedStep = step;
+    this->maxSubsteps = std::max(1u, maxSubsteps);
+  }
+  double getFixedStep() const
+  {
+    return fixedStep;
+  }
+
+  std::vector<Agent>& computeForces(std::vector<Agent>& agents, Workspace& workspace, Map* map = NULL) const;
+  // as above with a workspace private to the calling thread
   std::vector<Agent>& computeForces(std::vector<Agent>& agents, Map* map = NULL) const;
   void computeForces(Agent& me, std::vector<Agent>& agents, Map* map = NULL);
+  std::vector<Agent>& updatePosition(std::vector<Agent>& agents, double dt, Workspace& workspace) const;
+  // as above with a workspace private to the calling thread
   std::vector<Agent>& updatePosition(std::vector<Agent>& agents, double dt) const;
   void updatePosition(Agent& me, double dt) const;
+  // Advances the crowd by dt in substeps of the fixed step, recomputing the
+  // forces before each. The time short of a whole substep is carried in
+  // pendingTime to the next call, so the crowd only depends on the simulated
+  // time and not on how often the caller updates. pendingTime starts at 0.
+  std::vector<Agent>& step(std::vector<Agent>& agents, double dt, double& pendingTime, Workspace& workspace,
+                           Map* map = NULL) const;
 
 private:
 #define PW(x) ((x) * (x))
   SocialForceModel()
+    : neighborDistance(0)
+    , threads(std::max(1u, std::thread::hardware_concurrency()))
+    , parallelThreshold(256)
+    , integrator(SEMI_IMPLICIT_EULER)
+    , fixedStep(0)
+    , maxSubsteps(50)
   {
   }
+  unsigned slicesFor(unsigned size) const
+  {
+    return size >= parallelThreshold ? threads : 1;
+  }
+  static Workspace& threadWorkspace()
+  {
+    static thread_local Workspace workspace;
+    return workspace;
+  }
+  void loadCrowd(std::vector<Agent>& agents, kernel::CrowdState& crowd, Map* map) const;
   utils::Vector2d computeDesiredForce(Agent& agent) const;
   void computeObstacleForce(Agent& agent, Map* map) const;
-  void computeSocialForce(unsigned index, std::vector<Agent>& agents) const;
+  utils::Vector2d computeSocialForce(const Agent& agent, const Agent& other) const;
   void computeSocialForce(Agent& agent, std::vector<Agent>& agents) const;
-  void computeGroupForce(unsigned index, const utils::Vector2d& desiredDirection, std::vector<Agent>& agents,
-                         const std::unordered_map<int, Group>& groups) const;
+  void updateGroups(const std::vector<Agent>& agents, Workspace& workspace) const;
+  void computeGroupRepulsion(const std::vector<Agent>& agents, Workspace& workspace) const;
+  void computeGroupForce(Agent& agent, const utils::Vector2d& desiredDirection, const utils::Vector2d& center,
+                         unsigned size, const utils::Vector2d& repulsion) const;
   void computeGroupForce(Agent& me, const utils::Vector2d& desiredDirection, std::vector<Agent>& agents,
                          Group& group) const;
+  void integrate(Agent& agent, double dt) const;
+
+  double neighborDistance;
+  unsigned threads;
+  unsigned parallelThreshold;
+  Integrator integrator;
+  double fixedStep;
+  unsigned maxSubsteps;
 };
 
 inline utils::Vector2d SocialForceModel::computeDesiredForce(Agent& agent) const
@@ -269,35 +384,22 @@ inline void SocialForceModel::computeObstacleForce(Agent& agent, Map* map) const
   }
 }
 
-inline void SocialForceModel::computeSocialForce(unsigned index, std::vector<Agent>& agents) const
+inline utils::Vector2d SocialForceModel::computeSocialForce(const Agent& agent, const Agent& other) const
 {
-  Agent& agent = agents[index];
-  agent.forces.socialForce.set(0, 0);
-  for (unsigned i = 0; i < agents.size(); i++)
-  {
-    if (i == index)
-    {
-      continue;
-    }
-    utils::Vector2d diff = agents[i].position - agent.position;
-    utils::Vector2d diffDirection = diff.normalized();
-    utils::Vector2d velDiff = agent.velocity - agents[i].velocity;
-    utils::Vector2d interactionVector = agent.params.lambda * velDiff + diffDirection;
-    double interactionLength = interactionVector.norm();
-    utils::Vector2d interactionDirection = interactionVector / interactionLength;
-    utils::Angle theta = interactionDirection.angleTo(diffDirection);
-    double B = agent.params.gamma * interactionLength;
-    double thetaRad = theta.toRadian();
-    double forceVelocityAmount = -std::exp(-diff.norm() / B - PW(agent.params.nPrime * B * thetaRad));
-    double forceAngleAmount = -theta.sign() * std::exp(-diff.norm() / B - PW(agent.params.n * B * thetaRad));
-    utils::Vector2d forceVelocity = forceVelocityAmount * interactionDirection;
-    utils::Vector2d forceAngle = forceAngleAmount * interactionDirection.leftNormalVector();
-    agent.forces.socialForce += agent.params.forceFactorSocial * (forceVelocity + forceAngle);
-    if (i == 0)
-    {
-      agent.forces.robotSocialForce = agent.params.forceFactorSocial * (forceVelocity + forceAngle);
-    }
-  }
+  utils::Vector2d diff = other.position - agent.position;
+  utils::Vector2d diffDirection = diff.normalized();
+  utils::Vector2d velDiff = agent.velocity - other.velocity;
+  utils::Vector2d interactionVector = agent.params.lambda * velDiff + diffDirection;
+  double interactionLength = interactionVector.norm();
+  utils::Vector2d interactionDirection = interactionVector / interactionLength;
+  utils::Angle theta = interactionDirection.angleTo(diffDirection);
+  double B = agent.params.gamma * interactionLength;
+  double thetaRad = theta.toRadian();
+  double forceVelocityAmount = -std::exp(-diff.norm() / B - PW(agent.params.nPrime * B * thetaRad));
+  double forceAngleAmount = -theta.sign() * std::exp(-diff.norm() / B - PW(agent.params.n * B * thetaRad));
+  utils::Vector2d forceVelocity = forceVelocityAmount * interactionDirection;
+  utils::Vector2d forceAngle = forceAngleAmount * interactionDirection.leftNormalVector();
+  return agent.params.forceFactorSocial * (forceVelocity + forceAngle);
 }
 
 inline void SocialForceModel::computeSocialForce(Agent& me, std::vector<Agent>& agents) const
@@ -310,20 +412,7 @@ inline void SocialForceModel::computeSocialForce(Agent& me, std::vector<Agent>&
     {
       continue;
     }
-    utils::Vector2d diff = agents[i].position - me.position;
-    utils::Vector2d diffDirection = diff.normalized();
-    utils::Vector2d velDiff = me.velocity - agents[i].velocity;
-    utils::Vector2d interactionVector = me.params.lambda * velDiff + diffDirection;
-    double interactionLength = interactionVector.norm();
-    utils::Vector2d interactionDirection = interactionVector / interactionLength;
-    utils::Angle theta = interactionDirection.angleTo(diffDirection);
-    double B = me.params.gamma * interactionLength;
-    double thetaRad = theta.toRadian();
-    double forceVelocityAmount = -std::exp(-diff.norm() / B - PW(me.params.nPrime * B * thetaRad));
-    double forceAngleAmount = -theta.sign() * std::exp(-diff.norm() / B - PW(me.params.n * B * thetaRad));
-    utils::Vector2d forceVelocity = forceVelocityAmount * interactionDirection;
-    utils::Vector2d forceAngle = forceAngleAmount * interactionDirection.leftNormalVector();
-    me.forces.socialForce += me.params.forceFactorSocial * (forceVelocity + forceAngle);
+    me.forces.socialForce += computeSocialForce(me, agents[i]);
     // if (i == 0)
     //{
     //  agent.forces.robotSocialForce =
@@ -332,24 +421,123 @@ inline void SocialForceModel::computeSocialForce(Agent& me, std::vector<Agent>&
   }
 }
 
-inline void SocialForceModel::computeGroupForce(unsigned index, const utils::Vector2d& desiredDirection,
-                                                std::vector<Agent>& agents,
-                                                const std::unordered_map<int, Group>& groups) const
+inline void SocialForceModel::updateGroups(const std::vector<Agent>& agents, Workspace& workspace) const
+{
+  std::vector<int>& groupIds = workspace.groupIds;
+  std::vector<Group>& groups = workspace.groups;
+  std::vector<int>& agentGroup = workspace.agentGroup;
+  for (unsigned g = 0; g < groups.size(); g++)
+  {
+    groups[g].agents.clear();
+    groups[g].center.set(0, 0);
+  }
+
+  // new groups first, inserting them shifts the indices of the later ones;
+  // membership rarely changes so this is not on the hot path
+  for (unsigned i = 0; i < agents.size(); i++)
+  {
+    std::vector<int>::iterator it = std::lower_bound(groupIds.begin(), groupIds.end(), agents[i].groupId);
+    if (agents[i].groupId >= 0 && (it == groupIds.end() || *it != agents[i].groupId))
+    {
+      groups.insert(groups.begin() + (it - groupIds.begin()), Group());
+      groupIds.insert(it, agents[i].groupId);
+    }
+  }
+
+  agentGroup.resize(agents.size());
+  for (unsigned i = 0; i < agents.size(); i++)
+  {
+    if (agents[i].groupId < 0)
+    {
+      agentGroup[i] = -1;
+      continue;
+    }
+    int g = std::lower_bound(groupIds.begin(), groupIds.end(), agents[i].groupId) - groupIds.begin();
+    agentGroup[i] = g;
+    groups[g].agents.push_back(i);
+    groups[g].center += agents[i].position;
+  }
+
+  // drop the groups left without members, keeping the order of the others
+  unsigned kept = 0;
+  for (unsigned g = 0; g < groups.size(); g++)
+  {
+    if (groups[g].agents.empty())
+    {
+      continue;
+    }
+    groups[g].center /= (double)(groups[g].agents.size());
+    if (g != kept)
+    {
+      std::swap(groups[kept], groups[g]);
+      groupIds[kept] = groupIds[g];
+      for (unsigned i : groups[kept].agents)
+      {
+        agentGroup[i] = kept;
+      }
+    }
+    kept++;
+  }
+  groups.resize(kept);
+  groupIds.resize(kept);
+}
+
+inline void SocialForceModel::computeGroupRepulsion(const std::vector<Agent>& agents, Workspace& workspace) const
+{
+  std::vector<Group>& groups = workspace.groups;
+  std::vector<utils::Vector2d>& groupRepulsion = workspace.groupRepulsion;
+  groupRepulsion.assign(agents.size(), utils::Vector2d());
+  for (unsigned g = 0; g < groups.size(); g++)
+  {
+    // members sorted along x: once the next member is further away in x than
+    // any radius sum, so are all after it
+    std::vector<unsigned>& members = groups[g].agents;
+    std::sort(members.begin(), members.end(), [&agents](unsigned a, unsigned b) {
+      return agents[a].position.getX() < agents[b].position.getX();
+    });
+    double maxRadius = 0;
+    for (unsigned i = 0; i < members.size(); i++)
+    {
+      maxRadius = std::max(maxRadius, agents[members[i]].radius);
+    }
+
+    for (unsigned i = 0; i < members.size(); i++)
+    {
+      const Agent& agent = agents[members[i]];
+      for (unsigned j = i + 1; j < members.size(); j++)
+      {
+        const Agent& other = agents[members[j]];
+        if (other.position.getX() - agent.position.getX() >= agent.radius + maxRadius)
+        {
+          break;
+        }
+        utils::Vector2d diff = agent.position - other.position;
+        if (diff.norm() < agent.radius + other.radius)
+        {
+          groupRepulsion[members[i]] += diff;
+          groupRepulsion[members[j]] -= diff;
+        }
+      }
+    }
+  }
+}
+
+inline void SocialForceModel::computeGroupForce(Agent& agent, const utils::Vector2d& desiredDirection,
+                                                const utils::Vector2d& center, unsigned size,
+                                                const utils::Vector2d& repulsion) const
 {
-  Agent& agent = agents[index];
   agent.forces.groupForce.set(0, 0);
   agent.forces.groupGazeForce.set(0, 0);
   agent.forces.groupCoherenceForce.set(0, 0);
   agent.forces.groupRepulsionForce.set(0, 0);
-  if (groups.count(agent.groupId) == 0 || groups.at(agent.groupId).agents.size() < 2)
+  if (size < 2)
   {
     return;
   }
-  const Group& group = groups.at(agent.groupId);
 
   // Gaze force
-  utils::Vector2d com = group.center;
-  com = (1 / (double)(group.agents.size() - 1)) * (group.agents.size() * com - agent.position);
+  utils::Vector2d com = center;
+  com = (1 / (double)(size - 1)) * (size * com - agent.position);
 
   utils::Vector2d relativeCom = com - agent.position;
   utils::Angle visionAngle = utils::Angle::fromDegree(90);
@@ -370,10 +558,10 @@ inline void SocialForceModel::computeGroupForce(unsigned index, const utils::Vec
   }
 
   // Coherence force
-  com = group.center;
+  com = center;
   relativeCom = com - agent.position;
   double distance = relativeCom.norm();
-  double maxDistance = ((double)group.agents.size() - 1) / 2;
+  double maxDistance = ((double)size - 1) / 2;
 #ifdef _PAPER_VERSION_
   if (distance >= maxDistance)
   {
@@ -387,19 +575,7 @@ inline void SocialForceModel::computeGroupForce(unsigned index, const utils::Vec
 #endif
 
   // Repulsion Force
-  for (unsigned i = 0; i < group.agents.size(); i++)
-  {
-    if (index == group.agents[i])
-    {
-      continue;
-    }
-    utils::Vector2d diff = agent.position - agents.at(group.agents[i]).position;
-    if (diff.norm() < agent.radius + agents.at(group.agents[i]).radius)
-    {
-      agent.forces.groupRepulsionForce += diff;
-    }
-  }
-  agent.forces.groupRepulsionForce *= agent.params.forceFactorGroupRepulsion;
+  agent.forces.groupRepulsionForce = repulsion * agent.params.forceFactorGroupRepulsion;
 
   // Group Force
   agent.forces.groupForce =
@@ -409,97 +585,155 @@ inline void SocialForceModel::computeGroupForce(unsigned index, const utils::Vec
 inline void SocialForceModel::computeGroupForce(Agent& me, const utils::Vector2d& desiredDirection,
                                                 std::vector<Agent>& agents, Group& group) const
 {
-  // Agent& agent = agents[index];
-  me.forces.groupForce.set(0, 0);
-  me.forces.groupGazeForce.set(0, 0);
-  me.forces.groupCoherenceForce.set(0, 0);
-  me.forces.groupRepulsionForce.set(0, 0);
-  if (group.agents.size() < 2)
-  {
-    return;
-  }
-
-  // Gaze force
-  utils::Vector2d com = group.center;
-  com = (1 / (double)(group.agents.size() - 1)) * (group.agents.size() * com - me.position);
-
-  utils::Vector2d relativeCom = com - me.position;
-  utils::Angle visionAngle = utils::Angle::fromDegree(90);
-  double elementProduct = desiredDirection.dot(relativeCom);
-  utils::Angle comAngle =
-      utils::Angle::fromRadian(std::acos(elementProduct / (desiredDirection.norm() * relativeCom.norm())));
-  if (comAngle > visionAngle)
-  {
-#ifdef _PAPER_VERSION_
-    utils::Angle necessaryRotation = comAngle - visionAngle;
-    me.forces.groupGazeForce = -necessaryRotation.toRadian() * desiredDirection;
-#else
-    double desiredDirectionSquared = desiredDirection.squaredNorm();
-    double desiredDirectionDistance = elementProduct / desiredDirectionSquared;
-    me.forces.groupGazeForce = desiredDirectionDistance * desiredDirection;
-#endif
-    me.forces.groupGazeForce *= me.params.forceFactorGroupGaze;
-  }
-
-  // Coherence force
-  com = group.center;
-  relativeCom = com - me.position;
-  double distance = relativeCom.norm();
-  double maxDistance = ((double)group.agents.size() - 1) / 2;
-#ifdef _PAPER_VERSION_
-  if (distance >= maxDistance)
-  {
-    me.forces.groupCoherenceForce = relativeCom.normalized();
-    me.forces.groupCoherenceForce *= me.params.forceFactorGroupCoherence;
-  }
-#else
-  me.forces.groupCoherenceForce = relativeCom;
-  double softenedFactor = me.params.forceFactorGroupCoherence * (std::tanh(distance - maxDistance) + 1) / 2;
-  me.forces.groupCoherenceForce *= softenedFactor;
-#endif
-
-  // Repulsion Force
   // Index 0 -> me
+  utils::Vector2d repulsion;
   for (unsigned i = 1; i < group.agents.size(); i++)
   {
     utils::Vector2d diff = me.position - agents.at(group.agents[i]).position;
     if (diff.norm() < me.radius + agents.at(group.agents[i]).radius)
     {
-      me.forces.groupRepulsionForce += diff;
+      repulsion += diff;
     }
   }
-  me.forces.groupRepulsionForce *= me.params.forceFactorGroupRepulsion;
-
-  // Group Force
-  me.forces.groupForce = me.forces.groupGazeForce + me.forces.groupCoherenceForce + me.forces.groupRepulsionForce;
+  computeGroupForce(me, desiredDirection, group.center, group.agents.size(), repulsion);
 }
 
-inline std::vector<Agent>& SocialForceModel::computeForces(std::vector<Agent>& agents, Map* map) const
+inline void SocialForceModel::loadCrowd(std::vector<Agent>& agents, kernel::CrowdState& crowd, Map* map) const
 {
-  std::unordered_map<int, Group> groups;
+  crowd.resize(agents.size());
   for (unsigned i = 0; i < agents.size(); i++)
   {
-    if (agents[i].groupId < 0)
+    const Agent& agent = agents[i];
+    crowd.x[i] = agent.position.getX();
+    crowd.y[i] = agent.position.getY();
+    crowd.vx[i] = agent.velocity.getX();
+    crowd.vy[i] = agent.velocity.getY();
+    crowd.radius[i] = agent.radius;
+    crowd.desiredVelocity[i] = agent.desiredVelocity;
+    crowd.relaxationTime[i] = agent.params.relaxationTime;
+    crowd.factorDesired[i] = agent.params.forceFactorDesired;
+    crowd.factorObstacle[i] = agent.params.forceFactorObstacle;
+    crowd.sigmaObstacle[i] = agent.params.forceSigmaObstacle;
+    crowd.factorSocial[i] = agent.params.forceFactorSocial;
+    crowd.lambda[i] = agent.params.lambda;
+    crowd.gamma[i] = agent.params.gamma;
+    crowd.n[i] = agent.params.n;
+    crowd.nPrime[i] = agent.params.nPrime;
+
+    crowd.hasGoal[i] = agent.goals.empty() ? 0 : 1;
+    crowd.goalX[i] = agent.goals.empty() ? 0 : agent.goals.front().center.getX();
+    crowd.goalY[i] = agent.goals.empty() ? 0 : agent.goals.front().center.getY();
+    crowd.goalRadius[i] = agent.goals.empty() ? 0 : agent.goals.front().radius;
+
+    // a single obstacle point, given or from the map, goes through the
+    // vectorised loop; several points are averaged here
+    const unsigned obstacles = agent.obstacles1.size() + agent.obstacles2.size();
+    const utils::Vector2d* point = NULL;
+    if (obstacles == 1)
     {
-      continue;
+      point = agent.obstacles1.empty() ? &agent.obstacles2[0] : &agent.obstacles1[0];
+    }
+    else if (obstacles == 0 && map != NULL)
+    {
+      point = &map->getNearestObstacle(agent.position).position;
+    }
+    crowd.obstacleMode[i] = point != NULL ? 1 : (obstacles > 1 ? 2 : 0);
+    crowd.obstacleX[i] = point != NULL ? point->getX() : 0;
+    crowd.obstacleY[i] = point != NULL ? point->getY() : 0;
+    crowd.obstacleFx[i] = crowd.obstacleFy[i] = 0;
+    if (obstacles > 1)
+    {
+      computeObstacleForce(agents[i], map);
+      crowd.obstacleFx[i] = agents[i].forces.obstacleForce.getX();
+      crowd.obstacleFy[i] = agents[i].forces.obstacleForce.getY();
     }
-    groups[agents[i].groupId].agents.push_back(i);
-    groups[agents[i].groupId].center += agents[i].position;
-  }
-  for (auto it = groups.begin(); it != groups.end(); ++it)
-  {
-    it->second.center /= (double)(it->second.agents.size());
   }
+}
 
-  for (unsigned i = 0; i < agents.size(); i++)
+inline std::vector<Agent>& SocialForceModel::computeForces(std::vector<Agent>& agents, Map* map) const
+{
+  return computeForces(agents, threadWorkspace(), map);
+}
+
+inline std::vector<Agent>& SocialForceModel::computeForces(std::vector<Agent>& agents, Workspace& workspace,
+                                                           Map* map) const
+{
+  updateGroups(agents, workspace);
+  computeGroupRepulsion(agents, workspace);
+  const NeighborGrid& neighbors = workspace.neighbors;
+  const std::vector<Group>& groups = workspace.groups;
+  const std::vector<int>& agentGroup = workspace.agentGroup;
+  const std::vector<utils::Vector2d>& groupRepulsion = workspace.groupRepulsion;
+  kernel::CrowdState& crowd = workspace.crowd;
+  if (neighborDistance > 0)
   {
-    utils::Vector2d desiredDirection = computeDesiredForce(agents[i]);
-    computeObstacleForce(agents[i], map);
-    computeSocialForce(i, agents);
-    computeGroupForce(i, desiredDirection, agents, groups);
-    agents[i].forces.globalForce = agents[i].forces.desiredForce + agents[i].forces.socialForce +
-                                   agents[i].forces.obstacleForce + agents[i].forces.groupForce;
+    workspace.neighbors.build([&agents](unsigned i) -> const utils::Vector2d& { return agents[i].position; }, agents.size(),
+                    neighborDistance);
   }
+
+  loadCrowd(agents, crowd, map);
+  crowd.computeDesiredForces();
+  crowd.computeObstacleForces();
+
+  const double maxSquaredDistance = PW(neighborDistance);
+  const unsigned slices = slicesFor(agents.size());
+  crowd.scratch.resize(std::max<size_t>(crowd.scratch.size(), slices));
+  workspace.pool.run(agents.size(), slices, [&](unsigned begin, unsigned end, unsigned slice) {
+    kernel::Neighbors& others = crowd.scratch[slice];
+    for (unsigned i = begin; i < end; i++)
+    {
+      Agent& agent = agents[i];
+      others.clear();
+      // the grid returns candidates, the force is cut off at the exact distance
+      auto inRange = [&](unsigned k) {
+        return neighborDistance <= 0 || PW(crowd.x[k] - crowd.x[i]) + PW(crowd.y[k] - crowd.y[i]) <= maxSquaredDistance;
+      };
+      auto gather = [&](unsigned k) {
+        if (k != i && inRange(k))
+        {
+          others.x.push_back(crowd.x[k]);
+          others.y.push_back(crowd.y[k]);
+          others.vx.push_back(crowd.vx[k]);
+          others.vy.push_back(crowd.vy[k]);
+        }
+      };
+      if (neighborDistance > 0)
+      {
+        neighbors.forEachNear(agent.position, gather);
+      }
+      else
+      {
+        for (unsigned k = 0; k < agents.size(); k++)
+        {
+          gather(k);
+        }
+      }
+
+      double fx, fy;
+      crowd.computeSocialForce(i, others, fx, fy);
+      agent.forces.socialForce.set(fx, fy);
+      if (i != 0 && inRange(0))
+      {
+        agent.forces.robotSocialForce = computeSocialForce(agent, agents[0]);
+      }
+
+      agent.forces.desiredForce.set(crowd.desiredX[i], crowd.desiredY[i]);
+      agent.antimove = crowd.antimove[i] > 0;
+      agent.forces.obstacleForce.set(crowd.obstacleFx[i], crowd.obstacleFy[i]);
+      const utils::Vector2d direction(crowd.directionX[i], crowd.directionY[i]);
+      if (agentGroup[i] < 0)
+      {
+        computeGroupForce(agent, direction, utils::Vector2d(), 1, groupRepulsion[i]);
+      }
+      else
+      {
+        const Group& group = groups[agentGroup[i]];
+        computeGroupForce(agent, direction, group.center, group.agents.size(), groupRepulsion[i]);
+      }
+      agent.forces.globalForce = agent.forces.desiredForce + agent.forces.socialForce + agent.forces.obstacleForce +
+                                 agent.forces.groupForce;
+    }
+  });
   return agents;
 }
 
@@ -545,44 +779,59 @@ inline void Agent::move(double dt)
   velocity.set(linearVelocity * yaw.cos(), linearVelocity * yaw.sin());
 }
 
-inline std::vector<Agent>& SocialForceModel::updatePosition(std::vector<Agent>& agents, double dt) const
+inline void SocialForceModel::integrate(Agent& agent, double dt) const
 {
-  for (unsigned i = 0; i < agents.size(); i++)
+  const utils::Vector2d initVelocity = agent.velocity;
+  agent.velocity += agent.forces.globalForce * dt;
+  if (agent.velocity.norm() > agent.desiredVelocity)
   {
-    utils::Vector2d initPos = agents[i].position;
-    if (agents[i].teleoperated)
-    {
-      double imd = agents[i].linearVelocity * dt;
-      utils::Vector2d inc(imd * std::cos(agents[i].yaw.toRadian() + agents[i].angularVelocity * dt * 0.5),
-                          imd * std::sin(agents[i].yaw.toRadian() + agents[i].angularVelocity * dt * 0.5));
-      agents[i].yaw += utils::Angle::fromRadian(agents[i].angularVelocity * dt);
-      agents[i].position += inc;
-      agents[i].velocity.set(agents[i].linearVelocity * agents[i].yaw.cos(),
-                             agents[i].linearVelocity * agents[i].yaw.sin());
-    }
-    else
+    agent.velocity.normalize();
+    agent.velocity *= agent.desiredVelocity;
+  }
+  agent.yaw = agent.velocity.angle();
+  agent.position += (integrator == EXPLICIT_EULER ? initVelocity : agent.velocity) * dt;
+}
+
+inline std::vector<Agent>& SocialForceModel::updatePosition(std::vector<Agent>& agents, double dt) const
+{
+  return updatePosition(agents, dt, threadWorkspace());
+}
+
+inline std::vector<Agent>& SocialForceModel::updatePosition(std::vector<Agent>& agents, double dt,
+                                                            Workspace& workspace) const
+{
+  // every agent only touches its own state
+  workspace.pool.run(agents.size(), slicesFor(agents.size()), [&](unsigned begin, unsigned end, unsigned) {
+    for (unsigned i = begin; i < end; i++)
     {
-      agents[i].velocity += agents[i].forces.globalForce * dt;
-      if (agents[i].velocity.norm() > agents[i].desiredVelocity)
+      utils::Vector2d initPos = agents[i].position;
+      if (agents[i].teleoperated)
       {
-        agents[i].velocity.normalize();
-        agents[i].velocity *= agents[i].desiredVelocity;
+        double imd = agents[i].linearVelocity * dt;
+        utils::Vector2d inc(imd * std::cos(agents[i].yaw.toRadian() + agents[i].angularVelocity * dt * 0.5),
+                            imd * std::sin(agents[i].yaw.toRadian() + agents[i].angularVelocity * dt * 0.5));
+        agents[i].yaw += utils::Angle::fromRadian(agents[i].angularVelocity * dt);
+        agents[i].position += inc;
+        agents[i].velocity.set(agents[i].linearVelocity * agents[i].yaw.cos(),
+                               agents[i].linearVelocity * agents[i].yaw.sin());
       }
-      agents[i].yaw = agents[i].velocity.angle();
-      agents[i].position += agents[i].velocity * dt;
-    }
-    agents[i].movement = agents[i].position - initPos;
-    if (!agents[i].goals.empty() &&
-        (agents[i].goals.front().center - agents[i].position).norm() <= agents[i].goals.front().radius)
-    {
-      Goal g = agents[i].goals.front();
-      agents[i].goals.pop_front();
-      if (agents[i].cyclicGoals)
+      else
+      {
+        integrate(agents[i], dt);
+      }
+      agents[i].movement = agents[i].position - initPos;
+      if (!agents[i].goals.empty() &&
+          (agents[i].goals.front().center - agents[i].position).norm() <= agents[i].goals.front().radius)
       {
-        agents[i].goals.push_back(g);
+        Goal g = agents[i].goals.front();
+        agents[i].goals.pop_front();
+        if (agents[i].cyclicGoals)
+        {
+          agents[i].goals.push_back(g);
+        }
       }
     }
-  }
+  });
   return agents;
 }
 
@@ -591,14 +840,7 @@ inline void SocialForceModel::updatePosition(Agent& agent, double dt) const
   utils::Vector2d initPos = agent.position;
   utils::Angle initYaw = agent.yaw;
 
-  agent.velocity += agent.forces.globalForce * dt;
-  if (agent.velocity.norm() > agent.desiredVelocity)
-  {
-    agent.velocity.normalize();
-    agent.velocity *= agent.desiredVelocity;
-  }
-  agent.yaw = agent.velocity.angle();
-  agent.position += agent.velocity * dt;
+  integrate(agent, dt);
 
   agent.linearVelocity = agent.velocity.norm();
   agent.angularVelocity = (agent.yaw - initYaw).toRadian() / dt;
@@ -615,5 +857,42 @@ inline void SocialForceModel::updatePosition(Agent& agent, double dt) const
   }
 }
 
+inline std::vector<Agent>& SocialForceModel::step(std::vector<Agent>& agents, double dt, double& pendingTime,
+                                                  Workspace& workspace, Map* map) const
+{
+  if (fixedStep <= 0)
+  {
+    pendingTime = 0;
+    computeForces(agents, workspace, map);
+    return updatePosition(agents, dt, workspace);
+  }
+
+  pendingTime += dt;
+  // the epsilon keeps rounding from turning n exact substeps into n - 1
+  unsigned substeps = (unsigned)std::floor(pendingTime / fixedStep + 1e-9);
+  pendingTime = std::max(0.0, pendingTime - substeps * fixedStep);
+  if (substeps > maxSubsteps)
+  {
+    substeps = maxSubsteps;
+  }
+
+  std::vector<utils::Vector2d>& stepStart = workspace.stepStart;
+  stepStart.resize(agents.size());
+  for (unsigned i = 0; i < agents.size(); i++)
+  {
+    stepStart[i] = agents[i].position;
+  }
+  for (unsigned k = 0; k < substeps; k++)
+  {
+    computeForces(agents, workspace, map);
+    updatePosition(agents, fixedStep, workspace);
+  }
+  for (unsigned i = 0; i < agents.size(); i++)
+  {
+    agents[i].movement = agents[i].position - stepStart[i];
+  }
+  return agents;
+}
+
 }  // namespace sfm
 #endif
@@ -0,0 +1,101 @@
+/***********************************************************
+ *
+ * @file: pedestrian_crowd_plugin.h
+ * @breif: Gazebo world plugin stepping all social force model pedestrians at once
+ * @author: Yang Haodong
+ * @update: 2023-03-22
+ * @version: 1.0
+ *
+ * Copyright (c) 2023， Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#ifndef PEDESTRIANCROWD_GAZEBO_PLUGIN_H
+#define PEDESTRIANCROWD_GAZEBO_PLUGIN_H
+
+// C++
+#include <vector>
+
+// Gazebo
+#include <gazebo/common/Plugin.hh>
+#include <gazebo/physics/physics.hh>
+#include <gazebo/util/system.hh>
+
+// Social Force Model
+#include <lightsfm/sfm.hpp>
+
+#include "pedestrian_sfm_plugin.h"
+
+namespace gazebo
+{
+/**
+ * @brief Steps every PedestrianSFMPlugin actor of the world in one pass: the world models are read once per tick and
+ *        all agents go through a single sfm::SFM.computeForces() call. The actor plugins keep their SDF configuration
+ *        and only move their actor and publish its state.
+ */
+class GZ_PLUGIN_VISIBLE PedestrianCrowdPlugin : public WorldPlugin
+{
+public:
+  /**
+   * @brief Construct a gazebo plugin
+   */
+  PedestrianCrowdPlugin();
+
+  /**
+   * @brief De-Construct a gazebo plugin
+   */
+  ~PedestrianCrowdPlugin();
+
+  /**
+   * @brief Load the world plugin.
+   * @param _world  Pointer to the world.
+   * @param _sdf    Pointer to the plugin's SDF elements.
+   */
+  virtual void Load(physics::WorldPtr _world, sdf::ElementPtr _sdf);
+
+  /**
+   * @brief Reset the simulation time of the crowd.
+   */
+  virtual void Reset();
+
+private:
+  /**
+   * @brief Function that is called every update cycle.
+   * @param _info Timing information.
+   */
+  void OnUpdate(const common::UpdateInfo& _info);
+
+  /**
+   * @brief Take over the pedestrians of this world, registryMutex() must be held.
+   */
+  void claimPedestrians();
+
+  /**
+   * @brief Give all pedestrians linked through their walking groups a common group id.
+   */
+  void updateGroups();
+
+private:
+  // Pointer to the world.
+  physics::WorldPtr world_;
+  // List of connections
+  std::vector<event::ConnectionPtr> connections_;
+  // pedestrians stepped by this plugin
+  std::vector<PedestrianSFMPlugin*> pedestrians_;
+  // poses and boxes of all models, read once per tick
+  std::vector<ModelSnapshot> models_;
+  // SFM agents of the pedestrians, swapped in and out of the actor plugins every tick
+  std::vector<sfm::Agent> agents_;
+  // scratch of the SFM crowd methods for this world
+  sfm::Workspace workspace_;
+  // union-find parents for the walking groups
+  std::vector<int> group_parents_;
+  // Time of the last update.
+  common::Time last_update_;
+  bool time_init_;
+  // simulated time not yet stepped by the fixed step integrator
+  double pending_time_;
+};
+}  // namespace gazebo
+#endif
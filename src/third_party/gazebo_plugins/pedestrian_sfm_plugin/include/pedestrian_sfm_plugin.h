@@ -18,6 +18,9 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
 #include <ros/ros.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/Twist.h>
@@ -30,15 +33,35 @@
 #include <gazebo/transport/transport.hh>
 
 // Social Force Model
+#include <lightsfm/grid_map.hpp>
 #include <lightsfm/sfm.hpp>
 
 // message
 #include <gazebo_sfm_plugin/ped_state.h>
+#include <pedsim_msgs/TrackedPersons.h>
 
 namespace gazebo
 {
+/**
+ * @brief Pose and bounding box of a world model, read once per update and shared by all pedestrians
+ */
+struct ModelSnapshot
+{
+  std::string name;
+  unsigned int id;
+  bool is_actor;
+  bool is_static;
+  ignition::math::Pose3d pose;
+  ignition::math::AxisAlignedBox box;
+  ignition::math::Vector3d linear_vel;
+  ignition::math::Vector3d angular_vel;
+};
+
 class GZ_PLUGIN_VISIBLE PedestrianSFMPlugin : public ModelPlugin
 {
+  // steps all pedestrians of a world at once, see pedestrian_crowd_plugin.h
+  friend class PedestrianCrowdPlugin;
+
 public:
   /**
    * @brief Construct a gazebo plugin
@@ -62,6 +85,13 @@ public:
    */
   virtual void Reset();
 
+  /**
+   * @brief Read the pose and bounding box of every model in the world.
+   * @param world   the world to read
+   * @param models  one entry per model, in model index order
+   */
+  static void snapshotModels(const physics::WorldPtr& world, std::vector<ModelSnapshot>& models);
+
 private:
   /**
    * @brief Function that is called every update cycle.
@@ -71,15 +101,41 @@ private:
 
   bool OnStateCallBack(gazebo_sfm_plugin::ped_state::Request& req, gazebo_sfm_plugin::ped_state::Response& resp);
 
+  /**
+   * @brief Publish the states of all pedestrians of the world in one message, done by the first of them only.
+   */
+  void OnUpdateEnd();
+
+  /**
+   * @brief Move the actor to the position of the SFM agent and publish its state.
+   * @param _info Timing information.
+   */
+  void updateActor(const common::UpdateInfo& _info);
+
   /**
    * @brief Helper function to detect the closest obstacles.
+   * @param models  snapshot of the world models
    */
-  void handleObstacles();
+  void handleObstacles(const std::vector<ModelSnapshot>& models);
 
   /**
    * @brief Helper function to detect the nearby pedestrians (other actors).
+   * @param models  snapshot of the world models
+   */
+  void handlePedestrians(const std::vector<ModelSnapshot>& models);
+
+  /**
+   * @brief All loaded pedestrian plugins, guarded by registryMutex()
+   */
+  static std::vector<PedestrianSFMPlugin*>& registry();
+  static std::mutex& registryMutex();
+
+  /**
+   * @brief Load an occupancy map for the static obstacles, shared by all pedestrians using the same file.
+   * @param file  map_server yaml file
+   * @return the map, or nullptr if it could not be loaded
    */
-  void handlePedestrians();
+  static std::shared_ptr<sfm::GridMap> loadObstacleMap(const std::string& file);
 
 private:
   // Gazebo ROS node
@@ -87,6 +143,8 @@ private:
   // topic publisher
   ros::Publisher pose_pub_;
   ros::Publisher vel_pub_;
+  // states of all pedestrians of the world, see OnUpdateEnd()
+  ros::Publisher states_pub_;
   // pedestrian state server
   ros::ServiceServer state_server_;
   // this actor as a SFM agent
@@ -123,7 +181,13 @@ private:
   // Time of the last update.
   common::Time last_update_;
   // List of models to ignore. Used for vector field
-  std::vector<std::string> ignore_models_;
+  std::unordered_set<std::string> ignore_models_;
+  // static obstacles from the occupancy map, replacing the bounding boxes of static models
+  std::shared_ptr<sfm::GridMap> obstacle_map_;
+  // models of the world, only used when stepping on our own
+  std::vector<ModelSnapshot> models_;
+  // stepped by a PedestrianCrowdPlugin instead of OnUpdate
+  bool crowd_managed_ = false;
   // Custom trajectory info.
   physics::TrajectoryInfoPtr trajectory_info_;
 };
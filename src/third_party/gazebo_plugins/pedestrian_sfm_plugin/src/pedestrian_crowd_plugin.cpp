@@ -0,0 +1,191 @@
+/***********************************************************
+ *
+ * @file: pedestrian_crowd_plugin.cpp
+ * @breif: Gazebo world plugin stepping all social force model pedestrians at once
+ * @author: Yang Haodong
+ * @update: 2023-03-22
+ * @version: 1.0
+ *
+ * Copyright (c) 2023， Yang Haodong
+ * All rights reserved.
+ * --------------------------------------------------------
+ *
+ **********************************************************/
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include <pedestrian_crowd_plugin.h>
+
+using namespace gazebo;
+GZ_REGISTER_WORLD_PLUGIN(PedestrianCrowdPlugin)
+
+/**
+ * @brief Construct a gazebo plugin
+ */
+PedestrianCrowdPlugin::PedestrianCrowdPlugin() : time_init_(false), pending_time_(0.0)
+{
+}
+
+/**
+ * @brief De-Construct a gazebo plugin
+ */
+PedestrianCrowdPlugin::~PedestrianCrowdPlugin()
+{
+  // hand the pedestrians back to their own update
+  std::lock_guard<std::mutex> lock(PedestrianSFMPlugin::registryMutex());
+  for (auto ped : PedestrianSFMPlugin::registry())
+  {
+    if (ped->world_ == world_)
+      ped->crowd_managed_ = false;
+  }
+}
+
+/**
+ * @brief Load the world plugin.
+ * @param _world  Pointer to the world.
+ * @param _sdf    Pointer to the plugin's SDF elements.
+ */
+void PedestrianCrowdPlugin::Load(physics::WorldPtr _world, sdf::ElementPtr _sdf)
+{
+  world_ = _world;
+
+  // fixed substeps make the crowd independent of the update rate and of the real time factor
+  if (_sdf->HasElement("fixed_step"))
+    sfm::SFM.setFixedStep(_sdf->Get<double>("fixed_step"));
+  if (_sdf->HasElement("integrator"))
+    sfm::SFM.setIntegrator(_sdf->Get<std::string>("integrator") == "explicit_euler" ?
+                               sfm::SocialForceModel::EXPLICIT_EULER :
+                               sfm::SocialForceModel::SEMI_IMPLICIT_EULER);
+
+  // Bind the update callback function
+  connections_.push_back(
+      event::Events::ConnectWorldUpdateBegin(std::bind(&PedestrianCrowdPlugin::OnUpdate, this, std::placeholders::_1)));
+}
+
+/**
+ * @brief Reset the simulation time of the crowd.
+ */
+void PedestrianCrowdPlugin::Reset()
+{
+  time_init_ = false;
+  pending_time_ = 0.0;
+}
+
+/**
+ * @brief Take over the pedestrians of this world, registryMutex() must be held.
+ */
+void PedestrianCrowdPlugin::claimPedestrians()
+{
+  // actors may be loaded after us or removed, so this is redone every tick
+  pedestrians_.clear();
+  for (auto ped : PedestrianSFMPlugin::registry())
+  {
+    if (ped->world_ == world_)
+    {
+      ped->crowd_managed_ = true;
+      pedestrians_.push_back(ped);
+    }
+  }
+}
+
+/**
+ * @brief Give all pedestrians linked through their walking groups a common group id.
+ */
+void PedestrianCrowdPlugin::updateGroups()
+{
+  std::unordered_map<std::string, int> index;
+  for (int i = 0; i < static_cast<int>(pedestrians_.size()); i++)
+    index[pedestrians_[i]->actor_->GetName()] = i;
+
+  auto find = [this](int i) {
+    while (group_parents_[i] != i)
+      i = group_parents_[i] = group_parents_[group_parents_[i]];
+    return i;
+  };
+
+  group_parents_.resize(pedestrians_.size());
+  for (int i = 0; i < static_cast<int>(pedestrians_.size()); i++)
+    group_parents_[i] = i;
+  for (int i = 0; i < static_cast<int>(pedestrians_.size()); i++)
+  {
+    for (const auto& name : pedestrians_[i]->group_names_)
+    {
+      auto it = index.find(name);
+      if (it != index.end())
+        group_parents_[find(it->second)] = find(i);
+    }
+  }
+
+  // pedestrians without a group mate keep -1, the others use the id of the group's root
+  std::vector<int> group_size(pedestrians_.size(), 0);
+  for (int i = 0; i < static_cast<int>(pedestrians_.size()); i++)
+    group_size[find(i)]++;
+  for (int i = 0; i < static_cast<int>(pedestrians_.size()); i++)
+  {
+    int root = find(i);
+    agents_[i].groupId = group_size[root] > 1 ? agents_[root].id : -1;
+  }
+}
+
+/**
+ * @brief Function that is called every update cycle.
+ * @param _info Timing information.
+ */
+void PedestrianCrowdPlugin::OnUpdate(const common::UpdateInfo& _info)
+{
+  // also keeps pedestrians from being unloaded while we step them
+  std::lock_guard<std::mutex> lock(PedestrianSFMPlugin::registryMutex());
+  claimPedestrians();
+  if (pedestrians_.empty())
+    return;
+
+  if (!time_init_)
+  {
+    last_update_ = _info.simTime;
+    time_init_ = true;
+  }
+  double dt = (_info.simTime - last_update_).Double();
+  last_update_ = _info.simTime;
+
+  // one pass over the world models for all pedestrians
+  PedestrianSFMPlugin::snapshotModels(world_, models_);
+
+  agents_.resize(pedestrians_.size());
+  for (size_t i = 0; i < pedestrians_.size(); i++)
+  {
+    PedestrianSFMPlugin* ped = pedestrians_[i];
+    ped->handleObstacles(models_);
+    std::swap(agents_[i], ped->sfm_actor_);
+
+    // pedestrians still waiting for their time delay stand still but are seen by the others
+    if (!ped->time_init_)
+    {
+      agents_[i].teleoperated = true;
+      agents_[i].linearVelocity = 0.0;
+      agents_[i].angularVelocity = 0.0;
+    }
+  }
+  updateGroups();
+
+  // like the per-actor update, pedestrians only react to others within people_distance
+  double people_dist = 0.0;
+  for (auto ped : pedestrians_)
+    people_dist = std::max(people_dist, ped->people_dist_);
+  sfm::SFM.setNeighborDistance(people_dist);
+
+  // Compute Social Forces and update model, in fixed substeps if configured
+  sfm::SFM.step(agents_, dt, pending_time_, workspace_);
+
+  for (size_t i = 0; i < pedestrians_.size(); i++)
+  {
+    PedestrianSFMPlugin* ped = pedestrians_[i];
+    agents_[i].teleoperated = false;
+    agents_[i].linearVelocity = agents_[i].velocity.norm();
+    std::swap(agents_[i], ped->sfm_actor_);
+
+    if (ped->time_init_)
+      ped->updateActor(_info);
+  }
+}
@@ -14,6 +14,7 @@
 #include <functional>
 #include <stdio.h>
 #include <string>
+#include <unordered_map>
 
 #include <pedestrian_sfm_plugin.h>
 
@@ -34,9 +35,49 @@ PedestrianSFMPlugin::PedestrianSFMPlugin() : pose_init_(false), time_delay_(0.0)
  */
 PedestrianSFMPlugin::~PedestrianSFMPlugin()
 {
+  std::lock_guard<std::mutex> lock(registryMutex());
+  registry().erase(std::remove(registry().begin(), registry().end(), this), registry().end());
+
   pose_pub_.shutdown();
 }
 
+/**
+ * @brief All loaded pedestrian plugins, guarded by registryMutex()
+ */
+std::vector<PedestrianSFMPlugin*>& PedestrianSFMPlugin::registry()
+{
+  static std::vector<PedestrianSFMPlugin*> plugins;
+  return plugins;
+}
+
+std::mutex& PedestrianSFMPlugin::registryMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+/**
+ * @brief Load an occupancy map for the static obstacles, shared by all pedestrians using the same file.
+ * @param file  map_server yaml file
+ * @return the map, or nullptr if it could not be loaded
+ */
+std::shared_ptr<sfm::GridMap> PedestrianSFMPlugin::loadObstacleMap(const std::string& file)
+{
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::weak_ptr<sfm::GridMap>> maps;
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::shared_ptr<sfm::GridMap> map = maps[file].lock();
+  if (!map)
+  {
+    map = std::make_shared<sfm::GridMap>();
+    if (!map->load(file))
+      return nullptr;
+    maps[file] = map;
+  }
+  return map;
+}
+
 /**
  * @brief Load the actor plugin.
  * @param _model  Pointer to the parent model.
@@ -61,6 +102,7 @@ void PedestrianSFMPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   // topic publisher
   pose_pub_ = node_->advertise<geometry_msgs::PoseStamped>("/" + actor_->GetName() + "/pose", 10);
   vel_pub_ = node_->advertise<geometry_msgs::Twist>("/" + actor_->GetName() + "/twist", 10);
+  states_pub_ = node_->advertise<pedsim_msgs::TrackedPersons>("/ped_states", 1);
 
   // server
   state_server_ = node_->advertiseService(actor_->GetName() + "_state", &PedestrianSFMPlugin::OnStateCallBack, this);
@@ -140,9 +182,14 @@ void PedestrianSFMPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   // Bind the update callback function
   connections_.push_back(
       event::Events::ConnectWorldUpdateBegin(std::bind(&PedestrianSFMPlugin::OnUpdate, this, std::placeholders::_1)));
+  connections_.push_back(event::Events::ConnectWorldUpdateEnd(std::bind(&PedestrianSFMPlugin::OnUpdateEnd, this)));
 
   // Initialize the social force model.
   this->Reset();
+
+  // a PedestrianCrowdPlugin in the world picks us up from here
+  std::lock_guard<std::mutex> lock(registryMutex());
+  registry().push_back(this);
 }
 
 /**
@@ -252,12 +299,21 @@ void PedestrianSFMPlugin::Reset()
     sdf::ElementPtr model_elem = sdf_->GetElement("ignore_obstacles")->GetElement("model");
     while (model_elem)
     {
-      ignore_models_.push_back(model_elem->Get<std::string>());
+      ignore_models_.insert(model_elem->Get<std::string>());
       model_elem = model_elem->GetNextElement("model");
     }
   }
+  // Static obstacles from an occupancy map instead of model bounding boxes
+  if (sdf_->HasElement("obstacle_map"))
+  {
+    std::string file = sdf_->Get<std::string>("obstacle_map");
+    obstacle_map_ = loadObstacleMap(file);
+    if (!obstacle_map_)
+      gzerr << "Obstacle map " << file << " could not be loaded, using model bounding boxes.\n";
+  }
+
   // Add our own name to models we should ignore when avoiding obstacles.
-  ignore_models_.push_back(actor_->GetName());
+  ignore_models_.insert(actor_->GetName());
 
   // Add the other pedestrians to the ignored obstacles
   for (unsigned int i = 0; i < world_->ModelCount(); ++i)
@@ -265,35 +321,71 @@ void PedestrianSFMPlugin::Reset()
     physics::ModelPtr model = world_->ModelByIndex(i);
 
     if (model->GetId() != actor_->GetId() && ((int)model->GetType() == (int)actor_->GetType()))
-      ignore_models_.push_back(model->GetName());
+      ignore_models_.insert(model->GetName());
+  }
+}
+
+/**
+ * @brief Read the pose and bounding box of every model in the world.
+ * @param world   the world to read
+ * @param models  one entry per model, in model index order
+ */
+void PedestrianSFMPlugin::snapshotModels(const physics::WorldPtr& world, std::vector<ModelSnapshot>& models)
+{
+  models.resize(world->ModelCount());
+  for (unsigned int i = 0; i < models.size(); ++i)
+  {
+    physics::ModelPtr model = world->ModelByIndex(i);
+    ModelSnapshot& m = models[i];
+    m.name = model->GetName();
+    m.id = model->GetId();
+    m.is_actor = model->HasType(physics::Base::ACTOR);
+    m.is_static = model->IsStatic();
+    m.pose = model->WorldPose();
+    // merges the boxes of all links, so it is read once
+    m.box = model->BoundingBox();
+    m.linear_vel = model->WorldLinearVel();
+    m.angular_vel = model->WorldAngularVel();
   }
 }
 
 /**
  * @brief Helper function to detect the closest obstacles.
+ * @param models  snapshot of the world models
  */
-void PedestrianSFMPlugin::handleObstacles()
+void PedestrianSFMPlugin::handleObstacles(const std::vector<ModelSnapshot>& models)
 {
   double min_dist = 10000.0;
   ignition::math::Vector3d closest_obs;
   sfm_actor_.obstacles1.clear();
 
-  for (unsigned int i = 0; i < world_->ModelCount(); ++i)
+  ignition::math::Vector3d actorPos = actor_->WorldPose().Pos();
+
+  // static models are part of the occupancy map, whose nearest cell is exact unlike their bounding boxes
+  if (obstacle_map_)
   {
-    physics::ModelPtr model = world_->ModelByIndex(i);
-    if (std::find(ignore_models_.begin(), ignore_models_.end(), model->GetName()) == ignore_models_.end())
+    sfm::Map::Obstacle obs = obstacle_map_->nearestObstacle(utils::Vector2d(actorPos.X(), actorPos.Y()));
+    if (obs.distance >= 0)
+    {
+      min_dist = obs.distance;
+      closest_obs.Set(obs.position.getX(), obs.position.getY(), actorPos.Z());
+    }
+  }
+
+  for (const auto& model : models)
+  {
+    if (ignore_models_.find(model.name) == ignore_models_.end() && !(obstacle_map_ && model.is_static))
     {
       // simple method, suppose BBs are AABBs
-      ignition::math::Vector3d actorPos = actor_->WorldPose().Pos();
-      ignition::math::Vector3d modelPos = model->WorldPose().Pos();
+      ignition::math::Vector3d modelPos = model.pose.Pos();
 
       // BB border
-      double max_x = model->BoundingBox().Max().X();
-      double min_x = model->BoundingBox().Min().X();
-      double max_y = model->BoundingBox().Max().Y();
-      double min_y = model->BoundingBox().Min().Y();
-      double max_z = model->BoundingBox().Max().Z();
-      double min_z = model->BoundingBox().Min().Z();
+      double max_x = model.box.Max().X();
+      double min_x = model.box.Min().X();
+      double max_y = model.box.Max().Y();
+      double min_y = model.box.Min().Y();
+      double max_z = model.box.Max().Z();
+      double min_z = model.box.Min().Z();
 
       ignition::math::Vector3d closest_point;
       double closest_weight = 0.8;
@@ -320,39 +412,36 @@ void PedestrianSFMPlugin::handleObstacles()
 
 /**
  * @brief Helper function to detect the nearby pedestrians (other actors).
+ * @param models  snapshot of the world models
  */
-void PedestrianSFMPlugin::handlePedestrians()
+void PedestrianSFMPlugin::handlePedestrians(const std::vector<ModelSnapshot>& models)
 {
   other_actors_.clear();
 
-  for (unsigned int i = 0; i < world_->ModelCount(); ++i)
+  ignition::math::Vector3d actorPos = actor_->WorldPose().Pos();
+  for (const auto& model : models)
   {
-    physics::ModelPtr model = world_->ModelByIndex(i);
-
-    if (model->GetId() != actor_->GetId() && ((int)model->GetType() == (int)actor_->GetType()))
+    if (model.id != actor_->GetId() && model.is_actor)
     {
-      ignition::math::Pose3d model_pose = model->WorldPose();
-      ignition::math::Vector3d pos = model_pose.Pos() - actor_->WorldPose().Pos();
+      ignition::math::Vector3d pos = model.pose.Pos() - actorPos;
       if (pos.Length() < people_dist_)
       {
         sfm::Agent ped;
-        ped.id = model->GetId();
-        ped.position.set(model_pose.Pos().X(), model_pose.Pos().Y());
-        ignition::math::Vector3d rpy = model_pose.Rot().Euler();
+        ped.id = model.id;
+        ped.position.set(model.pose.Pos().X(), model.pose.Pos().Y());
+        ignition::math::Vector3d rpy = model.pose.Rot().Euler();
         ped.yaw = utils::Angle::fromRadian(rpy.Z());
 
         ped.radius = sfm_actor_.radius;
-        ignition::math::Vector3d linvel = model->WorldLinearVel();
-        ped.velocity.set(linvel.X(), linvel.Y());
-        ped.linearVelocity = linvel.Length();
-        ignition::math::Vector3d angvel = model->WorldAngularVel();
-        ped.angularVelocity = angvel.Z();
+        ped.velocity.set(model.linear_vel.X(), model.linear_vel.Y());
+        ped.linearVelocity = model.linear_vel.Length();
+        ped.angularVelocity = model.angular_vel.Z();
 
         // check if the ped belongs to my group
         if (sfm_actor_.groupId != -1)
         {
           std::vector<std::string>::iterator it;
-          it = find(group_names_.begin(), group_names_.end(), model->GetName());
+          it = find(group_names_.begin(), group_names_.end(), model.name);
           if (it != group_names_.end())
             ped.groupId = sfm_actor_.groupId;
           else
@@ -370,7 +459,8 @@ void PedestrianSFMPlugin::handlePedestrians()
  */
 void PedestrianSFMPlugin::OnUpdate(const common::UpdateInfo& _info)
 {
-  if (time_init_)
+  // a crowd plugin steps all pedestrians together
+  if (time_init_ && !crowd_managed_)
   {
     if (!pose_init_)
       last_update_ = _info.simTime;
@@ -378,87 +468,97 @@ void PedestrianSFMPlugin::OnUpdate(const common::UpdateInfo& _info)
     // Time delta
     double dt = (_info.simTime - last_update_).Double();
 
-    ignition::math::Pose3d actor_pose = actor_->WorldPose();
-
+    snapshotModels(world_, models_);
     // update closest obstacle
-    this->handleObstacles();
+    this->handleObstacles(models_);
     // update pedestrian around
-    this->handlePedestrians();
+    this->handlePedestrians(models_);
 
     // Compute Social Forces
     sfm::SFM.computeForces(sfm_actor_, other_actors_);
     // Update model
     sfm::SFM.updatePosition(sfm_actor_, dt);
 
-    utils::Angle h = this->sfm_actor_.yaw;
-    utils::Angle add = utils::Angle::fromRadian(1.5707);
-    h = h + add;
-    double yaw = h.toRadian();
+    this->updateActor(_info);
+  }
+}
 
-    ignition::math::Vector3d rpy = actor_pose.Rot().Euler();
-    utils::Angle current = utils::Angle::fromRadian(rpy.Z());
-    double diff = (h - current).toRadian();
-    if (std::fabs(diff) > IGN_DTOR(10))
-    {
-      current = current + utils::Angle::fromRadian(diff * 0.005);
-      yaw = current.toRadian();
-    }
+/**
+ * @brief Move the actor to the position of the SFM agent and publish its state.
+ * @param _info Timing information.
+ */
+void PedestrianSFMPlugin::updateActor(const common::UpdateInfo& _info)
+{
+  ignition::math::Pose3d actor_pose = actor_->WorldPose();
 
-    actor_pose.Pos().X(sfm_actor_.position.getX());
-    actor_pose.Pos().Y(sfm_actor_.position.getY());
-    actor_pose.Pos().Z(1.0);
-    actor_pose.Rot() = ignition::math::Quaterniond(1.5707, 0, yaw);
+  utils::Angle h = this->sfm_actor_.yaw;
+  utils::Angle add = utils::Angle::fromRadian(1.5707);
+  h = h + add;
+  double yaw = h.toRadian();
 
-    // Distance traveled is used to coordinate motion with the walking
-    double distance_traveled = (actor_pose.Pos() - actor_->WorldPose().Pos()).Length();
+  ignition::math::Vector3d rpy = actor_pose.Rot().Euler();
+  utils::Angle current = utils::Angle::fromRadian(rpy.Z());
+  double diff = (h - current).toRadian();
+  if (std::fabs(diff) > IGN_DTOR(10))
+  {
+    current = current + utils::Angle::fromRadian(diff * 0.005);
+    yaw = current.toRadian();
+  }
 
-    actor_->SetWorldPose(actor_pose);
-    actor_->SetScriptTime(actor_->ScriptTime() + distance_traveled * animation_factor_);
+  actor_pose.Pos().X(sfm_actor_.position.getX());
+  actor_pose.Pos().Y(sfm_actor_.position.getY());
+  actor_pose.Pos().Z(1.0);
+  actor_pose.Rot() = ignition::math::Quaterniond(1.5707, 0, yaw);
 
-    geometry_msgs::PoseStamped current_pose;
-    current_pose.header.frame_id = "map";
-    current_pose.header.stamp = ros::Time::now();
-    current_pose.pose.position.x = sfm_actor_.position.getX();
-    current_pose.pose.position.y = sfm_actor_.position.getY();
-    current_pose.pose.position.z = 1.0;
-    tf2::Quaternion q;
-    q.setRPY(0, 0, sfm_actor_.yaw.toRadian());
-    tf2::convert(q, current_pose.pose.orientation);
+  // Distance traveled is used to coordinate motion with the walking
+  double distance_traveled = (actor_pose.Pos() - actor_->WorldPose().Pos()).Length();
 
-    // set model velocity
-    geometry_msgs::Twist current_vel;
-    if (!pose_init_)
-    {
-      pose_init_ = true;
-      last_pose_x_ = current_pose.pose.position.x;
-      last_pose_y_ = current_pose.pose.position.y;
-      current_vel.linear.x = 0;
-      current_vel.linear.y = 0;
-    }
-    else
-    {
-      double dt = (_info.simTime - last_update_).Double();
-      double vx = (current_pose.pose.position.x - last_pose_x_) / dt;
-      double vy = (current_pose.pose.position.y - last_pose_y_) / dt;
-      last_pose_x_ = current_pose.pose.position.x;
-      last_pose_y_ = current_pose.pose.position.y;
-
-      current_vel.linear.x = vx;
-      current_vel.linear.y = vy;
-    }
+  actor_->SetWorldPose(actor_pose);
+  actor_->SetScriptTime(actor_->ScriptTime() + distance_traveled * animation_factor_);
+
+  geometry_msgs::PoseStamped current_pose;
+  current_pose.header.frame_id = "map";
+  current_pose.header.stamp = ros::Time::now();
+  current_pose.pose.position.x = sfm_actor_.position.getX();
+  current_pose.pose.position.y = sfm_actor_.position.getY();
+  current_pose.pose.position.z = 1.0;
+  tf2::Quaternion q;
+  q.setRPY(0, 0, sfm_actor_.yaw.toRadian());
+  tf2::convert(q, current_pose.pose.orientation);
+
+  // set model velocity
+  geometry_msgs::Twist current_vel;
+  if (!pose_init_)
+  {
+    pose_init_ = true;
+    last_pose_x_ = current_pose.pose.position.x;
+    last_pose_y_ = current_pose.pose.position.y;
+    current_vel.linear.x = 0;
+    current_vel.linear.y = 0;
+  }
+  else
+  {
+    double dt = (_info.simTime - last_update_).Double();
+    double vx = (current_pose.pose.position.x - last_pose_x_) / dt;
+    double vy = (current_pose.pose.position.y - last_pose_y_) / dt;
+    last_pose_x_ = current_pose.pose.position.x;
+    last_pose_y_ = current_pose.pose.position.y;
 
-    pose_pub_.publish(current_pose);
-    vel_pub_.publish(current_vel);
-
-    // update
-    px_ = current_pose.pose.position.x;
-    py_ = current_pose.pose.position.y;
-    pz_ = current_pose.pose.position.z;
-    vx_ = current_vel.linear.x;
-    vy_ = current_vel.linear.y;
-    theta_ = yaw;
-    last_update_ = _info.simTime;
+    current_vel.linear.x = vx;
+    current_vel.linear.y = vy;
   }
+
+  pose_pub_.publish(current_pose);
+  vel_pub_.publish(current_vel);
+
+  // update
+  px_ = current_pose.pose.position.x;
+  py_ = current_pose.pose.position.y;
+  pz_ = current_pose.pose.position.z;
+  vx_ = current_vel.linear.x;
+  vy_ = current_vel.linear.y;
+  theta_ = yaw;
+  last_update_ = _info.simTime;
 }
 
 bool PedestrianSFMPlugin::OnStateCallBack(gazebo_sfm_plugin::ped_state::Request& req,
@@ -476,4 +576,45 @@ bool PedestrianSFMPlugin::OnStateCallBack(gazebo_sfm_plugin::ped_state::Request&
   }
   else
     return false;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Publish the states of all pedestrians of the world in one message, done by the first of them only.
+ */
+void PedestrianSFMPlugin::OnUpdateEnd()
+{
+  std::lock_guard<std::mutex> lock(registryMutex());
+  auto leader = std::find_if(registry().begin(), registry().end(),
+                             [this](PedestrianSFMPlugin* ped) { return ped->world_ == world_; });
+  if (leader == registry().end() || *leader != this || states_pub_.getNumSubscribers() == 0)
+    return;
+
+  pedsim_msgs::TrackedPersonsPtr states(new pedsim_msgs::TrackedPersons);
+  states->header.stamp = ros::Time::now();
+  states->header.frame_id = "map";
+  for (auto ped : registry())
+  {
+    // pedestrians still waiting for their time delay have no state yet
+    if (ped->world_ != world_ || !ped->pose_init_)
+      continue;
+
+    pedsim_msgs::TrackedPerson person;
+    person.track_id = ped->actor_->GetId();
+    person.detection_id = person.track_id;
+    person.is_occluded = false;
+    person.is_matched = true;
+    person.pose.pose.position.x = ped->px_;
+    person.pose.pose.position.y = ped->py_;
+    person.pose.pose.position.z = ped->pz_;
+    // theta_ is the yaw of the actor mesh, which is turned by 90 degrees
+    tf2::Quaternion q;
+    q.setRPY(0, 0, ped->theta_ - 1.5707);
+    tf2::convert(q, person.pose.pose.orientation);
+    person.twist.twist.linear.x = ped->vx_;
+    person.twist.twist.linear.y = ped->vy_;
+    states->tracks.push_back(person);
+  }
+
+  // published as a shared pointer, subscribers in this process (the visualizer) get it without serialization
+  states_pub_.publish(states);
+}
@@ -18,7 +18,9 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <thread>
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/Twist.h>
 #include <tf2/utils.h>
@@ -35,7 +37,6 @@
 #include <visualization_msgs/MarkerArray.h>
 #include <pedsim_msgs/TrackedPersons.h>
 #include <pedsim_msgs/TrackedPerson.h>
-#include <gazebo_sfm_plugin/ped_state.h>
 
 namespace gazebo
 {
@@ -61,33 +62,35 @@ public:
 
   /**
    * @brief Publish pedestrians visualization information
+   * @param states  states of all pedestrians, published by the SFM plugins every tick
    */
-  void publishPedVisuals();
+  void publishPedVisuals(const pedsim_msgs::TrackedPersons::ConstPtr& states);
 
 private:
   /**
-   * @brief Function that is called every update cycle.
-   * @param _info Timing information.
+   * @brief Serve the pedestrian state subscription, away from the Gazebo update thread.
    */
-  void OnUpdate(const common::UpdateInfo& _info);
+  void queueThread();
 
 private:
   // Gazebo ROS node
   std::unique_ptr<ros::NodeHandle> node_;
   // topic publisher
   ros::Publisher ped_visual_pub_;
+  // pedestrian states subscriber with its own callback queue and thread
+  ros::Subscriber ped_states_sub_;
+  ros::CallbackQueue queue_;
+  std::thread queue_thread_;
   // Pointer to the parent actor.
   physics::ActorPtr actor_;
   // Pointer to the world, for convenience.
   physics::WorldPtr world_;
   // Pointer to the sdf element.
   sdf::ElementPtr sdf_;
-  // List of connections
-  std::vector<event::ConnectionPtr> connections_;
-  // Update interval
-  size_t update_interval_;
-  // Update counter
-  size_t update_cnt_;
+  // minimum time between two visualizations
+  ros::Duration update_interval_;
+  // stamp of the last visualization
+  ros::Time last_update_;
 };
 }  // namespace gazebo
 #endif
@@ -32,6 +32,12 @@ PedestrianVisualPlugin::PedestrianVisualPlugin()
  */
 PedestrianVisualPlugin::~PedestrianVisualPlugin()
 {
+  queue_.clear();
+  queue_.disable();
+  if (node_)
+    node_->shutdown();
+  if (queue_thread_.joinable())
+    queue_thread_.join();
   ped_visual_pub_.shutdown();
 }
 
@@ -59,78 +65,40 @@ void PedestrianVisualPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf
   // topic publisher
   ped_visual_pub_ = node_->advertise<pedsim_msgs::TrackedPersons>("/ped_visualization", 1);
 
-  // Bind the update callback function
-  connections_.push_back(event::Events::ConnectWorldUpdateBegin(
-      std::bind(&PedestrianVisualPlugin::OnUpdate, this, std::placeholders::_1)));
-
-  // Update rate setting
+  // Update rate setting, one visualization every 100 / update_rate physics steps as before
+  size_t update_steps = 10;
   if (sdf_->HasElement("update_rate"))
-  {
-    auto update_rate = sdf_->Get<double>("update_rate");
-    update_interval_ = std::max(size_t(1), size_t(100 / update_rate));
-  }
-  else
-    update_interval_ = 10;
-
-  update_cnt_ = 0;
+    update_steps = std::max(size_t(1), size_t(100 / sdf_->Get<double>("update_rate")));
+  update_interval_ = ros::Duration(update_steps * world_->Physics()->GetMaxStepSize());
+
+  // the states of all pedestrians arrive in one message per tick, the SFM plugins in this process hand it over
+  // without serialization
+  ros::SubscribeOptions options = ros::SubscribeOptions::create<pedsim_msgs::TrackedPersons>(
+      "/ped_states", 1, std::bind(&PedestrianVisualPlugin::publishPedVisuals, this, std::placeholders::_1),
+      ros::VoidPtr(), &queue_);
+  ped_states_sub_ = node_->subscribe(options);
+  queue_thread_ = std::thread(&PedestrianVisualPlugin::queueThread, this);
 }
 
 /**
  * @brief Publish pedestrians visualization information
+ * @param states  states of all pedestrians, published by the SFM plugins every tick
  */
-void PedestrianVisualPlugin::publishPedVisuals()
+void PedestrianVisualPlugin::publishPedVisuals(const pedsim_msgs::TrackedPersons::ConstPtr& states)
 {
-  int human_id = 0;
-
-  pedsim_msgs::TrackedPersons tracked_people;
-  std_msgs::Header msg_header;
-  msg_header.stamp = ros::Time::now();
-  msg_header.frame_id = "map";
-  tracked_people.header = msg_header;
+  // the simulation time may jump back on reset
+  if (states->header.stamp >= last_update_ && states->header.stamp - last_update_ < update_interval_)
+    return;
+  last_update_ = states->header.stamp;
 
-  for (unsigned int i = 0; i < world_->ModelCount(); ++i)
-  {
-    physics::ModelPtr model = world_->ModelByIndex(i);
-    if (((int)model->GetType() == (int)actor_->GetType()))
-    {
-      human_id++;
-      pedsim_msgs::TrackedPerson person;
-      person.track_id = human_id;
-      person.is_occluded = false;
-      person.detection_id = human_id;
-
-      ros::ServiceClient state_client = node_->serviceClient<gazebo_sfm_plugin::ped_state>(model->GetName() + "_state");
-      gazebo_sfm_plugin::ped_state model_state;
-      model_state.request.name = model->GetName();
-      state_client.call(model_state);
-
-      geometry_msgs::PoseWithCovariance pose_with_cov;
-      pose_with_cov.pose.position.x = model_state.response.px;
-      pose_with_cov.pose.position.y = model_state.response.py;
-      pose_with_cov.pose.position.z = model_state.response.pz;
-      tf2::Quaternion q;
-      q.setRPY(0, 0, model_state.response.theta - 1.57);
-      tf2::convert(q, pose_with_cov.pose.orientation);
-      person.pose = pose_with_cov;
-
-      geometry_msgs::TwistWithCovariance twist_with_cov;
-      twist_with_cov.twist.linear.x = model_state.response.vx;
-      twist_with_cov.twist.linear.y = model_state.response.vy;
-      person.twist = twist_with_cov;
-
-      tracked_people.tracks.push_back(person);
-    }
-  }
-  ped_visual_pub_.publish(tracked_people);
+  ped_visual_pub_.publish(states);
 }
 
 /**
- * @brief Function that is called every update cycle.
- * @param _info Timing information.
+ * @brief Serve the pedestrian state subscription, away from the Gazebo update thread.
  */
-void PedestrianVisualPlugin::OnUpdate(const common::UpdateInfo& _info)
+void PedestrianVisualPlugin::queueThread()
 {
-  update_cnt_ = update_cnt_ % update_interval_ + 1;
-  if (update_cnt_ == 1)
-    publishPedVisuals();
+  while (node_->ok())
+    queue_.callAvailable(ros::WallDuration(0.01));
 }
@@ -0,0 +1,184 @@
+/******************************************************************************
+ * Copyright (c) 2023, NKU Mobile & Flying Robotics Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 'AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+// Times DynamicVoronoi (and thereby BucketPrioQueue) on an occupancy map without ROS.
+// usage: voronoi_benchmark <map.pgm> [occupied_thresh=0.65] [incremental_steps=200]
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dynamicvoronoi.h"
+
+namespace
+{
+bool loadPGM(const std::string& file, double occupied_thresh, int& nx, int& ny, std::vector<bool>& occupied)
+{
+  std::ifstream in(file, std::ios::binary);
+  std::string magic;
+  in >> magic;
+  if (magic != "P5")
+  {
+    return false;
+  }
+
+  int values[3];
+  for (int k = 0; k < 3;)
+  {
+    in >> std::ws;
+    if (in.peek() == '#')
+    {
+      std::string comment;
+      std::getline(in, comment);
+      continue;
+    }
+    if (!(in >> values[k++]))
+    {
+      return false;
+    }
+  }
+  in.get();
+
+  nx = values[0];
+  ny = values[1];
+  std::vector<unsigned char> pixels(nx * ny);
+  if (!in.read(reinterpret_cast<char*>(pixels.data()), pixels.size()))
+  {
+    return false;
+  }
+
+  // image rows run top-down, the costmap runs bottom-up
+  occupied.assign(nx * ny, false);
+  for (int y = 0; y < ny; y++)
+  {
+    for (int x = 0; x < nx; x++)
+    {
+      double occ = (values[2] - pixels[(ny - 1 - y) * nx + x]) / static_cast<double>(values[2]);
+      occupied[y * nx + x] = occ > occupied_thresh || x == 0 || y == 0 || x == nx - 1 || y == ny - 1;
+    }
+  }
+  return true;
+}
+
+double msSince(const std::chrono::steady_clock::time_point& t)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    std::cerr << "usage: " << argv[0] << " <map.pgm> [occupied_thresh=0.65] [incremental_steps=200]" << std::endl;
+    return 1;
+  }
+  const double occupied_thresh = argc > 2 ? atof(argv[2]) : 0.65;
+  const int steps = argc > 3 ? atoi(argv[3]) : 200;
+
+  int nx, ny;
+  std::vector<bool> occupied;
+  if (!loadPGM(argv[1], occupied_thresh, nx, ny, occupied))
+  {
+    std::cerr << "failed to load " << argv[1] << std::endl;
+    return 1;
+  }
+
+  DynamicVoronoi voronoi;
+  auto t = std::chrono::steady_clock::now();
+  if (!voronoi.initializeEmpty(nx, ny))
+  {
+    std::cerr << "map " << nx << "x" << ny << " is too large for DynamicVoronoi" << std::endl;
+    return 1;
+  }
+  for (int y = 0; y < ny; y++)
+  {
+    for (int x = 0; x < nx; x++)
+    {
+      if (occupied[y * nx + x])
+      {
+        voronoi.occupyCell(x, y);
+      }
+    }
+  }
+  voronoi.update();
+  voronoi.prune();
+  printf("map %dx%d, incremental full build: %.3f ms\n", nx, ny, msSince(t));
+
+  std::unique_ptr<bool[]> grid(new bool[nx * ny]);
+  for (int i = 0; i < nx * ny; i++)
+  {
+    grid[i] = occupied[i];
+  }
+  t = std::chrono::steady_clock::now();
+  voronoi.initializeMapBatch(nx, ny, grid.get());
+  voronoi.update();
+  voronoi.prune();
+  printf("map %dx%d, batch full build: %.3f ms\n", nx, ny, msSince(t));
+
+  // a 6x6 cell "pedestrian" hopping through free space, the typical steady-state change set
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> ux(1, nx - 8), uy(1, ny - 8);
+  std::vector<IntPoint> blob;
+  t = std::chrono::steady_clock::now();
+  for (int s = 0; s < steps; s++)
+  {
+    for (const IntPoint& p : blob)
+    {
+      voronoi.clearCell(p.x, p.y);
+    }
+    blob.clear();
+
+    const int bx = ux(rng), by = uy(rng);
+    for (int y = by; y < by + 6; y++)
+    {
+      for (int x = bx; x < bx + 6; x++)
+      {
+        if (!occupied[y * nx + x])
+        {
+          voronoi.occupyCell(x, y);
+          blob.push_back(IntPoint(x, y));
+        }
+      }
+    }
+    voronoi.update();
+    voronoi.prune();
+  }
+  printf("incremental update + prune: %.3f ms/step over %d steps\n", msSince(t) / steps, steps);
+
+  return 0;
+}
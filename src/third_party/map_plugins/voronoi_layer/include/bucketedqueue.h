@@ -13,6 +13,11 @@
  *  The individual buckets are unsorted, which increases efficiency if these groups are large.
  *  The elements are assumed to be integer coordinates, and the priorities are assumed
  *  to be squared Euclidean distances (integers).
+ *
+ *  Buckets live in a flat array indexed directly by priority and keep their storage
+ *  between uses; a cursor tracks the lowest non-empty bucket (Dial's algorithm).
+ *  Priorities may be pushed below the cursor, which then moves back. Priorities of
+ *  maxFlatPriority and above (e.g. INT_MAX for unreachable cells) go to a sorted overflow map.
  */
 
 template <typename T>
@@ -20,17 +25,9 @@ class BucketPrioQueue {
 
 public:
   //! Standard constructor
-  /** Standard constructor. When called for the first time it creates a look up table
-   *  that maps square distances to bucket numbers, which might take some time...
-   */
   BucketPrioQueue();
 
-
-  void clear() {
-    buckets.clear();
-    count = 0;
-    nextPop = buckets.end();
-  }
+  void clear();
 
   //! Checks whether the Queue is empty
   bool empty();
@@ -40,19 +37,31 @@ public:
   T pop();
 
   int size() { return count; }
-  int getNumBuckets() { return buckets.size(); }
+  int getNumBuckets();
+
+  int getTopPriority();
 
-  int getTopPriority(){
-    return nextPop->first;
-  }
+  //! largest priority that is stored in the flat bucket array
+  static const int maxFlatPriority = 1 << 20;
 
 private:
+  //! FIFO bucket that keeps its capacity when drained
+  struct Bucket {
+    std::vector<T> items;
+    size_t head;
+    Bucket() : head(0) {}
+    bool empty() const { return head == items.size(); }
+  };
 
   int count;
+  int flatCount;
+  int nextPop;
+  int maxUsed;
+
+  std::vector<Bucket> buckets;
 
-  typedef std::map< int, std::queue<T> > BucketType;
-  BucketType buckets;
-  typename BucketType::iterator nextPop;
+  typedef std::map< int, std::queue<T> > OverflowType;
+  OverflowType overflow;
 };
 
 #include "bucketedqueue.hxx"
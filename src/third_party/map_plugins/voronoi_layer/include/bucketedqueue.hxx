@@ -6,7 +6,23 @@
 
 template <class T>
 BucketPrioQueue<T>::BucketPrioQueue() {
-  clear();
+  count = 0;
+  flatCount = 0;
+  nextPop = 0;
+  maxUsed = -1;
+}
+
+template <class T>
+void BucketPrioQueue<T>::clear() {
+  for (int i=0; i<=maxUsed; i++) {
+    buckets[i].items.clear();
+    buckets[i].head = 0;
+  }
+  overflow.clear();
+  count = 0;
+  flatCount = 0;
+  nextPop = 0;
+  maxUsed = -1;
 }
 
 template <class T>
@@ -14,25 +30,64 @@ bool BucketPrioQueue<T>::empty() {
   return (count==0);
 }
 
+template <class T>
+int BucketPrioQueue<T>::getNumBuckets() {
+  int n = overflow.size();
+  for (int i=nextPop; i<=maxUsed; i++) if (!buckets[i].empty()) n++;
+  return n;
+}
+
+template <class T>
+int BucketPrioQueue<T>::getTopPriority() {
+  if (flatCount==0) return overflow.begin()->first;
+  while (buckets[nextPop].empty()) nextPop++;
+  return nextPop;
+}
 
 template <class T>
 void BucketPrioQueue<T>::push(int prio, T t) {
-  buckets[prio].push(t);
-  if (nextPop == buckets.end() || prio < nextPop->first) nextPop = buckets.find(prio);
+  assert(prio >= 0);
   count++;
+  if (prio >= maxFlatPriority) {
+    overflow[prio].push(t);
+    return;
+  }
+
+  if (prio >= (int)buckets.size()) {
+    // grow geometrically so that a slowly rising maximum does not reallocate every push
+    int n = prio + prio/2 + 1;
+    if (n > maxFlatPriority) n = maxFlatPriority;
+    buckets.resize(n);
+  }
+  buckets[prio].items.push_back(t);
+  if (prio > maxUsed) maxUsed = prio;
+  if (flatCount==0 || prio < nextPop) nextPop = prio;
+  flatCount++;
 }
 
 template <class T>
 T BucketPrioQueue<T>::pop() {
-  while (nextPop!=buckets.end() && nextPop->second.empty()) ++nextPop;
-
-  T p = nextPop->second.front();
-  nextPop->second.pop();
-  if (nextPop->second.empty()) {
-    typename BucketType::iterator it = nextPop;
-    nextPop++;
-    buckets.erase(it);
-  }
   count--;
+  if (flatCount==0) {
+    typename OverflowType::iterator it = overflow.begin();
+    T p = it->second.front();
+    it->second.pop();
+    if (it->second.empty()) overflow.erase(it);
+    return p;
+  }
+
+  while (buckets[nextPop].empty()) nextPop++;
+
+  Bucket& b = buckets[nextPop];
+  T p = b.items[b.head++];
+  if (b.empty()) {
+    b.items.clear();
+    b.head = 0;
+  }
+  flatCount--;
+  if (flatCount==0) {
+    nextPop = 0;
+    maxUsed = -1;
+  }
   return p;
 }
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <limits.h>
 #include <queue>
+#include <vector>
 
 #include "bucketedqueue.h"
 
@@ -17,10 +18,16 @@ public:
   DynamicVoronoi();
   ~DynamicVoronoi();
 
-  //! Initialization with an empty map
-  void initializeEmpty(int _sizeX, int _sizeY, bool initGridMap=true);
-  //! Initialization with a given binary map (false==free, true==occupied)
-  void initializeMap(int _sizeX, int _sizeY, bool** _gridMap);
+  //! Initialization with an empty map. Returns false and leaves the object unchanged if a side is not positive or not
+  //! below invalidObstData cells, the largest size the obstacle coordinates can address. The same holds for the other
+  //! initializations.
+  bool initializeEmpty(int _sizeX, int _sizeY, bool initGridMap=true);
+  //! Initialization with a given binary map (false==free, true==occupied), the map is copied
+  bool initializeMap(int _sizeX, int _sizeY, bool** _gridMap);
+  //! Initialization with a given row-major binary map (index y*sizeX+x). Instead of the incremental brushfire, the
+  //! distance map comes from an exact Euclidean distance transform and the diagram from a local test on every cell,
+  //! both split across numThreads threads (0 == all cores). Later updates continue incrementally from this state.
+  bool initializeMapBatch(int _sizeX, int _sizeY, const bool* _gridMap, int numThreads=0);
 
   //! add an obstacle at the specified cell coordinate
   void occupyCell(int x, int y);
@@ -33,10 +40,10 @@ public:
   void update(bool updateRealDist=true);
   //! prune the Voronoi diagram
   void prune();
-  //! prune the Voronoi diagram by globally revisiting all Voronoi nodes. Takes more time but gives a more sparsely pruned Voronoi graph. You need to call this after every call to udpate()
+  //! prune the Voronoi diagram by revisiting Voronoi nodes. Gives a more sparsely pruned Voronoi graph. You need to call this after every call to udpate(). The first call visits the whole map, later calls only the cells changed by update() and prune() since then and their neighbours.
   void updateAlternativePrunedDiagram();
-  //! retrieve the alternatively pruned diagram. see updateAlternativePrunedDiagram()
-  int** alternativePrunedDiagram() const {
+  //! retrieve the alternatively pruned diagram (row-major, index y*sizeX+x). see updateAlternativePrunedDiagram()
+  const int* alternativePrunedDiagram() const {
     return alternativeDiagram;
   };
   //! retrieve the number of neighbors that are Voronoi nodes (4-connected)
@@ -53,20 +60,32 @@ public:
   //! write the current distance map and voronoi diagram as ppm file
   void visualize(const char* filename="result.ppm");
 
+  //! bounds (inclusive) of the cells whose distance or diagram state changed since the last resetChangedBounds(), the
+  //! whole map after an initialization. minX > maxX if nothing changed.
+  void getChangedBounds(int& minX, int& minY, int& maxX, int& maxY) const {
+    minX = changedMinX; minY = changedMinY; maxX = changedMaxX; maxY = changedMaxY;
+  }
+  void resetChangedBounds() {
+    changedMinX = changedMinY = INT_MAX;
+    changedMaxX = changedMaxY = -1;
+  }
+
   //! returns the horizontal size of the workspace/map
   unsigned int getSizeX() const {return sizeX;}
   //! returns the vertical size of the workspace/map
   unsigned int getSizeY() const {return sizeY;}
 
 private:
+  //! packed into 16 bytes so that four cells share a cache line
   struct dataCell {
     float dist;
-    char voronoi;
-    char queueing;
-    int obstX;
-    int obstY;
-    bool needsRaise;
     int sqdist;
+    short obstX;
+    short obstY;
+    signed char voronoi;
+    unsigned char queueing : 3;
+    unsigned char needsRaise : 1;
+    unsigned char dirty : 1;
   };
 
   typedef enum {voronoiKeep=-4, freeQueued = -3, voronoiRetry=-2, voronoiPrune=-1, free=0, occupied=1} State;
@@ -84,11 +103,37 @@ private:
   void commitAndColorize(bool updateRealDist=true);
   inline void reviveVoroNeighbors(int &x, int &y);
 
-  inline bool isOccupied(int &x, int &y, dataCell &c);
+  inline bool isOccupied(int x, int y, const dataCell &c) const;
+  inline dataCell& cellAt(int x, int y) { return data[y*sizeX+x]; }
+  inline void markChanged(int x, int y) {
+    if (x < changedMinX) changedMinX = x;
+    if (x > changedMaxX) changedMaxX = x;
+    if (y < changedMinY) changedMinY = y;
+    if (y > changedMaxY) changedMaxY = y;
+  }
+  //! remember a changed cell for the next updateAlternativePrunedDiagram(), c is the cell at x,y
+  inline void markDirty(int x, int y, dataCell& c) {
+    markChanged(x,y);
+    if (!alternativeDiagram || c.dirty) return;
+    c.dirty = true;
+    dirtyCells.push_back(INTPOINT(x,y));
+  }
+  inline const dataCell& cellAt(int x, int y) const { return data[y*sizeX+x]; }
   inline markerMatchResult markerMatch(int x, int y);
   inline bool markerMatchAlternative(int x, int y);
+  //! the same test on the 8 neighbour values, top row first, left to right
+  static bool markerMatchAlternative(const int* values);
   inline int getVoronoiPruneValence(int x, int y);
 
+  void computeColumnObstacles(int x0, int x1, std::vector<int>& colObstY);
+  void computeRowDistances(int y0, int y1, const std::vector<int>& colObstY);
+  void extractVoronoiCells(int y0, int y1);
+
+  void alternativePruneGlobal();
+  void alternativePruneIncremental();
+  //! value of x,y in the alternative diagram when the prune queue pops the entry (sqdist, phase, scan)
+  int alternativeValueAt(int x, int y, int sqdist, int phase, int scan) const;
+
   // queues
 
   BucketPrioQueue<INTPOINT> open;
@@ -98,13 +143,14 @@ private:
   std::vector<INTPOINT> removeList;
   std::vector<INTPOINT> addList;
   std::vector<INTPOINT> lastObstacles;
+  std::vector<INTPOINT> dirtyCells;
+  int changedMinX, changedMinY, changedMaxX, changedMaxY;
 
-  // maps
+  // maps, stored row-major (index y*sizeX+x) like the costmap
   int sizeY;
   int sizeX;
-  dataCell** data;
-  bool** gridMap;
-  bool allocatedGridMap;
+  dataCell* data;
+  bool* gridMap;
 
   // parameters
   int padding;
@@ -113,7 +159,13 @@ private:
   double sqrt2;
 
   //  dataCell** getData(){ return data; }
-  int** alternativeDiagram;
+  int* alternativeDiagram;
+  //! stages of the last alternative pruning: after the first and second keep pass and after the prune queue
+  std::vector<signed char> altPass1, altPass2, altQueued;
+  //! prune queue entries of every cell and their outcome
+  std::vector<unsigned char> altEvents;
+  //! scratch flags of the incremental pruning
+  std::vector<unsigned short> altMarks;
 };
 
 
@@ -32,7 +32,9 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
+#include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 
 #include "costmap_2d/GenericPluginConfig.h"
@@ -46,31 +48,159 @@
 
 namespace costmap_2d
 {
+/**
+ * @brief Read-only copy of the Voronoi diagram handed out to planners, cells are stored row-major (y * size_x + x).
+ *        With export_clearance enabled it doubles as a clearance field: the obstacle distance plus its gradient.
+ */
+struct VoronoiSnapshot
+{
+  unsigned long version = 0;
+  unsigned int size_x = 0;
+  unsigned int size_y = 0;
+  double resolution = 0.0;
+  double origin_x = 0.0;
+  double origin_y = 0.0;
+  std::vector<float> dist;                // distance to the closest obstacle in cells
+  std::vector<unsigned char> is_voronoi;  // whether the cell is part of the pruned diagram
+  std::vector<float> grad_x, grad_y;      // gradient of dist, empty unless export_clearance is set
+
+  // coarse companion diagram built from the max-pooled occupancy, empty unless coarse_factor is set.
+  // Coarse cell (cx, cy) covers the cells [cx * coarse_factor, (cx + 1) * coarse_factor) and likewise in y.
+  unsigned int coarse_factor = 1;
+  unsigned int coarse_size_x = 0;
+  unsigned int coarse_size_y = 0;
+  std::vector<float> coarse_dist;                // distance to the closest obstacle in coarse cells
+  std::vector<unsigned char> coarse_is_voronoi;  // whether the coarse cell is part of the pruned coarse diagram
+
+  float getDistance(unsigned int x, unsigned int y) const
+  {
+    return dist[y * size_x + x];
+  }
+  bool isVoronoi(unsigned int x, unsigned int y) const
+  {
+    return is_voronoi[y * size_x + x];
+  }
+  bool hasGradient() const
+  {
+    return !grad_x.empty();
+  }
+  /**
+   * @brief distance to the closest obstacle in meters
+   */
+  double getClearance(unsigned int x, unsigned int y) const
+  {
+    return dist[y * size_x + x] * resolution;
+  }
+  /**
+   * @brief direction of increasing clearance, (0, 0) on ridges, plateaus and the map border
+   */
+  void getClearanceGradient(unsigned int x, unsigned int y, double& gx, double& gy) const
+  {
+    gx = grad_x[y * size_x + x];
+    gy = grad_y[y * size_x + x];
+  }
+  bool hasCoarse() const
+  {
+    return !coarse_dist.empty();
+  }
+  bool isCoarseVoronoi(unsigned int cx, unsigned int cy) const
+  {
+    return coarse_is_voronoi[cy * coarse_size_x + cx];
+  }
+  /**
+   * @brief distance from a coarse cell to the closest (pooled) obstacle in meters, a lower bound of the fine one
+   */
+  double getCoarseClearance(unsigned int cx, unsigned int cy) const
+  {
+    return coarse_dist[cy * coarse_size_x + cx] * resolution * coarse_factor;
+  }
+};
+
 class VoronoiLayer : public Layer
 {
 public:
   VoronoiLayer() = default;
-  virtual ~VoronoiLayer() = default;
+  virtual ~VoronoiLayer();
 
   void onInitialize() override;
   void updateBounds(double robot_x, double robot_y, double robot_yaw, double* min_x, double* min_y, double* max_x,
                     double* max_y) override;
   void updateCosts(costmap_2d::Costmap2D& master_grid, int min_i, int min_j, int max_i, int max_j) override;
+
+  /**
+   * @brief Latest finished diagram, never blocks on the update thread. Null until the first update is done.
+   */
+  boost::shared_ptr<const VoronoiSnapshot> getSnapshot() const;
+
+  /**
+   * @brief Snapshot of the first Voronoi layer in a layered costmap, null if there is none or it is not ready yet
+   */
+  static boost::shared_ptr<const VoronoiSnapshot> getSnapshot(costmap_2d::LayeredCostmap* layered_costmap);
+
+  /**
+   * @brief Live diagram, only valid while holding getMutex(). The update thread holds it for a whole update.
+   */
   const DynamicVoronoi& getVoronoi() const;
   boost::mutex& getMutex();
 
 private:
-  void publishVoronoiGrid(const costmap_2d::Costmap2D& master_grid);
+  void updateThread();
+  void rebuildCoarse(const bool* grid, unsigned int size_x, unsigned int size_y);
+  void updateCoarse(const std::vector<unsigned int>& changed_cells, unsigned int size_x);
+  void publishSnapshot(double resolution, double origin_x, double origin_y);
+  static void computeGradient(VoronoiSnapshot& snapshot, int min_x, int min_y, int max_x, int max_y);
+  void publishVoronoiGrid(const VoronoiSnapshot& snapshot);
   void outlineMap(unsigned char* costarr, int nx, int ny, unsigned char value);
+  void diffLethalMask(const unsigned char* costarr, unsigned int nx, int min_i, int min_j, int max_i, int max_j);
 
   void reconfigureCB(const costmap_2d::GenericPluginConfig& config, uint32_t level);
   std::unique_ptr<dynamic_reconfigure::Server<costmap_2d::GenericPluginConfig>> dsrv_ = nullptr;
   ros::Publisher voronoi_grid_pub_;
+  double visualize_frequency_ = 1.0;
+  bool export_clearance_ = false;
+  bool alternative_pruning_ = false;
+  int coarse_factor_ = 0;
+  ros::WallTime last_visualize_time_;
 
+  // owned by the update thread, guarded by mutex_
   DynamicVoronoi voronoi_;
+  DynamicVoronoi coarse_voronoi_;
+  std::vector<unsigned char> coarse_flags_;
+  boost::mutex mutex_;
+  boost::thread update_thread_;
+
+  // costmap thread state
   unsigned int last_size_x_ = 0;
   unsigned int last_size_y_ = 0;
-  boost::mutex mutex_;
+  double last_origin_x_ = 0.0;
+  double last_origin_y_ = 0.0;
+  bool need_full_update_ = true;
+
+  // change set handed from the costmap thread to the update thread, guarded by changes_mutex_
+  boost::mutex changes_mutex_;
+  boost::condition_variable changes_cond_;
+  bool stop_ = false;
+  bool rebuild_pending_ = false;
+  unsigned int size_x_ = 0;
+  unsigned int size_y_ = 0;
+  double resolution_ = 0.0;
+  double origin_x_ = 0.0;
+  double origin_y_ = 0.0;
+  // occupancy (0/1) of every cell as last seen in the costmap, row-major like the costmap
+  std::vector<unsigned char> lethal_mask_;
+  // cells whose occupancy changed since the update thread last looked, flagged to keep the list unique
+  std::vector<unsigned int> pending_cells_;
+  std::vector<unsigned char> pending_flags_;
+
+  // double buffered result, the spare buffer is reused once no planner holds it anymore
+  mutable boost::mutex snapshot_mutex_;
+  boost::shared_ptr<VoronoiSnapshot> snapshot_;
+  boost::shared_ptr<VoronoiSnapshot> spare_snapshot_;
+  // cells changed by the update published last, the spare buffer lacks them (update thread only)
+  int last_changed_min_x_ = 0;
+  int last_changed_min_y_ = 0;
+  int last_changed_max_x_ = INT_MAX;
+  int last_changed_max_y_ = INT_MAX;
 };
 
 }  // namespace costmap_2d
@@ -1,58 +1,45 @@
 #include "dynamicvoronoi.h"
 
 #include <math.h>
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <thread>
 
 DynamicVoronoi::DynamicVoronoi() {
   sqrt2 = sqrt(2.0);
+  sizeX = 0;
+  sizeY = 0;
   data = NULL;
   gridMap = NULL;
   alternativeDiagram = NULL;
-  allocatedGridMap = false;
+  resetChangedBounds();
 }
 
 DynamicVoronoi::~DynamicVoronoi() {
-  if (data) {
-    for (int x=0; x<sizeX; x++) delete[] data[x];
-    delete[] data;
-  }
-  if (allocatedGridMap && gridMap) {
-    for (int x=0; x<sizeX; x++) delete[] gridMap[x];
-    delete[] gridMap;
-  }
+  delete[] data;
+  delete[] gridMap;
+  delete[] alternativeDiagram;
 }
 
-void DynamicVoronoi::initializeEmpty(int _sizeX, int _sizeY, bool initGridMap) {
-  if (data) {
-    for (int x=0; x<sizeX; x++) delete[] data[x];
-    delete[] data;
-    data = NULL;
-  }
-  if(alternativeDiagram){
-    for (int x=0; x<sizeX; x++) delete[] alternativeDiagram[x];
-    delete[] alternativeDiagram;
-    alternativeDiagram = NULL;
-  }
-  if (initGridMap) {
-    if (allocatedGridMap && gridMap) {
-      for (int x=0; x<sizeX; x++) delete[] gridMap[x];
-      delete[] gridMap;
-      gridMap = NULL;
-      allocatedGridMap = false;
-    }
-  }
+bool DynamicVoronoi::initializeEmpty(int _sizeX, int _sizeY, bool initGridMap) {
+  // obstacle coordinates are stored in shorts, a larger map would silently wrap them
+  if (_sizeX <= 0 || _sizeY <= 0 || _sizeX >= invalidObstData || _sizeY >= invalidObstData) return false;
 
+  delete[] alternativeDiagram;
+  alternativeDiagram = NULL;
+  dirtyCells.clear();
 
+  // a single row-major block, reallocated only if the number of cells changes
+  if (!data || _sizeX*_sizeY != sizeX*sizeY) {
+    delete[] data;
+    delete[] gridMap;
+    data = new dataCell[_sizeX*_sizeY];
+    gridMap = new bool[_sizeX*_sizeY];
+    initGridMap = true;
+  }
   sizeX = _sizeX;
   sizeY = _sizeY;
-  data = new dataCell*[sizeX];
-  for (int x=0; x<sizeX; x++) data[x] = new dataCell[sizeY];
-
-  if (initGridMap) {
-    gridMap = new bool*[sizeX];
-    for (int x=0; x<sizeX; x++) gridMap[x] = new bool[sizeY];
-    allocatedGridMap = true;
-  }
 
   dataCell c;
   c.dist = INFINITY;
@@ -62,24 +49,26 @@ void DynamicVoronoi::initializeEmpty(int _sizeX, int _sizeY, bool initGridMap) {
   c.voronoi = free;
   c.queueing = fwNotQueued;
   c.needsRaise = false;
+  c.dirty = false;
 
-  for (int x=0; x<sizeX; x++)
-    for (int y=0; y<sizeY; y++) data[x][y] = c;
+  std::fill(data, data + sizeX*sizeY, c);
 
-  if (initGridMap) {
-    for (int x=0; x<sizeX; x++)
-      for (int y=0; y<sizeY; y++) gridMap[x][y] = 0;
-  }
+  if (initGridMap) std::fill(gridMap, gridMap + sizeX*sizeY, false);
+  markChanged(0,0);
+  markChanged(sizeX-1,sizeY-1);
+  return true;
 }
 
-void DynamicVoronoi::initializeMap(int _sizeX, int _sizeY, bool** _gridMap) {
-  gridMap = _gridMap;
-  initializeEmpty(_sizeX, _sizeY, false);
+bool DynamicVoronoi::initializeMap(int _sizeX, int _sizeY, bool** _gridMap) {
+  if (!initializeEmpty(_sizeX, _sizeY, true)) return false;
+  for (int y=0; y<sizeY; y++) {
+    for (int x=0; x<sizeX; x++) gridMap[y*sizeX+x] = _gridMap[x][y];
+  }
 
-  for (int x=0; x<sizeX; x++) {
-    for (int y=0; y<sizeY; y++) {
-      if (gridMap[x][y]) {
-        dataCell c = data[x][y];
+  for (int y=0; y<sizeY; y++) {
+    for (int x=0; x<sizeX; x++) {
+      if (gridMap[y*sizeX+x]) {
+        dataCell c = cellAt(x,y);
         if (!isOccupied(x,y,c)) {
 
           bool isSurrounded = true;
@@ -91,7 +80,7 @@ void DynamicVoronoi::initializeMap(int _sizeX, int _sizeY, bool** _gridMap) {
               int ny = y+dy;
               if (ny<=0 || ny>=sizeY-1) continue;
 
-              if (!gridMap[nx][ny]) {
+              if (!gridMap[ny*sizeX+nx]) {
                 isSurrounded = false;
                 break;
               }
@@ -104,42 +93,190 @@ void DynamicVoronoi::initializeMap(int _sizeX, int _sizeY, bool** _gridMap) {
             c.dist=0;
             c.voronoi=occupied;
             c.queueing = fwProcessed;
-            data[x][y] = c;
+            cellAt(x,y) = c;
           } else setObstacle(x,y);
         }
       }
     }
   }
+  return true;
+}
+
+namespace {
+//! run f(begin, end) on numThreads contiguous slices of [0, n)
+template <typename F>
+void parallelSlices(int n, int numThreads, F f) {
+  if (numThreads <= 1 || n < 2*numThreads) {
+    f(0, n);
+    return;
+  }
+  std::vector<std::thread> workers;
+  for (int t=1; t<numThreads; t++) {
+    workers.push_back(std::thread(f, (long)n*t/numThreads, (long)n*(t+1)/numThreads));
+  }
+  f(0, n/numThreads);
+  for (unsigned int t=0; t<workers.size(); t++) workers[t].join();
+}
+}
+
+bool DynamicVoronoi::initializeMapBatch(int _sizeX, int _sizeY, const bool* _gridMap, int numThreads) {
+  if (!initializeEmpty(_sizeX, _sizeY, false)) return false;
+  std::copy(_gridMap, _gridMap + sizeX*sizeY, gridMap);
+
+  if (numThreads <= 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+  // pass 1: nearest obstacle row within each column, threads own vertical strips
+  std::vector<int> colObstY(sizeX*sizeY);
+  parallelSlices(sizeX, numThreads, [&](int x0, int x1) { computeColumnObstacles(x0, x1, colObstY); });
+
+  // pass 2: lower envelope of parabolas along each row gives the exact squared distance and the obstacle
+  parallelSlices(sizeY, numThreads, [&](int y0, int y1) { computeRowDistances(y0, y1, colObstY); });
+
+  // the diagram only depends on the obstacle data of a cell and its neighbours, so row bands are independent
+  parallelSlices(sizeY, numThreads, [&](int y0, int y1) { extractVoronoiCells(y0, y1); });
+
+  for (int y=1; y<sizeY-1; y++) {
+    for (int x=1; x<sizeX-1; x++) {
+      const dataCell& c = cellAt(x,y);
+      if (c.voronoi == free && c.obstX != invalidObstData) pruneQueue.push(INTPOINT(x,y));
+    }
+  }
+  return true;
+}
+
+void DynamicVoronoi::computeColumnObstacles(int x0, int x1, std::vector<int>& colObstY) {
+  // row by row so that every pass streams through the row-major map
+  for (int y=0; y<sizeY; y++) {
+    for (int x=x0; x<x1; x++) {
+      int i = y*sizeX+x;
+      if (gridMap[i]) colObstY[i] = y;
+      else colObstY[i] = (y > 0) ? colObstY[i-sizeX] : -1;
+    }
+  }
+  for (int y=sizeY-2; y>=0; y--) {
+    for (int x=x0; x<x1; x++) {
+      int i = y*sizeX+x;
+      int below = colObstY[i+sizeX];
+      if (below < 0) continue;
+      if (colObstY[i] < 0 || below - y < y - colObstY[i]) colObstY[i] = below;
+    }
+  }
+}
+
+void DynamicVoronoi::computeRowDistances(int y0, int y1, const std::vector<int>& colObstY) {
+  std::vector<int> v(sizeX);
+  std::vector<double> z(sizeX);
+  std::vector<long long> f(sizeX);
+
+  for (int y=y0; y<y1; y++) {
+    const int* g = &colObstY[y*sizeX];
+
+    // Felzenszwalb & Huttenlocher, skipping columns without any obstacle
+    int k = -1;
+    for (int q=0; q<sizeX; q++) {
+      if (g[q] < 0) continue;
+      f[q] = (long long)(y-g[q])*(y-g[q]);
+      double s = -INFINITY;
+      while (k >= 0) {
+        int p = v[k];
+        s = ((f[q] + (long long)q*q) - (f[p] + (long long)p*p)) / (2.0*(q-p));
+        if (s <= z[k]) k--;
+        else break;
+      }
+      if (k < 0) s = -INFINITY;
+      k++;
+      v[k] = q;
+      z[k] = s;
+    }
+    if (k < 0) continue;
+
+    int j = 0;
+    for (int x=0; x<sizeX; x++) {
+      while (j < k && z[j+1] <= x) j++;
+      int q = v[j];
+
+      dataCell& c = cellAt(x,y);
+      if (gridMap[y*sizeX+x]) {
+        c.dist = 0;
+        c.sqdist = 0;
+        c.obstX = x;
+        c.obstY = y;
+        c.voronoi = occupied;
+        c.queueing = fwProcessed;
+      } else if (x > 0 && x < sizeX-1 && y > 0 && y < sizeY-1) {
+        // like the brushfire, the border ring is only ever written for obstacles
+        c.sqdist = (x-q)*(x-q) + (int)f[q];
+        c.dist = sqrt((double) c.sqdist);
+        c.obstX = q;
+        c.obstY = g[q];
+        c.voronoi = occupied;
+        c.queueing = fwProcessed;
+      }
+    }
+  }
+}
+
+void DynamicVoronoi::extractVoronoiCells(int y0, int y1) {
+  // same test as checkVoro(), evaluated from the point of view of (x,y) only
+  for (int y=std::max(y0,1); y<std::min(y1,sizeY-1); y++) {
+    for (int x=1; x<sizeX-1; x++) {
+      dataCell& c = cellAt(x,y);
+      if (c.sqdist <= 2 || c.obstX == invalidObstData) continue;
+
+      bool isVoro = false;
+      for (int dx=-1; dx<=1 && !isVoro; dx++) {
+        int nx = x+dx;
+        if (nx<=0 || nx>=sizeX-1) continue;
+        for (int dy=-1; dy<=1; dy++) {
+          if (dx==0 && dy==0) continue;
+          int ny = y+dy;
+          if (ny<=0 || ny>=sizeY-1) continue;
+          const dataCell& nc = cellAt(nx,ny);
+          if (nc.obstX == invalidObstData) continue;
+          if (abs(c.obstX-nc.obstX) <= 1 && abs(c.obstY-nc.obstY) <= 1) continue;
+
+          int stability_xy = (x-nc.obstX)*(x-nc.obstX) + (y-nc.obstY)*(y-nc.obstY) - c.sqdist;
+          int stability_nxy = (nx-c.obstX)*(nx-c.obstX) + (ny-c.obstY)*(ny-c.obstY) - nc.sqdist;
+          if (stability_xy < 0 || stability_nxy < 0) continue;
+          if (stability_xy <= stability_nxy) {
+            isVoro = true;
+            break;
+          }
+        }
+      }
+      if (isVoro) c.voronoi = free;
+    }
+  }
 }
 
 void DynamicVoronoi::occupyCell(int x, int y) {
-  gridMap[x][y] = 1;
+  gridMap[y*sizeX+x] = 1;
   setObstacle(x,y);
 }
 void DynamicVoronoi::clearCell(int x, int y) {
-  gridMap[x][y] = 0;
+  gridMap[y*sizeX+x] = 0;
   removeObstacle(x,y);
 }
 
 void DynamicVoronoi::setObstacle(int x, int y) {
-  dataCell c = data[x][y];
+  dataCell c = cellAt(x,y);
   if(isOccupied(x,y,c)) return;
 
   addList.push_back(INTPOINT(x,y));
   c.obstX = x;
   c.obstY = y;
-  data[x][y] = c;
+  cellAt(x,y) = c;
 }
 
 void DynamicVoronoi::removeObstacle(int x, int y) {
-  dataCell c = data[x][y];
+  dataCell c = cellAt(x,y);
   if(isOccupied(x,y,c) == false) return;
 
   removeList.push_back(INTPOINT(x,y));
   c.obstX = invalidObstData;
   c.obstY  = invalidObstData;
   c.queueing = bwQueued;
-  data[x][y] = c;
+  cellAt(x,y) = c;
 }
 
 void DynamicVoronoi::exchangeObstacles(std::vector<INTPOINT>& points) {
@@ -148,7 +285,7 @@ void DynamicVoronoi::exchangeObstacles(std::vector<INTPOINT>& points) {
     int x = lastObstacles[i].x;
     int y = lastObstacles[i].y;
 
-    bool v = gridMap[x][y];
+    bool v = gridMap[y*sizeX+x];
     if (v) continue;
     removeObstacle(x,y);
   }
@@ -158,7 +295,7 @@ void DynamicVoronoi::exchangeObstacles(std::vector<INTPOINT>& points) {
   for (unsigned int i=0; i<points.size(); i++) {
     int x = points[i].x;
     int y = points[i].y;
-    bool v = gridMap[x][y];
+    bool v = gridMap[y*sizeX+x];
     if (v) continue;
     setObstacle(x,y);
     lastObstacles.push_back(points[i]);
@@ -173,7 +310,7 @@ void DynamicVoronoi::update(bool updateRealDist) {
     INTPOINT p = open.pop();
     int x = p.x;
     int y = p.y;
-    dataCell c = data[x][y];
+    dataCell c = cellAt(x,y);
 
     if(c.queueing==fwProcessed) continue;
 
@@ -186,9 +323,9 @@ void DynamicVoronoi::update(bool updateRealDist) {
           if (dx==0 && dy==0) continue;
           int ny = y+dy;
           if (ny<=0 || ny>=sizeY-1) continue;
-          dataCell nc = data[nx][ny];
+          dataCell nc = cellAt(nx,ny);
           if (nc.obstX!=invalidObstData && !nc.needsRaise) {
-            if(!isOccupied(nc.obstX,nc.obstY,data[nc.obstX][nc.obstY])) {
+            if(!isOccupied(nc.obstX,nc.obstY,cellAt(nc.obstX,nc.obstY))) {
               open.push(nc.sqdist, INTPOINT(nx,ny));
               nc.queueing = fwQueued;
               nc.needsRaise = true;
@@ -196,12 +333,13 @@ void DynamicVoronoi::update(bool updateRealDist) {
               nc.obstY = invalidObstData;
               if (updateRealDist) nc.dist = INFINITY;
               nc.sqdist = INT_MAX;
-              data[nx][ny] = nc;
+              markDirty(nx,ny,nc);
+              cellAt(nx,ny) = nc;
             } else {
               if(nc.queueing != fwQueued){
                 open.push(nc.sqdist, INTPOINT(nx,ny));
                 nc.queueing = fwQueued;
-                data[nx][ny] = nc;
+                cellAt(nx,ny) = nc;
               }
             }
           }
@@ -209,13 +347,14 @@ void DynamicVoronoi::update(bool updateRealDist) {
       }
       c.needsRaise = false;
       c.queueing = bwProcessed;
-      data[x][y] = c;
+      cellAt(x,y) = c;
     }
-    else if (c.obstX != invalidObstData && isOccupied(c.obstX,c.obstY,data[c.obstX][c.obstY])) {
+    else if (c.obstX != invalidObstData && isOccupied(c.obstX,c.obstY,cellAt(c.obstX,c.obstY))) {
 
       // LOWER
       c.queueing = fwProcessed;
       c.voronoi = occupied;
+      markDirty(x,y,c);
 
       for (int dx=-1; dx<=1; dx++) {
         int nx = x+dx;
@@ -224,14 +363,14 @@ void DynamicVoronoi::update(bool updateRealDist) {
           if (dx==0 && dy==0) continue;
           int ny = y+dy;
           if (ny<=0 || ny>=sizeY-1) continue;
-          dataCell nc = data[nx][ny];
+          dataCell nc = cellAt(nx,ny);
           if(!nc.needsRaise) {
             int distx = nx-c.obstX;
             int disty = ny-c.obstY;
             int newSqDistance = distx*distx + disty*disty;
             bool overwrite =  (newSqDistance < nc.sqdist);
             if(!overwrite && newSqDistance==nc.sqdist) {
-              if (nc.obstX == invalidObstData || isOccupied(nc.obstX,nc.obstY,data[nc.obstX][nc.obstY])==false) overwrite = true;
+              if (nc.obstX == invalidObstData || isOccupied(nc.obstX,nc.obstY,cellAt(nc.obstX,nc.obstY))==false) overwrite = true;
             }
             if (overwrite) {
               open.push(newSqDistance, INTPOINT(nx,ny));
@@ -242,30 +381,31 @@ void DynamicVoronoi::update(bool updateRealDist) {
               nc.sqdist = newSqDistance;
               nc.obstX = c.obstX;
               nc.obstY = c.obstY;
+              markDirty(nx,ny,nc);
             } else {
               checkVoro(x,y,nx,ny,c,nc);
             }
-            data[nx][ny] = nc;
+            cellAt(nx,ny) = nc;
           }
         }
       }
     }
-    data[x][y] = c;
+    cellAt(x,y) = c;
   }
 }
 
 float DynamicVoronoi::getDistance( int x, int y ) const {
-  if( (x>0) && (x<sizeX) && (y>0) && (y<sizeY)) return data[x][y].dist;
+  if( (x>0) && (x<sizeX) && (y>0) && (y<sizeY)) return cellAt(x,y).dist;
   else return -INFINITY;
 }
 
 bool DynamicVoronoi::isVoronoi( int x, int y ) const {
-  dataCell c = data[x][y];
+  dataCell c = cellAt(x,y);
   return (c.voronoi==free || c.voronoi==voronoiKeep);
 }
 
 bool DynamicVoronoi::isVoronoiAlternative(int x, int y) const {
-  int v = alternativeDiagram[x][y];
+  int v = alternativeDiagram[y*sizeX+x];
   return (v == free || v == voronoiKeep);
 }
 
@@ -275,7 +415,7 @@ void DynamicVoronoi::commitAndColorize(bool updateRealDist) {
     INTPOINT p = addList[i];
     int x = p.x;
     int y = p.y;
-    dataCell c = data[x][y];
+    dataCell c = cellAt(x,y);
 
     if(c.queueing != fwQueued){
       if (updateRealDist) c.dist = 0;
@@ -284,7 +424,8 @@ void DynamicVoronoi::commitAndColorize(bool updateRealDist) {
       c.obstY = y;
       c.queueing = fwQueued;
       c.voronoi = occupied;
-      data[x][y] = c;
+      markDirty(x,y,c);
+      cellAt(x,y) = c;
       open.push(0, INTPOINT(x,y));
     }
   }
@@ -294,14 +435,15 @@ void DynamicVoronoi::commitAndColorize(bool updateRealDist) {
     INTPOINT p = removeList[i];
     int x = p.x;
     int y = p.y;
-    dataCell c = data[x][y];
+    dataCell c = cellAt(x,y);
 
     if (isOccupied(x,y,c)==true) continue; // obstacle was removed and reinserted
     open.push(0, INTPOINT(x,y));
     if (updateRealDist) c.dist  = INFINITY;
     c.sqdist = INT_MAX;
     c.needsRaise = true;
-    data[x][y] = c;
+    markDirty(x,y,c);
+    cellAt(x,y) = c;
   }
   removeList.clear();
   addList.clear();
@@ -330,6 +472,7 @@ void DynamicVoronoi::checkVoro(int x, int y, int nx, int ny, dataCell& c, dataCe
       if(stability_xy <= stability_nxy && c.sqdist>2) {
         if (c.voronoi != free) {
           c.voronoi = free;
+          markDirty(x,y,c);
           reviveVoroNeighbors(x,y);
           pruneQueue.push(INTPOINT(x,y));
         }
@@ -337,6 +480,7 @@ void DynamicVoronoi::checkVoro(int x, int y, int nx, int ny, dataCell& c, dataCe
       if(stability_nxy <= stability_xy && nc.sqdist>2) {
         if (nc.voronoi != free) {
           nc.voronoi = free;
+          markDirty(nx,ny,nc);
           reviveVoroNeighbors(nx,ny);
           pruneQueue.push(INTPOINT(nx,ny));
         }
@@ -354,10 +498,11 @@ void DynamicVoronoi::reviveVoroNeighbors(int &x, int &y) {
       if (dx==0 && dy==0) continue;
       int ny = y+dy;
       if (ny<=0 || ny>=sizeY-1) continue;
-      dataCell nc = data[nx][ny];
+      dataCell nc = cellAt(nx,ny);
       if (nc.sqdist != INT_MAX && !nc.needsRaise && (nc.voronoi == voronoiKeep || nc.voronoi == voronoiPrune)) {
         nc.voronoi = free;
-        data[nx][ny] = nc;
+        markDirty(nx,ny,nc);
+        cellAt(nx,ny) = nc;
         pruneQueue.push(INTPOINT(nx,ny));
       }
     }
@@ -366,11 +511,11 @@ void DynamicVoronoi::reviveVoroNeighbors(int &x, int &y) {
 
 
 bool DynamicVoronoi::isOccupied(int x, int y) const {
-  dataCell c = data[x][y];
+  dataCell c = cellAt(x,y);
   return (c.obstX==x && c.obstY==y);
 }
 
-bool DynamicVoronoi::isOccupied(int &x, int &y, dataCell &c) {
+bool DynamicVoronoi::isOccupied(int x, int y, const dataCell &c) const {
   return (c.obstX==x && c.obstY==y);
 }
 
@@ -388,7 +533,7 @@ void DynamicVoronoi::visualize(const char *filename) {
   for(int y = sizeY-1; y >=0; y--){
     for(int x = 0; x<sizeX; x++){
       unsigned char c = 0;
-      if (alternativeDiagram!=NULL && (alternativeDiagram[x][y] == free || alternativeDiagram[x][y]==voronoiKeep)) {
+      if (alternativeDiagram!=NULL && (alternativeDiagram[y*sizeX+x] == free || alternativeDiagram[y*sizeX+x]==voronoiKeep)) {
         fputc( 255, F );
         fputc( 0, F );
         fputc( 0, F );
@@ -396,12 +541,12 @@ void DynamicVoronoi::visualize(const char *filename) {
         fputc( 0, F );
         fputc( 0, F );
         fputc( 255, F );
-      } else if (data[x][y].sqdist==0) {
+      } else if (cellAt(x,y).sqdist==0) {
         fputc( 0, F );
         fputc( 0, F );
         fputc( 0, F );
       } else {
-        float f = 80+(sqrt(data[x][y].sqdist)*10);
+        float f = 80+(sqrt(cellAt(x,y).sqdist)*10);
         if (f>255) f=255;
         if (f<0) f=0;
         c = (unsigned char)f;
@@ -423,58 +568,63 @@ void DynamicVoronoi::prune() {
     int x = p.x;
     int y = p.y;
 
-    if (data[x][y].voronoi==occupied) continue;
-    if (data[x][y].voronoi==freeQueued) continue;
+    if (cellAt(x,y).voronoi==occupied) continue;
+    if (cellAt(x,y).voronoi==freeQueued) continue;
 
-    data[x][y].voronoi = freeQueued;
-    sortedPruneQueue.push(data[x][y].sqdist, p);
+    cellAt(x,y).voronoi = freeQueued;
+    markDirty(x,y,cellAt(x,y));
+    sortedPruneQueue.push(cellAt(x,y).sqdist, p);
 
     /* tl t tr
        l c r
        bl b br */
 
     dataCell tr,tl,br,bl;
-    tr = data[x+1][y+1];
-    tl = data[x-1][y+1];
-    br = data[x+1][y-1];
-    bl = data[x-1][y-1];
+    tr = cellAt(x+1,y+1);
+    tl = cellAt(x-1,y+1);
+    br = cellAt(x+1,y-1);
+    bl = cellAt(x-1,y-1);
 
     dataCell r,b,t,l;
-    r = data[x+1][y];
-    l = data[x-1][y];
-    t = data[x][y+1];
-    b = data[x][y-1];
+    r = cellAt(x+1,y);
+    l = cellAt(x-1,y);
+    t = cellAt(x,y+1);
+    b = cellAt(x,y-1);
 
     if (x+2<sizeX && r.voronoi==occupied) {
       // fill to the right
-      if (tr.voronoi!=occupied && br.voronoi!=occupied && data[x+2][y].voronoi!=occupied) {
+      if (tr.voronoi!=occupied && br.voronoi!=occupied && cellAt(x+2,y).voronoi!=occupied) {
         r.voronoi = freeQueued;
+        markDirty(x+1,y,r);
         sortedPruneQueue.push(r.sqdist, INTPOINT(x+1,y));
-        data[x+1][y] = r;
+        cellAt(x+1,y) = r;
       }
     }
     if (x-2>=0 && l.voronoi==occupied) {
       // fill to the left
-      if (tl.voronoi!=occupied && bl.voronoi!=occupied && data[x-2][y].voronoi!=occupied) {
+      if (tl.voronoi!=occupied && bl.voronoi!=occupied && cellAt(x-2,y).voronoi!=occupied) {
         l.voronoi = freeQueued;
+        markDirty(x-1,y,l);
         sortedPruneQueue.push(l.sqdist, INTPOINT(x-1,y));
-        data[x-1][y] = l;
+        cellAt(x-1,y) = l;
       }
     }
     if (y+2<sizeY && t.voronoi==occupied) {
       // fill to the top
-      if (tr.voronoi!=occupied && tl.voronoi!=occupied && data[x][y+2].voronoi!=occupied) {
+      if (tr.voronoi!=occupied && tl.voronoi!=occupied && cellAt(x,y+2).voronoi!=occupied) {
         t.voronoi = freeQueued;
+        markDirty(x,y+1,t);
         sortedPruneQueue.push(t.sqdist, INTPOINT(x,y+1));
-        data[x][y+1] = t;
+        cellAt(x,y+1) = t;
       }
     }
     if (y-2>=0 && b.voronoi==occupied) {
       // fill to the bottom
-      if (br.voronoi!=occupied && bl.voronoi!=occupied && data[x][y-2].voronoi!=occupied) {
+      if (br.voronoi!=occupied && bl.voronoi!=occupied && cellAt(x,y-2).voronoi!=occupied) {
         b.voronoi = freeQueued;
+        markDirty(x,y-1,b);
         sortedPruneQueue.push(b.sqdist, INTPOINT(x,y-1));
-        data[x][y-1] = b;
+        cellAt(x,y-1) = b;
       }
     }
   }
@@ -482,7 +632,7 @@ void DynamicVoronoi::prune() {
 
   while(!sortedPruneQueue.empty()) {
     INTPOINT p = sortedPruneQueue.pop();
-    dataCell c = data[p.x][p.y];
+    dataCell c = cellAt(p.x,p.y);
     int v = c.voronoi;
     if (v!=freeQueued && v!=voronoiRetry) { // || v>free || v==voronoiPrune || v==voronoiKeep) {
       //      assert(v!=retry);
@@ -497,72 +647,109 @@ void DynamicVoronoi::prune() {
       //      printf("RETRY %d %d\n", x, sizeY-1-y);
       pruneQueue.push(p);
     }
-    data[p.x][p.y] = c;
+    markDirty(p.x,p.y,c);
+    cellAt(p.x,p.y) = c;
 
     if (sortedPruneQueue.empty()) {
       while (!pruneQueue.empty()) {
         INTPOINT p = pruneQueue.front();
         pruneQueue.pop();
-        sortedPruneQueue.push(data[p.x][p.y].sqdist, p);
+        sortedPruneQueue.push(cellAt(p.x,p.y).sqdist, p);
       }
     }
   }
   //  printf("match: %d\nnomat: %d\n", matchCount, noMatchCount);
 }
 
-void DynamicVoronoi::updateAlternativePrunedDiagram() {
-
-  if(alternativeDiagram==NULL){
-    alternativeDiagram = new int*[sizeX];
-    for(int x=0; x<sizeX; x++){
-      alternativeDiagram[x] = new int[sizeY];
-    }
+namespace {
+// bits of altEvents: the cell entered the prune queue in phase i (0 the first scan, 1 and 2 the keep passes), and
+// that entry pruned it
+const unsigned char altPushed = 1;
+const unsigned char altPruned = 8;
+// bits of altMarks, all zero between calls
+enum {markPass1=1, markPass2=2, markInput=4, markEvent=8, markSeed=64, markVisited=128, markRemoved=256};
+
+//! an entry of the prune queue: popped by sqdist, then in push order (phase, then x-outer scan index)
+struct AltEvent {
+  int sqdist;
+  int phase;
+  int scan;
+  bool operator<(const AltEvent& o) const {
+    if (sqdist!=o.sqdist) return sqdist<o.sqdist;
+    if (phase!=o.phase) return phase<o.phase;
+    return scan<o.scan;
   }
+  bool operator>(const AltEvent& o) const { return o<*this; }
+};
+
+inline bool isAltVoronoi(int v) {
+  return v==0 || v==-4;
+}
+}
+
+void DynamicVoronoi::updateAlternativePrunedDiagram() {
+  if (alternativeDiagram==NULL) alternativePruneGlobal();
+  else alternativePruneIncremental();
+}
 
+void DynamicVoronoi::alternativePruneGlobal() {
+  int size = sizeX*sizeY;
+  alternativeDiagram = new int[size];
+  for (int i=0; i<size; i++) alternativeDiagram[i] = data[i].voronoi;
+  altEvents.assign(size, 0);
+  altMarks.assign(size, 0);
+  for (unsigned int i=0; i<dirtyCells.size(); i++) cellAt(dirtyCells[i].x,dirtyCells[i].y).dirty = false;
+  dirtyCells.clear();
+  markChanged(0,0);
+  markChanged(sizeX-1,sizeY-1);
 
   std::queue<INTPOINT> end_cells;
   BucketPrioQueue<INTPOINT> sortedPruneQueue;
   for(int x=1; x<sizeX-1; x++){
     for(int y=1; y<sizeY-1; y++){
-      dataCell& c = data[x][y];
-	alternativeDiagram[x][y] = c.voronoi;
+      dataCell& c = cellAt(x,y);
+	alternativeDiagram[y*sizeX+x] = c.voronoi;
 	if(c.voronoi <=free){
 	  sortedPruneQueue.push(c.sqdist, INTPOINT(x,y));
 	  end_cells.push(INTPOINT(x, y));
+	  altEvents[y*sizeX+x] |= altPushed;
 	}
     }
   }
 
-  for(int x=1; x<sizeX-1; x++){
-    for(int y=1; y<sizeY-1; y++){
-      if( getNumVoronoiNeighborsAlternative(x, y) >= 3){
-	alternativeDiagram[x][y] = voronoiKeep;
-	sortedPruneQueue.push(data[x][y].sqdist, INTPOINT(x,y));
-	end_cells.push(INTPOINT(x, y));
-      }
-    }
-  }
-
-  for(int x=1; x<sizeX-1; x++){
-    for(int y=1; y<sizeY-1; y++){
-      if( getNumVoronoiNeighborsAlternative(x, y) >= 3){
-	alternativeDiagram[x][y] = voronoiKeep;
-	sortedPruneQueue.push(data[x][y].sqdist, INTPOINT(x,y));
-	end_cells.push(INTPOINT(x, y));
+  for (int pass=1; pass<=2; pass++) {
+    for(int x=1; x<sizeX-1; x++){
+      for(int y=1; y<sizeY-1; y++){
+	if( getNumVoronoiNeighborsAlternative(x, y) >= 3){
+	  alternativeDiagram[y*sizeX+x] = voronoiKeep;
+	  sortedPruneQueue.push(cellAt(x,y).sqdist, INTPOINT(x,y));
+	  end_cells.push(INTPOINT(x, y));
+	  altEvents[y*sizeX+x] |= altPushed<<pass;
+	}
       }
     }
+    (pass==1 ? altPass1 : altPass2).assign(alternativeDiagram, alternativeDiagram+size);
   }
 
 
   while (!sortedPruneQueue.empty()) {
     INTPOINT p = sortedPruneQueue.pop();
+    int i = p.y*sizeX+p.x;
+
+    // entries of one cell leave the queue in push order
+    int phase = 0;
+    while (!(altEvents[i] & altPushed<<phase) || (altMarks[i] & markEvent<<phase)) phase++;
+    altMarks[i] |= markEvent<<phase;
 
     if (markerMatchAlternative(p.x, p.y)) {
-      alternativeDiagram[p.x][p.y]=voronoiPrune;
+      alternativeDiagram[i]=voronoiPrune;
+      altEvents[i] |= altPruned<<phase;
     } else {
-  alternativeDiagram[p.x][p.y]=voronoiKeep;
+  alternativeDiagram[i]=voronoiKeep;
     }
   }
+  altMarks.assign(size, 0);
+  altQueued.assign(alternativeDiagram, alternativeDiagram+size);
 
   // //delete worms
   while (!end_cells.empty()) {
@@ -570,7 +757,7 @@ void DynamicVoronoi::updateAlternativePrunedDiagram() {
     end_cells.pop();
 
     if (isVoronoiAlternative(p.x,p.y) && getNumVoronoiNeighborsAlternative(p.x, p.y) == 1) {
-      alternativeDiagram[p.x][p.y] = voronoiPrune;
+      alternativeDiagram[p.y*sizeX+p.x] = voronoiPrune;
 
       for (int dx = -1; dx <= 1; ++dx) {
         for (int dy = -1; dy <= 1; ++dy) {
@@ -593,23 +780,272 @@ void DynamicVoronoi::updateAlternativePrunedDiagram() {
   }
 }
 
+int DynamicVoronoi::alternativeValueAt(int x, int y, int sqdist, int phase, int scan) const {
+  int i = y*sizeX+x;
+  unsigned char ev = altEvents[i];
+  if (ev) {
+    AltEvent t = {sqdist, phase, scan};
+    AltEvent k = {data[i].sqdist, 0, x*sizeY+y};
+    for (k.phase=2; k.phase>=0; k.phase--) {
+      if ((ev & altPushed<<k.phase) && k<t) return (ev & altPruned<<k.phase) ? voronoiPrune : voronoiKeep;
+    }
+  }
+  return altPass2[i];
+}
+
+void DynamicVoronoi::alternativePruneIncremental() {
+  // Replays the global pass on the cells whose inputs changed: the keep passes in scan order, the prune queue in pop
+  // order against the recorded outcome of the other entries, and the worm deletion on every touched component of the
+  // diagram. The result is the one alternativePruneGlobal() would give.
+  std::vector<int> inputs;   // cells whose value, sqdist or queue entries changed, later every re-evaluated cell
+  std::vector<int> seeds;    // cells whose queue entries or value after the prune queue changed
+  std::priority_queue<int, std::vector<int>, std::greater<int> > pass1, pass2;  // x-outer scan indices
+
+  auto addInput = [&](int i) {
+    if (altMarks[i] & markInput) return;
+    altMarks[i] |= markInput;
+    inputs.push_back(i);
+  };
+  auto addSeed = [&](int i) {
+    if (altMarks[i] & markSeed) return;
+    altMarks[i] |= markSeed;
+    seeds.push_back(i);
+  };
+  auto queuePass = [&](std::priority_queue<int, std::vector<int>, std::greater<int> >& q, int mark, int x, int y) {
+    if (x<=0 || x>=sizeX-1 || y<=0 || y>=sizeY-1) return;
+    int i = y*sizeX+x;
+    if (altMarks[i] & mark) return;
+    altMarks[i] |= mark;
+    q.push(x*sizeY+y);
+  };
+  auto setPushed = [&](int i, unsigned char mask, unsigned char pushed) {
+    if ((altEvents[i] & mask) == pushed) return;
+    altEvents[i] = (altEvents[i] & ~(mask | mask<<3)) | pushed;
+    addInput(i);
+    addSeed(i);
+  };
+
+  for (unsigned int k=0; k<dirtyCells.size(); k++) {
+    int x = dirtyCells[k].x;
+    int y = dirtyCells[k].y;
+    int i = y*sizeX+x;
+    dataCell& c = data[i];
+    c.dirty = false;
+    if (x<=0 || x>=sizeX-1 || y<=0 || y>=sizeY-1) {
+      // border cells keep their value through all passes
+      if (altPass2[i]==c.voronoi) continue;
+      altPass1[i] = altPass2[i] = c.voronoi;
+      addInput(i);
+      for (int pass=0; pass<2; pass++) {
+        queuePass(pass ? pass2 : pass1, pass ? markPass2 : markPass1, x-1, y);
+        queuePass(pass ? pass2 : pass1, pass ? markPass2 : markPass1, x+1, y);
+        queuePass(pass ? pass2 : pass1, pass ? markPass2 : markPass1, x, y-1);
+        queuePass(pass ? pass2 : pass1, pass ? markPass2 : markPass1, x, y+1);
+      }
+    } else {
+      addInput(i);
+      queuePass(pass1, markPass1, x, y);
+      queuePass(pass1, markPass1, x-1, y);
+      queuePass(pass1, markPass1, x, y-1);
+    }
+  }
+  dirtyCells.clear();
+
+  // keep passes: cells before (x,y) in the scan already hold this pass's value, the others the previous one
+  while (!pass1.empty()) {
+    int x = pass1.top()/sizeY;
+    int y = pass1.top()%sizeY;
+    pass1.pop();
+    int i = y*sizeX+x;
+    altMarks[i] &= ~markPass1;
+    int count = isAltVoronoi(altPass1[i-1]) + isAltVoronoi(altPass1[i-sizeX]) +
+                isAltVoronoi(data[i+1].voronoi) + isAltVoronoi(data[i+sizeX].voronoi);
+    setPushed(i, altPushed | altPushed<<1, (data[i].voronoi<=free ? altPushed : 0) | (count>=3 ? altPushed<<1 : 0));
+    signed char v = count>=3 ? (signed char)voronoiKeep : data[i].voronoi;
+    if (v==altPass1[i]) continue;
+    altPass1[i] = v;
+    queuePass(pass1, markPass1, x+1, y);
+    queuePass(pass1, markPass1, x, y+1);
+    queuePass(pass2, markPass2, x, y);
+    queuePass(pass2, markPass2, x-1, y);
+    queuePass(pass2, markPass2, x, y-1);
+  }
+  while (!pass2.empty()) {
+    int x = pass2.top()/sizeY;
+    int y = pass2.top()%sizeY;
+    pass2.pop();
+    int i = y*sizeX+x;
+    altMarks[i] &= ~markPass2;
+    int count = isAltVoronoi(altPass2[i-1]) + isAltVoronoi(altPass2[i-sizeX]) +
+                isAltVoronoi(altPass1[i+1]) + isAltVoronoi(altPass1[i+sizeX]);
+    setPushed(i, altPushed<<2, count>=3 ? altPushed<<2 : 0);
+    signed char v = count>=3 ? (signed char)voronoiKeep : altPass1[i];
+    if (v==altPass2[i]) continue;
+    altPass2[i] = v;
+    addInput(i);
+    queuePass(pass2, markPass2, x+1, y);
+    queuePass(pass2, markPass2, x, y+1);
+  }
+
+  // prune queue: an entry depends on the 8 neighbours as they were when it was popped
+  std::priority_queue<AltEvent, std::vector<AltEvent>, std::greater<AltEvent> > events;
+  auto queueEvents = [&](int x, int y, const AltEvent* after) {
+    int i = y*sizeX+x;
+    for (int phase=0; phase<3; phase++) {
+      if (!(altEvents[i] & altPushed<<phase) || (altMarks[i] & markEvent<<phase)) continue;
+      AltEvent e = {data[i].sqdist, phase, x*sizeY+y};
+      if (after && !(*after<e)) continue;
+      altMarks[i] |= markEvent<<phase;
+      events.push(e);
+    }
+  };
+  auto queueNeighborEvents = [&](int x, int y, const AltEvent* after) {
+    for (int dx=-1; dx<=1; dx++) {
+      for (int dy=-1; dy<=1; dy++) {
+        int nx = x+dx;
+        int ny = y+dy;
+        if ((dx || dy) && nx>0 && nx<sizeX-1 && ny>0 && ny<sizeY-1) queueEvents(nx, ny, after);
+      }
+    }
+  };
+  for (unsigned int k=0; k<inputs.size(); k++) {
+    int x = inputs[k]%sizeX;
+    int y = inputs[k]/sizeX;
+    queueEvents(x, y, NULL);
+    queueNeighborEvents(x, y, NULL);
+  }
+  while (!events.empty()) {
+    AltEvent e = events.top();
+    events.pop();
+    int x = e.scan/sizeY;
+    int y = e.scan%sizeY;
+    int i = y*sizeX+x;
+    altMarks[i] &= ~(markEvent<<e.phase);
+    addInput(i);
+
+    int v[8];
+    int n = 0;
+    for (int dy=1; dy>=-1; dy--) {
+      for (int dx=-1; dx<=1; dx++) {
+        if (dx || dy) v[n++] = alternativeValueAt(x+dx, y+dy, e.sqdist, e.phase, e.scan);
+      }
+    }
+    bool pruned = markerMatchAlternative(v);
+    if (pruned == ((altEvents[i] & altPruned<<e.phase) != 0)) continue;
+    altEvents[i] ^= altPruned<<e.phase;
+    queueNeighborEvents(x, y, &e);
+  }
+  for (unsigned int k=0; k<inputs.size(); k++) {
+    int i = inputs[k];
+    altMarks[i] &= ~markInput;
+    int v = alternativeValueAt(i%sizeX, i/sizeX, INT_MAX, 3, 0);
+    if (v==altQueued[i]) continue;
+    altQueued[i] = v;
+    addSeed(i);
+  }
+
+  // worm deletion is confined to a 4-connected component of the diagram, replay it on every component next to a
+  // seed with the component's queue entries in their global order
+  std::vector<int> visited;
+  std::vector<int> component;
+  std::vector<std::pair<int,int> > order;
+  std::queue<int> end_cells;
+  auto isVoro = [&](int i) { return isAltVoronoi(altQueued[i]) && !(altMarks[i] & markRemoved); };
+  auto countVoro = [&](int i) {
+    int x = i%sizeX;
+    int y = i/sizeX;
+    return (x>0 && isVoro(i-1)) + (x<sizeX-1 && isVoro(i+1)) + (y>0 && isVoro(i-sizeX)) + (y<sizeY-1 && isVoro(i+sizeX));
+  };
+  auto setFinal = [&](int i, int v) {
+    if (alternativeDiagram[i]==v) return;
+    alternativeDiagram[i] = v;
+    markChanged(i%sizeX, i/sizeX);
+  };
+  for (unsigned int k=0; k<seeds.size(); k++) {
+    int s = seeds[k];
+    altMarks[s] &= ~markSeed;
+    int sx = s%sizeX;
+    int sy = s/sizeX;
+    for (int d=0; d<5; d++) {
+      int x = sx + (d==1) - (d==2);
+      int y = sy + (d==3) - (d==4);
+      if (x<0 || x>=sizeX || y<0 || y>=sizeY) continue;
+      int start = y*sizeX+x;
+      if (altMarks[start] & markVisited) continue;
+      altMarks[start] |= markVisited;
+      visited.push_back(start);
+      if (!isAltVoronoi(altQueued[start])) {
+        setFinal(start, altQueued[start]);
+        continue;
+      }
+
+      component.assign(1, start);
+      order.clear();
+      for (unsigned int j=0; j<component.size(); j++) {
+        int i = component[j];
+        int cx = i%sizeX;
+        int cy = i/sizeX;
+        for (int phase=0; phase<3; phase++) {
+          if (altEvents[i] & altPushed<<phase) order.push_back(std::make_pair(phase, cx*sizeY+cy));
+        }
+        int nb[4] = {cx>0 ? i-1 : -1, cx<sizeX-1 ? i+1 : -1, cy>0 ? i-sizeX : -1, cy<sizeY-1 ? i+sizeX : -1};
+        for (int m=0; m<4; m++) {
+          if (nb[m]<0 || (altMarks[nb[m]] & markVisited) || !isAltVoronoi(altQueued[nb[m]])) continue;
+          altMarks[nb[m]] |= markVisited;
+          visited.push_back(nb[m]);
+          component.push_back(nb[m]);
+        }
+      }
+      std::sort(order.begin(), order.end());
+      for (unsigned int j=0; j<order.size(); j++) {
+        end_cells.push((order[j].second%sizeY)*sizeX + order[j].second/sizeY);
+      }
+      while (!end_cells.empty()) {
+        int i = end_cells.front();
+        end_cells.pop();
+        if (!isVoro(i) || countVoro(i)!=1) continue;
+        altMarks[i] |= markRemoved;
+        int cx = i%sizeX;
+        int cy = i/sizeX;
+        int nb[4] = {cx>0 ? i-1 : -1, cx<sizeX-1 ? i+1 : -1, cy>0 ? i-sizeX : -1, cy<sizeY-1 ? i+sizeX : -1};
+        for (int m=0; m<4; m++) {
+          if (nb[m]>=0 && isVoro(nb[m]) && countVoro(nb[m])==1) end_cells.push(nb[m]);
+        }
+      }
+      for (unsigned int j=0; j<component.size(); j++) {
+        int i = component[j];
+        setFinal(i, (altMarks[i] & markRemoved) ? (int)voronoiPrune : altQueued[i]);
+      }
+    }
+  }
+  for (unsigned int k=0; k<visited.size(); k++) altMarks[visited[k]] &= ~(markVisited | markRemoved);
+}
+
 bool DynamicVoronoi::markerMatchAlternative(int x, int y) {
+  int v[8];
+  int i = 0;
+  for (int dy = 1; dy >= -1; dy--) {
+    for (int dx = -1; dx <= 1; dx++) {
+      if (dx || dy) v[i++] = alternativeDiagram[(y+dy)*sizeX+x+dx];
+    }
+  }
+  return markerMatchAlternative(v);
+}
+
+bool DynamicVoronoi::markerMatchAlternative(const int* values) {
 // prune if this returns true
 
   bool f[8];
 
-  int nx, ny;
   int dx, dy;
 
   int i = 0;
 //  int obstacleCount=0;
   int voroCount = 0;
   for (dy = 1; dy >= -1; dy--) {
-    ny = y + dy;
     for (dx = -1; dx <= 1; dx++) {
       if (dx || dy) {
-        nx = x + dx;
-        int v = alternativeDiagram[nx][ny];
+        int v = values[i];
         bool b = (v <= free && v != voronoiPrune);
         //	if (v==occupied) obstacleCount++;
         f[i] = b;
@@ -656,7 +1092,7 @@ int DynamicVoronoi::getNumVoronoiNeighborsAlternative(int x, int y) const {
       if (nx < 0 || nx >= sizeX || ny < 0 || ny >= sizeY) {
         continue;
       }
-      if (alternativeDiagram[nx][ny]==free || alternativeDiagram[nx][ny]==voronoiKeep) {
+      if (alternativeDiagram[ny*sizeX+nx]==free || alternativeDiagram[ny*sizeX+nx]==voronoiKeep) {
         count++;
       }
     }
@@ -684,7 +1120,7 @@ DynamicVoronoi::markerMatchResult DynamicVoronoi::markerMatch(int x, int y) {
     for (dx=-1; dx<=1; dx++) {
       if (dx || dy) {
         nx = x+dx;
-        dataCell nc = data[nx][ny];
+        dataCell nc = cellAt(nx,ny);
         int v = nc.voronoi;
         bool b = (v<=free && v!=voronoiPrune);
         //	if (v==occupied) obstacleCount++;
@@ -712,7 +1148,7 @@ DynamicVoronoi::markerMatchResult DynamicVoronoi::markerMatch(int x, int y) {
 
 
   // keep voro cells inside of blocks and retry later
-  if (voroCount>=5 && voroCountFour>=3 && data[x][y].voronoi!=voronoiRetry) {
+  if (voroCount>=5 && voroCountFour>=3 && cellAt(x,y).voronoi!=voronoiRetry) {
     return retry;
   }
 
@@ -31,7 +31,15 @@
 
 #include "voronoi_layer.h"
 
+#include <algorithm>
 #include <chrono>  // NOLINT
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <boost/make_shared.hpp>
 
 #include "pluginlib/class_list_macros.h"
 
@@ -39,24 +47,71 @@ PLUGINLIB_EXPORT_CLASS(costmap_2d::VoronoiLayer, costmap_2d::Layer)
 
 namespace costmap_2d
 {
+VoronoiLayer::~VoronoiLayer()
+{
+  {
+    boost::unique_lock<boost::mutex> lock(changes_mutex_);
+    stop_ = true;
+  }
+  changes_cond_.notify_all();
+  if (update_thread_.joinable())
+  {
+    update_thread_.join();
+  }
+}
+
 void VoronoiLayer::onInitialize()
 {
   ros::NodeHandle nh("~/" + name_);
   current_ = true;
 
+  // the diagram message is large, publish it at its own rate (<= 0 disables it)
+  nh.param("visualize_frequency", visualize_frequency_, 1.0);
+  // also export the distance gradient so that other planners can use the snapshot as a clearance field
+  nh.param("export_clearance", export_clearance_, false);
+  // use the more sparsely pruned alternative diagram, only the cells changed by each update are revisited
+  nh.param("alternative_pruning", alternative_pruning_, false);
+  // also keep a diagram of the map max-pooled by this factor (e.g. 2 or 4) for routing on large maps, <= 1 disables it
+  nh.param("coarse_factor", coarse_factor_, 0);
   voronoi_grid_pub_ = nh.advertise<nav_msgs::OccupancyGrid>("voronoi_grid", 1);
 
   dsrv_ = std::make_unique<dynamic_reconfigure::Server<costmap_2d::GenericPluginConfig>>(nh);
   dynamic_reconfigure::Server<costmap_2d::GenericPluginConfig>::CallbackType cb =
       boost::bind(&VoronoiLayer::reconfigureCB, this, _1, _2);
   dsrv_->setCallback(cb);
+
+  update_thread_ = boost::thread(&VoronoiLayer::updateThread, this);
 }
 
 void VoronoiLayer::reconfigureCB(const costmap_2d::GenericPluginConfig& config, uint32_t level)
 {
+  if (config.enabled && !enabled_)
+  {
+    // changes made while disabled were never diffed
+    need_full_update_ = true;
+  }
   enabled_ = config.enabled;
 }
 
+boost::shared_ptr<const VoronoiSnapshot> VoronoiLayer::getSnapshot() const
+{
+  boost::unique_lock<boost::mutex> lock(snapshot_mutex_);
+  return snapshot_;
+}
+
+boost::shared_ptr<const VoronoiSnapshot> VoronoiLayer::getSnapshot(costmap_2d::LayeredCostmap* layered_costmap)
+{
+  for (auto layer = layered_costmap->getPlugins()->begin(); layer != layered_costmap->getPlugins()->end(); ++layer)
+  {
+    boost::shared_ptr<VoronoiLayer> voronoi_layer = boost::dynamic_pointer_cast<VoronoiLayer>(*layer);
+    if (voronoi_layer)
+    {
+      return voronoi_layer->getSnapshot();
+    }
+  }
+  return boost::shared_ptr<const VoronoiSnapshot>();
+}
+
 const DynamicVoronoi& VoronoiLayer::getVoronoi() const
 {
   return voronoi_;
@@ -74,6 +129,22 @@ void VoronoiLayer::updateBounds(double robot_x, double robot_y, double robot_yaw
   {
     return;
   }
+
+  // only the update window is diffed in updateCosts, so a resized or shifted map has to be swept entirely
+  Costmap2D* master = layered_costmap_->getCostmap();
+  if (master->getSizeInCellsX() != last_size_x_ || master->getSizeInCellsY() != last_size_y_ ||
+      master->getOriginX() != last_origin_x_ || master->getOriginY() != last_origin_y_)
+  {
+    need_full_update_ = true;
+  }
+
+  if (need_full_update_)
+  {
+    *min_x = std::min(*min_x, master->getOriginX());
+    *min_y = std::min(*min_y, master->getOriginY());
+    *max_x = std::max(*max_x, master->getOriginX() + master->getSizeInMetersX());
+    *max_y = std::max(*max_y, master->getOriginY() + master->getSizeInMetersY());
+  }
 }
 
 void VoronoiLayer::outlineMap(unsigned char* costarr, int nx, int ny, unsigned char value)
@@ -107,97 +178,464 @@ void VoronoiLayer::updateCosts(costmap_2d::Costmap2D& master_grid, int min_i, in
     return;
   }
 
-  boost::unique_lock<boost::mutex> lock(mutex_);
-
   unsigned int size_x = master_grid.getSizeInCellsX();
   unsigned int size_y = master_grid.getSizeInCellsY();
   outlineMap(master_grid.getCharMap(), size_x, size_y, costmap_2d::LETHAL_OBSTACLE);
 
   if (last_size_x_ != size_x || last_size_y_ != size_y)
   {
-    voronoi_.initializeEmpty(size_x, size_y);
-
     last_size_x_ = size_x;
     last_size_y_ = size_y;
+    need_full_update_ = true;
   }
 
-  std::vector<IntPoint> new_free_cells, new_occupied_cells;
-  for (unsigned int j = 0; j < size_y; ++j)
+  // only the diff happens here, the diagram itself is updated by updateThread()
   {
-    for (unsigned int i = 0; i < size_x; ++i)
+    boost::unique_lock<boost::mutex> lock(changes_mutex_);
+    size_x_ = size_x;
+    size_y_ = size_y;
+    resolution_ = master_grid.getResolution();
+    origin_x_ = master_grid.getOriginX();
+    origin_y_ = master_grid.getOriginY();
+
+    if (need_full_update_)
     {
-      if (voronoi_.isOccupied(i, j) && master_grid.getCost(i, j) == costmap_2d::FREE_SPACE)
+      const unsigned char* costarr = master_grid.getCharMap();
+      lethal_mask_.resize(size_x * size_y);
+      for (unsigned int i = 0; i < size_x * size_y; ++i)
       {
-        new_free_cells.push_back(IntPoint(i, j));
+        lethal_mask_[i] = costarr[i] == costmap_2d::LETHAL_OBSTACLE;
       }
+      pending_cells_.clear();
+      pending_flags_.assign(size_x * size_y, 0);
+      rebuild_pending_ = true;
+
+      last_origin_x_ = master_grid.getOriginX();
+      last_origin_y_ = master_grid.getOriginY();
+      need_full_update_ = false;
+    }
+    else
+    {
+      diffLethalMask(master_grid.getCharMap(), size_x, std::max(min_i, 0), std::max(min_j, 0),
+                     std::min(max_i, static_cast<int>(size_x)), std::min(max_j, static_cast<int>(size_y)));
+    }
+  }
+  changes_cond_.notify_one();
+}
+
+void VoronoiLayer::updateThread()
+{
+  std::vector<unsigned int> changed_cells;
+  std::vector<unsigned char> changed_states;
+  std::unique_ptr<bool[]> grid;
+  bool initialized = false;  // whether voronoi_ holds a diagram of the current map
 
-      if (!voronoi_.isOccupied(i, j) && master_grid.getCost(i, j) == costmap_2d::LETHAL_OBSTACLE)
+  while (true)
+  {
+    bool rebuild;
+    unsigned int size_x, size_y;
+    double resolution, origin_x, origin_y;
+    {
+      boost::unique_lock<boost::mutex> lock(changes_mutex_);
+      while (!stop_ && !rebuild_pending_ && pending_cells_.empty())
+      {
+        changes_cond_.wait(lock);
+      }
+      if (stop_)
+      {
+        return;
+      }
+
+      rebuild = rebuild_pending_;
+      size_x = size_x_;
+      size_y = size_y_;
+      resolution = resolution_;
+      origin_x = origin_x_;
+      origin_y = origin_y_;
+
+      if (rebuild)
       {
-        new_occupied_cells.push_back(IntPoint(i, j));
+        grid.reset(new bool[size_x * size_y]);
+        std::copy(lethal_mask_.begin(), lethal_mask_.end(), grid.get());
+        rebuild_pending_ = false;
       }
+      else
+      {
+        // several costmap updates may have been merged, only the latest state of each cell matters
+        changed_cells.swap(pending_cells_);
+        pending_cells_.clear();
+        changed_states.resize(changed_cells.size());
+        for (size_t i = 0; i < changed_cells.size(); ++i)
+        {
+          changed_states[i] = lethal_mask_[changed_cells[i]];
+          pending_flags_[changed_cells[i]] = 0;
+        }
+      }
+    }
+
+    {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+
+      // start timing
+      const auto start_timestamp = std::chrono::system_clock::now();
+
+      if (rebuild)
+      {
+        initialized = voronoi_.initializeMapBatch(size_x, size_y, grid.get());
+        if (!initialized)
+        {
+          // changes until the next rebuild refer to this map, so they are skipped as well
+          ROS_ERROR("Costmap of %ux%u cells is too large for the Voronoi diagram, skipping its updates", size_x,
+                    size_y);
+          continue;
+        }
+        if (coarse_factor_ > 1)
+        {
+          rebuildCoarse(grid.get(), size_x, size_y);
+        }
+      }
+      else if (!initialized)
+      {
+        continue;
+      }
+      else
+      {
+        for (size_t i = 0; i < changed_cells.size(); ++i)
+        {
+          const int x = changed_cells[i] % size_x;
+          const int y = changed_cells[i] / size_x;
+          if (changed_states[i] && !voronoi_.isOccupied(x, y))
+          {
+            voronoi_.occupyCell(x, y);
+          }
+          else if (!changed_states[i] && voronoi_.isOccupied(x, y))
+          {
+            voronoi_.clearCell(x, y);
+          }
+        }
+        if (coarse_factor_ > 1)
+        {
+          updateCoarse(changed_cells, size_x);
+        }
+      }
+
+      voronoi_.update();
+      voronoi_.prune();
+      if (alternative_pruning_)
+      {
+        voronoi_.updateAlternativePrunedDiagram();
+      }
+      if (coarse_factor_ > 1)
+      {
+        coarse_voronoi_.update();
+        coarse_voronoi_.prune();
+      }
+
+      // end timing
+      const auto end_timestamp = std::chrono::system_clock::now();
+      const std::chrono::duration<double> diff = end_timestamp - start_timestamp;
+      ROS_DEBUG("Runtime=%.3fms.", diff.count() * 1e3);
+
+      publishSnapshot(resolution, origin_x, origin_y);
+    }
+
+    if (visualize_frequency_ > 0.0 &&
+        (ros::WallTime::now() - last_visualize_time_).toSec() >= 1.0 / visualize_frequency_ &&
+        voronoi_grid_pub_.getNumSubscribers() > 0)
+    {
+      last_visualize_time_ = ros::WallTime::now();
+      publishVoronoiGrid(*getSnapshot());
+    }
+  }
+}
+
+/**
+ * @brief Build the coarse diagram from scratch, a coarse cell is occupied if any of its cells is. mutex_ must be held.
+ */
+void VoronoiLayer::rebuildCoarse(const bool* grid, unsigned int size_x, unsigned int size_y)
+{
+  const unsigned int f = coarse_factor_;
+  const unsigned int coarse_x = (size_x + f - 1) / f;
+  const unsigned int coarse_y = (size_y + f - 1) / f;
+  std::unique_ptr<bool[]> coarse_grid(new bool[coarse_x * coarse_y]());
+  for (unsigned int y = 0; y < size_y; y++)
+  {
+    bool* coarse_row = coarse_grid.get() + (y / f) * coarse_x;
+    for (unsigned int x = 0; x < size_x; x++)
+    {
+      coarse_row[x / f] |= grid[y * size_x + x];
     }
   }
+  coarse_voronoi_.initializeMapBatch(coarse_x, coarse_y, coarse_grid.get());
+  coarse_flags_.assign(coarse_x * coarse_y, 0);
+}
+
+/**
+ * @brief Re-pool the coarse cells covering the changed cells from the (already updated) fine diagram.
+ *        mutex_ must be held.
+ */
+void VoronoiLayer::updateCoarse(const std::vector<unsigned int>& changed_cells, unsigned int size_x)
+{
+  const unsigned int f = coarse_factor_;
+  const unsigned int size_y = voronoi_.getSizeY();
+  const unsigned int coarse_x = coarse_voronoi_.getSizeX();
 
-  for (size_t i = 0; i < new_free_cells.size(); ++i)
+  std::vector<unsigned int> blocks;
+  for (size_t i = 0; i < changed_cells.size(); ++i)
   {
-    voronoi_.clearCell(new_free_cells[i].x, new_free_cells[i].y);
+    const unsigned int block = (changed_cells[i] / size_x / f) * coarse_x + (changed_cells[i] % size_x) / f;
+    if (!coarse_flags_[block])
+    {
+      coarse_flags_[block] = 1;
+      blocks.push_back(block);
+    }
+  }
+
+  for (size_t i = 0; i < blocks.size(); ++i)
+  {
+    coarse_flags_[blocks[i]] = 0;
+    const unsigned int cx = blocks[i] % coarse_x;
+    const unsigned int cy = blocks[i] / coarse_x;
+    bool occupied = false;
+    for (unsigned int y = cy * f; y < std::min((cy + 1) * f, size_y) && !occupied; y++)
+    {
+      for (unsigned int x = cx * f; x < std::min((cx + 1) * f, size_x) && !occupied; x++)
+      {
+        occupied = voronoi_.isOccupied(x, y);
+      }
+    }
+
+    if (occupied && !coarse_voronoi_.isOccupied(cx, cy))
+    {
+      coarse_voronoi_.occupyCell(cx, cy);
+    }
+    else if (!occupied && coarse_voronoi_.isOccupied(cx, cy))
+    {
+      coarse_voronoi_.clearCell(cx, cy);
+    }
   }
+}
 
-  for (size_t i = 0; i < new_occupied_cells.size(); ++i)
+/**
+ * @brief Copy the diagram into the back buffer and swap it with the one planners see. Only the cells changed since the
+ *        back buffer was published are copied when it can be reused. mutex_ must be held.
+ */
+void VoronoiLayer::publishSnapshot(double resolution, double origin_x, double origin_y)
+{
+  const int size_x = voronoi_.getSizeX();
+  const int size_y = voronoi_.getSizeY();
+
+  // the back buffer holds the diagram from before the previous update, so it misses the cells changed by that one too
+  int min_x, min_y, max_x, max_y;
+  voronoi_.getChangedBounds(min_x, min_y, max_x, max_y);
+  voronoi_.resetChangedBounds();
+  int copy_min_x = std::max(std::min(min_x, last_changed_min_x_), 0);
+  int copy_min_y = std::max(std::min(min_y, last_changed_min_y_), 0);
+  int copy_max_x = std::min(std::max(max_x, last_changed_max_x_), size_x - 1);
+  int copy_max_y = std::min(std::max(max_y, last_changed_max_y_), size_y - 1);
+  last_changed_min_x_ = min_x;
+  last_changed_min_y_ = min_y;
+  last_changed_max_x_ = max_x;
+  last_changed_max_y_ = max_y;
+
+  // planners only get hold of snapshot_, so the spare buffer is free for good once nobody else references it
+  boost::shared_ptr<VoronoiSnapshot> snapshot;
+  if (spare_snapshot_ && spare_snapshot_.unique() && spare_snapshot_->size_x == static_cast<unsigned int>(size_x) &&
+      spare_snapshot_->size_y == static_cast<unsigned int>(size_y))
+  {
+    snapshot.swap(spare_snapshot_);
+  }
+  else
   {
-    voronoi_.occupyCell(new_occupied_cells[i].x, new_occupied_cells[i].y);
+    // a planner still reads the old buffer, or there is none yet
+    spare_snapshot_.reset();
+    snapshot = boost::make_shared<VoronoiSnapshot>();
+    copy_min_x = copy_min_y = 0;
+    copy_max_x = size_x - 1;
+    copy_max_y = size_y - 1;
   }
 
-  // start timing
-  const auto start_timestamp = std::chrono::system_clock::now();
+  snapshot->version = snapshot_ ? snapshot_->version + 1 : 1;
+  snapshot->size_x = size_x;
+  snapshot->size_y = size_y;
+  snapshot->resolution = resolution;
+  snapshot->origin_x = origin_x;
+  snapshot->origin_y = origin_y;
+  snapshot->dist.resize(size_x * size_y);
+  snapshot->is_voronoi.resize(size_x * size_y);
+  for (int y = copy_min_y; y <= copy_max_y; y++)
+  {
+    for (int x = copy_min_x; x <= copy_max_x; x++)
+    {
+      snapshot->dist[y * size_x + x] = voronoi_.getDistance(x, y);
+      snapshot->is_voronoi[y * size_x + x] =
+          alternative_pruning_ ? voronoi_.isVoronoiAlternative(x, y) : voronoi_.isVoronoi(x, y);
+    }
+  }
 
-  voronoi_.update();
-  voronoi_.prune();
+  if (coarse_factor_ > 1)
+  {
+    const unsigned int coarse_x = coarse_voronoi_.getSizeX();
+    const unsigned int coarse_y = coarse_voronoi_.getSizeY();
+    snapshot->coarse_factor = coarse_factor_;
+    snapshot->coarse_size_x = coarse_x;
+    snapshot->coarse_size_y = coarse_y;
+    snapshot->coarse_dist.resize(coarse_x * coarse_y);
+    snapshot->coarse_is_voronoi.resize(coarse_x * coarse_y);
+    for (unsigned int y = 0; y < coarse_y; y++)
+    {
+      for (unsigned int x = 0; x < coarse_x; x++)
+      {
+        snapshot->coarse_dist[y * coarse_x + x] = coarse_voronoi_.getDistance(x, y);
+        snapshot->coarse_is_voronoi[y * coarse_x + x] = coarse_voronoi_.isVoronoi(x, y);
+      }
+    }
+  }
 
-  // end timing
-  const auto end_timestamp = std::chrono::system_clock::now();
-  const std::chrono::duration<double> diff = end_timestamp - start_timestamp;
-  ROS_DEBUG("Runtime=%.3fms.", diff.count() * 1e3);
+  if (export_clearance_)
+  {
+    // the gradient of a cell depends on the distances of its neighbours
+    computeGradient(*snapshot, copy_min_x - 1, copy_min_y - 1, copy_max_x + 1, copy_max_y + 1);
+  }
+  else
+  {
+    snapshot->grad_x.clear();
+    snapshot->grad_y.clear();
+  }
 
-  publishVoronoiGrid(master_grid);
+  boost::unique_lock<boost::mutex> lock(snapshot_mutex_);
+  spare_snapshot_.swap(snapshot_);
+  snapshot_.swap(snapshot);
 }
 
-void VoronoiLayer::publishVoronoiGrid(const costmap_2d::Costmap2D& master_grid)
+/**
+ * @brief Compare the costs in [min_i, max_i) x [min_j, max_j) with the cached occupancy and collect the cells whose
+ *        state changed. A lethal cell becomes occupied, a free cell becomes free, any other cost keeps the old state.
+ *        Changed cells are queued in pending_cells_, changes_mutex_ must be held.
+ */
+void VoronoiLayer::diffLethalMask(const unsigned char* costarr, unsigned int nx, int min_i, int min_j, int max_i,
+                                  int max_j)
 {
-  unsigned int nx = master_grid.getSizeInCellsX();
-  unsigned int ny = master_grid.getSizeInCellsY();
+#ifdef __SSE2__
+  const __m128i lethal = _mm_set1_epi8(static_cast<char>(costmap_2d::LETHAL_OBSTACLE));
+  const __m128i free_space = _mm_set1_epi8(static_cast<char>(costmap_2d::FREE_SPACE));
+  const __m128i one = _mm_set1_epi8(1);
+#endif
 
-  double resolution = master_grid.getResolution();
-  nav_msgs::OccupancyGrid grid;
-  // Publish Whole Grid
-  grid.header.frame_id = "map";
-  grid.header.stamp = ros::Time::now();
-  grid.info.resolution = resolution;
+  for (int j = min_j; j < max_j; ++j)
+  {
+    const unsigned char* row = costarr + j * nx;
+    unsigned char* mask = lethal_mask_.data() + j * nx;
+    int i = min_i;
 
-  grid.info.width = nx;
-  grid.info.height = ny;
+#ifdef __SSE2__
+    // 16 cells at a time, unchanged blocks are skipped without touching the Voronoi diagram
+    for (; i + 16 <= max_i; i += 16)
+    {
+      const __m128i cost = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+      const __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+      const __m128i is_lethal = _mm_and_si128(_mm_cmpeq_epi8(cost, lethal), one);
+      const __m128i is_free = _mm_cmpeq_epi8(cost, free_space);
+      const __m128i next = _mm_or_si128(is_lethal, _mm_andnot_si128(is_free, prev));
+
+      unsigned int changed = ~static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(next, prev))) & 0xFFFFu;
+      if (!changed)
+      {
+        continue;
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(mask + i), next);
 
-  grid.info.origin.position.x = master_grid.getOriginX();
-  grid.info.origin.position.y = master_grid.getOriginY();
-  grid.info.origin.position.z = 0.0;
-  grid.info.origin.orientation.w = 1.0;
+      while (changed)
+      {
+        const int k = __builtin_ctz(changed);
+        changed &= changed - 1;
+        const unsigned int index = j * nx + i + k;
+        if (!pending_flags_[index])
+        {
+          pending_flags_[index] = 1;
+          pending_cells_.push_back(index);
+        }
+      }
+    }
+#endif
 
-  grid.data.resize(nx * ny);
+    for (; i < max_i; ++i)
+    {
+      const unsigned char next =
+          row[i] == costmap_2d::LETHAL_OBSTACLE ? 1 : (row[i] == costmap_2d::FREE_SPACE ? 0 : mask[i]);
+      if (next != mask[i])
+      {
+        mask[i] = next;
+        const unsigned int index = j * nx + i;
+        if (!pending_flags_[index])
+        {
+          pending_flags_[index] = 1;
+          pending_cells_.push_back(index);
+        }
+      }
+    }
+  }
+}
 
-  for (unsigned int x = 0; x < nx; x++)
+/**
+ * @brief Central differences of the distance field, zero wherever a neighbour has no finite distance
+ */
+void VoronoiLayer::computeGradient(VoronoiSnapshot& snapshot, int min_x, int min_y, int max_x, int max_y)
+{
+  const int nx = snapshot.size_x;
+  const int ny = snapshot.size_y;
+  if (snapshot.grad_x.size() != snapshot.dist.size())
   {
-    for (unsigned int y = 0; y < ny; y++)
+    // border cells keep a zero gradient
+    snapshot.grad_x.assign(nx * ny, 0.0f);
+    snapshot.grad_y.assign(nx * ny, 0.0f);
+    min_x = min_y = 0;
+    max_x = nx - 1;
+    max_y = ny - 1;
+  }
+  const float* d = snapshot.dist.data();
+
+  for (int y = std::max(min_y, 1); y <= std::min(max_y, ny - 2); y++)
+  {
+    for (int x = std::max(min_x, 1); x <= std::min(max_x, nx - 2); x++)
     {
-      if (voronoi_.isVoronoi(x, y))
+      const int i = y * nx + x;
+      const float l = d[i - 1], r = d[i + 1], b = d[i - nx], t = d[i + nx];
+      if (std::isfinite(l) && std::isfinite(r) && std::isfinite(b) && std::isfinite(t))
       {
-        grid.data[x + y * nx] = 128;
+        snapshot.grad_x[i] = 0.5f * (r - l);
+        snapshot.grad_y[i] = 0.5f * (t - b);
       }
       else
       {
-        grid.data[x + y * nx] = 0;
+        snapshot.grad_x[i] = 0.0f;
+        snapshot.grad_y[i] = 0.0f;
       }
     }
   }
+}
+
+void VoronoiLayer::publishVoronoiGrid(const VoronoiSnapshot& snapshot)
+{
+  nav_msgs::OccupancyGrid grid;
+  // Publish Whole Grid
+  grid.header.frame_id = "map";
+  grid.header.stamp = ros::Time::now();
+  grid.info.resolution = snapshot.resolution;
+
+  grid.info.width = snapshot.size_x;
+  grid.info.height = snapshot.size_y;
+
+  grid.info.origin.position.x = snapshot.origin_x;
+  grid.info.origin.position.y = snapshot.origin_y;
+  grid.info.origin.position.z = 0.0;
+  grid.info.origin.orientation.w = 1.0;
+
+  grid.data.resize(snapshot.is_voronoi.size());
+  for (size_t i = 0; i < snapshot.is_voronoi.size(); i++)
+  {
+    grid.data[i] = snapshot.is_voronoi[i] ? 128 : 0;
+  }
   voronoi_grid_pub_.publish(grid);
 }
 
@@ -86,6 +86,15 @@ void DetectedPersonsDisplay::personVisualTypeChanged()
     stylesChanged();
 }
 
+// Switch distant detections to impostors
+void DetectedPersonsDisplay::update(float wall_dt, float ros_dt)
+{
+    foreach(boost::shared_ptr<DetectedPersonVisual>& detectedPersonVisual, m_previousDetections)
+    {
+        updateLevelOfDetail(detectedPersonVisual->personVisual);
+    }
+}
+
 // Update dynamically adjustable properties of all existing detections
 void DetectedPersonsDisplay::stylesChanged()
 {
@@ -110,6 +119,11 @@ void DetectedPersonsDisplay::stylesChanged()
         Ogre::ColourValue fontColor = m_commonProperties->font_color_style->getOptionInt() == FONT_COLOR_CONSTANT ? m_commonProperties->constant_font_color->getOgreColor() : detectionColor;
         fontColor.a = m_commonProperties->alpha->getFloat();
         if(personHidden) fontColor.a = 0.0;
+
+        const double textDistance = getTextRenderingDistance();
+        detectedPersonVisual->detectionIdText->setRenderingDistance(textDistance);
+        detectedPersonVisual->modalityText->setRenderingDistance(textDistance);
+        detectedPersonVisual->confidenceText->setRenderingDistance(textDistance);
         
         float textOffset = 0.0f;
         detectedPersonVisual->detectionIdText->setCharacterHeight(0.18 * m_commonProperties->font_scale->getFloat());
@@ -74,6 +74,9 @@ namespace spencer_tracking_rviz_plugin
         
         virtual void onInitialize();
 
+        // Called periodically by the visualization manager
+        virtual void update(float wall_dt, float ros_dt);
+
     protected:
         // A helper to clear this display back to the initial state.
         virtual void reset();
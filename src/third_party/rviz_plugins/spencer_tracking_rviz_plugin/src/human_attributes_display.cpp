@@ -87,8 +87,8 @@ void HumanAttributesDisplay::updateVisualStyles(boost::shared_ptr<HumanAttribute
     track_id trackId = humanAttributeVisual->trackId;
     bool personHidden = isPersonHidden(trackId);
 
-    boost::shared_ptr<CachedTrackedPerson> trackedPerson = m_trackedPersonsCache.lookup(trackId);
-    float occlusionAlpha = trackedPerson->isOccluded ? m_occlusion_alpha_property->getFloat() : 1.0;
+    const CachedTrackedPerson* trackedPerson = m_trackedPersonsCache.lookup(trackId);
+    float occlusionAlpha = trackedPerson && trackedPerson->isOccluded ? m_occlusion_alpha_property->getFloat() : 1.0;
 
     // Update text colors, size and visibility
     Ogre::ColourValue fontColor = m_commonProperties->font_color_style->getOptionInt() == FONT_COLOR_CONSTANT ? m_commonProperties->constant_font_color->getOgreColor() : getColorFromId(trackId);
@@ -242,7 +242,7 @@ void HumanAttributesDisplay::processMessage(const spencer_human_attribute_msgs::
     set<track_id> tracksWithUnknownPosition;
     foreach(boost::shared_ptr<HumanAttributeVisual> humanAttributeVisual, m_humanAttributeVisuals | boost::adaptors::map_values)
     {
-        boost::shared_ptr<CachedTrackedPerson> trackedPerson = m_trackedPersonsCache.lookup(humanAttributeVisual->trackId);
+        const CachedTrackedPerson* trackedPerson = m_trackedPersonsCache.lookup(humanAttributeVisual->trackId);
 
         // Get current track position
         if(!trackedPerson) {
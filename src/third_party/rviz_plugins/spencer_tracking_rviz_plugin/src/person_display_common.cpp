@@ -86,6 +86,14 @@ PersonDisplayCommonProperties::PersonDisplayCommonProperties(rviz::Display* disp
     font_scale = new rviz::FloatProperty( "Font scale", 2.0, "Larger values mean bigger font", m_display);
     font_scale->setMin( 0.0 );
 
+    level_of_detail = new rviz::BoolProperty( "Level of detail", true, "Draw distant persons as flat impostors and hide distant texts, for large crowds", m_display, SLOT(stylesChanged()), this);
+
+    impostor_distance = new rviz::FloatProperty( "Impostor distance", 25.0, "Distance from the camera beyond which persons are drawn as flat impostors", level_of_detail, SLOT(stylesChanged()), this);
+    impostor_distance->setMin( 0.0 );
+
+    text_distance = new rviz::FloatProperty( "Text distance", 15.0, "Distance from the camera beyond which texts are hidden", level_of_detail, SLOT(stylesChanged()), this);
+    text_distance->setMin( 0.0 );
+
     z_offset = new rviz::FloatProperty( "Z offset", 0.0, "Offset of all visualizations on the z (height) axis", m_display, SLOT(stylesChanged()), this);
 
     use_actual_z_position = new rviz::BoolProperty( "Use Z position from message", false, "Use Z position from message (otherwise place above ground plane)", z_offset, SLOT(stylesChanged()), this);
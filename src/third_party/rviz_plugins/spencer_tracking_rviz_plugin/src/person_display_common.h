@@ -38,9 +38,12 @@
 #include <spencer_tracking_msgs/TrackedPersons.h>
 #include <geometry_msgs/Twist.h>
 #include <rviz/message_filter_display.h>
+#include <rviz/view_controller.h>
+#include <rviz/view_manager.h>
 
 #include <OGRE/OgreSceneNode.h>
 #include <OGRE/OgreSceneManager.h>
+#include <OGRE/OgreCamera.h>
 #include "visuals/person_visual.h"
 #include "visuals/text_node.h"
 #include "visuals/covariance_visual.h"
@@ -125,6 +128,10 @@ namespace spencer_tracking_rviz_plugin
         rviz::ColorProperty* constant_font_color;
         rviz::FloatProperty* font_scale;
 
+        rviz::BoolProperty*  level_of_detail;
+        rviz::FloatProperty* impostor_distance;
+        rviz::FloatProperty* text_distance;
+
         rviz::StringProperty* m_excluded_person_ids_property;
         rviz::StringProperty* m_included_person_ids_property;
 
@@ -208,6 +215,33 @@ namespace spencer_tracking_rviz_plugin
             personVisual->setScalingFactor(m_commonProperties->scaling_factor->getFloat());
         }
 
+        /// Distance from the camera beyond which texts are not rendered, 0 if they are rendered at any distance
+        double getTextRenderingDistance() {
+            return m_commonProperties->level_of_detail->getBool() ? m_commonProperties->text_distance->getFloat() : 0.0;
+        }
+
+        /// Switches between the full visual and its impostor according to the distance from the camera. Must be called
+        /// once per frame. Returns true if the full visual is in view, otherwise its per-frame updates (e.g. mesh
+        /// animation) can be skipped.
+        bool updateLevelOfDetail(boost::shared_ptr<PersonVisual> &personVisual)
+        {
+            if(!personVisual) return false;
+
+            rviz::ViewController* viewController = getContext()->getViewManager()->getCurrent();
+            if(!m_commonProperties->level_of_detail->getBool() || !viewController) {
+                personVisual->setImpostor(false);
+                return true;
+            }
+
+            Ogre::Camera* camera = viewController->getCamera();
+            const Ogre::Sphere boundingSphere = personVisual->getWorldBoundingSphere();
+            if(!camera->isVisible(boundingSphere)) return false;
+
+            const double distance = camera->getDerivedPosition().distance(boundingSphere.getCenter());
+            personVisual->setImpostor(distance > m_commonProperties->impostor_distance->getFloat());
+            return !personVisual->isImpostor();
+        }
+
         // Builds velocity vector for a person from a twist message
         Ogre::Vector3 getVelocityVector(const geometry_msgs::TwistWithCovariance& twist) {
             const double zVelocityVariance = twist.covariance[2 * 6 + 2];
@@ -128,9 +128,9 @@ void SocialActivitiesDisplay::reset()
 
 void SocialActivitiesDisplay::update(float wall_dt, float ros_dt)
 {
-    // Update animations
+    // Switch distant persons to impostors, update animations of full visuals in view
     foreach(PersonVisualContainer& personVisualContainer, m_personVisualMap | boost::adaptors::map_values) {
-        if(personVisualContainer.personVisual) {
+        if(updateLevelOfDetail(personVisualContainer.personVisual)) {
             personVisualContainer.personVisual->update(ros_dt);
         }
     }
@@ -292,7 +292,7 @@ void SocialActivitiesDisplay::updateSocialActivityVisualStyles(boost::shared_ptr
 
             Ogre::Vector3 centerAt;
             if(m_activity_type_per_track_property->getBool()) {
-                boost::shared_ptr<CachedTrackedPerson> trackedPerson = m_trackedPersonsCache.lookup(socialActivityVisual->trackIds[i]);
+                const CachedTrackedPerson* trackedPerson = m_trackedPersonsCache.lookup(socialActivityVisual->trackIds[i]);
                 if(!trackedPerson) continue;
                 centerAt = Ogre::Vector3(trackedPerson->center.x, trackedPerson->center.y, m_commonProperties->z_offset->getFloat());
             }
@@ -363,7 +363,7 @@ void SocialActivitiesDisplay::processMessage(const spencer_social_relation_msgs:
         for(size_t trackIndex = 0; trackIndex < socialActivity.track_ids.size(); trackIndex++)
         {
             const track_id trackId = socialActivity.track_ids[trackIndex];
-            boost::shared_ptr<CachedTrackedPerson> trackedPerson = m_trackedPersonsCache.lookup(trackId);
+            const CachedTrackedPerson* trackedPerson = m_trackedPersonsCache.lookup(trackId);
 
             ActivityWithConfidence activityWithConfidence;
             activityWithConfidence.type = socialActivity.type;
@@ -424,7 +424,7 @@ void SocialActivitiesDisplay::processMessage(const spencer_social_relation_msgs:
                     for(size_t otherTrackIndex = trackIndex + 1; otherTrackIndex < socialActivity.track_ids.size(); otherTrackIndex++)
                     {
                         const track_id otherTrackId = socialActivity.track_ids[otherTrackIndex];
-                        boost::shared_ptr<CachedTrackedPerson> otherTrackedPerson = m_trackedPersonsCache.lookup(otherTrackId);
+                        const CachedTrackedPerson* otherTrackedPerson = m_trackedPersonsCache.lookup(otherTrackId);
 
                         // Get other track's position
                         if(otherTrackedPerson) {
@@ -499,9 +499,9 @@ void SocialActivitiesDisplay::processMessage(const spencer_social_relation_msgs:
     // Create person visuals for all tracked persons (colored in color of activity with highest confidence)
     //
     set<track_id> seenTrackIds;
-    foreach(const TrackedPersonsCache::CachedTrackedPersonsMap::value_type& entry, m_trackedPersonsCache.getMap()) {
-        const track_id trackId = entry.first;
-        const boost::shared_ptr<CachedTrackedPerson> trackedPerson = entry.second;
+    for(size_t i = 0; i < m_trackedPersonsCache.size(); i++) {
+        const CachedTrackedPerson* trackedPerson = &m_trackedPersonsCache[i];
+        const track_id trackId = trackedPerson->trackId;
 
         PersonVisualContainer personVisualContainer;
         if(m_personVisualMap.find(trackId) != m_personVisualMap.end()) {
@@ -83,8 +83,8 @@ void SocialRelationsDisplay::processMessage(const spencer_social_relation_msgs::
 
     foreach(const spencer_social_relation_msgs::SocialRelation& socialRelation, msg->elements)
     {
-        boost::shared_ptr<CachedTrackedPerson> personTrack1 = m_trackedPersonsCache.lookup(socialRelation.track1_id);
-        boost::shared_ptr<CachedTrackedPerson> personTrack2 = m_trackedPersonsCache.lookup(socialRelation.track2_id);
+        const CachedTrackedPerson* personTrack1 = m_trackedPersonsCache.lookup(socialRelation.track1_id);
+        const CachedTrackedPerson* personTrack2 = m_trackedPersonsCache.lookup(socialRelation.track2_id);
 
         // Cannot draw relations for tracks with unknown position
         if(!personTrack1 || !personTrack2) continue;
@@ -74,6 +74,18 @@ void TrackedGroupsDisplay::onInitialize()
     // Create a scene node for visualizing group affiliation history
     m_groupAffiliationHistorySceneNode = boost::shared_ptr<Ogre::SceneNode>(scene_node_->createChildSceneNode());
     m_groupsSceneNode = boost::shared_ptr<Ogre::SceneNode>(scene_node_->createChildSceneNode());
+
+    // History entries are instanced points of a single cloud, with per-point alpha for occluded and hidden entries
+    m_groupAffiliationHistoryCloud.reset(new rviz::PointCloud());
+    m_groupAffiliationHistoryCloud->setRenderMode(rviz::PointCloud::RM_SPHERES);
+    m_groupAffiliationHistoryCloud->setDimensions(0.1, 0.1, 0.1);
+    m_groupAffiliationHistoryCloud->setAlpha(1.0, true);
+    m_groupAffiliationHistorySceneNode->attachObject(m_groupAffiliationHistoryCloud.get());
+
+    // Connections of all groups are lines of one billboard line object
+    m_connectionLines.reset(new rviz::BillboardLine(context_->getSceneManager(), m_groupsSceneNode.get()));
+    m_connectionLines->setMaxPointsPerLine(2);
+    m_connectionLines->setLineWidth(0.05);
 }
 
 TrackedGroupsDisplay::~TrackedGroupsDisplay()
@@ -88,6 +100,8 @@ void TrackedGroupsDisplay::reset()
     m_groupVisuals.clear();
     m_groupAffiliationHistory.clear();
     m_groupAffiliations.clear();
+    if(m_groupAffiliationHistoryCloud) m_groupAffiliationHistoryCloud->clear();
+    if(m_connectionLines) m_connectionLines->clear();
 }
 
 void TrackedGroupsDisplay::update(float wall_dt, float ros_dt)
@@ -98,6 +112,13 @@ void TrackedGroupsDisplay::update(float wall_dt, float ros_dt)
     Ogre::Matrix4 mapFrameTransform(mapFrameOrientation); mapFrameTransform.setTrans(mapFramePosition);
     m_groupAffiliationHistorySceneNode->setPosition(mapFramePosition);
     m_groupAffiliationHistorySceneNode->setOrientation(mapFrameOrientation);
+
+    // Switch distant group members to impostors
+    foreach(group_map::value_type& entry, m_groupVisuals) {
+        foreach(boost::shared_ptr<PersonVisual>& personVisual, entry.second->personVisuals) {
+            updateLevelOfDetail(personVisual);
+        }
+    }
 }
 
 bool TrackedGroupsDisplay::isGroupHidden(group_id groupId) {
@@ -132,9 +153,10 @@ void TrackedGroupsDisplay::stylesChanged()
         }
     }
 
-    foreach(boost::shared_ptr<GroupVisual> groupVisual, m_groupVisuals) {
-        updateGroupVisualStyles(groupVisual);
+    foreach(group_map::value_type& entry, m_groupVisuals) {
+        updateGroupVisualStyles(entry.second);
     }
+    updateConnectionLines();
 
      // Update history size
     m_groupAffiliationHistory.rset_capacity(m_history_length_property->getInt());
@@ -147,8 +169,8 @@ void TrackedGroupsDisplay::stylesChanged()
 // Set the rendering style (cylinders, meshes, ...) of tracked persons
 void TrackedGroupsDisplay::personVisualTypeChanged()
 {
-    foreach(boost::shared_ptr<GroupVisual> groupVisual, m_groupVisuals) {
-        foreach(boost::shared_ptr<PersonVisual>& personVisual, groupVisual->personVisuals) {
+    foreach(group_map::value_type& entry, m_groupVisuals) {
+        foreach(boost::shared_ptr<PersonVisual>& personVisual, entry.second->personVisuals) {
             Ogre::SceneNode* parentSceneNode = personVisual->getParentSceneNode();
             personVisual.reset();
             createPersonVisualIfRequired(parentSceneNode, personVisual);
@@ -157,16 +179,20 @@ void TrackedGroupsDisplay::personVisualTypeChanged()
     stylesChanged();
 }
 
+Ogre::ColourValue TrackedGroupsDisplay::getGroupColor(group_id groupId, bool isSinglePersonGroup)
+{
+    if(isSinglePersonGroup && m_single_person_groups_in_constant_color_property->getBool()) {
+        return m_commonProperties->constant_color->getOgreColor();
+    }
+    return getColorFromId(groupId);
+}
+
 void TrackedGroupsDisplay::updateGroupVisualStyles(boost::shared_ptr<GroupVisual>& groupVisual)
 {
     bool hideGroup = isGroupHidden(groupVisual->groupId);
 
     // Apply current group color
-    Ogre::ColourValue groupColor = m_commonProperties->constant_color->getOgreColor();
-
-    if(groupVisual->personCount > 1 || !m_single_person_groups_in_constant_color_property->getBool()) {
-        groupColor = getColorFromId(groupVisual->groupId);
-    }   
+    Ogre::ColourValue groupColor = getGroupColor(groupVisual->groupId, groupVisual->personCount <= 1);
 
     groupColor.a *= m_commonProperties->alpha->getFloat(); // general alpha
     if(hideGroup) groupColor.a = 0;
@@ -184,18 +210,13 @@ void TrackedGroupsDisplay::updateGroupVisualStyles(boost::shared_ptr<GroupVisual
         }
     }
 
-    double connectionLineVisibilityAlpha = m_render_intragroup_connections_property->getBool() ? 1.0 : 0.0;
-    foreach(boost::shared_ptr<rviz::BillboardLine> connectionLine, groupVisual->connectionLines) {
-        connectionLine->setColor(groupColor.r, groupColor.g, groupColor.b, groupColor.a * connectionLineVisibilityAlpha);
-        connectionLine->setLineWidth(0.05);
-    }
-
     // Update text colors, size and visibility
     Ogre::ColourValue fontColor = m_commonProperties->font_color_style->getOptionInt() == FONT_COLOR_CONSTANT ? m_commonProperties->constant_font_color->getOgreColor() : groupColor;
     fontColor.a = m_commonProperties->alpha->getFloat();
     if(hideGroup) fontColor.a = 0;
     bool groupIdVisible = groupVisual->personCount > 1 ? true : !m_hide_ids_of_single_person_groups_property->getBool();
     groupVisual->idText->setVisible(m_render_ids_property->getBool() && groupIdVisible);
+    groupVisual->idText->setRenderingDistance(getTextRenderingDistance());
     groupVisual->idText->setCharacterHeight(0.23 * m_commonProperties->font_scale->getFloat());
     groupVisual->idText->setColor(fontColor);
     groupVisual->idText->setPosition(m_frameTransform * Ogre::Vector3(
@@ -204,29 +225,103 @@ void TrackedGroupsDisplay::updateGroupVisualStyles(boost::shared_ptr<GroupVisual
         groupVisual->groupCenter.z + m_group_id_offset->getFloat() + m_commonProperties->z_offset->getFloat()));
 }
 
-void TrackedGroupsDisplay::updateHistoryStyles()
+// Rewrite the lines connecting the members of each group, in group color. Hidden groups get no lines.
+void TrackedGroupsDisplay::updateConnectionLines()
 {
-    const Ogre::Quaternion shapeQuaternion( Ogre::Degree(90), Ogre::Vector3(1,0,0) );
-    foreach(boost::shared_ptr<GroupAffiliationHistoryEntry> groupAffiliationHistoryEntry, m_groupAffiliationHistory) {
-        bool hideGroup = isGroupHidden(groupAffiliationHistoryEntry->groupId);
-        const double historyShapeDiameter = 0.1;
+    m_connectionLines->clear();
+    if(!m_render_intragroup_connections_property->getBool()) return;
 
-        Ogre::ColourValue historyColor = m_commonProperties->constant_color->getOgreColor();
+    unsigned int numLines = 0;
+    foreach(group_map::value_type& entry, m_groupVisuals) {
+        const size_t memberCount = entry.second->memberPositions.size();
+        if(!isGroupHidden(entry.first)) numLines += memberCount * (memberCount - 1) / 2;
+    }
+    if(numLines == 0) return;
 
-        if(!groupAffiliationHistoryEntry->wasSinglePersonGroup || !m_single_person_groups_in_constant_color_property->getBool()) {
-            historyColor = getColorFromId(groupAffiliationHistoryEntry->groupId);
-        }   
+    // Grow in steps, resizing the line object rebuilds its chains
+    if(numLines > m_connectionLineCapacity) {
+        m_connectionLineCapacity = std::max(2 * m_connectionLineCapacity, numLines);
+        m_connectionLines->setNumLines(m_connectionLineCapacity);
+    }
 
+    // Sets up blending for the common alpha, lines are colored per point
+    m_connectionLines->setColor(1, 1, 1, m_commonProperties->alpha->getFloat());
+
+    bool firstLine = true;
+    const Ogre::Vector3 verticalShift(0,0, 0.5 + m_commonProperties->z_offset->getFloat());
+    foreach(group_map::value_type& entry, m_groupVisuals) {
+        const boost::shared_ptr<GroupVisual>& groupVisual = entry.second;
+        if(isGroupHidden(groupVisual->groupId)) continue;
+
+        Ogre::ColourValue groupColor = getGroupColor(groupVisual->groupId, groupVisual->personCount <= 1);
+        groupColor.a *= m_commonProperties->alpha->getFloat();
+
+        // Positions are already in fixed frame coordinates!
+        const vector<Ogre::Vector3>& positions = groupVisual->memberPositions;
+        for(size_t i = 0; i < positions.size(); i++) {
+            for(size_t j = i + 1; j < positions.size(); j++) {
+                if(!firstLine) m_connectionLines->newLine();
+                firstLine = false;
+                m_connectionLines->addPoint(verticalShift + positions[i], groupColor);
+                m_connectionLines->addPoint(verticalShift + positions[j], groupColor);
+            }
+        }
+    }
+}
 
-        historyColor.a = m_commonProperties->alpha->getFloat();
+rviz::PointCloud::Point TrackedGroupsDisplay::getHistoryPoint(const GroupAffiliationHistoryEntry& entry)
+{
+    rviz::PointCloud::Point point;
+    point.position = entry.position;
+    point.color = getGroupColor(entry.groupId, entry.wasSinglePersonGroup);
+    point.color.a = m_commonProperties->alpha->getFloat();
+    if(entry.wasOccluded) point.color.a *= m_occlusion_alpha_property->getFloat();
+    if(isGroupHidden(entry.groupId)) point.color.a = 0;
+    return point;
+}
+
+// Refill the history cloud with the current colors; only needed when styles change
+void TrackedGroupsDisplay::updateHistoryStyles()
+{
+    m_groupAffiliationHistorySceneNode->setVisible(m_render_history_property->getBool());
+
+    vector<rviz::PointCloud::Point> points;
+    points.reserve(m_groupAffiliationHistory.size());
+    foreach(const GroupAffiliationHistoryEntry& entry, m_groupAffiliationHistory) {
+        points.push_back(getHistoryPoint(entry));
+    }
+    m_groupAffiliationHistoryCloud->clear();
+    if(!points.empty()) m_groupAffiliationHistoryCloud->addPoints(points.begin(), points.end());
+}
 
-        if(groupAffiliationHistoryEntry->wasOccluded) historyColor.a *= m_occlusion_alpha_property->getFloat();
-        if(hideGroup) historyColor.a = 0;
-        if(!m_render_history_property->getBool()) historyColor.a = 0;
+// Match the number of circles, person visuals and scene nodes of a group to its number of members with known position
+void TrackedGroupsDisplay::resizeGroupVisual(boost::shared_ptr<GroupVisual>& groupVisual, size_t memberCount)
+{
+    const Ogre::Quaternion shapeQuaternion( Ogre::Degree(90), Ogre::Vector3(1,0,0) ); // required to fix orientation of any Cylinder shapes
+    const double groupAssignmentCircleHeight = 0;
+    const double groupAssignmentCircleDiameter = 0.9;
 
-        groupAffiliationHistoryEntry->shape->setColor(historyColor);
-        groupAffiliationHistoryEntry->shape->setScale(shapeQuaternion * Ogre::Vector3(historyShapeDiameter, historyShapeDiameter, 0.05));
+    while(groupVisual->groupAssignmentCircles.size() < memberCount)
+    {
+        // Group visualization circles (below tracks)
+        boost::shared_ptr<rviz::Shape> groupAssignmentCircle = boost::shared_ptr<rviz::Shape>(new rviz::Shape(rviz::Shape::Cylinder, context_->getSceneManager(), m_groupsSceneNode.get()));
+        groupAssignmentCircle->setScale(shapeQuaternion * Ogre::Vector3(groupAssignmentCircleDiameter, groupAssignmentCircleDiameter, groupAssignmentCircleHeight));
+        groupAssignmentCircle->setOrientation(shapeQuaternion);
+        groupVisual->groupAssignmentCircles.push_back(groupAssignmentCircle);
+
+        // Person visuals (colored in group color). This scene node is the parent of all visualization elements for the tracked person
+        boost::shared_ptr<Ogre::SceneNode> sceneNode = boost::shared_ptr<Ogre::SceneNode>(scene_node_->createChildSceneNode());
+        groupVisual->personVisualSceneNodes.push_back(sceneNode);
+
+        boost::shared_ptr<PersonVisual> personVisual;
+        createPersonVisualIfRequired(sceneNode.get(), personVisual);
+        groupVisual->personVisuals.push_back(personVisual);
     }
+
+    groupVisual->groupAssignmentCircles.resize(memberCount);
+    groupVisual->personVisuals.resize(memberCount);
+    groupVisual->personVisualSceneNodes.resize(memberCount);
+    groupVisual->memberPositions.resize(memberCount);
 }
 
 // This is our callback to handle an incoming group message.
@@ -244,145 +339,112 @@ void TrackedGroupsDisplay::processMessage(const spencer_tracking_msgs::TrackedGr
     m_frameTransform = Ogre::Matrix4(m_frameOrientation);
     m_frameTransform.setTrans(m_framePosition);
 
-    const Ogre::Quaternion shapeQuaternion( Ogre::Degree(90), Ogre::Vector3(1,0,0) ); // required to fix orientation of any Cylinder shapes
     stringstream ss;
 
-    // Clear previous visualization
-    m_groupVisuals.clear();
-    m_groupsSceneNode->removeAndDestroyAllChildren();
-
     unsigned int numTracksWithUnknownPosition = 0;
     m_groupAffiliations.clear();
 
+    // Groups not in this message are removed below, visuals of the others are updated in place
+    set<group_id> encounteredGroupIds;
+
     //
     // Iterate over all groups in this message
     //
     foreach (const spencer_tracking_msgs::TrackedGroup& trackedGroup, msg->groups)
     {
-        // Create a new visual representation of the tracked group
-        boost::shared_ptr<GroupVisual> groupVisual = boost::shared_ptr<GroupVisual>(new GroupVisual);
-        groupVisual->groupId = trackedGroup.group_id;
+        if(!encounteredGroupIds.insert(trackedGroup.group_id).second) {
+            ROS_ERROR_STREAM("spencer_tracking_msgs::TrackedGroups contains duplicate group ID " << trackedGroup.group_id << "! Skipping duplicate group.");
+            continue;
+        }
+
+        // See if we have a visual for this group already, else create a new one
+        boost::shared_ptr<GroupVisual>& groupVisual = m_groupVisuals[trackedGroup.group_id];
+        if(!groupVisual) {
+            groupVisual = boost::shared_ptr<GroupVisual>(new GroupVisual);
+            groupVisual->groupId = trackedGroup.group_id;
+
+            // Group ID
+            groupVisual->idText = boost::shared_ptr<TextNode>(new TextNode(context_->getSceneManager(), m_groupsSceneNode.get()));
+            ss.str(""); ss << "group " << trackedGroup.group_id;
+            groupVisual->idText->setCaption(ss.str());
+            groupVisual->idText->showOnTop();
+        }
         groupVisual->personCount = trackedGroup.track_ids.size();
-        m_groupVisuals.push_back(groupVisual);
+
+        // Look up the members first, the visual gets one circle and person visual per member with known position
+        vector<const CachedTrackedPerson*> members;
+        members.reserve(trackedGroup.track_ids.size());
+        foreach(const track_id trackId, trackedGroup.track_ids) {
+            const CachedTrackedPerson* trackedPerson = m_trackedPersonsCache.lookup(trackId);
+            if(!trackedPerson) {
+                numTracksWithUnknownPosition++;
+                continue;
+            }
+            members.push_back(trackedPerson);
+            m_groupAffiliations[trackId] = trackedGroup.group_id; // required to hide certain groups later on
+        }
+        resizeGroupVisual(groupVisual, members.size());
 
         //
         // Group visualization circles, person visuals (if enabled) + connections between group members
         //
 
-        for(size_t trackIndex = 0; trackIndex < trackedGroup.track_ids.size(); trackIndex++)
+        for(size_t memberIndex = 0; memberIndex < members.size(); memberIndex++)
         {
-            const track_id trackId = trackedGroup.track_ids[trackIndex];
-            boost::shared_ptr<CachedTrackedPerson> trackedPerson = m_trackedPersonsCache.lookup(trackId);
-
-            // Get current track position
-            if(!trackedPerson) {
-                numTracksWithUnknownPosition++;
-            }
-            else
-            {
-                Ogre::Vector3 trackCenterAtGroundPlane(trackedPerson->center.x, trackedPerson->center.y, m_commonProperties->z_offset->getFloat());
-
-                m_groupAffiliations[trackId] = trackedGroup.group_id; // required to hide certain groups later on
-
-
-                //
-                // Group visualization circles (below tracks)
-                //
-
-                const double groupAssignmentCircleHeight = 0;
-                const double groupAssignmentCircleDiameter = 0.9;
-                boost::shared_ptr<rviz::Shape> groupAssignmentCircle = boost::shared_ptr<rviz::Shape>(new rviz::Shape(rviz::Shape::Cylinder, context_->getSceneManager(), m_groupsSceneNode.get()));
-
-                groupAssignmentCircle->setScale(shapeQuaternion * Ogre::Vector3(groupAssignmentCircleDiameter, groupAssignmentCircleDiameter, groupAssignmentCircleHeight));
-                groupAssignmentCircle->setOrientation(shapeQuaternion);
-
-                Ogre::Vector3 groupAssignmentCirclePos = trackCenterAtGroundPlane + Ogre::Vector3(0, 0, -0.5*groupAssignmentCircleHeight - 0.01);
-                groupAssignmentCircle->setPosition(groupAssignmentCirclePos);
-
-                groupVisual->groupAssignmentCircles.push_back(groupAssignmentCircle);
-
-
-                //
-                // Person visuals (colored in group color)
-                //
-
-                // This scene node is the parent of all visualization elements for the tracked person
-                boost::shared_ptr<Ogre::SceneNode> sceneNode = boost::shared_ptr<Ogre::SceneNode>(scene_node_->createChildSceneNode());
-                groupVisual->personVisualSceneNodes.push_back(sceneNode);
-
-                // Create new visual for the person itself, if needed
-                boost::shared_ptr<PersonVisual> personVisual;
-                createPersonVisualIfRequired(sceneNode.get(), personVisual);
-                groupVisual->personVisuals.push_back(personVisual);
-
-                const double personHeight = personVisual ? personVisual->getHeight() : 0;
-                const Ogre::Matrix3 covXYZinTargetFrame = covarianceXYZIntoTargetFrame(trackedPerson->pose);
-                setPoseOrientation(sceneNode.get(), trackedPerson->pose, covXYZinTargetFrame, personHeight);
-
-
-                //
-                // Intra-group connections
-                //
-
-                // Iterate over all neighbouring group tracks to render intra-group connections
-                for(size_t otherTrackIndex = trackIndex + 1; otherTrackIndex < trackedGroup.track_ids.size(); otherTrackIndex++)
-                {
-                    const track_id otherTrackId = trackedGroup.track_ids[otherTrackIndex];
-                    boost::shared_ptr<CachedTrackedPerson> otherTrackedPerson = m_trackedPersonsCache.lookup(otherTrackId);
-
-                    // Get other track's position
-                    if(otherTrackedPerson) {
-                        // Get positions. These are already in fixed frame coordinates!
-                        const Ogre::Vector3 verticalShift(0,0, 0.5 + m_commonProperties->z_offset->getFloat());
-                        const Ogre::Vector3& position1 = verticalShift + trackedPerson->center;
-                        const Ogre::Vector3& position2 = verticalShift + otherTrackedPerson->center;
-
-                        // Add line connecting the two tracks
-                        boost::shared_ptr<rviz::BillboardLine> connectionLine(new rviz::BillboardLine(context_->getSceneManager(), m_groupsSceneNode.get()));
-                        connectionLine->setMaxPointsPerLine(2);
-                        connectionLine->addPoint(position1);
-                        connectionLine->addPoint(position2);
-                        groupVisual->connectionLines.push_back(connectionLine);
-                    }
-                } // end loop over neighbouring group tracks
-
-
-                //
-                // Group affiliation history
-                //
-              
-                boost::shared_ptr<GroupAffiliationHistoryEntry> newHistoryEntry(new GroupAffiliationHistoryEntry);
-                newHistoryEntry->shape = boost::shared_ptr<rviz::Shape>(new rviz::Shape(rviz::Shape::Cylinder, context_->getSceneManager(), m_groupAffiliationHistorySceneNode.get()));
-                newHistoryEntry->shape->setPosition(mapFrameTransform.inverse() * trackCenterAtGroundPlane);
-                newHistoryEntry->shape->setOrientation(shapeQuaternion);
-                newHistoryEntry->wasOccluded = trackedPerson->isOccluded;
-                newHistoryEntry->wasSinglePersonGroup = trackedGroup.track_ids.size() <= 1;
-                newHistoryEntry->groupId = trackedGroup.group_id;
+            const CachedTrackedPerson* trackedPerson = members[memberIndex];
+            Ogre::Vector3 trackCenterAtGroundPlane(trackedPerson->center.x, trackedPerson->center.y, m_commonProperties->z_offset->getFloat());
+
+            // Group visualization circles (below tracks)
+            const double groupAssignmentCircleHeight = 0;
+            Ogre::Vector3 groupAssignmentCirclePos = trackCenterAtGroundPlane + Ogre::Vector3(0, 0, -0.5*groupAssignmentCircleHeight - 0.01);
+            groupVisual->groupAssignmentCircles[memberIndex]->setPosition(groupAssignmentCirclePos);
+
+            // Person visuals
+            const boost::shared_ptr<PersonVisual>& personVisual = groupVisual->personVisuals[memberIndex];
+            const double personHeight = personVisual ? personVisual->getHeight() : 0;
+            const Ogre::Matrix3 covXYZinTargetFrame = covarianceXYZIntoTargetFrame(trackedPerson->pose);
+            setPoseOrientation(groupVisual->personVisualSceneNodes[memberIndex].get(), trackedPerson->pose, covXYZinTargetFrame, personHeight);
+
+            // Intra-group connections, drawn for all groups at once below
+            groupVisual->memberPositions[memberIndex] = trackedPerson->center;
+
+            //
+            // Group affiliation history
+            //
+
+            GroupAffiliationHistoryEntry newHistoryEntry;
+            newHistoryEntry.position = mapFrameTransform.inverse() * trackCenterAtGroundPlane;
+            newHistoryEntry.wasOccluded = trackedPerson->isOccluded;
+            newHistoryEntry.wasSinglePersonGroup = trackedGroup.track_ids.size() <= 1;
+            newHistoryEntry.groupId = trackedGroup.group_id;
+
+            // The cloud drops its oldest point together with the history
+            if(m_groupAffiliationHistory.capacity() > 0) {
+                if(m_groupAffiliationHistory.full()) m_groupAffiliationHistoryCloud->popPoints(1);
                 m_groupAffiliationHistory.push_back(newHistoryEntry);
-
-
-            } // end if track found
-        } // end for loop over tracks
+                vector<rviz::PointCloud::Point> newPoint(1, getHistoryPoint(newHistoryEntry));
+                m_groupAffiliationHistoryCloud->addPoints(newPoint.begin(), newPoint.end());
+            }
+        } // end for loop over members
 
 
         //
         // Texts
         //
-        const geometry_msgs::Point& groupCenter = trackedGroup.centerOfGravity.pose.position;
-        groupVisual->groupCenter = groupCenter;
-
-        // Group ID
-        boost::shared_ptr<TextNode> idText(new TextNode(context_->getSceneManager(), m_groupsSceneNode.get()));
-        ss.str(""); ss << "group " << trackedGroup.group_id;
-        idText->setCaption(ss.str());
-        idText->showOnTop();
-        groupVisual->idText = idText;
+        groupVisual->groupCenter = trackedGroup.centerOfGravity.pose.position;
 
         // Set adjustable styles such as color etc.
         updateGroupVisualStyles(groupVisual);
-        updateHistoryStyles();
     } // end for loop over all tracked groups
 
+    // Remove visuals of groups that disappeared
+    for(group_map::iterator groupIt = m_groupVisuals.begin(); groupIt != m_groupVisuals.end(); ) {
+        if(encounteredGroupIds.find(groupIt->first) == encounteredGroupIds.end()) m_groupVisuals.erase(groupIt++);
+        else ++groupIt;
+    }
+
+    updateConnectionLines();
+
 
     //
     // Update status (shown in property pane)
@@ -34,6 +34,8 @@
 #ifndef Q_MOC_RUN
 #include <map>
 #include <boost/circular_buffer.hpp>
+#include <rviz/ogre_helpers/billboard_line.h>
+#include <rviz/ogre_helpers/point_cloud.h>
 #endif
 #include <spencer_tracking_msgs/TrackedGroups.h>
 
@@ -48,12 +50,12 @@ namespace spencer_tracking_rviz_plugin
     struct GroupAffiliationHistoryEntry
     {
         group_id groupId;
-        boost::shared_ptr<rviz::Shape> shape;
+        Ogre::Vector3 position; // in map frame
         bool wasOccluded, wasSinglePersonGroup;
     };
 
-    /// History of a tracked person.
-    typedef circular_buffer<boost::shared_ptr<GroupAffiliationHistoryEntry> > GroupAffiliationHistory;
+    /// History of all tracked persons, oldest entry first. Drawn as one point of m_groupAffiliationHistoryCloud per entry.
+    typedef circular_buffer<GroupAffiliationHistoryEntry> GroupAffiliationHistory;
 
     /// The display which can be added in RViz to display tracked groups.
     class TrackedGroupsDisplay: public PersonDisplayCommon<spencer_tracking_msgs::TrackedGroups>
@@ -62,7 +64,7 @@ namespace spencer_tracking_rviz_plugin
     public:
         // Constructor.  pluginlib::ClassLoader creates instances by calling
         // the default constructor, so make sure you have one.
-        TrackedGroupsDisplay() {};
+        TrackedGroupsDisplay() : m_connectionLineCapacity(0) {};
         virtual ~TrackedGroupsDisplay();
 
         // Overrides of protected virtual functions from Display.  As much
@@ -87,28 +89,42 @@ namespace spencer_tracking_rviz_plugin
         }
 
     private:
+        /// Visual of a group, kept across messages while the group exists. Member i of the group
+        /// (counting members with known position only) uses the i-th circle, person visual and scene node.
         struct GroupVisual {
             vector<boost::shared_ptr<rviz::Shape> > groupAssignmentCircles;
             vector<boost::shared_ptr<PersonVisual> > personVisuals;
             vector<boost::shared_ptr<Ogre::SceneNode> > personVisualSceneNodes;
-            vector<boost::shared_ptr<rviz::BillboardLine> > connectionLines;
+            vector<Ogre::Vector3> memberPositions; // end points of the connection lines
             boost::shared_ptr<TextNode> idText;
             group_id groupId;
             geometry_msgs::Point groupCenter;
             size_t personCount;
         };
+        typedef map<group_id, boost::shared_ptr<GroupVisual> > group_map;
 
         // Functions to handle an incoming ROS message.
         void processMessage(const spencer_tracking_msgs::TrackedGroups::ConstPtr& msg);
        
         // Helper functions
         void updateGroupVisualStyles(boost::shared_ptr<GroupVisual>& groupVisual);
+        void updateConnectionLines();
         void updateHistoryStyles();
+        void resizeGroupVisual(boost::shared_ptr<GroupVisual>& groupVisual, size_t memberCount);
+        Ogre::ColourValue getGroupColor(group_id groupId, bool isSinglePersonGroup);
+        rviz::PointCloud::Point getHistoryPoint(const GroupAffiliationHistoryEntry& entry);
         bool isGroupHidden(group_id groupId);
 
         // Scene node for group affiliation history visualization
         boost::shared_ptr<Ogre::SceneNode> m_groupAffiliationHistorySceneNode, m_groupsSceneNode;
 
+        // All history entries, drawn as instanced points; entries are appended and popped in FIFO order
+        boost::shared_ptr<rviz::PointCloud> m_groupAffiliationHistoryCloud;
+
+        // Intra-group connections of all groups, one line of two points per connection
+        boost::shared_ptr<rviz::BillboardLine> m_connectionLines;
+        unsigned int m_connectionLineCapacity;
+
         std::string m_realFixedFrame;
 
         // User-editable property variables.
@@ -127,7 +143,7 @@ namespace spencer_tracking_rviz_plugin
         rviz::FloatProperty* m_group_id_offset; // z offset of the group ID text
 
         // State variables
-        vector<boost::shared_ptr<GroupVisual> > m_groupVisuals;
+        group_map m_groupVisuals;
         
         map<track_id, group_id> m_groupAffiliations;
         GroupAffiliationHistory m_groupAffiliationHistory;
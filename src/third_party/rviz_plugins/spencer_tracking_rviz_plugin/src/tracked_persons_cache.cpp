@@ -40,9 +40,21 @@
 namespace spencer_tracking_rviz_plugin
 {
 
+namespace
+{
+// Multiplying by an odd constant permutes the low bits, consecutive track IDs thus land in distinct slots
+size_t hashTrackId(track_id trackId, size_t mask)
+{
+    return (trackId * 2654435769u) & mask;
+}
+}
+
+TrackedPersonsCache::TrackedPersonsCache() : m_tracked_person_subscriber(NULL), m_numUsed(0), m_generation(1)
+{
+}
+
 TrackedPersonsCache::~TrackedPersonsCache()
 {
-    m_cachedTrackedPersons.clear();
     delete m_tracked_person_subscriber;
 }
 
@@ -57,14 +69,69 @@ void TrackedPersonsCache::initialize(rviz::Display* display, rviz::DisplayContex
 
 void TrackedPersonsCache::reset()
 {
-    m_cachedTrackedPersons.clear();
+    for(size_t i = 0; i < m_slots.size(); i++) m_slots[i].used = false;
+    m_numUsed = 0;
+    m_currentSlots.clear();
+    m_generation++;
+}
+
+const TrackedPersonsCache::Slot* TrackedPersonsCache::find(track_id trackId) const
+{
+    if(m_slots.empty()) return NULL;
+
+    const size_t mask = m_slots.size() - 1;
+    for(size_t i = hashTrackId(trackId, mask); m_slots[i].used; i = (i + 1) & mask) {
+        if(m_slots[i].person.trackId == trackId) {
+            return m_slots[i].generation == m_generation ? &m_slots[i] : NULL;
+        }
+    }
+    return NULL;
+}
+
+TrackedPersonsCache::Slot& TrackedPersonsCache::insert(track_id trackId)
+{
+    // the table is at most half full, so the probing ends at an unused slot
+    const size_t mask = m_slots.size() - 1;
+    size_t i = hashTrackId(trackId, mask), stale = m_slots.size();
+    for(; m_slots[i].used; i = (i + 1) & mask) {
+        if(m_slots[i].person.trackId == trackId) return m_slots[i];
+        if(stale == m_slots.size() && m_slots[i].generation != m_generation) stale = i;
+    }
+
+    if(stale != m_slots.size()) return m_slots[stale];
+    m_slots[i].used = true;
+    m_numUsed++;
+    return m_slots[i];
 }
 
-const boost::shared_ptr<CachedTrackedPerson> TrackedPersonsCache::lookup(track_id trackId)
+void TrackedPersonsCache::reserve(size_t incoming)
 {
-    CachedTrackedPersonsMap::const_iterator entry = m_cachedTrackedPersons.find(trackId);
-    if(entry == m_cachedTrackedPersons.end()) return boost::shared_ptr<CachedTrackedPerson>();
-    else return entry->second;
+    if(2 * (m_numUsed + incoming) <= m_slots.size()) return;
+
+    // rehash the tracks of the current generation, dropping the stale ones
+    size_t numCurrent = 0;
+    for(size_t i = 0; i < m_slots.size(); i++) {
+        if(m_slots[i].used && m_slots[i].generation == m_generation) numCurrent++;
+    }
+    size_t size = 16;
+    while(size < 4 * (numCurrent + incoming)) size *= 2;
+
+    std::vector<Slot> slots(size);
+    for(size_t i = 0; i < size; i++) slots[i].used = false;
+    m_slots.swap(slots);
+    m_numUsed = 0;
+    for(size_t i = 0; i < slots.size(); i++) {
+        if(slots[i].used && slots[i].generation == m_generation) {
+            Slot& slot = insert(slots[i].person.trackId);
+            slot = slots[i];
+        }
+    }
+}
+
+const CachedTrackedPerson* TrackedPersonsCache::lookup(track_id trackId) const
+{
+    const Slot* slot = find(trackId);
+    return slot ? &slot->person : NULL;
 }
 
 void TrackedPersonsCache::processTrackedPersonsMessage(const spencer_tracking_msgs::TrackedPersons::ConstPtr& msg)
@@ -75,14 +142,21 @@ void TrackedPersonsCache::processTrackedPersonsMessage(const spencer_tracking_ms
     Ogre::Matrix4 transform(frameOrientation);
     transform.setTrans(frameOrigin);
 
+    // Tracks of the previous message which are not refreshed below become stale
+    reserve(msg->tracks.size());
+    m_generation++;
+    m_currentSlots.clear();
+
     // Now iterate over all tracks and store their positions
-    m_cachedTrackedPersons.clear();
-    foreach(spencer_tracking_msgs::TrackedPerson trackedPerson, msg->tracks)
+    foreach(const spencer_tracking_msgs::TrackedPerson& trackedPerson, msg->tracks)
     {
-        m_cachedTrackedPersons[trackedPerson.track_id] = boost::shared_ptr<CachedTrackedPerson>(new CachedTrackedPerson);
-        CachedTrackedPerson& cachedTrackedPerson = *m_cachedTrackedPersons[trackedPerson.track_id];
+        Slot& slot = insert(trackedPerson.track_id);
+        if(slot.generation != m_generation) m_currentSlots.push_back(&slot - &m_slots[0]);  // not a duplicate ID
+        slot.generation = m_generation;
 
+        CachedTrackedPerson& cachedTrackedPerson = slot.person;
         const geometry_msgs::Point& position = trackedPerson.pose.pose.position;
+        cachedTrackedPerson.trackId = trackedPerson.track_id;
         cachedTrackedPerson.center = transform * Ogre::Vector3(position.x, position.y, position.z);
         cachedTrackedPerson.pose = trackedPerson.pose;
         cachedTrackedPerson.twist = trackedPerson.twist;
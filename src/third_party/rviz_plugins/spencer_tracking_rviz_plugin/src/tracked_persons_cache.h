@@ -32,7 +32,7 @@
 #define TRACKED_PERSONS_CACHE_H
 
 #ifndef Q_MOC_RUN
-#include <map>
+#include <vector>
 #include <geometry_msgs/PoseWithCovariance.h>
 #include <geometry_msgs/TwistWithCovariance.h>
 #include <spencer_tracking_msgs/TrackedPersons.h>
@@ -46,6 +46,7 @@ namespace spencer_tracking_rviz_plugin
     /// Data structure for storing information about individual person tracks
     struct CachedTrackedPerson
     {
+        track_id trackId;
         Ogre::Vector3 center;
         geometry_msgs::PoseWithCovariance pose;
         geometry_msgs::TwistWithCovariance twist;
@@ -54,9 +55,13 @@ namespace spencer_tracking_rviz_plugin
 
     /// Subscribes to a TrackedPersons topic and caches all TrackedPersons of the current cycle, so that
     /// the owning rviz::Display can look up track positions etc for visualization.
+    ///
+    /// Tracks are kept in an open-addressing hash table keyed by track ID and updated in place. Every message starts
+    /// a new generation; entries not refreshed by it count as absent and their slots are reused by later tracks, so
+    /// neither updates nor lookups allocate once the table has grown to the size of the crowd.
     class TrackedPersonsCache {
     public:
-        typedef std::map<track_id, boost::shared_ptr<CachedTrackedPerson> > CachedTrackedPersonsMap;
+        TrackedPersonsCache();
 
         // Destructor
         ~TrackedPersonsCache();
@@ -67,24 +72,50 @@ namespace spencer_tracking_rviz_plugin
         /// Clear internal state, including all cached track positions.
         void reset();
 
-        /// Lookup information for the given tracked person ID. Returns a null pointer if no information is available.
-        const boost::shared_ptr<CachedTrackedPerson> lookup(track_id trackId);
+        /// Lookup information for the given tracked person ID. Returns a null pointer if the track was not in the
+        /// latest message. The pointer is valid until the next message arrives.
+        const CachedTrackedPerson* lookup(track_id trackId) const;
 
-        /// Return internal map
-        const CachedTrackedPersonsMap& getMap() {
-            return m_cachedTrackedPersons;
+        /// Number of tracks in the latest message
+        size_t size() const {
+            return m_currentSlots.size();
+        }
+
+        /// The i-th track of the latest message, in message order
+        const CachedTrackedPerson& operator[](size_t i) const {
+            return m_slots[m_currentSlots[i]].person;
         }
 
     private:
+        struct Slot
+        {
+            bool used;            // ever held a track, ends the probe sequence if false
+            unsigned generation;  // message that last refreshed the track, stale if not the current one
+            CachedTrackedPerson person;
+        };
+
         // Callback when a new TrackedPersons message has arrived
         void processTrackedPersonsMessage(const spencer_tracking_msgs::TrackedPersons::ConstPtr& msg);
 
+        // Slot holding the track of this generation, or NULL
+        const Slot* find(track_id trackId) const;
+
+        // Slot of the track, reusing a stale or empty one if it is not in the table
+        Slot& insert(track_id trackId);
+
+        // Make room for incoming more tracks, keeping only the tracks of the current generation
+        void reserve(size_t incoming);
+
         rviz::AdditionalTopicSubscriber<spencer_tracking_msgs::TrackedPersons>* m_tracked_person_subscriber;
         rviz::Display* m_display;
         rviz::DisplayContext* m_context;
 
-        // Our TrackedPerson memory
-        CachedTrackedPersonsMap m_cachedTrackedPersons;
+        // Our TrackedPerson memory, the size is a power of two
+        std::vector<Slot> m_slots;
+        size_t m_numUsed;
+        unsigned m_generation;
+        // slots of the tracks in the latest message
+        std::vector<size_t> m_currentSlots;
     };
     
 
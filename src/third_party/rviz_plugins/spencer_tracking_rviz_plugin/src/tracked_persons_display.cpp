@@ -118,11 +118,13 @@ void TrackedPersonsDisplay::onInitialize()
 
   // Create a scene node for visualizing track history
   m_trackHistorySceneNode = boost::shared_ptr<Ogre::SceneNode>(scene_node_->createChildSceneNode());
+  m_trackHistory.reset(new HistoryVisual(context_->getSceneManager(), m_trackHistorySceneNode.get()));
 }
 
 TrackedPersonsDisplay::~TrackedPersonsDisplay()
 {
   m_cachedTracks.clear();
+  m_trackHistory.reset();
 }
 
 // Clear the visuals by deleting their objects.
@@ -130,6 +132,8 @@ void TrackedPersonsDisplay::reset()
 {
   PersonDisplayCommon::reset();
   m_cachedTracks.clear();
+  if (m_trackHistory)
+    m_trackHistory->clear();
 }
 
 void TrackedPersonsDisplay::update(float wall_dt, float ros_dt)
@@ -158,19 +162,19 @@ void TrackedPersonsDisplay::update(float wall_dt, float ros_dt)
         trackedPersonVisual->sceneNode->setOrientation(orientation);
       }
     }
-    else
-    {
-      // Update animation etc.
-      if (trackedPersonVisual->personVisual)
-        trackedPersonVisual->personVisual->update(ros_dt);
-    }
+
+    // Switch to the impostor when far away; animation etc. only for full visuals in view
+    if (updateLevelOfDetail(trackedPersonVisual->personVisual) && !trackedPersonVisual->isDeleted)
+      trackedPersonVisual->personVisual->update(ros_dt);
   }
 }
 
 /// Update all dynamically adjusted visualization properties (colors, font sizes etc.) of all currently tracked persons
 void TrackedPersonsDisplay::stylesChanged()
 {
-  const Ogre::Quaternion shapeQuaternion(Ogre::Degree(90), Ogre::Vector3(1, 0, 0));
+  // Update history size and style, rewrites the whole history only if they changed
+  m_trackHistory->setCapacity(m_history_length_property->getInt());
+  m_trackHistory->setStyle(m_render_history_as_line_property->getBool(), m_history_line_width_property->getFloat());
 
   // Update each track
   foreach (const track_map::value_type& entry, m_cachedTracks)
@@ -194,8 +198,6 @@ void TrackedPersonsDisplay::stylesChanged()
       trackVisible &= m_show_matched_property->getBool();
 
     trackedPersonVisual->sceneNode->setVisible(trackVisible);
-    trackedPersonVisual->historySceneNode->setVisible(trackVisible && !m_render_history_as_line_property->getBool());
-    trackedPersonVisual->historyLineSceneNode->setVisible(trackVisible && m_render_history_as_line_property->getBool());
 
     // Get current track color
     Ogre::ColourValue trackColorWithFullAlpha = getColorFromId(trackId);
@@ -216,36 +218,14 @@ void TrackedPersonsDisplay::stylesChanged()
       trackedPersonVisual->personVisual->setColor(personColor);
     }
 
-    // Update history size
-    trackedPersonVisual->history.rset_capacity(m_history_length_property->getInt());
-
-    // Update history color
-    foreach (boost::shared_ptr<TrackedPersonHistoryEntry> historyEntry, trackedPersonVisual->history)
-    {
-      const double historyShapeDiameter = 0.1;
-      Ogre::ColourValue historyColor = trackColorWithFullAlpha;
-      historyColor.a *= m_commonProperties->alpha->getFloat();  // general alpha
-      if (historyEntry->wasOccluded)
-        historyColor.a *= m_occlusion_alpha_property->getFloat();
-      if (isPersonHidden(trackId) || m_render_history_as_line_property->getBool())
-        historyColor.a = 0;
-
-      if (historyEntry->shape)
-      {
-        historyEntry->shape->setColor(historyColor);
-        historyEntry->shape->setScale(shapeQuaternion *
-                                      Ogre::Vector3(historyShapeDiameter, historyShapeDiameter, 0.05));
-      }
-    }
-
-    if (trackedPersonVisual->historyLine)
-    {  // history-as-line mode (as opposed to history-as-dots)
-      Ogre::ColourValue historyColor = trackColorWithFullAlpha;
-      historyColor.a *= m_commonProperties->alpha->getFloat();  // general alpha
-      if (isPersonHidden(trackId))
-        historyColor.a = 0;
-      trackedPersonVisual->historyLine->setColor(historyColor.r, historyColor.g, historyColor.b, historyColor.a);
-    }
+    // Update history color, only dots of occluded entries are faded
+    Ogre::ColourValue historyColor = trackColorWithFullAlpha;
+    historyColor.a *= m_commonProperties->alpha->getFloat();  // general alpha
+    if (!trackVisible)
+      historyColor.a = 0;
+    const float historyOcclusionAlpha =
+        m_render_history_as_line_property->getBool() ? 1.0 : m_occlusion_alpha_property->getFloat();
+    m_trackHistory->setColor(trackId, historyColor, historyOcclusionAlpha);
 
     // Update text colors, font size and visibility
     const double personHeight = trackedPersonVisual->personVisual ? trackedPersonVisual->personVisual->getHeight() : 0;
@@ -253,6 +233,11 @@ void TrackedPersonsDisplay::stylesChanged()
                                       m_commonProperties->constant_font_color->getOgreColor() :
                                       trackColor;
     fontColor.a = m_commonProperties->alpha->getFloat();
+    const double textDistance = getTextRenderingDistance();
+
+    trackedPersonVisual->detectionIdText->setRenderingDistance(textDistance);
+    trackedPersonVisual->stateText->setRenderingDistance(textDistance);
+    trackedPersonVisual->idText->setRenderingDistance(textDistance);
 
     trackedPersonVisual->detectionIdText->setCharacterHeight(0.18 * m_commonProperties->font_scale->getFloat());
     trackedPersonVisual->detectionIdText->setVisible(!trackedPersonVisual->isOccluded &&
@@ -322,8 +307,6 @@ void TrackedPersonsDisplay::processMessage(const spencer_tracking_msgs::TrackedP
   Ogre::Matrix4 mapFrameTransform(mapFrameOrientation);
   mapFrameTransform.setTrans(mapFramePosition);
 
-  // Transform required to fix orientation of any Cylinder shapes
-  const Ogre::Quaternion shapeQuaternion(Ogre::Degree(90), Ogre::Vector3(1, 0, 0));
   stringstream ss;
 
   //
@@ -360,10 +343,6 @@ void TrackedPersonsDisplay::processMessage(const spencer_tracking_msgs::TrackedP
 
       // This scene node is the parent of all visualization elements for the tracked person
       trackedPersonVisual->sceneNode = boost::shared_ptr<Ogre::SceneNode>(scene_node_->createChildSceneNode());
-      trackedPersonVisual->historySceneNode =
-          boost::shared_ptr<Ogre::SceneNode>(m_trackHistorySceneNode->createChildSceneNode());
-      trackedPersonVisual->historyLineSceneNode =
-          boost::shared_ptr<Ogre::SceneNode>(m_trackHistorySceneNode->createChildSceneNode());
     }
 
     // These values need to be remembered for later use in stylesChanged()
@@ -416,42 +395,8 @@ void TrackedPersonsDisplay::processMessage(const spencer_tracking_msgs::TrackedP
     if ((trackedPersonVisual->positionOfLastHistoryEntry - newHistoryEntryPosition).length() >
         MIN_HISTORY_ENTRY_DISTANCE)
     {
-      // General history
-      boost::shared_ptr<TrackedPersonHistoryEntry> newHistoryEntry(new TrackedPersonHistoryEntry);
-      newHistoryEntry->trackId = trackedPersonIt->track_id;
-      newHistoryEntry->position = newHistoryEntryPosition;  // used by history lines (below) even if no shape is set
-      newHistoryEntry->wasOccluded = trackedPersonIt->is_occluded;
-      trackedPersonVisual->history.push_back(newHistoryEntry);
-
-      // Always need to reset history line since history is like a queue, oldest element has to be removed but
-      // BillboardLine doesn't offer that functionality
-      trackedPersonVisual->historyLine.reset(
-          new rviz::BillboardLine(context_->getSceneManager(), trackedPersonVisual->historyLineSceneNode.get()));
-
-      if (m_render_history_as_line_property->getBool())
-      {
-        // History lines
-        if (trackedPersonVisual->history.size() >= 2)
-        {
-          trackedPersonVisual->historyLine->setLineWidth(m_history_line_width_property->getFloat());
-          trackedPersonVisual->historyLine->setMaxPointsPerLine(trackedPersonVisual->history.size());
-
-          foreach (const boost::shared_ptr<TrackedPersonHistoryEntry>& historyEntry, trackedPersonVisual->history)
-          {
-            historyEntry->shape.reset();  // remove existing dot shapes, if any, for better performance
-            trackedPersonVisual->historyLine->addPoint(historyEntry->position);
-          }
-        }
-      }
-      else
-      {
-        // History dots
-        newHistoryEntry->shape = boost::shared_ptr<rviz::Shape>(new rviz::Shape(
-            rviz::Shape::Cylinder, context_->getSceneManager(), trackedPersonVisual->historySceneNode.get()));
-        newHistoryEntry->shape->setPosition(newHistoryEntryPosition);
-        newHistoryEntry->shape->setOrientation(shapeQuaternion);
-      }
-
+      // Overwrites the oldest entry in place once the history is full
+      m_trackHistory->addPoint(trackedPersonIt->track_id, newHistoryEntryPosition, trackedPersonIt->is_occluded);
       trackedPersonVisual->positionOfLastHistoryEntry = newHistoryEntryPosition;
     }
 
@@ -590,6 +535,7 @@ void TrackedPersonsDisplay::processMessage(const spencer_tracking_msgs::TrackedP
   for (set<unsigned int>::const_iterator setIt = trackIdsToDelete.begin(); setIt != trackIdsToDelete.end(); ++setIt)
   {
     m_cachedTracks.erase(*setIt);
+    m_trackHistory->removeTrack(*setIt);
   }
 
   //
@@ -36,32 +36,19 @@
 #include <boost/circular_buffer.hpp>
 #include <spencer_tracking_msgs/TrackedPersons.h>
 #include "person_display_common.h"
+#include "visuals/history_visual.h"
 #endif
 
 namespace spencer_tracking_rviz_plugin
 {
     typedef unsigned int track_id;
 
-    /// A single entry in the history of a tracked person.
-    struct TrackedPersonHistoryEntry
-    {
-        Ogre::Vector3 position;
-        boost::shared_ptr<rviz::Shape> shape;
-        bool wasOccluded;
-        track_id trackId;
-    };
-
-    /// History of a tracked person.
-    typedef circular_buffer<boost::shared_ptr<TrackedPersonHistoryEntry> > TrackedPersonHistory;
-
-    /// The visual of a tracked person.
+    /// The visual of a tracked person. Its history is kept in the display's HistoryVisual.
     struct TrackedPersonVisual
     {
-        TrackedPersonHistory history;
-        boost::shared_ptr<rviz::BillboardLine> historyLine;
         Ogre::Vector3 positionOfLastHistoryEntry;
 
-        boost::shared_ptr<Ogre::SceneNode> sceneNode, historySceneNode, historyLineSceneNode;
+        boost::shared_ptr<Ogre::SceneNode> sceneNode;
 
         boost::shared_ptr<PersonVisual> personVisual;
         boost::shared_ptr<TextNode> idText, detectionIdText, stateText;
@@ -122,6 +109,8 @@ namespace spencer_tracking_rviz_plugin
 
         // Scene node for track history visualization
         boost::shared_ptr<Ogre::SceneNode> m_trackHistorySceneNode;
+        // Histories of all tracks, attached to m_trackHistorySceneNode
+        boost::shared_ptr<HistoryVisual> m_trackHistory;
         std::string m_realFixedFrame;
 
         // User-editable property variables.
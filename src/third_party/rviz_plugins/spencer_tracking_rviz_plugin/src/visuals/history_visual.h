@@ -0,0 +1,365 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2013-2015, Timm Linder, Social Robotics Lab, University of Freiburg
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *  * Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ *  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HISTORY_VISUAL_H
+#define HISTORY_VISUAL_H
+
+#include <OgreHardwareBufferManager.h>
+#include <OgreMaterialManager.h>
+#include <OgreRoot.h>
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+#include <OgreSimpleRenderable.h>
+#include <OgreTechnique.h>
+
+#include <boost/circular_buffer.hpp>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace spencer_tracking_rviz_plugin
+{
+// Track histories of a whole display in one dynamic vertex buffer. Every track owns a block of point slots that is
+// used as a ring buffer: a new point overwrites the slot of the oldest one in place, so adding a point writes a few
+// vertices instead of recreating a line or a shape per entry. Points are drawn as flat dots, or as ribbon segments
+// from their predecessor.
+class HistoryVisual
+{
+public:
+  HistoryVisual(Ogre::SceneManager* sceneManager, Ogre::SceneNode* parentNode)
+    : m_sceneManager(sceneManager), m_capacity(100), m_numBlocks(0), m_asLine(true), m_lineWidth(0.05)
+  {
+    static int count = 0;
+    std::stringstream ss;
+    ss << "history_visual" << count++;
+
+    m_material = Ogre::MaterialManager::getSingleton().create(ss.str() + "Material",
+                                                              Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+    m_material->setReceiveShadows(false);
+    m_material->getTechnique(0)->setLightingEnabled(false);
+    m_material->getTechnique(0)->setSceneBlending(Ogre::SBT_TRANSPARENT_ALPHA);
+    m_material->getTechnique(0)->setDepthWriteEnabled(false);
+    m_material->getTechnique(0)->setCullingMode(Ogre::CULL_NONE);
+    m_material->getTechnique(0)->getPass(0)->setVertexColourTracking(Ogre::TVC_DIFFUSE);
+
+    m_renderable = new Renderable();
+    m_renderable->setMaterial(m_material->getName());
+    m_sceneNode = parentNode->createChildSceneNode();
+    m_sceneNode->attachObject(m_renderable);
+
+    reserveBlocks(16);
+  }
+
+  virtual ~HistoryVisual()
+  {
+    m_sceneNode->detachAllObjects();
+    delete m_renderable;
+    m_sceneManager->destroySceneNode(m_sceneNode->getName());
+    m_material->unload();
+    Ogre::MaterialManager::getSingleton().remove(m_material->getName());
+  }
+
+  /// Number of points kept per track; the newest ones are kept when shrinking.
+  void setCapacity(unsigned int capacity)
+  {
+    capacity = std::max(1u, capacity);
+    if (capacity == m_capacity)
+      return;
+    m_capacity = capacity;
+    for (TrackMap::iterator it = m_tracks.begin(); it != m_tracks.end(); ++it)
+    {
+      it->second.entries.rset_capacity(m_capacity);
+      it->second.numAdded = it->second.entries.size();
+    }
+    rebuild();
+  }
+
+  /// Draw the history as a line of the given width, or as dots.
+  void setStyle(bool asLine, float lineWidth)
+  {
+    if (asLine == m_asLine && lineWidth == m_lineWidth)
+      return;
+    m_asLine = asLine;
+    m_lineWidth = lineWidth;
+    rebuild();
+  }
+
+  /// Color of a track's history, occludedAlpha multiplies the alpha of points added while occluded.
+  void setColor(unsigned int trackId, const Ogre::ColourValue& color, float occludedAlpha)
+  {
+    TrackMap::iterator it = m_tracks.find(trackId);
+    if (it == m_tracks.end() || (it->second.color == color && it->second.occludedAlpha == occludedAlpha))
+      return;
+    it->second.color = color;
+    it->second.occludedAlpha = occludedAlpha;
+    writeBlock(it->second);
+  }
+
+  void addPoint(unsigned int trackId, const Ogre::Vector3& position, bool wasOccluded)
+  {
+    TrackMap::iterator it = m_tracks.find(trackId);
+    if (it == m_tracks.end())
+    {
+      if (m_freeBlocks.empty())
+        reserveBlocks(2 * m_numBlocks);
+      Track track;
+      track.block = m_freeBlocks.back();
+      track.entries.set_capacity(m_capacity);
+      track.numAdded = 0;
+      track.color = Ogre::ColourValue(0, 0, 0, 0);
+      track.occludedAlpha = 1;
+      m_freeBlocks.pop_back();
+      it = m_tracks.insert(TrackMap::value_type(trackId, track)).first;
+    }
+
+    Track& track = it->second;
+    Entry entry = { position, wasOccluded };
+    track.entries.push_back(entry);
+    track.numAdded++;
+    writePoint(track, track.entries.size() - 1);
+    // the oldest point lost its predecessor if the ring buffer wrapped around
+    if (m_asLine && track.entries.full())
+      writePoint(track, 0);
+  }
+
+  void removeTrack(unsigned int trackId)
+  {
+    TrackMap::iterator it = m_tracks.find(trackId);
+    if (it == m_tracks.end())
+      return;
+    it->second.entries.clear();
+    writeBlock(it->second);
+    m_freeBlocks.push_back(it->second.block);
+    m_tracks.erase(it);
+  }
+
+  void clear()
+  {
+    m_tracks.clear();
+    m_freeBlocks.clear();
+    for (unsigned int block = m_numBlocks; block > 0; block--)
+      m_freeBlocks.push_back(block - 1);
+    rebuild();
+  }
+
+private:
+  // a dot is a hexagon of four triangles, a line segment a quad of two and four degenerate ones
+  static const unsigned int VERTICES_PER_POINT = 12;
+
+  struct Vertex
+  {
+    float x, y, z;
+    Ogre::RGBA color;
+  };
+
+  struct Entry
+  {
+    Ogre::Vector3 position;
+    bool wasOccluded;
+  };
+
+  struct Track
+  {
+    unsigned int block;
+    boost::circular_buffer<Entry> entries;
+    unsigned long numAdded;  // the newest entry is in slot (numAdded - 1) % capacity of the block
+    Ogre::ColourValue color;
+    float occludedAlpha;
+  };
+  typedef std::map<unsigned int, Track> TrackMap;
+
+  // Unlit triangle list over the whole vertex buffer, never culled (the histories span the map)
+  class Renderable : public Ogre::SimpleRenderable
+  {
+  public:
+    Renderable()
+    {
+      mRenderOp.vertexData = new Ogre::VertexData();
+      mRenderOp.vertexData->vertexStart = 0;
+      mRenderOp.vertexData->vertexCount = 0;
+      mRenderOp.vertexData->vertexDeclaration->addElement(0, 0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+      mRenderOp.vertexData->vertexDeclaration->addElement(0, Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3),
+                                                          Ogre::VET_COLOUR, Ogre::VES_DIFFUSE);
+      mRenderOp.operationType = Ogre::RenderOperation::OT_TRIANGLE_LIST;
+      mRenderOp.useIndexes = false;
+      mBox.setInfinite();
+    }
+
+    virtual ~Renderable()
+    {
+      delete mRenderOp.vertexData;
+    }
+
+    void setBuffer(const Ogre::HardwareVertexBufferSharedPtr& buffer, size_t vertexCount)
+    {
+      mRenderOp.vertexData->vertexBufferBinding->setBinding(0, buffer);
+      mRenderOp.vertexData->vertexCount = vertexCount;
+    }
+
+    virtual Ogre::Real getSquaredViewDepth(const Ogre::Camera* camera) const
+    {
+      return 0;
+    }
+
+    virtual Ogre::Real getBoundingRadius() const
+    {
+      return 0;
+    }
+  };
+
+  size_t firstVertex(const Track& track, unsigned long slot) const
+  {
+    return (track.block * m_capacity + slot) * VERTICES_PER_POINT;
+  }
+
+  // Vertices of the k-th oldest entry of a track
+  void fillPoint(const Track& track, size_t k, Vertex* vertices) const
+  {
+    const Entry& entry = track.entries[k];
+    Ogre::ColourValue color = track.color;
+    if (entry.wasOccluded)
+      color.a *= track.occludedAlpha;
+    Ogre::RGBA rgba;
+    Ogre::Root::getSingleton().convertColourValue(color, &rgba);
+
+    Ogre::Vector3 corners[VERTICES_PER_POINT];
+    for (unsigned int i = 0; i < VERTICES_PER_POINT; i++)
+      corners[i] = entry.position;
+
+    if (!m_asLine)
+    {
+      const double radius = 0.05;
+      Ogre::Vector3 hexagon[6];
+      for (unsigned int i = 0; i < 6; i++)
+        hexagon[i] = entry.position + radius * Ogre::Vector3(std::cos(i * M_PI / 3), std::sin(i * M_PI / 3), 0);
+      for (unsigned int i = 0; i < 4; i++)
+      {
+        corners[3 * i] = hexagon[0];
+        corners[3 * i + 1] = hexagon[i + 1];
+        corners[3 * i + 2] = hexagon[i + 2];
+      }
+    }
+    else if (k > 0)
+    {
+      const Ogre::Vector3& from = track.entries[k - 1].position;
+      Ogre::Vector3 side(from.y - entry.position.y, entry.position.x - from.x, 0);
+      if (side.normalise() > 0)
+      {
+        side *= 0.5 * m_lineWidth;
+        corners[0] = from + side;
+        corners[1] = from - side;
+        corners[2] = entry.position + side;
+        corners[3] = entry.position + side;
+        corners[4] = from - side;
+        corners[5] = entry.position - side;
+      }
+    }
+
+    for (unsigned int i = 0; i < VERTICES_PER_POINT; i++)
+    {
+      vertices[i].x = corners[i].x;
+      vertices[i].y = corners[i].y;
+      vertices[i].z = corners[i].z;
+      vertices[i].color = rgba;
+    }
+  }
+
+  // Overwrite the slot of one entry in place
+  void writePoint(const Track& track, size_t k)
+  {
+    Vertex vertices[VERTICES_PER_POINT];
+    fillPoint(track, k, vertices);
+    unsigned long slot = (track.numAdded - track.entries.size() + k) % m_capacity;
+    m_buffer->writeData(firstVertex(track, slot) * sizeof(Vertex), sizeof(vertices), vertices);
+  }
+
+  // Fill all slots of a track's block, the unused ones with degenerate triangles
+  void fillBlock(const Track& track, Vertex* vertices) const
+  {
+    Vertex degenerate = { 0, 0, 0, 0 };
+    std::fill(vertices, vertices + m_capacity * VERTICES_PER_POINT, degenerate);
+    for (size_t k = 0; k < track.entries.size(); k++)
+    {
+      unsigned long slot = (track.numAdded - track.entries.size() + k) % m_capacity;
+      fillPoint(track, k, vertices + slot * VERTICES_PER_POINT);
+    }
+  }
+
+  void writeBlock(const Track& track)
+  {
+    m_scratch.resize(m_capacity * VERTICES_PER_POINT);
+    fillBlock(track, &m_scratch[0]);
+    m_buffer->writeData(firstVertex(track, 0) * sizeof(Vertex), m_scratch.size() * sizeof(Vertex), &m_scratch[0]);
+  }
+
+  // Grow to numBlocks blocks, the new ones are free
+  void reserveBlocks(unsigned int numBlocks)
+  {
+    numBlocks = std::max(numBlocks, 16u);
+    for (unsigned int block = numBlocks; block > m_numBlocks; block--)
+      m_freeBlocks.push_back(block - 1);
+    m_numBlocks = numBlocks;
+    rebuild();
+  }
+
+  // Recreate the vertex buffer for the current number of blocks and capacity and write all tracks
+  void rebuild()
+  {
+    const size_t blockSize = m_capacity * VERTICES_PER_POINT;
+    Vertex degenerate = { 0, 0, 0, 0 };
+    m_scratch.assign(m_numBlocks * blockSize, degenerate);
+    for (TrackMap::const_iterator it = m_tracks.begin(); it != m_tracks.end(); ++it)
+      fillBlock(it->second, &m_scratch[it->second.block * blockSize]);
+
+    m_buffer = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
+        sizeof(Vertex), m_scratch.size(), Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+    m_buffer->writeData(0, m_scratch.size() * sizeof(Vertex), &m_scratch[0], true);
+    m_renderable->setBuffer(m_buffer, m_scratch.size());
+  }
+
+  Ogre::SceneManager* m_sceneManager;
+  Ogre::SceneNode* m_sceneNode;
+  Renderable* m_renderable;
+  Ogre::MaterialPtr m_material;
+  Ogre::HardwareVertexBufferSharedPtr m_buffer;
+
+  TrackMap m_tracks;
+  std::vector<unsigned int> m_freeBlocks;
+  unsigned int m_capacity, m_numBlocks;
+  bool m_asLine;
+  float m_lineWidth;
+  std::vector<Vertex> m_scratch;
+};
+
+}  // namespace spencer_tracking_rviz_plugin
+
+#endif  // HISTORY_VISUAL_H
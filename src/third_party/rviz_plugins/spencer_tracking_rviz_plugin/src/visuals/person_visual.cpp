@@ -167,7 +167,7 @@ MeshPersonVisual::~MeshPersonVisual() {
     m_sceneManager->destroySceneNode(m_childSceneNode->getName());
 }
 
-void MeshPersonVisual::setColor(const Ogre::ColourValue& c) {
+void MeshPersonVisual::setVisualColor(const Ogre::ColourValue& c) {
     Ogre::SceneBlendType blending;
     bool depth_write;
 
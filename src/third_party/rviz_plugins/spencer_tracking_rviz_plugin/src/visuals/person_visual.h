@@ -38,6 +38,9 @@
 #include <OgreAnimation.h>
 #include <OgreSharedPtr.h>
 #include <OgreEntity.h>
+#include <OgreSphere.h>
+
+#include <limits>
 
 
 namespace spencer_tracking_rviz_plugin {
@@ -59,7 +62,8 @@ namespace spencer_tracking_rviz_plugin {
     public:
         PersonVisual(const PersonVisualDefaultArgs& args) :
                 m_sceneManager(args.sceneManager),
-                m_correctOrientation( Ogre::Degree(90), Ogre::Vector3(1,0,0) )
+                m_correctOrientation( Ogre::Degree(90), Ogre::Vector3(1,0,0) ),
+                m_impostor(NULL), m_isImpostor(false), m_scalingFactor(1.0)
         {
             m_parentSceneNode = args.parentNode;
             m_sceneNode = args.parentNode->createChildSceneNode();
@@ -69,11 +73,13 @@ namespace spencer_tracking_rviz_plugin {
         }
 
         virtual ~PersonVisual() {
+            delete m_impostor;
             m_sceneManager->destroySceneNode(m_sceneNode->getName());
         };
 
         void setPosition(const Ogre::Vector3& position) {
             m_sceneNode->setPosition(position);
+            if(m_impostor) m_impostor->setPosition(position);
         }
 
         const Ogre::Vector3& getPosition() const {
@@ -90,24 +96,86 @@ namespace spencer_tracking_rviz_plugin {
 
         virtual void setScalingFactor(double scalingFactor) {
             m_sceneNode->setScale(scalingFactor, scalingFactor, scalingFactor);
+            m_scalingFactor = scalingFactor;
+            if(m_impostor) m_impostor->setScale(Ogre::Vector3(scalingFactor));
         }
 
         void setVisible(bool visible) {
             m_sceneNode->setVisible(visible, true);
+            if(m_impostor) m_impostor->getSceneNode()->setVisible(visible, true);
         }
 
         Ogre::SceneNode* getParentSceneNode() {
             return m_parentSceneNode;
         }
 
+        void setColor(const Ogre::ColourValue& c) {
+            m_color = c;
+            setVisualColor(c);
+            if(m_impostor) m_impostor->setColor(c.r, c.g, c.b, m_isImpostor ? c.a : 0.0f);
+        }
+
+        /// Sphere around the person in world coordinates, for culling and level of detail
+        Ogre::Sphere getWorldBoundingSphere() {
+            return Ogre::Sphere(m_sceneNode->_getDerivedPosition(), 0.5 * getHeight() * m_scalingFactor);
+        }
+
+        /// Draw the person as a camera-facing billboard of the same size. The full visual and the impostor are switched
+        /// through their rendering distance and alpha instead of their visibility, so the visibility that displays set
+        /// on the parent scene node still applies to both. Only the caller decides when to switch, with one threshold.
+        void setImpostor(bool impostor) {
+            // Ogre skips an object further away than its rendering distance plus its bounding radius, which holds for
+            // the full visual at any impostor distance beyond the person's size. Applied on every call because some
+            // visuals recreate their objects when restyled.
+            setRenderingDistance(m_sceneNode, impostor ? std::numeric_limits<Ogre::Real>::min() : 0.0f);
+
+            if(impostor == m_isImpostor) return;
+            m_isImpostor = impostor;
+
+            if(!m_impostor) {
+                const double halfHeight = 0.5 * getHeight();
+                m_impostor = new rviz::BillboardLine(m_sceneManager, m_parentSceneNode);
+                m_impostor->setMaxPointsPerLine(2);
+                m_impostor->setNumLines(1);
+                m_impostor->setLineWidth(getWidth());
+                m_impostor->addPoint(Ogre::Vector3(0, 0, -halfHeight));
+                m_impostor->addPoint(Ogre::Vector3(0, 0, +halfHeight));
+                m_impostor->setPosition(m_sceneNode->getPosition());
+                m_impostor->setScale(Ogre::Vector3(m_scalingFactor));
+            }
+            m_impostor->setColor(m_color.r, m_color.g, m_color.b, m_isImpostor ? m_color.a : 0.0f);
+        }
+
+        bool isImpostor() const {
+            return m_isImpostor;
+        }
+
         virtual void update(float deltaTime) {}
-        virtual void setColor(const Ogre::ColourValue& c) = 0;
         virtual double getHeight() = 0;
+        virtual double getWidth() {
+            return 0.4;
+        }
 
     protected:
+        virtual void setVisualColor(const Ogre::ColourValue& c) = 0;
+
         Ogre::SceneManager* m_sceneManager;
         Ogre::SceneNode *m_sceneNode, *m_parentSceneNode;
         Ogre::Quaternion m_correctOrientation;
+
+    private:
+        static void setRenderingDistance(Ogre::SceneNode* sceneNode, Ogre::Real distance) {
+            Ogre::SceneNode::ObjectIterator objects = sceneNode->getAttachedObjectIterator();
+            while(objects.hasMoreElements()) objects.getNext()->setRenderingDistance(distance);
+
+            Ogre::Node::ChildNodeIterator children = sceneNode->getChildIterator();
+            while(children.hasMoreElements()) setRenderingDistance(static_cast<Ogre::SceneNode*>(children.getNext()), distance);
+        }
+
+        rviz::BillboardLine* m_impostor;
+        bool m_isImpostor;
+        Ogre::ColourValue m_color;
+        double m_scalingFactor;
     };
 
 
@@ -135,15 +203,16 @@ namespace spencer_tracking_rviz_plugin {
             delete m_headShape;
         }
 
-        virtual void setColor(const Ogre::ColourValue& c) {
-            m_bodyShape->setColor(c);
-            m_headShape->setColor(c);
-        }
-
         virtual double getHeight() {
             return 1.75;
         }
 
+    protected:
+        virtual void setVisualColor(const Ogre::ColourValue& c) {
+            m_bodyShape->setColor(c);
+            m_headShape->setColor(c);
+        }
+
     private:
         rviz::Shape *m_bodyShape, *m_headShape;
     };
@@ -163,14 +232,14 @@ namespace spencer_tracking_rviz_plugin {
             delete m_wireframe;
         }
 
-        virtual void setColor(const Ogre::ColourValue& c) {
-            m_wireframe->setColor(c.r, c.g, c.b, c.a);
-        }
-
         virtual double getHeight() {
             return m_height;
         }
 
+        virtual double getWidth() {
+            return m_width;
+        }
+
         virtual void setLineWidth(double lineWidth) {
             m_wireframe->setLineWidth(lineWidth);
         }
@@ -185,6 +254,10 @@ namespace spencer_tracking_rviz_plugin {
         */
 
     protected:
+        virtual void setVisualColor(const Ogre::ColourValue& c) {
+            m_wireframe->setColor(c.r, c.g, c.b, c.a);
+        }
+
         virtual void generateWireframe() {
             delete m_wireframe;
             m_wireframe = new rviz::BillboardLine(m_sceneManager, m_sceneNode);
@@ -238,20 +311,24 @@ namespace spencer_tracking_rviz_plugin {
             delete m_crosshair;
         }
 
-        virtual void setColor(const Ogre::ColourValue& c) {
-            m_crosshair->setColor(c.r, c.g, c.b, c.a);
-        }
-
         virtual double getHeight() {
             return m_height;
         }
 
+        virtual double getWidth() {
+            return m_width;
+        }
+
         virtual void setLineWidth(double lineWidth) {
             m_crosshair->setLineWidth(lineWidth);
         }
 
 
     protected:
+        virtual void setVisualColor(const Ogre::ColourValue& c) {
+            m_crosshair->setColor(c.r, c.g, c.b, c.a);
+        }
+
         virtual void generateCrosshair() {
             delete m_crosshair;
             m_crosshair = new rviz::BillboardLine(m_sceneManager, m_sceneNode);
@@ -292,8 +369,6 @@ namespace spencer_tracking_rviz_plugin {
 
         virtual void update(float deltaTime);
 
-        virtual void setColor(const Ogre::ColourValue& c);
-
         void setAnimationState(const std::string& nameOfAnimationState);
 
         void setWalkingSpeed(float walkingSpeed);
@@ -306,6 +381,9 @@ namespace spencer_tracking_rviz_plugin {
             // Not supported (for some reason causes the mesh to be mirrored vertically).
         }
 
+    protected:
+        virtual void setVisualColor(const Ogre::ColourValue& c);
+
     private:
         Ogre::SceneNode *m_childSceneNode;
         Ogre::Entity* entity_;
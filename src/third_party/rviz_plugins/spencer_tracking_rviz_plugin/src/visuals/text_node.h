@@ -84,6 +84,11 @@ namespace spencer_tracking_rviz_plugin {
             m_text->showOnTop(onTop);
         }
 
+        /// Hide the text when the camera is further away than this, 0 shows it at any distance
+        void setRenderingDistance(double distance) {
+            m_text->setRenderingDistance(distance);
+        }
+
     private:
         Ogre::SceneManager* m_sceneManager;
         Ogre::SceneNode* m_sceneNode;